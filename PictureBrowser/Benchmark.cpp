@@ -0,0 +1,143 @@
+#include "PCH.hpp"
+#include "Benchmark.hpp"
+#include "DecodePipeline.hpp"
+#include "DirectoryScanner.hpp"
+#include "LogWrap.hpp"
+#include "ReadAhead.hpp"
+#include "SidecarIndex.hpp"
+
+namespace PictureBrowser
+{
+	struct BenchmarkRun
+	{
+		size_t DecodeThreads = 0;
+		size_t FinishThreads = 0;
+		double Seconds = 0.0;
+		size_t Failures = 0;
+		uint64_t Steals = 0;
+		std::string MetricsJson;
+	};
+
+	BenchmarkRun TimeRun(const std::vector<std::filesystem::path>& images, size_t threads, uint32_t width, uint32_t height)
+	{
+		BenchmarkRun run;
+		run.DecodeThreads = threads;
+		run.FinishThreads = std::max(threads / 2, size_t(1));
+
+		Metrics metrics;
+		ReadAhead readAhead(ReadAhead::DefaultBudget, metrics);
+		std::vector<std::future<std::shared_ptr<const Image>>> results;
+		results.reserve(images.size());
+
+		const auto start = std::chrono::steady_clock::now();
+
+		{
+			DecodePipeline pipeline(run.DecodeThreads, run.FinishThreads, metrics, nullptr, nullptr);
+
+			readAhead.Schedule(images);
+
+			for (const std::filesystem::path& image : images)
+			{
+				auto result = std::make_shared<DecodePipeline::Promise>();
+				results.emplace_back(result->get_future());
+
+				pipeline.Submit({ std::make_shared<ImageSource>(image, metrics, readAhead), width, height, nullptr, result }, Priority::Prefetch);
+			}
+
+			for (std::future<std::shared_ptr<const Image>>& result : results)
+			{
+				try
+				{
+					if (!result.get())
+					{
+						++run.Failures;
+					}
+				}
+				catch (const std::exception&)
+				{
+					++run.Failures;
+				}
+			}
+
+			run.Steals = pipeline.Statistics().Steals;
+		}
+
+		run.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		run.MetricsJson = metrics.ToJson({});
+		return run;
+	}
+
+	void RunDecodeBenchmark(
+		const std::filesystem::path& folder,
+		const std::filesystem::path& report,
+		uint32_t width,
+		uint32_t height)
+	{
+		SidecarIndex sidecars;
+		const FileModel files = ScanDirectory(folder, sidecars);
+
+		std::vector<std::filesystem::path> images;
+		images.reserve(files.Count());
+
+		for (size_t i = 0; i < files.Count(); ++i)
+		{
+			images.emplace_back(files.Path(i));
+		}
+
+		if (images.empty())
+		{
+			throw std::runtime_error("No images to decode!");
+		}
+
+		const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+		std::vector<size_t> threadCounts;
+
+		for (size_t threads = 1; threads < cores; threads *= 2)
+		{
+			threadCounts.emplace_back(threads);
+		}
+
+		threadCounts.emplace_back(cores);
+
+		TimeRun(images, cores, width, height);
+
+		std::string json = std::format(
+			"{{\n\t\"images\": {},\n\t\"width\": {},\n\t\"height\": {},\n\t\"runs\": [",
+			images.size(),
+			width,
+			height);
+
+		for (size_t i = 0; i < threadCounts.size(); ++i)
+		{
+			const BenchmarkRun run = TimeRun(images, threadCounts[i], width, height);
+
+			LOGD << L"Decoded " << uint64_t(images.size()) << L" images with " << uint64_t(run.DecodeThreads)
+				<< L" threads in " << uint64_t(run.Seconds * 1000.0) << L" ms";
+
+			json += std::format(
+				"{}\n\t\t{{\"decodeThreads\": {}, \"finishThreads\": {}, \"seconds\": {:.3f}, \"imagesPerSecond\": {:.1f}, "
+				"\"failures\": {}, \"steals\": {}, \"metrics\": {}}}",
+				i ? "," : "",
+				run.DecodeThreads,
+				run.FinishThreads,
+				run.Seconds,
+				run.Seconds > 0.0 ? double(images.size()) / run.Seconds : 0.0,
+				run.Failures,
+				run.Steals,
+				run.MetricsJson);
+		}
+
+		json += "\n\t]\n}\n";
+
+		std::filesystem::create_directories(report.parent_path());
+
+		std::ofstream file(report, std::ios::binary | std::ios::trunc);
+		file << json;
+
+		if (!file)
+		{
+			throw std::runtime_error("Failed to write the benchmark report!");
+		}
+	}
+}
\ No newline at end of file
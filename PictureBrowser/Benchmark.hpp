@@ -0,0 +1,14 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// Decodes every image in a folder through the decode pipeline at the given size, first with one decode thread,
+	// then with twice as many each run up to the number of cores, and writes the images per second of each run
+	// with its metrics to the report as JSON. Uses no window, no cache and no preview store.
+	// An untimed run first brings the files into the file cache, so that the runs compare the decoding.
+	void RunDecodeBenchmark(
+		const std::filesystem::path& folder,
+		const std::filesystem::path& report,
+		uint32_t width,
+		uint32_t height);
+}
\ No newline at end of file
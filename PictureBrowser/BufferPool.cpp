@@ -0,0 +1,162 @@
+#include "PCH.hpp"
+#include "BufferPool.hpp"
+
+namespace PictureBrowser
+{
+	constexpr size_t DefaultMaxIdleBytes = sizeof(void*) == 8 ? 512ull << 20 : 128ull << 20;
+
+	// Below this the classes are simply multiples of the alignment
+	constexpr size_t SmallBytes = 4096;
+
+	uint8_t* AllocateAligned(size_t bytes)
+	{
+		return static_cast<uint8_t*>(::operator new(bytes, std::align_val_t(BufferPool::Alignment)));
+	}
+
+	void FreeAligned(uint8_t* data)
+	{
+		::operator delete(data, std::align_val_t(BufferPool::Alignment));
+	}
+
+	BufferPool::Deleter::Deleter(std::shared_ptr<BufferPool> pool, size_t bytes) :
+		_pool(std::move(pool)),
+		_bytes(bytes)
+	{
+	}
+
+	void BufferPool::Deleter::operator()(uint8_t* data) const
+	{
+		if (_pool)
+		{
+			_pool->Release(data, _bytes);
+		}
+		else
+		{
+			FreeAligned(data);
+		}
+	}
+
+	BufferPool::BufferPool(size_t maxIdleBytes) :
+		_maxIdleBytes(maxIdleBytes)
+	{
+	}
+
+	BufferPool::~BufferPool()
+	{
+		Trim();
+	}
+
+	const std::shared_ptr<BufferPool>& BufferPool::Shared()
+	{
+		static const std::shared_ptr<BufferPool> shared = std::make_shared<BufferPool>(DefaultMaxIdleBytes);
+		return shared;
+	}
+
+	BufferPool::Buffer BufferPool::Allocate(size_t bytes)
+	{
+		const size_t size = SizeClass(bytes);
+		uint8_t* data = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			const auto iter = _idle.find(size);
+
+			if (iter != _idle.end() && !iter->second.empty())
+			{
+				data = iter->second.back();
+				iter->second.pop_back();
+				_stats.IdleBytes -= size;
+				++_stats.Hits;
+			}
+			else
+			{
+				++_stats.Misses;
+			}
+
+			_stats.InUseBytes += size;
+			_stats.HighWaterBytes = std::max(_stats.HighWaterBytes, _stats.InUseBytes);
+		}
+
+		if (!data)
+		{
+			try
+			{
+				data = AllocateAligned(size);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stats.InUseBytes -= size;
+				throw;
+			}
+		}
+
+		return Buffer(data, Deleter(shared_from_this(), size));
+	}
+
+	void BufferPool::Trim(size_t keepBytes)
+	{
+		std::vector<uint8_t*> freed;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			for (auto iter = _idle.begin(); iter != _idle.end() && _stats.IdleBytes > keepBytes;)
+			{
+				std::vector<uint8_t*>& buffers = iter->second;
+
+				while (!buffers.empty() && _stats.IdleBytes > keepBytes)
+				{
+					freed.push_back(buffers.back());
+					buffers.pop_back();
+					_stats.IdleBytes -= iter->first;
+				}
+
+				iter = buffers.empty() ? _idle.erase(iter) : std::next(iter);
+			}
+		}
+
+		// Outside of the lock, freeing hundreds of megabytes takes a while
+		for (uint8_t* data : freed)
+		{
+			FreeAligned(data);
+		}
+	}
+
+	BufferPool::Stats BufferPool::Statistics() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _stats;
+	}
+
+	size_t BufferPool::SizeClass(size_t bytes)
+	{
+		if (bytes <= SmallBytes)
+		{
+			return std::max(Alignment, (bytes + Alignment - 1) & ~(Alignment - 1));
+		}
+
+		// Eight classes per power of two
+		const size_t shift = static_cast<size_t>(std::bit_width(bytes - 1)) - 4;
+		return (((bytes - 1) >> shift) + 1) << shift;
+	}
+
+	void BufferPool::Release(uint8_t* data, size_t bytes)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			_stats.InUseBytes -= bytes;
+
+			if (_stats.IdleBytes + bytes <= _maxIdleBytes)
+			{
+				_idle[bytes].push_back(data);
+				_stats.IdleBytes += bytes;
+				return;
+			}
+		}
+
+		FreeAligned(data);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// Recycles 64 byte aligned pixel buffers, so that browsing same sized frames
+	// does not allocate and free hundreds of megabytes over and over again.
+	// Sizes are rounded up to classes at most 1/8 apart. Thread safe, and uses nothing but the standard library.
+	class BufferPool : public std::enable_shared_from_this<BufferPool>
+	{
+	public:
+		static constexpr size_t Alignment = 64;
+
+		class Deleter
+		{
+		public:
+			Deleter() = default;
+			Deleter(std::shared_ptr<BufferPool> pool, size_t bytes);
+
+			void operator()(uint8_t* data) const;
+
+		private:
+			std::shared_ptr<BufferPool> _pool;
+			size_t _bytes = 0;
+		};
+
+		using Buffer = std::unique_ptr<uint8_t[], Deleter>;
+
+		struct Stats
+		{
+			uint64_t Hits = 0;
+			uint64_t Misses = 0;
+			size_t InUseBytes = 0;
+			size_t HighWaterBytes = 0;
+			size_t IdleBytes = 0;
+		};
+
+		// At most maxIdleBytes are kept around for reuse, the rest is freed
+		explicit BufferPool(size_t maxIdleBytes);
+		~BufferPool();
+
+		BufferPool(const BufferPool&) = delete;
+		BufferPool& operator = (const BufferPool&) = delete;
+
+		// The one the images allocate from
+		static const std::shared_ptr<BufferPool>& Shared();
+
+		// The pool must be owned by a shared_ptr, the buffers keep it alive
+		Buffer Allocate(size_t bytes);
+
+		// Frees idle buffers until at most keepBytes of them are left
+		void Trim(size_t keepBytes = 0);
+
+		Stats Statistics() const;
+
+		static size_t SizeClass(size_t bytes);
+
+	private:
+		void Release(uint8_t* data, size_t bytes);
+
+		const size_t _maxIdleBytes;
+
+		mutable std::mutex _mutex;
+		std::unordered_map<size_t, std::vector<uint8_t*>> _idle;
+		Stats _stats;
+	};
+}
\ No newline at end of file
@@ -40,9 +40,10 @@ namespace PictureBrowser
 	class PaintGuard
 	{
 	public:
-		PaintGuard(const BaseWindow* widget, ID2D1HwndRenderTarget* target) :
+		PaintGuard(const BaseWindow* widget, ID2D1HwndRenderTarget* target, HRESULT& result) :
 			_widget(widget),
-			_target(target)
+			_target(target),
+			_result(result)
 #ifdef _DEBUG
 			, _start(std::chrono::high_resolution_clock::now())
 #endif
@@ -56,7 +57,7 @@ namespace PictureBrowser
 
 		~PaintGuard()
 		{
-			_target->EndDraw();
+			_result = _target->EndDraw();
 			_widget->EndPaint(Paint);
 #ifdef _DEBUG
 			const auto diff = std::chrono::high_resolution_clock::now() - _start;
@@ -67,6 +68,7 @@ namespace PictureBrowser
 	private:
 		const BaseWindow* _widget;
 		ID2D1HwndRenderTarget* _target;
+		HRESULT& _result;
 
 #ifdef _DEBUG
 		const std::chrono::high_resolution_clock::time_point _start;
@@ -98,24 +100,15 @@ namespace PictureBrowser
 			throw std::system_error(hr, std::system_category(), "D2D1CreateFactory");
 		}
 
-		RECT rect = GetClientRect();
-
-		D2D1_SIZE_U size = D2D1::SizeU(rect.right, rect.bottom);
-
-		auto rtp = D2D1::RenderTargetProperties();
-		auto hrtp = D2D1::HwndRenderTargetProperties(*this, size);
+		CreateRenderTarget();
+	}
 
-		hr = _factory->CreateHwndRenderTarget(rtp, hrtp, &_renderTarget);
-		
-		if (FAILED(hr))
+	CanvasWidget::~CanvasWidget()
+	{
+		if (_imageCache)
 		{
-			throw std::system_error(hr, std::system_category(),"ID2D1Factory::CreateHwndRenderTarget");
+			_imageCache->SetRenderTarget(nullptr);
 		}
-
-		// TODO: I really do not like this, but I could not come up with else
-		_imageCache->SetRenderTarget(_renderTarget.Get());
-
-		_renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::DarkGray), &_brush);
 	}
 
 	bool CanvasWidget::HandleMessage(UINT message, WPARAM wParam, LPARAM lParam)
@@ -175,12 +168,59 @@ namespace PictureBrowser
 		SIZE size = GetClientSize();
 
 		_renderTarget->Resize(D2D1::SizeU(size.cx, size.cy));
+		_imageCache->SetDisplaySize(static_cast<uint32_t>(size.cx), static_cast<uint32_t>(size.cy));
 	}
 
-	void CanvasWidget::OnPaint() const
+	void CanvasWidget::CreateRenderTarget()
 	{
-		PaintGuard paintGuard(this, _renderTarget.Get());
+		RECT rect = GetClientRect();
+
+		D2D1_SIZE_U size = D2D1::SizeU(rect.right, rect.bottom);
+
+		auto rtp = D2D1::RenderTargetProperties();
+		auto hrtp = D2D1::HwndRenderTargetProperties(*this, size);
+
+		_brush.Reset();
+		_renderTarget.Reset();
+
+		HRESULT hr = _factory->CreateHwndRenderTarget(rtp, hrtp, &_renderTarget);
 
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(),"ID2D1Factory::CreateHwndRenderTarget");
+		}
+
+		// TODO: I really do not like this, but I could not come up with else
+		_imageCache->SetRenderTarget(_renderTarget.Get());
+		_imageCache->SetDisplaySize(size.width, size.height);
+
+		_renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::DarkGray), &_brush);
+	}
+
+	void CanvasWidget::OnPaint()
+	{
+		HRESULT hr = S_OK;
+
+		{
+			PaintGuard paintGuard(this, _renderTarget.Get(), hr);
+			Draw();
+		}
+
+		if (SUCCEEDED(hr))
+		{
+			_imageCache->Painted();
+		}
+		else if (hr == D2DERR_RECREATE_TARGET)
+		{
+			// The decoded pixels live in the image cache, so this does not cause a decode
+			LOGD << L"Recreating the render target";
+			CreateRenderTarget();
+			Invalidate();
+		}
+	}
+
+	void CanvasWidget::Draw() const
+	{
 		ComPtr<ID2D1Bitmap> bitmap = _imageCache->Current();
 
 		_renderTarget->Clear(bitmap ? D2D1::ColorF(D2D1::ColorF::Gray) : D2D1::ColorF(D2D1::ColorF::Red));
@@ -205,6 +245,11 @@ namespace PictureBrowser
 			else
 			{
 				_renderTarget->DrawBitmap(bitmap.Get(), scaled);
+
+				for (const ImageCache::Tile& tile : _imageCache->Tiles(scaled, canvasSize))
+				{
+					_renderTarget->DrawBitmap(tile.Bitmap.Get(), tile.Destination);
+				}
 			}
 		}
 	}
@@ -222,13 +267,20 @@ namespace PictureBrowser
 
 	void CanvasWidget::OnImageChanged(const std::filesystem::path& path)
 	{
+		Invalidate();
+
+		// A better version of the same image keeps the zoom and the position
+		if (path == _imagePath)
+		{
+			return;
+		}
+
+		_imagePath = path;
 		_zoomPercent = 0.0f;
 
 		ZeroInit(_mouseDragStart);
 		ZeroInit(_mouseDragOffset);
 
-		Invalidate();
-
 		// TODO: I really do not like that the child sets the title
 		const std::wstring title = L"Picture Browser 2.2 - " + path.filename().wstring();
 		_parent->SetWindowTextW(title.c_str());
@@ -254,6 +306,9 @@ namespace PictureBrowser
 				break;
 		}
 
+		// See Zoom(), the percentage is added on each side
+		_imageCache->Magnify(1.0f + 2.0f * _zoomPercent / 100.0f);
+
 		LOGD << _zoomPercent;
 	}
 
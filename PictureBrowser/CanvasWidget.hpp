@@ -13,6 +13,7 @@ namespace PictureBrowser
 			HINSTANCE instance,
 			BaseWindow* parent,
 			const std::shared_ptr<ImageCache>& imageCache);
+		~CanvasWidget();
 
 		bool HandleMessage(UINT, WPARAM, LPARAM) override;
 
@@ -21,7 +22,9 @@ namespace PictureBrowser
 		void Resize();
 
 	private:
-		void OnPaint() const;
+		void CreateRenderTarget();
+		void OnPaint();
+		void Draw() const;
 		void Invalidate() const;
 		void OnZoom(WPARAM);
 
@@ -30,6 +33,7 @@ namespace PictureBrowser
 		bool UpdateMousePosition(LPARAM);
 		void OnLeftMouseUp(LPARAM);
 
+		std::filesystem::path _imagePath;
 		float _zoomPercent = 0.0f;
 		bool _isDragging = false;
 		D2D_POINT_2F _mouseDragStart = { 0.0f, 0.0f };
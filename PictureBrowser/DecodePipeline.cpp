@@ -0,0 +1,330 @@
+#include "PCH.hpp"
+#include "DecodePipeline.hpp"
+#include "Decoder.hpp"
+#include "ImageProbe.hpp"
+#include "LogWrap.hpp"
+#include "Orientation.hpp"
+#include "WicDecoder.hpp"
+
+namespace PictureBrowser
+{
+	// Decoded images each finisher may have waiting, before the decoders hold off
+	constexpr size_t FinishQueueDepth = 2;
+
+	// Each decode worker lives in the multithreaded apartment and has decoders of its own
+	thread_local Decoders WorkerDecoders;
+
+	void WorkerStart()
+	{
+		HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+		if (FAILED(hr))
+		{
+			LOGD << L"CoInitializeEx failed!";
+			return;
+		}
+
+		try
+		{
+			WorkerDecoders.Add(std::make_unique<WicDecoder>());
+		}
+		catch (const std::system_error&)
+		{
+			LOGD << L"Failed to create a WIC decoder for a worker!";
+		}
+	}
+
+	void WorkerStop()
+	{
+		// Must be released before the apartment goes away
+		WorkerDecoders.Clear();
+		CoUninitialize();
+	}
+
+	// TODO: instead of immediate throw, maybe display the error as an image
+	// Runs on a decode worker
+	DecodedImage DecodeSource(ImageSource& source, uint32_t maxWidth, uint32_t maxHeight, Metrics& metrics)
+	{
+		// Decoded in place, without the bytes being copied into a stream of the decoder
+		std::span<const uint8_t> data = source.Data();
+		const std::optional<ImageInfo>& info = source.Info();
+
+		// The read and the probe have timers of their own
+		const auto start = std::chrono::steady_clock::now();
+		ImageFormat format = info ? info->Format : ImageFormat::Other;
+		const bool raw = IsPreviewedRawFile(source.Path());
+
+		if (raw)
+		{
+			// Few RAW files decode at all without a codec pack, and slowly,
+			// so these are shown by the largest JPEG the camera rendered into them
+			if (!info || !info->PreviewBytes)
+			{
+				throw std::runtime_error("No preview in the RAW file!");
+			}
+
+			data = data.subspan(static_cast<size_t>(info->PreviewOffset), info->PreviewBytes);
+			format = ImageFormat::Jpeg;
+		}
+
+		DecodedImage decoded = WorkerDecoders.For(format).Decode(
+			data,
+			maxWidth,
+			maxHeight,
+			info ? std::optional<uint16_t>(info->Orientation) : std::nullopt);
+
+		if (raw)
+		{
+			decoded.Format = ImageFormat::Raw;
+		}
+
+		metrics.RecordDecode(decoded.Format, std::chrono::steady_clock::now() - start);
+		return decoded;
+	}
+
+	// Runs on a decode worker. The largest preview the camera put in the file, no pixels if there is none.
+	// Decoded straight out of the file the decode reads as well, which is a matter of milliseconds.
+	DecodedImage DecodeEmbedded(ImageSource& source, uint32_t maxWidth, uint32_t maxHeight)
+	{
+		const std::optional<ImageInfo>& info = source.Info();
+
+		if (!info || (!info->PreviewBytes && !info->ThumbnailBytes))
+		{
+			return {};
+		}
+
+		uint64_t offset = info->PreviewBytes ? info->PreviewOffset : info->ThumbnailOffset;
+		uint32_t bytes = info->PreviewBytes ? info->PreviewBytes : info->ThumbnailBytes;
+
+		if (IsPreviewedRawFile(source.Path()))
+		{
+			// The decode itself takes the largest preview, only a smaller one is any quicker
+			if (!info->ThumbnailBytes || info->ThumbnailOffset == info->PreviewOffset)
+			{
+				return {};
+			}
+
+			offset = info->ThumbnailOffset;
+			bytes = info->ThumbnailBytes;
+		}
+
+		// Stored the same way as the image itself, whatever the headers of the preview say
+		return WorkerDecoders.For(ImageFormat::Jpeg).Decode(
+			source.Data().subspan(static_cast<size_t>(offset), bytes),
+			maxWidth,
+			maxHeight,
+			info->Orientation);
+	}
+
+	// Way faster than IWICBitmapFlipRotator, which transposes one pixel at a time
+	std::shared_ptr<Image> Upright(std::shared_ptr<Image>&& pixels, uint16_t orientation)
+	{
+		if (orientation > 1 && orientation <= 8)
+		{
+			return Oriented(*pixels, orientation);
+		}
+
+		return std::move(pixels);
+	}
+
+	DecodePipeline::DecodePipeline(
+		size_t decodeThreads,
+		size_t finishThreads,
+		Metrics& metrics,
+		PreviewStore* previewStore,
+		const std::function<void()>& finished) :
+		_metrics(metrics),
+		_previewStore(previewStore),
+		_finished(finished),
+		_finishers(std::make_unique<ThreadPool>(
+			std::max(finishThreads, size_t(1)),
+			nullptr,
+			nullptr,
+			std::max(finishThreads, size_t(1)) * FinishQueueDepth)),
+		_decoders(std::make_unique<ThreadPool>(std::max(decodeThreads, size_t(1)), WorkerStart, WorkerStop))
+	{
+	}
+
+	DecodePipeline::~DecodePipeline()
+	{
+		// The decoders first, so that none of them is left waiting for room in the finishing queue.
+		// Either pool drops the jobs it has not started yet, which breaks their promises.
+		_decoders.reset();
+		_finishers.reset();
+	}
+
+	void DecodePipeline::Submit(Job&& job, Priority priority)
+	{
+		_decoders->Submit([this, job = std::move(job), priority]() mutable
+		{
+			Decode(job, priority);
+		}, priority);
+	}
+
+	void DecodePipeline::SubmitEmbedded(Job&& job)
+	{
+		// Small enough that handing it over to the finishers would only add to its latency
+		_decoders->Submit([this, job = std::move(job)]()
+		{
+			std::shared_ptr<const Image> preview;
+
+			if (!job.Wanted || job.Wanted())
+			{
+				try
+				{
+					DecodedImage decoded = DecodeEmbedded(*job.Source, job.MaxWidth, job.MaxHeight);
+
+					if (decoded.Pixels)
+					{
+						preview = Upright(std::move(decoded.Pixels), decoded.Orientation);
+					}
+				}
+				catch (const std::exception&)
+				{
+					LOGD << L"No embedded preview in " << job.Source->Path();
+				}
+			}
+
+			job.Result->set_value(preview);
+
+			if (preview)
+			{
+				Finished();
+			}
+		}, Priority::Visible);
+	}
+
+	void DecodePipeline::Post(std::function<void()>&& work, Priority priority, std::stop_token cancel)
+	{
+		_decoders->Submit(std::move(work), priority, std::move(cancel));
+	}
+
+	size_t DecodePipeline::Pending() const
+	{
+		return _decoders->Pending() + _finishers->Pending();
+	}
+
+	ThreadPool::Stats DecodePipeline::Statistics() const
+	{
+		ThreadPool::Stats stats = _decoders->Statistics();
+		const ThreadPool::Stats finishing = _finishers->Statistics();
+
+		for (size_t i = 0; i < stats.Queued.size(); ++i)
+		{
+			stats.Queued[i] += finishing.Queued[i];
+		}
+
+		stats.HighWaterQueued += finishing.HighWaterQueued;
+		stats.Steals += finishing.Steals;
+		stats.Cancelled += finishing.Cancelled;
+		return stats;
+	}
+
+	void DecodePipeline::Decode(Job& job, Priority priority)
+	{
+		if (job.Wanted && !job.Wanted())
+		{
+			_metrics.Add(Metrics::Counter::Dropped);
+			job.Result->set_value(nullptr);
+			Finished();
+			return;
+		}
+
+		_metrics.Add(Metrics::Counter::Decodes);
+
+		try
+		{
+			uint32_t maxWidth = job.MaxWidth;
+			uint32_t maxHeight = job.MaxHeight;
+
+			if (_previewStore && job.DisplaySize && maxWidth && maxHeight)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				std::shared_ptr<const Image> preview = _previewStore->Find(job.Source->Path());
+
+				// Never opens the file
+				if (preview)
+				{
+					_metrics.Add(Metrics::Counter::PreviewHits);
+					_metrics.Record(Metrics::Timer::PreviewLoad, std::chrono::steady_clock::now() - start);
+					job.Result->set_value(preview);
+					Finished();
+					return;
+				}
+
+				_metrics.Add(Metrics::Counter::PreviewMisses);
+
+				// Big enough to be stored as a preview as well
+				maxWidth = std::max(maxWidth, _previewStore->MaxWidth());
+				maxHeight = std::max(maxHeight, _previewStore->MaxHeight());
+			}
+
+			DecodedImage decoded = DecodeSource(*job.Source, maxWidth, maxHeight, _metrics);
+
+			// Waits while the finishers are behind
+			_finishers->Submit([this, job, pixels = std::move(decoded.Pixels), orientation = decoded.Orientation]() mutable
+			{
+				Finish(job, std::move(pixels), orientation);
+			}, priority);
+		}
+		catch (...)
+		{
+			_metrics.Add(Metrics::Counter::DecodeFailures);
+			job.Result->set_exception(std::current_exception());
+			Finished();
+		}
+	}
+
+	void DecodePipeline::Finish(Job& job, std::shared_ptr<Image>&& pixels, uint16_t orientation)
+	{
+		try
+		{
+			auto start = std::chrono::steady_clock::now();
+			const std::shared_ptr<const Image> image = Upright(std::move(pixels), orientation);
+			_metrics.Record(Metrics::Timer::Orient, std::chrono::steady_clock::now() - start);
+
+			if (_previewStore && job.DisplaySize)
+			{
+				start = std::chrono::steady_clock::now();
+
+				try
+				{
+					const uint32_t previewWidth = _previewStore->MaxWidth();
+					const uint32_t previewHeight = _previewStore->MaxHeight();
+
+					if (image->Width() <= previewWidth && image->Height() <= previewHeight)
+					{
+						_previewStore->Insert(job.Source->Path(), *image);
+					}
+					else
+					{
+						_previewStore->Insert(job.Source->Path(), *Downscale(*image, previewWidth, previewHeight));
+					}
+				}
+				catch (const std::exception&)
+				{
+					LOGD << L"Failed to store a preview of " << job.Source->Path();
+				}
+
+				_metrics.Record(Metrics::Timer::StorePreview, std::chrono::steady_clock::now() - start);
+			}
+
+			job.Result->set_value(image);
+		}
+		catch (...)
+		{
+			_metrics.Add(Metrics::Counter::DecodeFailures);
+			job.Result->set_exception(std::current_exception());
+		}
+
+		Finished();
+	}
+
+	void DecodePipeline::Finished()
+	{
+		if (_finished)
+		{
+			_finished();
+		}
+	}
+}
\ No newline at end of file
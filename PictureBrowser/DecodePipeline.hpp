@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Image.hpp"
+#include "ImageSource.hpp"
+#include "Metrics.hpp"
+#include "PreviewStore.hpp"
+#include "ThreadPool.hpp"
+
+namespace PictureBrowser
+{
+	// Turns image files into upright pixels in stages, each with workers of its own:
+	// - Decode reads the bytes and decodes them, the backend converts and scales the pixels on the way
+	// - Finish turns the pixels upright and stores a preview of them
+	// Uploading is the last stage, which the owner of the render target does on its own thread.
+	// The finishing queue is bounded, so that the decoders wait for it instead of piling up pixels.
+	// Each stage records its own timer, the decodes by format.
+	class DecodePipeline
+	{
+	public:
+		using Promise = std::promise<std::shared_ptr<const Image>>;
+
+		struct Job
+		{
+			std::shared_ptr<ImageSource> Source;
+
+			// Zero for the full size
+			uint32_t MaxWidth = 0;
+			uint32_t MaxHeight = 0;
+
+			// Asked right before the decode starts, an unwanted job yields nullptr
+			std::function<bool()> Wanted;
+
+			std::shared_ptr<Promise> Result;
+
+			// Looked up in the preview store and stored in it, a full resolution decode is neither
+			bool DisplaySize = true;
+		};
+
+		// The callback runs on a worker thread whenever a result is set.
+		// Display sized decodes are looked up in the preview store and stored in it, if there is one.
+		DecodePipeline(
+			size_t decodeThreads,
+			size_t finishThreads,
+			Metrics& metrics,
+			PreviewStore* previewStore,
+			const std::function<void()>& finished);
+
+		// Waits for the jobs which are running, the queued ones are dropped and their promises broken.
+		// Nothing may block on the results of a pipeline which is going away.
+		~DecodePipeline();
+
+		DecodePipeline(const DecodePipeline&) = delete;
+		DecodePipeline& operator = (const DecodePipeline&) = delete;
+
+		// The finishing stage keeps the priority of the decode
+		void Submit(Job&& job, Priority priority);
+
+		// The largest preview embedded in the file, decoded and turned upright in one go in front of everything else.
+		// Yields nullptr if there is none, and calls back only if there is.
+		void SubmitEmbedded(Job&& job);
+
+		// Other work for the decode workers
+		void Post(std::function<void()>&& work, Priority priority, std::stop_token cancel = {});
+
+		// Queued in either stage
+		size_t Pending() const;
+
+		// Of both stages together
+		ThreadPool::Stats Statistics() const;
+
+	private:
+		void Decode(Job& job, Priority priority);
+		void Finish(Job& job, std::shared_ptr<Image>&& pixels, uint16_t orientation);
+		void Finished();
+
+		Metrics& _metrics;
+		PreviewStore* const _previewStore;
+		const std::function<void()> _finished;
+
+		std::unique_ptr<ThreadPool> _finishers;
+		std::unique_ptr<ThreadPool> _decoders;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "PCH.hpp"
+#include "Decoder.hpp"
+
+namespace PictureBrowser
+{
+	void Decoders::Add(std::unique_ptr<Decoder>&& decoder)
+	{
+		_decoders.emplace_back(std::move(decoder));
+	}
+
+	void Decoders::Clear()
+	{
+		_decoders.clear();
+	}
+
+	Decoder& Decoders::For(ImageFormat format) const
+	{
+		for (const std::unique_ptr<Decoder>& decoder : _decoders)
+		{
+			if (decoder->Supports(format))
+			{
+				return *decoder;
+			}
+		}
+
+		throw std::runtime_error("No decoder for the format!");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Image.hpp"
+#include "Metrics.hpp"
+
+namespace PictureBrowser
+{
+	struct DecodedImage
+	{
+		// As stored, the source size being the size of the whole frame. The pipeline turns them upright.
+		std::shared_ptr<Image> Pixels;
+
+		// What the backend found the bytes to be
+		ImageFormat Format = ImageFormat::Other;
+
+		// EXIF orientation, 1 is upright
+		uint16_t Orientation = 1;
+	};
+
+	// Turns encoded bytes into pixels which belong to no device, in the most compact format which fits them.
+	// An instance is only ever used by the thread which created it.
+	class Decoder
+	{
+	public:
+		virtual ~Decoder() = default;
+
+		virtual std::wstring_view Name() const = 0;
+
+		// ImageFormat::Other stands for anything the probe did not recognize
+		virtual bool Supports(ImageFormat format) const = 0;
+
+		// Scales the first frame down to fit maxWidth x maxHeight, unless either is zero.
+		// Without a known orientation, the backend asks the metadata if it can. Throws on failure.
+		virtual DecodedImage Decode(
+			std::span<const uint8_t> data,
+			uint32_t maxWidth,
+			uint32_t maxHeight,
+			std::optional<uint16_t> orientation) = 0;
+	};
+
+	// The backends of one thread in order of preference, the first one which supports a format decodes it
+	class Decoders
+	{
+	public:
+		void Add(std::unique_ptr<Decoder>&& decoder);
+		void Clear();
+
+		// Throws if no backend supports the format
+		Decoder& For(ImageFormat format) const;
+
+	private:
+		std::vector<std::unique_ptr<Decoder>> _decoders;
+	};
+}
\ No newline at end of file
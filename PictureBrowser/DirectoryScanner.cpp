@@ -0,0 +1,317 @@
+#include "PCH.hpp"
+#include "DirectoryScanner.hpp"
+#include "FileNames.hpp"
+#include "ImageProbe.hpp"
+#include "LogWrap.hpp"
+
+namespace PictureBrowser
+{
+	constexpr std::wstring_view ListedImageExtensions[] =
+	{
+		L".jpg", L".jpeg", L".png"
+	};
+
+	// A batch goes out when it is full, or when the enumeration has been this slow since the last one
+	constexpr std::chrono::milliseconds BatchLatency(100);
+
+	bool IsListedImage(std::wstring_view extension)
+	{
+		return HasExtension(extension, ListedImageExtensions);
+	}
+
+	FileModel::FileModel(const std::filesystem::path& directory) :
+		_directory(directory)
+	{
+	}
+
+	const std::filesystem::path& FileModel::Directory() const
+	{
+		return _directory;
+	}
+
+	size_t FileModel::Count() const
+	{
+		return _entries.size();
+	}
+
+	bool FileModel::Empty() const
+	{
+		return _entries.empty();
+	}
+
+	std::wstring_view FileModel::Name(size_t index) const
+	{
+		return index < _entries.size() ? Name(_entries[index]) : std::wstring_view();
+	}
+
+	std::filesystem::path FileModel::Path(size_t index) const
+	{
+		return index < _entries.size() ? _directory / Name(_entries[index]) : std::filesystem::path();
+	}
+
+	std::optional<size_t> FileModel::Find(std::wstring_view name) const
+	{
+		const auto sorted = _entries.cbegin() + static_cast<ptrdiff_t>(_sorted);
+
+		const auto iter = std::lower_bound(_entries.cbegin(), sorted, name, [this](const Entry& entry, std::wstring_view other)
+		{
+			return LessIgnoringCase(Name(entry), other);
+		});
+
+		if (iter == sorted || LessIgnoringCase(name, Name(*iter)))
+		{
+			return std::nullopt;
+		}
+
+		return static_cast<size_t>(std::distance(_entries.cbegin(), iter));
+	}
+
+	void FileModel::Add(std::wstring_view name)
+	{
+		if (_names.size() + name.size() > UINT32_MAX)
+		{
+			throw std::length_error("FileModel::Add");
+		}
+
+		_entries.push_back({ static_cast<uint32_t>(_names.size()), static_cast<uint32_t>(name.size()) });
+		_names.append(name);
+	}
+
+	void FileModel::Erase(size_t index)
+	{
+		// The name stays in the buffer until the next scan
+		if (index < _entries.size())
+		{
+			_entries.erase(_entries.begin() + static_cast<ptrdiff_t>(index));
+			_sorted -= index < _sorted ? 1 : 0;
+		}
+	}
+
+	void FileModel::Sort()
+	{
+		const auto less = [this](const Entry& a, const Entry& b)
+		{
+			return LessIgnoringCase(Name(a), Name(b));
+		};
+
+		const auto sorted = _entries.begin() + static_cast<ptrdiff_t>(_sorted);
+
+		std::sort(sorted, _entries.end(), less);
+		std::inplace_merge(_entries.begin(), sorted, _entries.end(), less);
+		_sorted = _entries.size();
+	}
+
+	std::wstring_view FileModel::Name(const Entry& entry) const
+	{
+		return std::wstring_view(_names).substr(entry.Offset, entry.Length);
+	}
+
+	void AddEntries(std::span<const std::wstring> filenames, FileModel& model, SidecarIndex& sidecars)
+	{
+		// All of the stems first, so that a RAW file sees the JPG of the same batch
+		for (const std::wstring& filename : filenames)
+		{
+			sidecars.Add(filename);
+		}
+
+		// Then out with the RAW files of earlier batches which a new JPG shadows, while the model is still sorted
+		for (const std::wstring& filename : filenames)
+		{
+			if (!IsListedImage(FileExtension(filename)))
+			{
+				continue;
+			}
+
+			for (const std::wstring& other : sidecars.Group(filename))
+			{
+				const std::optional<size_t> listed = IsPreviewedRawExtension(FileExtension(other)) ? model.Find(other) : std::nullopt;
+
+				if (listed)
+				{
+					model.Erase(*listed);
+				}
+			}
+		}
+
+		for (const std::wstring& filename : filenames)
+		{
+			const std::wstring_view extension = FileExtension(filename);
+			const std::optional<size_t> listed = model.Find(filename);
+
+			if (listed && model.Name(*listed) == filename)
+			{
+				continue;
+			}
+
+			if (IsListedImage(extension))
+			{
+				model.Add(filename);
+				continue;
+			}
+
+			if (!IsPreviewedRawExtension(extension))
+			{
+				continue;
+			}
+
+			// A RAW file next to a JPG or PNG of the same shot adds nothing but a slower duplicate
+			const std::span<const std::wstring> shot = sidecars.Group(filename);
+
+			const bool shadowed = std::any_of(shot.begin(), shot.end(), [](const std::wstring& other)
+			{
+				return IsListedImage(FileExtension(other));
+			});
+
+			if (!shadowed)
+			{
+				model.Add(filename);
+			}
+		}
+
+		model.Sort();
+	}
+
+	void RemoveEntry(const std::wstring& filename, FileModel& model, SidecarIndex& sidecars)
+	{
+		std::vector<std::wstring> raws;
+
+		if (IsListedImage(FileExtension(filename)))
+		{
+			for (const std::wstring& other : sidecars.Group(filename))
+			{
+				if (IsPreviewedRawExtension(FileExtension(other)))
+				{
+					raws.push_back(other);
+				}
+			}
+		}
+
+		sidecars.Remove(model.Directory() / filename);
+
+		const std::optional<size_t> listed = model.Find(filename);
+
+		if (listed && model.Name(*listed) == filename)
+		{
+			model.Erase(*listed);
+		}
+
+		if (!raws.empty())
+		{
+			AddEntries(raws, model, sidecars);
+		}
+	}
+
+	FileModel ScanDirectory(const std::filesystem::path& directory, SidecarIndex& sidecars)
+	{
+		FileModel model(directory);
+		sidecars.Reset(directory);
+
+		std::vector<std::wstring> filenames;
+		std::error_code error;
+
+		for (auto it = std::filesystem::directory_iterator(directory, error);
+			!error && it != std::filesystem::directory_iterator();
+			it.increment(error))
+		{
+			// Cached by the enumeration on Windows, no extra call per file
+			std::error_code typeError;
+
+			if (it->is_regular_file(typeError))
+			{
+				filenames.push_back(it->path().filename().wstring());
+			}
+		}
+
+		if (error)
+		{
+			LOGD << L"Failed to enumerate " << directory;
+		}
+
+		AddEntries(filenames, model, sidecars);
+		return model;
+	}
+
+	DirectoryScan::DirectoryScan(const std::filesystem::path& directory, const std::function<void()>& batchReady, size_t batchSize) :
+		_directory(directory),
+		_batchReady(batchReady),
+		_batchSize(std::max(batchSize, size_t(1))),
+		_thread([this](std::stop_token stopToken) { Scan(stopToken); })
+	{
+	}
+
+	DirectoryScan::~DirectoryScan()
+	{
+		_thread.request_stop();
+	}
+
+	const std::filesystem::path& DirectoryScan::Directory() const
+	{
+		return _directory;
+	}
+
+	DirectoryScan::Batch DirectoryScan::Take()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return std::exchange(_found, Batch());
+	}
+
+	void DirectoryScan::Scan(std::stop_token stopToken)
+	{
+		std::vector<std::wstring> filenames;
+		auto delivered = std::chrono::steady_clock::now();
+		std::error_code error;
+
+		for (auto it = std::filesystem::directory_iterator(_directory, error);
+			!error && it != std::filesystem::directory_iterator() && !stopToken.stop_requested();
+			it.increment(error))
+		{
+			std::error_code typeError;
+
+			if (it->is_regular_file(typeError))
+			{
+				filenames.push_back(it->path().filename().wstring());
+			}
+
+			if (filenames.size() >= _batchSize || (!filenames.empty() && std::chrono::steady_clock::now() - delivered >= BatchLatency))
+			{
+				Deliver(filenames, false);
+				delivered = std::chrono::steady_clock::now();
+			}
+		}
+
+		if (error)
+		{
+			LOGD << L"Failed to enumerate " << _directory;
+		}
+
+		if (!stopToken.stop_requested())
+		{
+			Deliver(filenames, true);
+		}
+	}
+
+	void DirectoryScan::Deliver(std::vector<std::wstring>& filenames, bool done)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if (_found.Filenames.empty())
+			{
+				_found.Filenames = std::move(filenames);
+			}
+			else
+			{
+				std::move(filenames.begin(), filenames.end(), std::back_inserter(_found.Filenames));
+			}
+
+			_found.Done = done;
+		}
+
+		filenames.clear();
+
+		if (_batchReady)
+		{
+			_batchReady();
+		}
+	}
+}
\ No newline at end of file
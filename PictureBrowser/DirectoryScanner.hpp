@@ -0,0 +1,97 @@
+#pragma once
+
+#include "SidecarIndex.hpp"
+
+namespace PictureBrowser
+{
+	// The images of one directory in display order, all of the names in a single buffer.
+	// A list of a hundred thousand files costs a few megabytes, and no window stores any of it.
+	class FileModel
+	{
+	public:
+		FileModel() = default;
+		explicit FileModel(const std::filesystem::path& directory);
+
+		const std::filesystem::path& Directory() const;
+		size_t Count() const;
+		bool Empty() const;
+
+		std::wstring_view Name(size_t index) const;
+		std::filesystem::path Path(size_t index) const;
+
+		// Case insensitive, the index of the name or nullopt
+		std::optional<size_t> Find(std::wstring_view name) const;
+
+		void Add(std::wstring_view name);
+		void Erase(size_t index);
+
+		// Case insensitive by name, Find() relies on it. Only what was added since the last sort needs sorting,
+		// it is then merged into the rest. Find() does not see the entries added since.
+		void Sort();
+
+	private:
+		struct Entry
+		{
+			uint32_t Offset;
+			uint32_t Length;
+		};
+
+		std::wstring_view Name(const Entry& entry) const;
+
+		std::filesystem::path _directory;
+		std::wstring _names;
+		std::vector<Entry> _entries;
+		size_t _sorted = 0;
+	};
+
+	// Sorts filenames found in the directory of the model: the JPG, PNG and previewed RAW files go into the model,
+	// the companions of every image into the sidecar index. RAW files which have a JPG or PNG of the same name are
+	// left out, whichever of them comes first. Names already in the model are skipped.
+	void AddEntries(std::span<const std::wstring> filenames, FileModel& model, SidecarIndex& sidecars);
+
+	// The reverse of AddEntries(), the RAW files a removed JPG or PNG kept off the model come back
+	void RemoveEntry(const std::wstring& filename, FileModel& model, SidecarIndex& sidecars);
+
+	// Enumerates the directory once, as a single batch of AddEntries().
+	// Only the standard library, so that it runs and can be measured on any platform.
+	FileModel ScanDirectory(const std::filesystem::path& directory, SidecarIndex& sidecars);
+
+	// Enumerates a directory on a thread of its own and hands the filenames over in batches, so that a slow
+	// network share or card reader holds up nothing but the list. The callback runs on the scan thread whenever
+	// a batch is ready, Take() is for the owner's thread. Stops and joins when destroyed.
+	class DirectoryScan
+	{
+	public:
+		struct Batch
+		{
+			std::vector<std::wstring> Filenames;
+
+			// Nothing more is coming
+			bool Done = false;
+		};
+
+		DirectoryScan(const std::filesystem::path& directory, const std::function<void()>& batchReady, size_t batchSize = 1024);
+		~DirectoryScan();
+
+		DirectoryScan(const DirectoryScan&) = delete;
+		DirectoryScan& operator=(const DirectoryScan&) = delete;
+
+		const std::filesystem::path& Directory() const;
+
+		// The filenames found since the last call
+		Batch Take();
+
+	private:
+		void Scan(std::stop_token stopToken);
+		void Deliver(std::vector<std::wstring>& filenames, bool done);
+
+		const std::filesystem::path _directory;
+		const std::function<void()> _batchReady;
+		const size_t _batchSize;
+
+		std::mutex _mutex;
+		Batch _found;
+
+		std::jthread _thread;
+	};
+}
\ No newline at end of file
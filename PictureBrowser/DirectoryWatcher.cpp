@@ -0,0 +1,178 @@
+#include "PCH.hpp"
+#include "DirectoryWatcher.hpp"
+#include "LogWrap.hpp"
+
+namespace PictureBrowser
+{
+	// Plenty for a camera writing a frame a second, the system keeps changes in it between the reads
+	constexpr DWORD ChangeBufferBytes = 64 * 1024;
+
+	constexpr DWORD WatchedChanges = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+	std::optional<DirectoryChange::Kind> ChangeKind(DWORD action)
+	{
+		switch (action)
+		{
+			case FILE_ACTION_ADDED:
+			case FILE_ACTION_RENAMED_NEW_NAME:
+				return DirectoryChange::Kind::Added;
+			case FILE_ACTION_REMOVED:
+			case FILE_ACTION_RENAMED_OLD_NAME:
+				return DirectoryChange::Kind::Removed;
+			case FILE_ACTION_MODIFIED:
+				return DirectoryChange::Kind::Modified;
+		}
+
+		return std::nullopt;
+	}
+
+	DirectoryWatcher::DirectoryWatcher(const std::filesystem::path& directory, const std::function<void()>& changed) :
+		_changed(changed),
+		_directory(CreateFileW(
+			directory.c_str(),
+			FILE_LIST_DIRECTORY,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+			nullptr)),
+		_stop(CreateEventW(nullptr, TRUE, FALSE, nullptr))
+	{
+		if (_directory == INVALID_HANDLE_VALUE || !_stop)
+		{
+			LOGD << L"Cannot watch " << directory;
+			return;
+		}
+
+		_thread = std::thread(&DirectoryWatcher::Watch, this);
+	}
+
+	DirectoryWatcher::~DirectoryWatcher()
+	{
+		if (_thread.joinable())
+		{
+			SetEvent(_stop);
+			_thread.join();
+		}
+
+		if (_directory != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(_directory);
+		}
+
+		if (_stop)
+		{
+			CloseHandle(_stop);
+		}
+	}
+
+	bool DirectoryWatcher::Watching() const
+	{
+		return _thread.joinable();
+	}
+
+	DirectoryWatcher::Changes DirectoryWatcher::Take()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return std::exchange(_found, Changes());
+	}
+
+	void DirectoryWatcher::Watch()
+	{
+		// FILE_NOTIFY_INFORMATION is DWORD aligned
+		std::vector<DWORD> buffer(ChangeBufferBytes / sizeof(DWORD));
+
+		OVERLAPPED overlapped;
+		ZeroInit(overlapped);
+		overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+		if (!overlapped.hEvent)
+		{
+			LOGD << L"CreateEventW failed";
+			return;
+		}
+
+		const HANDLE events[] = { overlapped.hEvent, _stop };
+
+		while (true)
+		{
+			ResetEvent(overlapped.hEvent);
+
+			if (!ReadDirectoryChangesW(
+				_directory,
+				buffer.data(),
+				ChangeBufferBytes,
+				FALSE,
+				WatchedChanges,
+				nullptr,
+				&overlapped,
+				nullptr))
+			{
+				LOGD << L"ReadDirectoryChangesW failed";
+				break;
+			}
+
+			DWORD bytes = 0;
+
+			if (WaitForMultipleObjects(DWORD(std::size(events)), events, FALSE, INFINITE) != WAIT_OBJECT_0)
+			{
+				CancelIoEx(_directory, &overlapped);
+				GetOverlappedResult(_directory, &overlapped, &bytes, TRUE);
+				break;
+			}
+
+			if (!GetOverlappedResult(_directory, &overlapped, &bytes, FALSE))
+			{
+				const DWORD error = GetLastError();
+
+				if (error != ERROR_NOTIFY_ENUM_DIR)
+				{
+					// Such as the directory itself going away
+					LOGD << L"Watching stopped, error " << error;
+					break;
+				}
+
+				bytes = 0;
+			}
+
+			std::vector<DirectoryChange> changes;
+
+			// Nothing in the buffer means it overflowed
+			for (DWORD offset = 0; bytes;)
+			{
+				const auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(reinterpret_cast<const uint8_t*>(buffer.data()) + offset);
+				const std::optional<DirectoryChange::Kind> kind = ChangeKind(info->Action);
+
+				if (kind)
+				{
+					changes.push_back({ *kind, std::wstring(info->FileName, info->FileNameLength / sizeof(wchar_t)) });
+				}
+
+				if (!info->NextEntryOffset)
+				{
+					break;
+				}
+
+				offset += info->NextEntryOffset;
+			}
+
+			Deliver(changes, !bytes);
+		}
+
+		CloseHandle(overlapped.hEvent);
+	}
+
+	void DirectoryWatcher::Deliver(std::vector<DirectoryChange>& changes, bool overflowed)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			std::move(changes.begin(), changes.end(), std::back_inserter(_found.Changes));
+			_found.Overflowed = _found.Overflowed || overflowed;
+		}
+
+		if (_changed)
+		{
+			_changed();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	struct DirectoryChange
+	{
+		enum class Kind
+		{
+			Added,
+			Removed,
+			// Written to, such as a frame a tethered camera is still writing
+			Modified
+		};
+
+		Kind What;
+
+		// A name in the watched directory, not a path
+		std::wstring Filename;
+	};
+
+	// Watches a single directory for files coming, going and changing, on a thread of its own.
+	// A rename is a removal of the old name and an addition of the new one. The callback runs on the watch thread
+	// whenever there are changes, Take() is for the owner's thread. Stops and joins when destroyed.
+	class DirectoryWatcher
+	{
+	public:
+		struct Changes
+		{
+			std::vector<DirectoryChange> Changes;
+
+			// More changed than could be told apart, only a rescan brings the listing up to date
+			bool Overflowed = false;
+		};
+
+		// Watches nothing if the directory cannot be watched, such as on some network shares
+		DirectoryWatcher(const std::filesystem::path& directory, const std::function<void()>& changed);
+		~DirectoryWatcher();
+
+		DirectoryWatcher(const DirectoryWatcher&) = delete;
+		DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+		bool Watching() const;
+
+		// The changes since the last call, in the order they happened
+		Changes Take();
+
+	private:
+		void Watch();
+		void Deliver(std::vector<DirectoryChange>& changes, bool overflowed);
+
+		const std::function<void()> _changed;
+
+		HANDLE _directory = INVALID_HANDLE_VALUE;
+		HANDLE _stop = nullptr;
+
+		std::mutex _mutex;
+		Changes _found;
+
+		std::thread _thread;
+	};
+}
\ No newline at end of file
@@ -1,36 +1,22 @@
 #include "PCH.hpp"
 #include "FileListWidget.hpp"
+#include "ImageProbe.hpp"
 #include "LogWrap.hpp"
 #include "Resource.h"
 
 namespace PictureBrowser
 {
-	// Source: https://en.wikipedia.org/wiki/Raw_image_format
-	// TODO: move these under a registry key. 
-	// This way the whole binary does not have to be rebuilt each time this list is updated
-	constexpr std::wstring_view RawFileExtensions[] =
-	{
-		L".3FR",
-		L".ARI", L".ARW",
-		L".BAY",
-		L".BRAW", L".CRW", L".CR2", L".CR3",
-		L".CAP",
-		L".DATA", L".DCS", L".DCR", L".DNG",
-		L".DRF",
-		L".EIP", L".ERF",
-		L".FFF",
-		L".GPR",
-		L".IIQ",
-		L".K25", L".KDC",
-		L".MDC", L".MEF", L".MOS", L".MRW",
-		L".NEF", L".NRW",
-		L".OBM", L".ORF",
-		L".PEF", L".PTX", L".PXN",
-		L".R3D", L".RAF", L".RAW", L".RWL", L".RW2", L".RWZ",
-		L".SR2", L".SRF", L".SRW",
-		L".TIF",
-		L".X3F"
-	};
+	constexpr UINT WM_IMAGE_DECODED = WM_APP + 1;
+	constexpr UINT WM_DIRECTORY_SCANNED = WM_APP + 2;
+	constexpr UINT WM_DIRECTORY_CHANGED = WM_APP + 3;
+
+	// How long a write may take to be reported by the watcher
+	constexpr std::chrono::seconds ChangeLatency(2);
+
+	// The selected file is reloaded once it has not been written to for this long.
+	// Well clear of the timers the list box runs on its own.
+	constexpr UINT_PTR ReloadTimer = 0x1000;
+	constexpr UINT ReloadDelay = 500;
 
 	class ItemIdList
 	{
@@ -108,12 +94,14 @@ namespace PictureBrowser
 		BaseWindow* parent,
 		const std::shared_ptr<ImageCache>& imageCache,
 		const std::function<void(std::filesystem::path)>& imageChanged,
-		bool promptRawFileRemove) :
+		bool promptRawFileRemove,
+		size_t prefetchDepth) :
 		Widget(
 			0,
 			WC_LISTBOX,
 			ClassName(FileListWidget),
-			WS_VISIBLE | WS_CHILD | WS_BORDER | WS_VSCROLL | LBS_NOTIFY | LBS_HASSTRINGS,
+			// The rows are drawn from the file model, the list box stores nothing but their count
+			WS_VISIBLE | WS_CHILD | WS_BORDER | WS_VSCROLL | LBS_NOTIFY | LBS_NODATA | LBS_OWNERDRAWFIXED,
 			5,
 			5,
 			250,
@@ -124,9 +112,21 @@ namespace PictureBrowser
 			nullptr),
 		_imageCache(imageCache),
 		_imageChanged(imageChanged),
-		_promptRawFileRemove(promptRawFileRemove)
+		_promptRawFileRemove(promptRawFileRemove),
+		_prefetchScheduler(prefetchDepth)
 	{
 		Listen();
+
+		// WM_MEASUREITEM comes before the parent is intercepted
+		SendMessageW(LB_SETITEMHEIGHT, 0, MAKELPARAM(RowHeight(), 0));
+
+		// The worker must not touch this widget, which might be gone by the time a decode finishes
+		const HWND window = *this;
+
+		_imageCache->SetDecodedCallback([window]()
+		{
+			::PostMessageW(window, WM_IMAGE_DECODED, 0, 0);
+		});
 	}
 
 	bool FileListWidget::HandleMessage(UINT message, WPARAM wParam, LPARAM lParam)
@@ -186,6 +186,36 @@ namespace PictureBrowser
 			case WM_DROPFILES:
 				OnFileDrop(wParam);
 				break;
+			case WM_IMAGE_DECODED:
+				OnPictureDecoded();
+				return true;
+			case WM_DIRECTORY_SCANNED:
+				OnDirectoryScanned();
+				return true;
+			case WM_DIRECTORY_CHANGED:
+				OnDirectoryChanged();
+				return true;
+			case WM_TIMER:
+			{
+				if (wParam == ReloadTimer)
+				{
+					KillTimer(*this, ReloadTimer);
+					OnSelectedFileWritten();
+					return true;
+				}
+				break;
+			}
+			case WM_DRAWITEM:
+			{
+				const auto item = reinterpret_cast<const DRAWITEMSTRUCT*>(lParam);
+
+				if (item->hwndItem == *this)
+				{
+					OnDrawItem(*item);
+					return true;
+				}
+				break;
+			}
 		}
 
 		return Widget::HandleMessage(message, wParam, lParam);
@@ -194,32 +224,33 @@ namespace PictureBrowser
 	void FileListWidget::Open(const std::filesystem::path& path)
 	{
 		_imageCache->Clear();
+		_imageCache->Opened();
 
-		switch (LoadFileList(path))
+		// A file is decoded at once, while the rest of its directory is still being listed.
+		// A folder shows its first image with the first batch.
+		if (LoadFileList(path) == std::filesystem::file_type::regular)
 		{
-			case std::filesystem::file_type::regular:
-			{
-				LoadPicture(path);
-				break;
-			}
-			case std::filesystem::file_type::directory:
-			{
-				OnSelectionChanged();
-				break;
-			}
+			LoadPicture(_imageCache->Paths().Intern(path));
 		}
 	}
 
 	void FileListWidget::Clear()
 	{
-		_currentDirectory.clear();
+		KillTimer(*this, ReloadTimer);
+		_watcher.reset();
+		_scan.reset();
+		_removedWhileScanning.clear();
+		_addedWhileScanning.clear();
+		_rescanning = false;
+		_files = FileModel();
+		_sidecars.Clear();
 		_imageCache->Clear();
 	}
 
 	std::filesystem::path FileListWidget::SelectedImage() const
 	{
 		LONG_PTR current = CurrentSelection();
-		return _currentDirectory / ImageFromIndex(current);
+		return _files.Path(size_t(current));
 	}
 
 	LONG_PTR FileListWidget::CurrentSelection() const
@@ -244,19 +275,23 @@ namespace PictureBrowser
 
 	void FileListWidget::OnSelectionChanged(LONG_PTR cursel)
 	{
+		// Whatever was waiting to be reloaded is no longer on the screen
+		KillTimer(*this, ReloadTimer);
+		_reloading = NoPath;
+
 		if (cursel < 0)
 		{
 			cursel = CurrentSelection();
 		}
 
-		const std::filesystem::path path = _currentDirectory / ImageFromIndex(cursel);
+		const PathId id = ImageFromIndex(cursel);
 
-		if (path.empty())
+		if (id == NoPath)
 		{
 			return;
 		}
 
-		LoadPicture(path);
+		LoadPicture(id);
 	}
 
 	void FileListWidget::OnOpenMenu()
@@ -266,13 +301,35 @@ namespace PictureBrowser
 
 		std::wstring filePath(0x1000, '\0');
 
+		// Follows the RAW extensions the probe knows, the dialog matches them regardless of case
+		std::wstring rawPatterns;
+
+		for (const std::wstring_view extension : PreviewedRawExtensions)
+		{
+			rawPatterns += rawPatterns.empty() ? L"*" : L";*";
+			rawPatterns += extension;
+		}
+
+		// Pairs of a description and its patterns, each ending in a null, the list in another one
+		std::wstring filter;
+
+		const auto addFilter = [&](std::wstring_view description, std::wstring_view patterns)
+		{
+			filter.append(description).push_back(L'\0');
+			filter.append(patterns).push_back(L'\0');
+		};
+
+		addFilter(L"All supported images", L"*.jpg;*.jpeg;*.png;" + rawPatterns);
+		addFilter(L"Joint Photographic Experts Group (*.jpg, *.jpeg)", L"*.jpg;*.jpeg");
+		addFilter(L"Portable Network Graphics (*.png)", L"*.png");
+		addFilter(L"Camera RAW", rawPatterns);
+		filter.push_back(L'\0');
+
 		openFile.lStructSize = sizeof(OPENFILENAMEW);
 		openFile.hwndOwner = *_parent;
 		openFile.lpstrFile = filePath.data();
 		openFile.nMaxFile = static_cast<DWORD>(filePath.size());
-		openFile.lpstrFilter =
-			L"Joint Photographic Experts Group (*.jpg|*.jpeg)\0*.jpg;*.jpeg\0"
-			L"Portable Network Graphics(*.png)\0 * .png\0";
+		openFile.lpstrFilter = filter.c_str();
 		openFile.nFilterIndex = 1;
 		openFile.lpstrFileTitle = nullptr;
 		openFile.nMaxFileTitle = 0;
@@ -318,17 +375,13 @@ namespace PictureBrowser
 
 		ScreenToClient(p);
 
-		LRESULT result = SendMessageW(LB_ITEMFROMPOINT,	0, MAKELPARAM(p.x, p.y));
+		// LB_ITEMFROMPOINT only has a WORD for the index, too little for a large directory
+		const RECT client = GetClientRect();
+		const LONG_PTR top = SendMessageW(LB_GETTOPINDEX, 0, 0);
+		const LONG_PTR height = SendMessageW(LB_GETITEMHEIGHT, 0, 0);
+		const LONG_PTR index = height > 0 ? top + p.y / height : LB_ERR;
 
-		if (result < 0)
-		{
-			LOGD << L"LB_ITEMFROMPOINT failed";
-			return;
-		}
-
-		WORD index = LOWORD(result);
-
-		if (HIWORD(result))
+		if (!PtInRect(&client, p) || index < 0 || size_t(index) >= _files.Count())
 		{
 			LOGD << L"The click is outside client area " << p;
 			return;
@@ -349,15 +402,13 @@ namespace PictureBrowser
 
 	void FileListWidget::OnOpenPath() const
 	{
-		std::wstring filename = ImageFromIndex(_contextMenuIndex);
+		const std::filesystem::path path = _files.Path(size_t(_contextMenuIndex));
 
-		if (filename.empty())
+		if (path.empty())
 		{
 			return;
 		}
 
-		const std::filesystem::path path = _currentDirectory / filename;
-
 		ItemIdList list(path);
 
 		HRESULT hr = SHOpenFolderAndSelectItems(list, 0, nullptr, 0);
@@ -370,7 +421,7 @@ namespace PictureBrowser
 
 	void FileListWidget::OnCopyPath() const
 	{
-		std::wstring filename = ImageFromIndex(_contextMenuIndex);
+		const std::wstring filename(_files.Name(size_t(_contextMenuIndex)));
 
 		if (filename.empty())
 		{
@@ -387,63 +438,66 @@ namespace PictureBrowser
 		CloseClipboard();
 	}
 
-	void FileListWidget::OnDeletePath() const
+	void FileListWidget::OnDeletePath()
 	{
-		std::wstring filename = ImageFromIndex(_contextMenuIndex);
+		const std::filesystem::path path = _files.Path(size_t(_contextMenuIndex));
 
-		if (filename.empty())
+		if (path.empty())
 		{
 			return;
 		}
 
-		std::filesystem::path path = _currentDirectory / filename;
-		auto it = std::cbegin(RawFileExtensions);
+		std::vector<std::filesystem::path> targets = { path };
+
+		if (_promptRawFileRemove)
+		{
+			// The RAW files and sidecars of the same shot, looked up without touching the disk
+			const std::vector<std::filesystem::path> companions = _sidecars.Companions(path);
+			targets.insert(targets.end(), companions.cbegin(), companions.cend());
+		}
 
-		do
+		for (const std::filesystem::path& target : targets)
 		{
+			const std::wstring filename = target.filename();
 			std::wstring message = L"Are you sure you want to delete: " + filename;
 
 			if (_parent->MessageBoxW(
 				message.c_str(),
 				L"Confirm Delete",
-				MB_ICONQUESTION | MB_YESNO) == IDYES)
+				MB_ICONQUESTION | MB_YESNO) != IDYES)
 			{
-				if (_imageCache->RemoveFile(path))
-				{
-					SendMessageW(LB_DELETESTRING, _contextMenuIndex, 0);
-				}
-				else
-				{
-					message = L"Failed to delete: " + filename;
-
-					_parent->MessageBoxW(
-						message.c_str(),
-						L"An error occurred!",
-						MB_ICONEXCLAMATION | MB_OK);
-				}
+				continue;
 			}
 
-			while (it != std::cend(RawFileExtensions))
+			if (!_imageCache->RemoveFile(target))
 			{
-				const std::wstring_view extension = *it++;
+				message = L"Failed to delete: " + filename;
 
-				if (std::filesystem::exists(path.replace_extension(extension)))
-				{
-					filename = path.filename();
-					break;
-				}
+				_parent->MessageBoxW(
+					message.c_str(),
+					L"An error occurred!",
+					MB_ICONEXCLAMATION | MB_OK);
+
+				continue;
 			}
 
-		} while (_promptRawFileRemove && it != std::cend(RawFileExtensions));
+			_sidecars.Remove(target);
+
+			// Most companions are not on the list
+			const std::optional<size_t> listed = _files.Find(filename);
+
+			if (listed)
+			{
+				SendMessageW(LB_DELETESTRING, *listed, 0);
+				_files.Erase(*listed);
+			}
+		}
 	}
 
 	std::filesystem::file_type FileListWidget::LoadFileList(const std::filesystem::path& path)
 	{
-		std::wstring jpgFilter = L"\\*.jpg";
-		std::wstring jpegFilter = L"\\*.jpeg";
-		std::wstring pngFilter = L"\\*.png";
-
 		const std::filesystem::file_type status = std::filesystem::status(path).type();
+		std::filesystem::path directory;
 
 		switch (status)
 		{
@@ -465,28 +519,23 @@ namespace PictureBrowser
 			{
 				if (_wcsicmp(path.extension().c_str(), L".jpg") != 0 &&
 					_wcsicmp(path.extension().c_str(), L".jpeg") != 0 &&
-					_wcsicmp(path.extension().c_str(), L".png") != 0)
+					_wcsicmp(path.extension().c_str(), L".png") != 0 &&
+					!IsPreviewedRawFile(path))
 				{
 					_parent->MessageBoxW(
-						L"Only JPG and PNG are supported!",
+						L"Only JPG, PNG and camera RAW files are supported!",
 						L"Unsupported file format!",
 						MB_OK | MB_ICONINFORMATION);
 
 					return std::filesystem::file_type::none;
 				}
 
-				jpgFilter.insert(0, path.parent_path().wstring());
-				jpegFilter.insert(0, path.parent_path().wstring());
-				pngFilter.insert(0, path.parent_path().wstring());
-				_currentDirectory = path.parent_path();
+				directory = path.parent_path();
 				break;
 			}
 			case std::filesystem::file_type::directory:
 			{
-				jpgFilter.insert(0, path.wstring());
-				jpegFilter.insert(0, path.wstring());
-				pngFilter.insert(0, path.wstring());
-				_currentDirectory = path;
+				directory = path;
 				break;
 			}
 			default:
@@ -503,60 +552,296 @@ namespace PictureBrowser
 			}
 		}
 
-		if (SendMessageW(LB_RESETCONTENT, 0, 0) != 0) // This message does not return a value.
+		KillTimer(*this, ReloadTimer);
+		_watcher.reset();
+		_scan.reset();
+		_removedWhileScanning.clear();
+		_addedWhileScanning.clear();
+		_rescanning = false;
+		_files = FileModel(directory);
+		_sidecars.Reset(directory);
+
+		if (status == std::filesystem::file_type::regular)
+		{
+			const std::wstring filename = path.filename().wstring();
+			AddEntries(std::span<const std::wstring>(&filename, 1), _files, _sidecars);
+		}
+
+		if (SendMessageW(LB_SETCOUNT, _files.Count(), 0) == LB_ERRSPACE)
 		{
 			throw std::runtime_error("SendMessageW failed!");
 		}
 
-		if (!SendMessageW(LB_DIR, DDL_READWRITE, reinterpret_cast<LPARAM>(jpgFilter.c_str())))
+		if (!_files.Empty() && SendMessageW(LB_SETCURSEL, 0, 0) == LB_ERR)
 		{
-			LOGD << L"Failed to send JPG filter update!";
+			throw std::runtime_error("SendMessageW failed!");
 		}
 
-		if (!SendMessageW(LB_DIR, DDL_READWRITE, reinterpret_cast<LPARAM>(jpegFilter.c_str())))
+		// A single pass for the list and the sidecars, streamed in from a thread of its own.
+		// Watched from before the scan starts, so that no change falls in between.
+		const HWND window = *this;
+
+		_watcher = std::make_unique<DirectoryWatcher>(directory, [window]()
 		{
-			LOGD << L"Failed to send JPEG filter update!";
+			::PostMessageW(window, WM_DIRECTORY_CHANGED, 0, 0);
+		});
+
+		_inSyncSince = std::filesystem::file_time_type::clock::now();
+
+		_scan = std::make_unique<DirectoryScan>(directory, [window]()
+		{
+			::PostMessageW(window, WM_DIRECTORY_SCANNED, 0, 0);
+		});
+
+		return status;
+	}
+
+	void FileListWidget::OnDirectoryScanned()
+	{
+		if (!_scan)
+		{
+			// A batch of a scan which is gone
+			return;
 		}
 
-		if (!SendMessageW(LB_DIR, DDL_READWRITE, reinterpret_cast<LPARAM>(pngFilter.c_str())))
+		DirectoryScan::Batch batch = _scan->Take();
+		const bool selected = SendMessageW(LB_GETCURSEL, 0, 0) != LB_ERR;
+
+		// The scan may have listed a file just before it went away
+		std::erase_if(batch.Filenames, [this](const std::wstring& filename)
 		{
-			LOGD << L"Failed to send PNG filter update!";
+			return _removedWhileScanning.contains(PathTable::Key(filename));
+		});
+
+		if (_rescanning)
+		{
+			AddEntries(batch.Filenames, _rescanned, _rescannedSidecars);
+
+			if (batch.Done)
+			{
+				FinishRescan();
+			}
+
+			return;
 		}
 
-		const LONG_PTR count = SendMessageW(LB_GETCOUNT, 0, 0);
+		UpdateList([&]()
+		{
+			AddEntries(batch.Filenames, _files, _sidecars);
+		});
+
+		if (!selected && !_files.Empty())
+		{
+			// The first image of a folder
+			SendMessageW(LB_SETCURSEL, 0, 0);
+			OnSelectionChanged(0);
+		}
 
-		if (!count)
+		if (!batch.Done)
+		{
+			return;
+		}
+
+		const std::filesystem::path directory = _scan->Directory();
+		_scan.reset();
+		_removedWhileScanning.clear();
+		_imageCache->Listed();
+
+		if (_files.Empty())
 		{
 			const std::wstring message =
-				L"The path you have entered does not appear to have JPG or PNG files!\n" + path.wstring();
+				L"The path you have entered does not appear to have JPG, PNG or RAW files!\n" + directory.wstring();
 
 			_parent->MessageBoxW(
 				message.c_str(),
 				L"Empty directory!",
 				MB_OK | MB_ICONINFORMATION);
+		}
+	}
 
-			return std::filesystem::file_type::none;
+	void FileListWidget::OnDirectoryChanged()
+	{
+		if (!_watcher)
+		{
+			return;
 		}
 
-		if (status == std::filesystem::file_type::regular)
+		DirectoryWatcher::Changes changes = _watcher->Take();
+
+		if (changes.Overflowed)
+		{
+			// Too much at once to tell apart, such as a whole card copied in
+			Rescan();
+			return;
+		}
+
+		_inSyncSince = std::filesystem::file_time_type::clock::now();
+
+		const LONG_PTR selection = SendMessageW(LB_GETCURSEL, 0, 0);
+		const std::wstring selected(selection >= 0 ? _files.Name(size_t(selection)) : std::wstring_view());
+		bool reload = false;
+
+		UpdateList([&]()
+		{
+			for (const DirectoryChange& change : changes.Changes)
+			{
+				// Only the files which changed lose their pixels
+				_imageCache->Invalidate(_files.Directory() / change.Filename);
+
+				switch (change.What)
+				{
+					case DirectoryChange::Kind::Added:
+						AddEntries(std::span<const std::wstring>(&change.Filename, 1), _files, _sidecars);
+
+						if (_scan)
+						{
+							_removedWhileScanning.erase(PathTable::Key(change.Filename));
+						}
+
+						if (_rescanning)
+						{
+							_addedWhileScanning.push_back(change.Filename);
+						}
+						break;
+					case DirectoryChange::Kind::Removed:
+						RemoveEntry(change.Filename, _files, _sidecars);
+
+						if (_scan)
+						{
+							_removedWhileScanning.insert(PathTable::Key(change.Filename));
+						}
+
+						std::erase(_addedWhileScanning, change.Filename);
+						break;
+					case DirectoryChange::Kind::Modified:
+						break;
+				}
+
+				reload = reload || (change.What != DirectoryChange::Kind::Removed && change.Filename == selected);
+			}
+		});
+
+		// Such as the frame a tethered camera is still writing, every write restarts the wait
+		if (reload)
+		{
+			SetTimer(*this, ReloadTimer, ReloadDelay, nullptr);
+		}
+	}
+
+	void FileListWidget::OnSelectedFileWritten()
+	{
+		const LONG_PTR cursel = SendMessageW(LB_GETCURSEL, 0, 0);
+		const PathId id = cursel < 0 ? NoPath : ImageFromIndex(cursel);
+
+		if (id == NoPath)
 		{
-			const std::wstring filename = path.filename();
+			return;
+		}
+
+		_reloading = id;
+		LoadPicture(id);
+	}
+
+	void FileListWidget::Rescan()
+	{
+		LOGD << L"Rescanning " << _files.Directory();
+
+		if (!_rescanning)
+		{
+			// The earliest of overflows in a row
+			_staleSince = _inSyncSince - ChangeLatency;
+		}
+
+		// Listed in the background like when opened, the list stays as it is until the rescan is complete
+		_rescanning = true;
+		_rescanned = FileModel(_files.Directory());
+		_rescannedSidecars.Reset(_files.Directory());
+		_removedWhileScanning.clear();
+		_addedWhileScanning.clear();
+
+		const HWND window = *this;
+
+		_scan = std::make_unique<DirectoryScan>(_files.Directory(), [window]()
+		{
+			::PostMessageW(window, WM_DIRECTORY_SCANNED, 0, 0);
+		});
+	}
 
-			if (SendMessageW(LB_SELECTSTRING, 0, reinterpret_cast<LPARAM>(filename.c_str())) == LB_ERR)
+	void FileListWidget::FinishRescan()
+	{
+		_scan.reset();
+		_rescanning = false;
+
+		AddEntries(_addedWhileScanning, _rescanned, _rescannedSidecars);
+
+		// Listed by a batch before they went away
+		std::vector<std::wstring> removed;
+
+		for (size_t i = 0; i < _rescanned.Count(); ++i)
+		{
+			if (_removedWhileScanning.contains(PathTable::Key(_rescanned.Name(i))))
 			{
-				LOGD << L"Failed to send message LB_SELECTSTRING!";
+				removed.emplace_back(_rescanned.Name(i));
 			}
 		}
-		else if (SendMessageW(LB_SETCURSEL, 0, 0) == LB_ERR)
+
+		for (const std::wstring& filename : removed)
+		{
+			RemoveEntry(filename, _rescanned, _rescannedSidecars);
+		}
+
+		UpdateList([this]()
+		{
+			_files = std::move(_rescanned);
+			_sidecars = std::move(_rescannedSidecars);
+		});
+
+		_rescanned = FileModel();
+		_rescannedSidecars.Clear();
+		_removedWhileScanning.clear();
+		_addedWhileScanning.clear();
+
+		// The decoded images stay, unless their files were written to while nobody was telling
+		_imageCache->InvalidateWrittenSince(_staleSince);
+
+		if (SendMessageW(LB_GETCURSEL, 0, 0) == LB_ERR && !_files.Empty())
+		{
+			// The overflow came before the first batch of the folder
+			SendMessageW(LB_SETCURSEL, 0, 0);
+			OnSelectionChanged(0);
+		}
+	}
+
+	void FileListWidget::UpdateList(const std::function<void()>& update)
+	{
+		// The rows move as names come and go, the selection and the scroll position follow their names
+		const LONG_PTR selection = SendMessageW(LB_GETCURSEL, 0, 0);
+		const std::wstring selected(selection >= 0 ? _files.Name(size_t(selection)) : std::wstring_view());
+		const std::wstring top(_files.Name(size_t(std::max(SendMessageW(LB_GETTOPINDEX, 0, 0), LRESULT(0)))));
+
+		update();
+
+		if (SendMessageW(LB_SETCOUNT, _files.Count(), 0) == LB_ERRSPACE)
 		{
 			throw std::runtime_error("SendMessageW failed!");
 		}
 
-		return status;
+		if (const std::optional<size_t> index = top.empty() ? std::nullopt : _files.Find(top))
+		{
+			SendMessageW(LB_SETTOPINDEX, *index, 0);
+		}
+
+		if (!selected.empty())
+		{
+			const std::optional<size_t> index = _files.Find(selected);
+			SendMessageW(LB_SETCURSEL, index ? WPARAM(*index) : WPARAM(-1), 0);
+		}
 	}
 
-	void FileListWidget::LoadPicture(const std::filesystem::path& path)
+	void FileListWidget::LoadPicture(PathId id)
 	{
+		const std::filesystem::path& path = _imageCache->Paths().Path(id);
+
 		if (!std::filesystem::is_regular_file(path))
 		{
 			const std::wstring message =
@@ -570,41 +855,144 @@ namespace PictureBrowser
 			return;
 		}
 
-		if (!_imageCache->SetCurrent(path))
+		switch (_imageCache->Request(id))
 		{
-			const std::wstring message =
-				L"Failed to load:\n" + path.wstring();
+			case ImageCache::State::Preview:
+				OnPicturePreviewed(path);
+				break;
+			case ImageCache::State::Ready:
+				OnPictureLoaded(path);
+				break;
+			case ImageCache::State::Failed:
+				OnPictureFailed(path);
+				break;
+		}
+	}
 
-			_parent->MessageBoxW(
-				message.c_str(),
-				L"FUBAR",
-				MB_OK | MB_ICONINFORMATION);
+	void FileListWidget::OnPictureDecoded()
+	{
+		const std::filesystem::path path = _imageCache->Requested();
 
-			return;
+		switch (_imageCache->Complete())
+		{
+			case ImageCache::State::Preview:
+				OnPicturePreviewed(_imageCache->CurrentPath());
+				break;
+			case ImageCache::State::Ready:
+				OnPictureLoaded(_imageCache->CurrentPath());
+				break;
+			case ImageCache::State::Failed:
+				OnPictureFailed(path);
+				break;
 		}
+	}
 
+	void FileListWidget::OnPicturePreviewed(const std::filesystem::path& path)
+	{
+		// The neighbors wait for the real thing
 		if (_imageChanged)
 		{
 			_imageChanged(path);
 		}
 	}
 
-	std::filesystem::path FileListWidget::ImageFromIndex(LONG_PTR index) const
+	void FileListWidget::OnPictureLoaded(const std::filesystem::path& path)
 	{
-		LRESULT result = SendMessageW(LB_GETTEXTLEN, index, 0);
+		if (_imageChanged)
+		{
+			_imageChanged(path);
+		}
 
-		if (result <= 0)
+		PrefetchNeighbors();
+	}
+
+	void FileListWidget::OnPictureFailed(const std::filesystem::path& path)
+	{
+		if (_reloading != NoPath && path == _imageCache->Paths().Path(_reloading))
 		{
-			return L"";
+			// Most likely still being written, the next write brings another reload
+			LOGD << L"Failed to reload: " << path;
+			return;
 		}
 
-		std::wstring buffer(static_cast<size_t>(result), '\0');
+		const std::wstring message =
+			L"Failed to load:\n" + path.wstring();
 
-		if (SendMessageW(LB_GETTEXT, index, reinterpret_cast<LPARAM>(buffer.data())) != result)
+		_parent->MessageBoxW(
+			message.c_str(),
+			L"FUBAR",
+			MB_OK | MB_ICONINFORMATION);
+	}
+
+	void FileListWidget::PrefetchNeighbors()
+	{
+		const LONG_PTR count = SendMessageW(LB_GETCOUNT, 0, 0);
+		const LONG_PTR cursel = SendMessageW(LB_GETCURSEL, 0, 0);
+
+		if (count <= 0 || cursel < 0)
 		{
-			throw std::runtime_error("SendMessageW failed!");
+			return;
 		}
 
-		return buffer;
+		std::vector<PathId> neighbors;
+
+		for (size_t index : _prefetchScheduler.Neighbors(size_t(cursel), size_t(count)))
+		{
+			neighbors.push_back(ImageFromIndex(LONG_PTR(index)));
+		}
+
+		_imageCache->Prefetch(neighbors);
+	}
+
+	PathId FileListWidget::ImageFromIndex(LONG_PTR index)
+	{
+		if (index < 0 || size_t(index) >= _files.Count())
+		{
+			return NoPath;
+		}
+
+		// Interned when first needed, a large directory is mostly never looked at
+		return _imageCache->Paths().Intern(_files.Path(size_t(index)));
+	}
+
+	UINT FileListWidget::RowHeight() const
+	{
+		const HDC context = GetDC(*this);
+		const HGDIOBJ font = SelectObject(context, reinterpret_cast<HFONT>(SendMessageW(WM_GETFONT, 0, 0)));
+
+		TEXTMETRICW metrics;
+		ZeroInit(metrics);
+		GetTextMetricsW(context, &metrics);
+
+		SelectObject(context, font);
+		ReleaseDC(*this, context);
+
+		return static_cast<UINT>(std::max(metrics.tmHeight, LONG(1)) + 2);
+	}
+
+	void FileListWidget::OnDrawItem(const DRAWITEMSTRUCT& item) const
+	{
+		if (item.itemID == UINT(-1))
+		{
+			// An empty list with the focus
+			return;
+		}
+
+		const bool selected = item.itemState & ODS_SELECTED;
+
+		FillRect(item.hDC, &item.rcItem, GetSysColorBrush(selected ? COLOR_HIGHLIGHT : COLOR_WINDOW));
+		SetBkMode(item.hDC, TRANSPARENT);
+		SetTextColor(item.hDC, GetSysColor(selected ? COLOR_HIGHLIGHTTEXT : COLOR_WINDOWTEXT));
+
+		const std::wstring_view name = _files.Name(item.itemID);
+		RECT text = item.rcItem;
+		text.left += 2;
+
+		DrawTextW(item.hDC, name.data(), static_cast<int>(name.size()), &text, DT_SINGLELINE | DT_VCENTER | DT_NOPREFIX | DT_END_ELLIPSIS);
+
+		if (item.itemState & ODS_FOCUS)
+		{
+			DrawFocusRect(item.hDC, &item.rcItem);
+		}
 	}
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "DirectoryScanner.hpp"
+#include "DirectoryWatcher.hpp"
 #include "ImageCache.hpp"
+#include "PrefetchScheduler.hpp"
 #include "Widget.hpp"
 
 namespace PictureBrowser
@@ -14,7 +17,8 @@ namespace PictureBrowser
 			BaseWindow* parent,
 			const std::shared_ptr<ImageCache>& imageCache,
 			const std::function<void(std::filesystem::path)>& imageChanged,
-			bool promptRawFileRemove);
+			bool promptRawFileRemove,
+			size_t prefetchDepth);
 
 		bool HandleMessage(UINT, WPARAM, LPARAM) override;
 
@@ -32,16 +36,57 @@ namespace PictureBrowser
 		void OnContextMenu(LPARAM);
 		void OnOpenPath() const;
 		void OnCopyPath() const;
-		void OnDeletePath() const;
+		void OnDeletePath();
 
 		std::filesystem::file_type LoadFileList(const std::filesystem::path&);
-		void LoadPicture(const std::filesystem::path& path);
-		std::filesystem::path ImageFromIndex(LONG_PTR index) const;
+		void OnDirectoryScanned();
+		void OnDirectoryChanged();
+		void Rescan();
+		void FinishRescan();
+		void OnSelectedFileWritten();
+		void UpdateList(const std::function<void()>& update);
+		void LoadPicture(PathId id);
+		void OnPictureDecoded();
+		void OnPicturePreviewed(const std::filesystem::path& path);
+		void OnPictureLoaded(const std::filesystem::path& path);
+		void OnPictureFailed(const std::filesystem::path& path);
+		void PrefetchNeighbors();
+		PathId ImageFromIndex(LONG_PTR index);
+		UINT RowHeight() const;
+		void OnDrawItem(const DRAWITEMSTRUCT& item) const;
 
 		std::shared_ptr<ImageCache> _imageCache;
-		std::filesystem::path _currentDirectory;
+
+		// The list items, in the same order
+		FileModel _files;
+		SidecarIndex _sidecars;
+
+		// Streams the rest of the directory into the list, until it is done
+		std::unique_ptr<DirectoryScan> _scan;
+
+		// Removed while the scan was under way, its batches may still list them.
+		// Keyed like PathTable, a later addition takes the name off again.
+		std::unordered_set<std::wstring> _removedWhileScanning;
+
+		// After the watcher overflowed, the scan builds a listing of its own which replaces the list once complete.
+		// What the watcher adds in the meantime goes into both.
+		bool _rescanning = false;
+		FileModel _rescanned;
+		SidecarIndex _rescannedSidecars;
+		std::vector<std::wstring> _addedWhileScanning;
+
+		// The watcher reported everything up to then, files written since an overflow may have changed unnoticed
+		std::filesystem::file_time_type _inSyncSince;
+		std::filesystem::file_time_type _staleSince;
+
+		// Keeps the list up to date as files come and go, for as long as the directory is open
+		std::unique_ptr<DirectoryWatcher> _watcher;
 		std::function<void(std::filesystem::path)> _imageChanged;
-		WORD _contextMenuIndex = 0;
+		LONG_PTR _contextMenuIndex = 0;
+
+		// Reloaded because its file was written to, failing to decode it is no news worth a dialog
+		PathId _reloading = NoPath;
 		bool _promptRawFileRemove = false;
+		PrefetchScheduler _prefetchScheduler;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "PCH.hpp"
+#include "FileNames.hpp"
+
+namespace PictureBrowser
+{
+	std::wstring_view FileStem(std::wstring_view filename)
+	{
+		const size_t dot = filename.rfind(L'.');
+		return dot == std::wstring_view::npos || dot == 0 || filename == L".." ? filename : filename.substr(0, dot);
+	}
+
+	std::wstring_view FileExtension(std::wstring_view filename)
+	{
+		return filename.substr(FileStem(filename).size());
+	}
+
+	wchar_t FoldCase(wchar_t c)
+	{
+		if (c < 0x80)
+		{
+			return c >= L'A' && c <= L'Z' ? static_cast<wchar_t>(c + (L'a' - L'A')) : c;
+		}
+
+		return static_cast<wchar_t>(std::towlower(c));
+	}
+
+	bool EqualsIgnoringCase(std::wstring_view a, std::wstring_view b)
+	{
+		return a.size() == b.size() && std::equal(a.cbegin(), a.cend(), b.cbegin(), [](wchar_t x, wchar_t y)
+		{
+			return FoldCase(x) == FoldCase(y);
+		});
+	}
+
+	bool LessIgnoringCase(std::wstring_view a, std::wstring_view b)
+	{
+		return std::lexicographical_compare(a.cbegin(), a.cend(), b.cbegin(), b.cend(), [](wchar_t x, wchar_t y)
+		{
+			return FoldCase(x) < FoldCase(y);
+		});
+	}
+
+	std::wstring FoldedCase(std::wstring_view text)
+	{
+		std::wstring folded(text);
+
+		for (wchar_t& c : folded)
+		{
+			c = FoldCase(c);
+		}
+
+		return folded;
+	}
+
+	bool HasExtension(std::wstring_view extension, std::span<const std::wstring_view> extensions)
+	{
+		return std::any_of(extensions.begin(), extensions.end(), [&](std::wstring_view known)
+		{
+			return EqualsIgnoringCase(extension, known);
+		});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// Filename helpers which neither allocate nor touch the file system, for loops over whole directories
+
+	// Split the way std::filesystem::path splits a filename. ".xmp" alone is a stem.
+	std::wstring_view FileStem(std::wstring_view filename);
+	std::wstring_view FileExtension(std::wstring_view filename);
+
+	// Case insensitive the way file systems mostly are, ASCII without a locale lookup
+	wchar_t FoldCase(wchar_t c);
+	bool EqualsIgnoringCase(std::wstring_view a, std::wstring_view b);
+	bool LessIgnoringCase(std::wstring_view a, std::wstring_view b);
+	std::wstring FoldedCase(std::wstring_view text);
+
+	bool HasExtension(std::wstring_view extension, std::span<const std::wstring_view> extensions);
+}
\ No newline at end of file
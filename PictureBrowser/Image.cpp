@@ -0,0 +1,153 @@
+#include "PCH.hpp"
+#include "Image.hpp"
+
+namespace PictureBrowser
+{
+	uint32_t BytesPerPixel(PixelFormat format)
+	{
+		switch (format)
+		{
+			case PixelFormat::Bgr24:
+				return 3;
+			case PixelFormat::Gray8:
+				return 1;
+			default:
+				return 4;
+		}
+	}
+
+	Image::Image(uint32_t width, uint32_t height, PixelFormat format) :
+		_width(width),
+		_height(height),
+		_stride(width * BytesPerPixel(format)),
+		_format(format),
+		_sourceWidth(width),
+		_sourceHeight(height),
+		_bytes(size_t(_stride) * height),
+		_pixels(BufferPool::Shared()->Allocate(_bytes))
+	{
+	}
+
+	uint32_t Image::Width() const
+	{
+		return _width;
+	}
+
+	uint32_t Image::Height() const
+	{
+		return _height;
+	}
+
+	uint32_t Image::Stride() const
+	{
+		return _stride;
+	}
+
+	size_t Image::Bytes() const
+	{
+		return _bytes;
+	}
+
+	PixelFormat Image::Format() const
+	{
+		return _format;
+	}
+
+	uint32_t Image::SourceWidth() const
+	{
+		return _sourceWidth;
+	}
+
+	uint32_t Image::SourceHeight() const
+	{
+		return _sourceHeight;
+	}
+
+	void Image::SetSourceSize(uint32_t width, uint32_t height)
+	{
+		_sourceWidth = width;
+		_sourceHeight = height;
+	}
+
+	bool Image::IsPartial() const
+	{
+		return _width < _sourceWidth || _height < _sourceHeight;
+	}
+
+	std::span<uint8_t> Image::Pixels()
+	{
+		return { _pixels.get(), _bytes };
+	}
+
+	std::span<const uint8_t> Image::Pixels() const
+	{
+		return { _pixels.get(), _bytes };
+	}
+
+	std::shared_ptr<Image> Downscale(const Image& source, uint32_t maxWidth, uint32_t maxHeight)
+	{
+		const double scale = std::min({
+			1.0,
+			double(maxWidth) / source.Width(),
+			double(maxHeight) / source.Height() });
+
+		const uint32_t width = std::max(1u, static_cast<uint32_t>(source.Width() * scale));
+		const uint32_t height = std::max(1u, static_cast<uint32_t>(source.Height() * scale));
+
+		auto target = std::make_shared<Image>(width, height, source.Format());
+		target->SetSourceSize(source.SourceWidth(), source.SourceHeight());
+
+		// The first source column of each target column
+		std::vector<uint32_t> columns(size_t(width) + 1);
+
+		for (uint32_t x = 0; x <= width; ++x)
+		{
+			columns[x] = static_cast<uint32_t>(uint64_t(x) * source.Width() / width);
+		}
+
+		const uint32_t bytesPerPixel = BytesPerPixel(source.Format());
+		std::vector<uint64_t> sums(size_t(width) * bytesPerPixel);
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint32_t top = static_cast<uint32_t>(uint64_t(y) * source.Height() / height);
+			const uint32_t bottom = static_cast<uint32_t>(uint64_t(y + 1) * source.Height() / height);
+
+			std::fill(sums.begin(), sums.end(), 0);
+
+			for (uint32_t sourceY = top; sourceY < bottom; ++sourceY)
+			{
+				const uint8_t* row = source.Pixels().data() + size_t(sourceY) * source.Stride();
+
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					uint64_t* sum = &sums[size_t(x) * bytesPerPixel];
+
+					for (uint32_t sourceX = columns[x]; sourceX < columns[x + 1]; ++sourceX)
+					{
+						const uint8_t* pixel = row + size_t(sourceX) * bytesPerPixel;
+
+						for (uint32_t channel = 0; channel < bytesPerPixel; ++channel)
+						{
+							sum[channel] += pixel[channel];
+						}
+					}
+				}
+			}
+
+			uint8_t* row = target->Pixels().data() + size_t(y) * target->Stride();
+
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const uint64_t count = uint64_t(columns[x + 1] - columns[x]) * (bottom - top);
+
+				for (uint32_t channel = 0; channel < bytesPerPixel; ++channel)
+				{
+					row[x * bytesPerPixel + channel] = static_cast<uint8_t>(sums[x * bytesPerPixel + channel] / count);
+				}
+			}
+		}
+
+		return target;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "BufferPool.hpp"
+
+namespace PictureBrowser
+{
+	enum class PixelFormat : uint32_t
+	{
+		// Blue, green, red and one unused byte, what Direct2D takes
+		Bgr32,
+		Bgr24,
+		Gray8
+	};
+
+	uint32_t BytesPerPixel(PixelFormat format);
+
+	// Decoded, orientation corrected pixels which do not belong to any render target.
+	// Opaque photos are kept in the most compact format which fits, they are expanded only when uploaded.
+	// The rows are packed, the pixels start 64 byte aligned.
+	class Image
+	{
+	public:
+		Image(uint32_t width, uint32_t height, PixelFormat format = PixelFormat::Bgr32);
+
+		uint32_t Width() const;
+		uint32_t Height() const;
+		uint32_t Stride() const;
+		size_t Bytes() const;
+		PixelFormat Format() const;
+
+		// The size of the image the pixels were scaled down from
+		uint32_t SourceWidth() const;
+		uint32_t SourceHeight() const;
+		void SetSourceSize(uint32_t width, uint32_t height);
+
+		// True if a better version can be decoded from the source
+		bool IsPartial() const;
+
+		std::span<uint8_t> Pixels();
+		std::span<const uint8_t> Pixels() const;
+
+	private:
+		uint32_t _width = 0;
+		uint32_t _height = 0;
+		uint32_t _stride = 0;
+		PixelFormat _format = PixelFormat::Bgr32;
+		uint32_t _sourceWidth = 0;
+		uint32_t _sourceHeight = 0;
+		size_t _bytes = 0;
+		BufferPool::Buffer _pixels;
+	};
+
+	// Area averaging, which keeps the aspect ratio and the pixel format. Never scales up.
+	std::shared_ptr<Image> Downscale(const Image& source, uint32_t maxWidth, uint32_t maxHeight);
+}
\ No newline at end of file
@@ -1,234 +1,934 @@
 #include "PCH.hpp"
 #include "ImageCache.hpp"
+#include "Image.hpp"
+#include "ImageProbe.hpp"
 #include "LogWrap.hpp"
+#include "ReadAhead.hpp"
+#include "Swizzle.hpp"
 
 namespace PictureBrowser
 {
-	struct PropertyVariant : PROPVARIANT
+	// Compact images are expanded to 32 bpp through a buffer of about this size
+	constexpr uint32_t UploadStripBytes = 1 << 20;
+
+	// The neighbors prefetched ahead of the rest, one in each direction
+	constexpr size_t NearNeighbors = 2;
+
+	// Tiles are cut from a full resolution decode, which has to be resident in one piece.
+	// Larger images are decoded down to this many pixels, which the tiles then treat as the full resolution.
+	constexpr uint64_t MaxRefinePixels = sizeof(void*) == 8 ? 256ull << 20 : 32ull << 20;
+
+	bool IsReady(const std::shared_future<std::shared_ptr<const Image>>& result)
+	{
+		return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	bool Dropped(const std::shared_future<std::shared_ptr<const Image>>& result)
 	{
-		PropertyVariant()
+		if (!IsReady(result))
 		{
-			PropVariantInit(this);
+			return false;
 		}
 
-		~PropertyVariant()
+		try
 		{
-			PropVariantClear(this);
+			return !result.get();
+		}
+		catch (const std::exception&)
+		{
+			return false;
 		}
-	};
+	}
+
+	void ShowError(const std::exception& e)
+	{
+		MessageBoxA(nullptr,
+			e.what(),
+			"An exception occurred!",
+			MB_ICONSTOP | MB_OK);
+	}
+
+	ImageCache::ImageCache(bool useCaching, size_t budget, size_t tileBudget, size_t threads, std::unique_ptr<PreviewStore>&& previewStore) :
+		_budget(useCaching ? budget : 0),
+		_cache(_budget),
+		_tiles(tileBudget),
+		_previewStore(std::move(previewStore)),
+		_readAhead(std::make_unique<ReadAhead>(ReadAhead::DefaultBudget, _metrics)),
+		_pipeline(std::make_unique<DecodePipeline>(
+			threads,
+			std::max(threads / 2, size_t(1)),
+			_metrics,
+			_previewStore.get(),
+			[this]()
+			{
+				if (_decodedCallback)
+				{
+					_decodedCallback();
+				}
+			}))
+	{
+	}
+
+	ImageCache::~ImageCache()
+	{
+		// Joins the workers before anything they touch goes away.
+		// The results of the dropped jobs are broken promises, which are only polled and cleared here.
+		_pipeline.reset();
+		Clear();
+	}
 
-	WICBitmapTransformOptions OrientationTransformOptions(uint16_t exifOrientation)
+	void ImageCache::SetDecodedCallback(const std::function<void()>& decodedCallback)
 	{
-		_ASSERTE(exifOrientation <= 8);
+		_decodedCallback = decodedCallback;
+	}
 
-		switch (exifOrientation)
+	void ImageCache::SetRenderTarget(ID2D1RenderTarget* renderTarget)
+	{
+		// The pixels stay, the bitmap is uploaded again on the next paint
+		_renderTarget = renderTarget;
+		_current.Reset();
+		_tiles.Clear();
+	}
+
+	PathTable& ImageCache::Paths()
+	{
+		return _paths;
+	}
+
+	ImageCache::State ImageCache::Request(PathId path)
+	{
+		// Anything queued for an older selection is dropped before it reaches the decoder
+		const uint64_t generation = ++_generation;
+
+		if (_refining != NoPath)
 		{
-			case 2:
-				return WICBitmapTransformFlipHorizontal;
-			case 3:
-				return WICBitmapTransformRotate180;
-			case 4:
-				return WICBitmapTransformFlipVertical;
-			case 5:
-				return WICBitmapTransformOptions(WICBitmapTransformRotate90 | WICBitmapTransformRotate180 | WICBitmapTransformFlipHorizontal);
-			case 6:
-				return WICBitmapTransformRotate90;
-			case 7:
-				return WICBitmapTransformOptions(WICBitmapTransformRotate90 | WICBitmapTransformFlipHorizontal);
-			case 8:
-				return WICBitmapTransformRotate270;
+			// Full resolution pixels never go under the budget, not even as a prefetch
+			_pending.erase(_refining);
 		}
 
-		return WICBitmapTransformRotate0;
+		_requested = path;
+		_refining = NoPath;
+		_magnification = 1.0f;
+		_requestTime = std::chrono::steady_clock::now();
+		_previewShown = false;
+		_awaitingPixels = false;
+
+		const std::shared_ptr<const Image>* cached = _cache.Find(path);
+
+		if (cached)
+		{
+			LOGD << L"Cached: " << _paths.Path(path);
+			_metrics.Add(Metrics::Counter::CacheHits);
+			_unseen.erase(path);
+
+			try
+			{
+				MakeCurrent(*cached);
+				return State::Ready;
+			}
+			catch (const std::exception& e)
+			{
+				ShowError(e);
+			}
+
+			_requested = NoPath;
+			return State::Failed;
+		}
+
+		_metrics.Add(Metrics::Counter::CacheMisses);
+
+		const auto iter = _pending.find(path);
+
+		if (iter == _pending.end())
+		{
+			Submit(path, generation, Priority::Visible, false);
+			SubmitEmbedded(path, generation);
+			return State::Pending;
+		}
+
+		// Either being prefetched already, or done and waiting to be picked up
+		_metrics.Add(Metrics::Counter::PrefetchHits);
+		iter->second.Generation->store(generation);
+
+		const State state = Complete();
+
+		if (state == State::Pending)
+		{
+			SubmitEmbedded(path, generation);
+		}
+
+		return state;
 	}
 
-	ImageCache::ImageCache(bool useCaching) :
-		_useCaching(useCaching)
+	ImageCache::State ImageCache::Complete()
 	{
-		HRESULT hr = CoCreateInstance(
-			CLSID_WICImagingFactory,
-			NULL,
-			CLSCTX_INPROC_SERVER,
-			IID_PPV_ARGS(&_wicFactory));
+		State state = State::Pending;
+		const auto iter = _pending.find(_requested);
 
-		if (FAILED(hr))
+		if (iter != _pending.end() && IsReady(iter->second.Result))
 		{
-			throw std::system_error(hr, std::system_category(), "CoCreateInstance");
+			const std::shared_future<std::shared_ptr<const Image>> result = iter->second.Result;
+			_pending.erase(iter);
+
+			try
+			{
+				const std::shared_ptr<const Image> image = result.get();
+
+				if (image)
+				{
+					_cache.Insert(_requested, image, image->Bytes());
+					MakeCurrent(image);
+					state = State::Ready;
+				}
+				else
+				{
+					// Was dropped just before the request caught up with it
+					Submit(_requested, _generation, Priority::Visible, false);
+				}
+			}
+			catch (const std::exception& e)
+			{
+				ShowError(e);
+				_requested = NoPath;
+				state = State::Failed;
+			}
 		}
+
+		if (_refining != NoPath)
+		{
+			const auto refined = _pending.find(_refining);
+
+			if (refined != _pending.end() && IsReady(refined->second.Result))
+			{
+				const std::shared_future<std::shared_ptr<const Image>> result = refined->second.Result;
+				_pending.erase(refined);
+
+				try
+				{
+					const std::shared_ptr<const Image> image = result.get();
+
+					if (image && _refining == _currentImage)
+					{
+						// Swap the better version in without making it a new selection.
+						// Not cached, the display sized version already is and the full pixels live only while current.
+						Show(image, true);
+						state = State::Ready;
+					}
+				}
+				catch (const std::exception&)
+				{
+					LOGD << L"Failed to refine: " << _paths.Path(_refining);
+				}
+
+				_refining = NoPath;
+			}
+		}
+
+		if (state == State::Pending && HarvestEmbedded())
+		{
+			state = State::Preview;
+		}
+
+		if (HarvestTiles() && state == State::Pending && _requested == NoPath)
+		{
+			// Nothing new to show, just sharper
+			state = State::Ready;
+		}
+
+		Harvest();
+		return state;
 	}
 
-	ImageCache::~ImageCache()
+	const std::filesystem::path& ImageCache::Requested() const
 	{
-		Clear();
+		return _paths.Path(_requested);
+	}
+
+	const std::filesystem::path& ImageCache::CurrentPath() const
+	{
+		return _paths.Path(_currentImage);
 	}
 
-	bool ImageCache::SetCurrent(const std::filesystem::path& path)
+	ComPtr<ID2D1Bitmap> ImageCache::Current()
 	{
-		if (!Get(path))
+		if (!_current && _currentPixels && _renderTarget)
 		{
-			return false;
+			try
+			{
+				_current = Upload(*_currentPixels);
+			}
+			catch (const std::system_error&)
+			{
+				LOGD << L"Failed to upload: " << _paths.Path(_currentImage);
+			}
 		}
 
-		_currentImage = path;
-		return true;
+		return _current;
 	}
 
-	ComPtr<ID2D1Bitmap> ImageCache::Current()
+	void ImageCache::Prefetch(const std::vector<PathId>& paths)
+	{
+		if (!_cache.Budget() || _pressure == MemoryPressure::High)
+		{
+			if (_readAhead)
+			{
+				_readAhead->Clear();
+			}
+
+			return;
+		}
+
+		// Whatever fell out of the neighborhood is not worth keeping around
+		std::erase_if(_pending, [&](const auto& pair)
+		{
+			return pair.first != _requested &&
+				pair.first != _refining &&
+				std::find(paths.cbegin(), paths.cend(), pair.first) == paths.cend();
+		});
+
+		const uint64_t generation = _generation;
+		std::vector<PathId> decodes;
+		std::vector<std::filesystem::path> reads;
+
+		// Only the preview of a RAW file is read, which the mapping does better than reading all of it
+		const auto readAhead = [&](PathId path)
+		{
+			if (!IsPreviewedRawFile(_paths.Path(path)))
+			{
+				reads.emplace_back(_paths.Path(path));
+			}
+		};
+
+		for (const PathId path : paths)
+		{
+			if (path == NoPath || _cache.Contains(path))
+			{
+				continue;
+			}
+
+			const auto iter = _pending.find(path);
+
+			if (iter != _pending.end() && !Dropped(iter->second.Result))
+			{
+				// Still wanted, do not let it be dropped
+				iter->second.Generation->store(generation);
+
+				const std::shared_ptr<ImageSource> source = iter->second.Source.lock();
+
+				if (source && !source->Opened())
+				{
+					readAhead(path);
+				}
+
+				continue;
+			}
+
+			decodes.emplace_back(path);
+			readAhead(path);
+		}
+
+		// Before the decodes, so that they find their reads under way
+		_readAhead->Schedule(reads);
+
+		for (size_t i = 0; i < decodes.size(); ++i)
+		{
+			Submit(decodes[i], generation, i < NearNeighbors ? Priority::Prefetch : Priority::Background, false);
+		}
+	}
+
+	bool ImageCache::RemoveFile(const std::filesystem::path& path)
+	{
+		const PathId id = _paths.Find(path);
+
+		Invalidate(path);
+
+		if (id != NoPath && id == _currentImage)
+		{
+			_current.Reset();
+			_currentPixels.reset();
+			_currentImage = NoPath;
+			ResetTiles();
+		}
+
+		return DeleteFileW(path.c_str());
+	}
+
+	void ImageCache::Invalidate(const std::filesystem::path& path)
 	{
-		return Get(_currentImage);
+		const PathId id = _paths.Find(path);
+
+		if (id != NoPath)
+		{
+			_cache.Erase(id);
+			_pending.erase(id);
+			_unseen.erase(id);
+		}
+
+		if (_readAhead)
+		{
+			_readAhead->Drop(path);
+		}
 	}
 
-	ComPtr<ID2D1Bitmap> ImageCache::Get(const std::filesystem::path& path)
+	void ImageCache::InvalidateWrittenSince(std::filesystem::file_time_type since)
 	{
-		if (_useCaching)
+		// Only what is decoded is looked at, a few dozen files rather than the whole directory
+		const auto stale = [&](PathId id)
 		{
-			const auto iter = _cache.find(path);
+			std::error_code error;
+			const std::filesystem::file_time_type written = std::filesystem::last_write_time(_paths.Path(id), error);
 
-			if (iter != _cache.end())
+			if (!error && written < since)
 			{
-				return iter->second;
+				return false;
 			}
 
-			LOGD << L"Not cached: " << path;
+			_unseen.erase(id);
+
+			if (_readAhead)
+			{
+				_readAhead->Drop(_paths.Path(id));
+			}
+
+			return true;
+		};
+
+		_cache.EraseIf([&](PathId id, const std::shared_ptr<const Image>&)
+		{
+			return stale(id);
+		});
+
+		std::erase_if(_pending, [&](const auto& pair)
+		{
+			return pair.first != _requested && pair.first != _refining && stale(pair.first);
+		});
+	}
+
+	void ImageCache::Clear()
+	{
+		++_generation;
+		_cache.Clear();
+		_pending.clear();
+		_unseen.clear();
+		_current.Reset();
+		_currentPixels.reset();
+		_currentImage = NoPath;
+		_requested = NoPath;
+		_refining = NoPath;
+		_previewing = NoPath;
+		_embedded = {};
+		_paths.Clear();
+		ResetTiles();
+
+		if (_readAhead)
+		{
+			_readAhead->Clear();
 		}
+	}
 
-		try
+	void ImageCache::SetDisplaySize(uint32_t width, uint32_t height)
+	{
+		_displayWidth = width;
+		_displayHeight = height;
+
+		Refine();
+	}
+
+	void ImageCache::Magnify(float magnification)
+	{
+		_magnification = std::max(magnification, 1.0f);
+
+		Refine();
+	}
+
+	size_t ImageCache::ResidentBytes() const
+	{
+		return _cache.Bytes() + (_fullPixels ? _fullPixels->Bytes() : 0) + BufferPool::Shared()->Statistics().IdleBytes;
+	}
+
+	void ImageCache::SetMemoryPressureSource(std::unique_ptr<MemoryPressureSource>&& pressureSource)
+	{
+		_pressureSource = std::move(pressureSource);
+		_pressure = MemoryPressure::None;
+	}
+
+	void ImageCache::CheckMemoryPressure()
+	{
+		if (!_pressureSource)
 		{
-			return Load(path);
+			return;
 		}
-		catch (const std::system_error& e)
+
+		_pressure = _pressureSource->Sample();
+
+		if (_pressure == MemoryPressure::None)
 		{
-			MessageBoxA(nullptr,
-				e.what(),
-				"An exception occurred!",
-				MB_ICONSTOP | MB_OK);
+			return;
 		}
-		catch (const std::exception& e)
+
+		const size_t resident = _cache.Bytes();
+
+		std::erase_if(_unseen, [this](PathId path)
+		{
+			return !_cache.Contains(path);
+		});
+
+		// Prefetched images nobody has looked at go first, the least recently viewed next
+		ShrinkForPressure(_cache, _pressure, [this](PathId path, const std::shared_ptr<const Image>&)
 		{
-			MessageBoxA(nullptr,
-				e.what(),
-				"An exception occurred!",
-				MB_ICONSTOP | MB_OK);
+			return _unseen.contains(path);
+		});
+
+		_tiles.Shrink(PressureTarget(_tiles.Bytes(), _pressure));
+
+		// The evicted pixels went back to the pool, hand them to the system
+		BufferPool::Shared()->Trim();
+
+		_metrics.Add(Metrics::Counter::PressureShrinks);
+		_metrics.Add(Metrics::Counter::PressureEvictedBytes, resident - _cache.Bytes());
+
+		LOGD << L"Memory pressure, resident " << uint64_t(resident) << L" -> " << uint64_t(_cache.Bytes());
+	}
+
+	void ImageCache::SetReadThrottle(uint64_t bytesPerSecond)
+	{
+		if (_readAhead)
+		{
+			_readAhead->SetThrottle(bytesPerSecond);
+		}
+	}
+
+	void ImageCache::Painted()
+	{
+		if (_awaitingPixels && _current)
+		{
+			_awaitingPixels = false;
+			_metrics.Record(Metrics::Timer::FirstPixels, std::chrono::steady_clock::now() - _requestTime);
 		}
 
-		return nullptr;
+		if (_awaitingPaint && _current)
+		{
+			_awaitingPaint = false;
+			_metrics.Record(Metrics::Timer::FirstPaint, std::chrono::steady_clock::now() - _requestTime);
+		}
+
+		if (_awaitingOpen && _current)
+		{
+			_awaitingOpen = false;
+			_metrics.Record(Metrics::Timer::OpenFirstImage, std::chrono::steady_clock::now() - _openTime);
+		}
 	}
 
-	bool ImageCache::RemoveFile(const std::filesystem::path& path)
+	void ImageCache::Opened()
+	{
+		_openTime = std::chrono::steady_clock::now();
+		_awaitingOpen = true;
+	}
+
+	void ImageCache::Listed()
+	{
+		_metrics.Record(Metrics::Timer::OpenListed, std::chrono::steady_clock::now() - _openTime);
+	}
+
+	const Metrics& ImageCache::Stats() const
+	{
+		return _metrics;
+	}
+
+	std::string ImageCache::StatsJson() const
 	{
-		if (_useCaching)
+		const BufferPool::Stats buffers = BufferPool::Shared()->Statistics();
+		const ThreadPool::Stats jobs = _pipeline ? _pipeline->Statistics() : ThreadPool::Stats();
+
+		// Prefetches which were never looked at count towards the images which were
+		const uint64_t displayed = _metrics.Get(Metrics::Timer::FirstPaint).Count();
+
+		return _metrics.ToJson({
+			{ "residentBytes", ResidentBytes() },
+			{ "cachedImageBytes", _cache.Bytes() },
+			{ "residentImages", _cache.Count() },
+			{ "evictions", _cache.Evictions() },
+			{ "budgetBytes", _cache.Budget() },
+			{ "tileBytes", _tiles.Bytes() },
+			{ "tileEvictions", _tiles.Evictions() },
+			{ "pendingDecodes", _pending.size() },
+			{ "queuedJobs", _pipeline ? _pipeline->Pending() : 0 },
+			{ "queuedVisibleJobs", jobs.Queued[size_t(Priority::Visible)] },
+			{ "queuedPrefetchJobs", jobs.Queued[size_t(Priority::Prefetch)] },
+			{ "queuedBackgroundJobs", jobs.Queued[size_t(Priority::Background)] },
+			{ "queuedJobsHighWater", jobs.HighWaterQueued },
+			{ "stolenJobs", jobs.Steals },
+			{ "cancelledJobs", jobs.Cancelled },
+			{ "bufferPoolHits", buffers.Hits },
+			{ "bufferPoolMisses", buffers.Misses },
+			{ "bufferInUseBytes", buffers.InUseBytes },
+			{ "bufferIdleBytes", buffers.IdleBytes },
+			{ "bufferHighWaterBytes", buffers.HighWaterBytes },
+			{ "readAheadBytes", _readAhead ? _readAhead->Bytes() : 0 },
+			{ "bytesReadPerDisplayedImage", displayed ? _metrics.Value(Metrics::Counter::BytesRead) / displayed : 0 }
+		});
+	}
+
+	void ImageCache::Submit(PathId id, uint64_t generation, Priority priority, bool fullSize)
+	{
+		auto promise = std::make_shared<DecodePipeline::Promise>();
+		auto ticket = std::make_shared<std::atomic<uint64_t>>(generation);
+
+		// The table belongs to the UI thread, the worker gets a copy of the path
+		auto source = std::make_shared<ImageSource>(_paths.Path(id), _metrics, *_readAhead);
+
+		_pending[id] = { promise->get_future().share(), ticket, source };
+
+		uint32_t maxWidth = fullSize ? 0 : _displayWidth;
+		uint32_t maxHeight = fullSize ? 0 : _displayHeight;
+
+		if (fullSize && _currentPixels && id == _currentImage)
 		{
-			const auto iter = _cache.find(path);
+			const uint32_t sourceWidth = _currentPixels->SourceWidth();
+			const uint32_t sourceHeight = _currentPixels->SourceHeight();
+			const uint64_t pixels = uint64_t(sourceWidth) * sourceHeight;
 
-			if (iter != _cache.end())
+			if (pixels > MaxRefinePixels)
 			{
-				_cache.erase(iter);
+				const double shrink = std::sqrt(double(MaxRefinePixels) / double(pixels));
+				maxWidth = std::max(static_cast<uint32_t>(sourceWidth * shrink), 1u);
+				maxHeight = std::max(static_cast<uint32_t>(sourceHeight * shrink), 1u);
 			}
 		}
 
-		return DeleteFileW(path.c_str());
+		const auto wanted = [this, ticket]()
+		{
+			return ticket->load() == _generation;
+		};
+
+		_pipeline->Submit({ source, maxWidth, maxHeight, wanted, promise, !fullSize }, priority);
 	}
 
-	void ImageCache::Clear()
+	void ImageCache::SubmitEmbedded(PathId id, uint64_t generation)
 	{
-		_cache = { { L"", nullptr } };
+		auto promise = std::make_shared<DecodePipeline::Promise>();
+
+		_previewing = id;
+		_embedded = promise->get_future().share();
+
+		// Reads the same memory as the decode, unless that is done already
+		const auto pending = _pending.find(id);
+		std::shared_ptr<ImageSource> source = pending != _pending.end() ? pending->second.Source.lock() : nullptr;
+
+		if (!source)
+		{
+			source = std::make_shared<ImageSource>(_paths.Path(id), _metrics, *_readAhead);
+		}
+
+		const uint32_t maxWidth = _displayWidth;
+		const uint32_t maxHeight = _displayHeight;
+
+		const auto wanted = [this, generation]()
+		{
+			return generation == _generation;
+		};
+
+		// Submitted after the decode, so that a worker with both queued takes it first
+		_pipeline->SubmitEmbedded({ source, maxWidth, maxHeight, wanted, promise });
 	}
 
-	// TODO: this method should be cleaned up a bit.
-	// TODO: instead of immediate throw, maybe display the error as an image
-	ComPtr<ID2D1Bitmap> ImageCache::Load(const std::filesystem::path& path)
+	bool ImageCache::HarvestEmbedded()
 	{
-		if (!_renderTarget)
+		if (_previewing == NoPath || !IsReady(_embedded))
 		{
-			throw std::runtime_error("ID2D1RenderTarget was null!");
+			return false;
 		}
 
-		ComPtr<IWICBitmapDecoder> decoder;
+		const PathId previewing = std::exchange(_previewing, NoPath);
+		const std::shared_ptr<const Image> preview = _embedded.get();
+		_embedded = {};
 
-		HRESULT hr = _wicFactory->CreateDecoderFromFilename(
-			path.c_str(),
-			nullptr,
-			GENERIC_READ,
-			WICDecodeMetadataCacheOnDemand,
-			&decoder);
+		if (!preview || previewing != _requested)
+		{
+			return false;
+		}
 
-		if (FAILED(hr))
+		try
+		{
+			// Shown as the current image, but not cached and not refined
+			Show(preview, false);
+			_currentImage = _requested;
+			_previewShown = true;
+			_awaitingPixels = true;
+			_metrics.Add(Metrics::Counter::EmbeddedPreviews);
+			return true;
+		}
+		catch (const std::system_error&)
 		{
-			throw std::system_error(hr, std::system_category(), "IWICImagingFactory::CreateDecoderFromFilename");
+			LOGD << L"Failed to upload the embedded preview of " << _paths.Path(previewing);
 		}
 
-		ComPtr<IWICBitmapFrameDecode> frame;
+		return false;
+	}
+
+	void ImageCache::Harvest()
+	{
+		// Finished prefetches move under the budget
+		std::erase_if(_pending, [this](const auto& pair)
+		{
+			if (pair.first == _refining || !IsReady(pair.second.Result))
+			{
+				return false;
+			}
 
-		hr = decoder->GetFrame(0, &frame);
+			try
+			{
+				const std::shared_ptr<const Image> image = pair.second.Result.get();
 
-		if (FAILED(hr))
+				if (image && _cache.Insert(pair.first, image, image->Bytes()))
+				{
+					_unseen.insert(pair.first);
+				}
+			}
+			catch (const std::exception&)
+			{
+				// Reported when, and if, the image is requested
+				return pair.first != _requested;
+			}
+
+			return true;
+		});
+
+		// Evicted pixels go back to the pool, which must not hold on to more than the budget has left
+		if (const size_t budget = _cache.Budget())
 		{
-			throw std::system_error(hr, std::system_category(), "IWICBitmapDecoder::GetFrame");
+			BufferPool::Shared()->Trim(budget > _cache.Bytes() ? budget - _cache.Bytes() : 0);
 		}
 
-		ComPtr<IWICFormatConverter> formatConverter;
+		LOGD << L"Resident: " << uint64_t(_cache.Bytes())
+			<< L", decoded: " << _metrics.Value(Metrics::Counter::Decodes)
+			<< L", dropped: " << _metrics.Value(Metrics::Counter::Dropped);
+	}
+
+	void ImageCache::MakeCurrent(const std::shared_ptr<const Image>& image)
+	{
+		Show(image, false);
+		_currentImage = _requested;
+		_requested = NoPath;
 
-		hr = _wicFactory->CreateFormatConverter(&formatConverter);
+		Refine();
 
-		if (FAILED(hr))
+		const auto diff = std::chrono::steady_clock::now() - _requestTime;
+		_metrics.Record(Metrics::Timer::Ready, diff);
+		_awaitingPaint = true;
+		_awaitingPixels = _awaitingPixels || !_previewShown;
+
+		LOGD << _paths.Path(_currentImage) << L" ready in " << int64_t(std::chrono::duration_cast<std::chrono::microseconds>(diff).count()) << L"us";
+	}
+
+	void ImageCache::Refine()
+	{
+		// An embedded preview is showing while the decode runs
+		if (!_currentPixels || _pyramid || _currentImage == NoPath || _refining == _currentImage || _currentImage == _requested)
+		{
+			return;
+		}
+
+		const Image& image = *_currentPixels;
+
+		if (!image.IsPartial())
 		{
-			throw std::system_error(hr, std::system_category(), "IWICImagingFactory::CreateFormatConverter");
+			return;
 		}
 
-		// I wonder why GUID_WICPixelFormat24bppBGR does not work
+		// How many pixels the canvas shows the image with
+		const double scale = std::min(
+			double(_displayWidth) / image.SourceWidth(),
+			double(_displayHeight) / image.SourceHeight()) * _magnification;
 
-		hr = formatConverter->Initialize(
-			frame.Get(),
-			GUID_WICPixelFormat32bppBGR,
-			WICBitmapDitherTypeNone,
-			nullptr,
-			0.0f,
-			WICBitmapPaletteTypeCustom);
+		const uint32_t width = static_cast<uint32_t>(std::min(image.SourceWidth() * scale, double(image.SourceWidth())));
+		const uint32_t height = static_cast<uint32_t>(std::min(image.SourceHeight() * scale, double(image.SourceHeight())));
 
-		if (FAILED(hr))
+		if (image.Width() >= width && image.Height() >= height)
 		{
-			throw std::system_error(hr, std::system_category(), "IWICFormatConverter::Initialize");
+			return;
 		}
 
-		ComPtr<IWICMetadataQueryReader> metadata;
+		// Shown as is for now, the full decode follows
+		_metrics.Add(Metrics::Counter::Refines);
+		_refining = _currentImage;
+		Submit(_refining, _generation, Priority::Visible, true);
+	}
 
-		hr = frame->GetMetadataQueryReader(&metadata);
+	void ImageCache::Show(const std::shared_ptr<const Image>& image, bool refined)
+	{
+		ResetTiles();
 
-		if (FAILED(hr))
+		if (!TilePyramid::Wanted(image->Width(), image->Height()))
 		{
-			throw std::system_error(hr, std::system_category(), "IWICBitmapFrameDecode::GetMetadataQueryReader");
+			_current = Upload(*image);
+			_currentPixels = image;
+			return;
 		}
 
-		PropertyVariant orientation;
-		hr = metadata->GetMetadataByName(L"/app1/ifd/{ushort=274}", &orientation);
-		WICBitmapTransformOptions options = OrientationTransformOptions(orientation.uiVal);
+		// Too large for a single bitmap. The tiles are drawn over a smaller version.
+		// The full resolution stays for them to be cut from, so the cache makes room for it.
+		_fullPixels = image;
+		_cache.SetBudget(_budget > image->Bytes() ? _budget - image->Bytes() : 0);
+		_pyramid.emplace(image->Width(), image->Height());
 
-		IWICBitmapSource* source = formatConverter.Get();
-		ComPtr<IWICBitmapFlipRotator> rotator;
+		if (refined)
+		{
+			// The smaller version is already on the screen
+			return;
+		}
 
-		if (FAILED(hr) && hr != WINCODEC_ERR_PROPERTYNOTFOUND)
+		_currentPixels = Downscale(*image, std::max(_displayWidth, 1u), std::max(_displayHeight, 1u));
+		_current = Upload(*_currentPixels);
+	}
+
+	std::vector<ImageCache::Tile> ImageCache::Tiles(const D2D_RECT_F& target, const D2D_SIZE_F& viewport)
+	{
+		std::vector<Tile> tiles;
+
+		if (!_pyramid || !_currentPixels || !_renderTarget)
 		{
-			throw std::system_error(hr, std::system_category(), "IWICMetadataQueryReader::GetMetadataByName");
+			return tiles;
 		}
-		else
+
+		const float width = target.right - target.left;
+
+		if (width <= float(_currentPixels->Width()))
 		{
-			hr = _wicFactory->CreateBitmapFlipRotator(&rotator);
+			// The smaller version has enough pixels
+			return tiles;
+		}
 
-			if (FAILED(hr))
+		const float scale = width / float(_pyramid->Width());
+
+		const D2D_RECT_F visible = {
+			-target.left / scale,
+			-target.top / scale,
+			(viewport.width - target.left) / scale,
+			(viewport.height - target.top) / scale
+		};
+
+		for (const TileKey& key : _pyramid->Tiles(_pyramid->LevelFor(scale), visible))
+		{
+			const ComPtr<ID2D1Bitmap>* bitmap = _tiles.Find(key);
+
+			if (!bitmap)
 			{
-				throw std::system_error(hr, std::system_category(), "IWICImagingFactory::CreateBitmapFlipRotator");
+				SubmitTile(key);
+				continue;
 			}
 
-			hr = rotator->Initialize(formatConverter.Get(), options);
+			const D2D_RECT_F source = _pyramid->SourceRect(key);
 
-			if (FAILED(hr))
+			tiles.push_back({ *bitmap, {
+				target.left + source.left * scale,
+				target.top + source.top * scale,
+				target.left + source.right * scale,
+				target.top + source.bottom * scale } });
+		}
+
+		return tiles;
+	}
+
+	void ImageCache::SubmitTile(const TileKey& key)
+	{
+		if (_pendingTiles.contains(key))
+		{
+			return;
+		}
+
+		auto promise = std::make_shared<std::promise<std::shared_ptr<const Image>>>();
+		const uint64_t generation = _generation;
+
+		_pendingTiles[key] = promise->get_future().share();
+
+		_pipeline->Post([this, promise, generation, key, image = _fullPixels, pyramid = *_pyramid]()
+		{
+			if (generation != _generation)
+			{
+				promise->set_value(nullptr);
+			}
+			else
+			{
+				try
+				{
+					const auto start = std::chrono::steady_clock::now();
+					promise->set_value(pyramid.Cut(*image, key));
+
+					_metrics.Add(Metrics::Counter::TilesCut);
+					_metrics.Record(Metrics::Timer::TileCut, std::chrono::steady_clock::now() - start);
+				}
+				catch (...)
+				{
+					promise->set_exception(std::current_exception());
+				}
+			}
+
+			if (_decodedCallback)
+			{
+				_decodedCallback();
+			}
+		}, Priority::Visible, _tileCancel.get_token());
+	}
+
+	bool ImageCache::HarvestTiles()
+	{
+		bool harvested = false;
+
+		std::erase_if(_pendingTiles, [&](const auto& pair)
+		{
+			if (!IsReady(pair.second))
 			{
-				throw std::system_error(hr, std::system_category(), "IWICBitmapFlipRotator::Initialize");
+				return false;
 			}
 
-			source = rotator.Get();
+			try
+			{
+				const std::shared_ptr<const Image> tile = pair.second.get();
+
+				if (tile && _renderTarget)
+				{
+					_tiles.Insert(pair.first, Upload(*tile), tile->Bytes());
+					harvested = true;
+				}
+			}
+			catch (const std::exception&)
+			{
+				LOGD << L"Failed to cut tile " << pair.first.Level << L"/" << pair.first.Column << L"/" << pair.first.Row;
+			}
+
+			return true;
+		});
+
+		return harvested;
+	}
+
+	void ImageCache::ResetTiles()
+	{
+		if (_fullPixels)
+		{
+			_fullPixels.reset();
+			_cache.SetBudget(_budget);
 		}
 
+		_pyramid.reset();
+		_tiles.Clear();
+		_pendingTiles.clear();
+
+		_tileCancel.request_stop();
+		_tileCancel = {};
+	}
+
+	// The last stage of the decode pipeline, the render target belongs to this thread
+	ComPtr<ID2D1Bitmap> ImageCache::Upload(const Image& image)
+	{
+		if (!_renderTarget)
+		{
+			throw std::runtime_error("ID2D1RenderTarget was null!");
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+
 		ComPtr<ID2D1Bitmap> bitmap;
 
 		D2D1_BITMAP_PROPERTIES properties;
@@ -237,22 +937,56 @@ namespace PictureBrowser
 		properties.dpiX = 96.0f;
 		properties.dpiY = 96.0f;
 
-		hr = _renderTarget->CreateBitmapFromWicBitmap(
-			source,
+		const bool compact = image.Format() != PixelFormat::Bgr32;
+
+		HRESULT hr = _renderTarget->CreateBitmap(
+			D2D1::SizeU(image.Width(), image.Height()),
+			compact ? nullptr : image.Pixels().data(),
+			image.Stride(),
 			properties,
 			&bitmap);
 
 		if (FAILED(hr))
 		{
-			throw std::system_error(hr, std::system_category(), "ID2D1RenderTarget::CreateBitmapFromWicBitmap");
+			throw std::system_error(hr, std::system_category(), "ID2D1RenderTarget::CreateBitmap");
+		}
+
+		// An empty image has no rows to expand, and no pitch to divide by
+		if (!compact || !image.Width() || !image.Height())
+		{
+			_metrics.Record(Metrics::Timer::Upload, std::chrono::steady_clock::now() - start);
+			return bitmap;
 		}
 
-		if (_useCaching)
+		// Expanded a strip at a time, so that only the bitmap itself is ever full size
+		const uint32_t pitch = image.Width() * BytesPerPixel(PixelFormat::Bgr32);
+		const uint32_t rows = std::clamp(UploadStripBytes / pitch, 1u, image.Height());
+		const BufferPool::Buffer strip = BufferPool::Shared()->Allocate(size_t(pitch) * rows);
+
+		for (uint32_t top = 0; top < image.Height(); top += rows)
 		{
-			_cache.emplace(path, bitmap);
-			LOGD << L"Cached: " << path;
+			const uint32_t bottom = std::min(top + rows, image.Height());
+
+			for (uint32_t y = top; y < bottom; ++y)
+			{
+				ExpandToBgr32(
+					image.Format(),
+					image.Pixels().data() + size_t(y) * image.Stride(),
+					strip.get() + size_t(y - top) * pitch,
+					image.Width());
+			}
+
+			const D2D1_RECT_U rect = D2D1::RectU(0, top, image.Width(), bottom);
+
+			hr = bitmap->CopyFromMemory(&rect, strip.get(), pitch);
+
+			if (FAILED(hr))
+			{
+				throw std::system_error(hr, std::system_category(), "ID2D1Bitmap::CopyFromMemory");
+			}
 		}
 
+		_metrics.Record(Metrics::Timer::Upload, std::chrono::steady_clock::now() - start);
 		return bitmap;
 	}
 }
\ No newline at end of file
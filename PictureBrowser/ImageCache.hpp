@@ -1,35 +1,179 @@
 #pragma once
 
+#include "DecodePipeline.hpp"
+#include "Image.hpp"
+#include "ImageSource.hpp"
+#include "LruCache.hpp"
+#include "MemoryPressure.hpp"
+#include "Metrics.hpp"
+#include "PathTable.hpp"
+#include "PreviewStore.hpp"
+#include "ReadAhead.hpp"
+#include "TilePyramid.hpp"
+
 namespace PictureBrowser
 {
 	class ImageCache
 	{
 	public:
+		enum class State
+		{
+			Pending,
+			// A preview embedded in the file is showing, the decode goes on
+			Preview,
+			Ready,
+			Failed
+		};
+
+		struct Tile
+		{
+			ComPtr<ID2D1Bitmap> Bitmap;
+			D2D_RECT_F Destination;
+		};
+
 		ImageCache() = default;
-		ImageCache(bool useCaching);
+		ImageCache(bool useCaching, size_t budget, size_t tileBudget, size_t threads, std::unique_ptr<PreviewStore>&& previewStore);
 		~ImageCache();
 
-		bool SetCurrent(const std::filesystem::path& path);
+		// Called on a worker thread whenever a decode finishes
+		void SetDecodedCallback(const std::function<void()>& decodedCallback);
+
+		// The images are keyed by the IDs of this table, it is emptied by Clear()
+		PathTable& Paths();
+
+		// Makes the path the current image, if it is cached. Otherwise decodes it in the background.
+		// Only the latest request counts, older ones are dropped if their decode has not started yet.
+		State Request(PathId path);
+
+		// Call after the decoded callback to check whether the latest request is done
+		State Complete();
+		const std::filesystem::path& Requested() const;
+		const std::filesystem::path& CurrentPath() const;
+
 		ComPtr<ID2D1Bitmap> Current();
-		ComPtr<ID2D1Bitmap> Get(const std::filesystem::path& path);
+
+		// Sharper parts of a very large image, to be drawn over Current() when zoomed in.
+		// The target is where the whole image goes, the missing tiles are cut in the background.
+		std::vector<Tile> Tiles(const D2D_RECT_F& target, const D2D_SIZE_F& viewport);
+
 		bool RemoveFile(const std::filesystem::path& path);
 
+		// Drops the decoded pixels of a file which changed or went away, the current image stays on screen
+		void Invalidate(const std::filesystem::path& path);
+
+		// Like Invalidate(), for every decoded file written to since then, when the watcher lost track of which were
+		void InvalidateWrittenSince(std::filesystem::file_time_type since);
+
+		// Decodes the given images in the background, so that stepping onto them is a cache hit.
+		// The first ones are the likeliest next, the farther ones yield to them.
+		void Prefetch(const std::vector<PathId>& paths);
+
 		void Clear();
 
+		// The size the canvas fits the images to, decodes do not go past it
+		void SetDisplaySize(uint32_t width, uint32_t height);
+
+		// How many times larger than the display size the current image is drawn.
+		// Decodes it in full, if the pixels at hand do not suffice.
+		void Magnify(float magnification);
+
+		// The decoded images, the full resolution behind the tiles and the idle pixel buffers kept for reuse,
+		// which all count against the same budget
+		size_t ResidentBytes() const;
+
+		// Shrinks the cache a bit at a time while the source reports pressure, and stops prefetching under high pressure
+		void SetMemoryPressureSource(std::unique_ptr<MemoryPressureSource>&& pressureSource);
+		void CheckMemoryPressure();
+
+		// Makes every read of an image file take as long as it would at the given rate, zero turns it off.
+		// Stands in for slow removable media when measuring. Call before requesting anything.
+		void SetReadThrottle(uint64_t bytesPerSecond);
+
+		// Call after a paint, ends the time to first paint of the current image
+		void Painted();
+
+		// Call when a file or a folder is opened, after Clear(). The time to the first image and to the complete list
+		// are measured from here, Listed() ends the latter.
+		void Opened();
+		void Listed();
+
+		const Metrics& Stats() const;
+		std::string StatsJson() const;
+
 		// TODO: I hate this function
-		inline void SetRenderTarget(ID2D1RenderTarget* renderTarget)
-		{
-			_renderTarget = renderTarget;
-		}
+		void SetRenderTarget(ID2D1RenderTarget* renderTarget);
 
 	private:
-		ComPtr<ID2D1Bitmap> Load(const std::filesystem::path& path);
+		struct PendingDecode
+		{
+			std::shared_future<std::shared_ptr<const Image>> Result;
+
+			// The latest generation which still wants this decode
+			std::shared_ptr<std::atomic<uint64_t>> Generation;
+
+			// Lent to the embedded preview of the same file while the decode holds it
+			std::weak_ptr<ImageSource> Source;
+		};
+
+		void Submit(PathId path, uint64_t generation, Priority priority, bool fullSize);
+		void SubmitEmbedded(PathId path, uint64_t generation);
+		bool HarvestEmbedded();
+		void Harvest();
+		void MakeCurrent(const std::shared_ptr<const Image>& image);
+		void Refine();
+		void Show(const std::shared_ptr<const Image>& image, bool refined);
+		void SubmitTile(const TileKey& key);
+		bool HarvestTiles();
+		void ResetTiles();
+		ComPtr<ID2D1Bitmap> Upload(const Image& image);
+
+		PathTable _paths;
+
+		// Decoded pixels, which survive the render target.
+		// The full resolution of a tiled image is charged to the same budget while it is current.
+		const size_t _budget;
+		LruCache<PathId, std::shared_ptr<const Image>> _cache;
+		PathId _currentImage = NoPath;
+		std::shared_ptr<const Image> _currentPixels;
+		ComPtr<ID2D1Bitmap> _current;
+		PathId _requested = NoPath;
+		PathId _refining = NoPath;
+		std::chrono::steady_clock::time_point _requestTime;
+		uint32_t _displayWidth = 0;
+		uint32_t _displayHeight = 0;
+		float _magnification = 1.0f;
+		bool _awaitingPaint = false;
+		bool _awaitingPixels = false;
+		bool _previewShown = false;
+		std::chrono::steady_clock::time_point _openTime;
+		bool _awaitingOpen = false;
+		std::unordered_map<PathId, PendingDecode> _pending;
+
+		// The embedded preview of the latest request, while its decode runs
+		PathId _previewing = NoPath;
+		std::shared_future<std::shared_ptr<const Image>> _embedded;
+
+		// Prefetched, but not yet looked at
+		std::unordered_set<PathId> _unseen;
+		std::unique_ptr<MemoryPressureSource> _pressureSource;
+		MemoryPressure _pressure = MemoryPressure::None;
+
+		// The full resolution of a current image, which is too large for a single bitmap
+		std::shared_ptr<const Image> _fullPixels;
+		std::optional<TilePyramid> _pyramid;
+		LruCache<TileKey, ComPtr<ID2D1Bitmap>, TileKeyHash> _tiles;
+		std::unordered_map<TileKey, std::shared_future<std::shared_ptr<const Image>>, TileKeyHash> _pendingTiles;
+
+		// Stopped whenever the tiles are reset, so that the cuts still queued are dropped
+		std::stop_source _tileCancel;
 
-		std::map<std::filesystem::path, ComPtr<ID2D1Bitmap>> _cache = { { L"", nullptr } };
-		std::filesystem::path _currentImage;
-		bool _useCaching = true;
+		std::atomic<uint64_t> _generation = 0;
+		Metrics _metrics;
+		std::function<void()> _decodedCallback;
 
 		ID2D1RenderTarget* _renderTarget = nullptr;
-		ComPtr<IWICImagingFactory> _wicFactory;
+		std::unique_ptr<PreviewStore> _previewStore;
+		std::unique_ptr<ReadAhead> _readAhead;
+		std::unique_ptr<DecodePipeline> _pipeline;
 	};
 }
\ No newline at end of file
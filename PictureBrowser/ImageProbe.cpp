@@ -0,0 +1,930 @@
+#include "PCH.hpp"
+#include "ImageProbe.hpp"
+#include "FileNames.hpp"
+#include "MappedFile.hpp"
+
+namespace PictureBrowser
+{
+	constexpr uint16_t TagPanasonicJpeg = 0x002E;
+	constexpr uint16_t TagImageWidth = 0x0100;
+	constexpr uint16_t TagImageHeight = 0x0101;
+	constexpr uint16_t TagCompression = 0x0103;
+	constexpr uint16_t TagStripOffsets = 0x0111;
+	constexpr uint16_t TagOrientation = 0x0112;
+	constexpr uint16_t TagStripBytes = 0x0117;
+	constexpr uint16_t TagSubIfds = 0x014A;
+	constexpr uint16_t TagThumbnailOffset = 0x0201;
+	constexpr uint16_t TagThumbnailBytes = 0x0202;
+	constexpr uint16_t TagExifIfd = 0x8769;
+	constexpr uint16_t TagDateTimeOriginal = 0x9003;
+	constexpr uint16_t TagMpEntry = 0xB002;
+
+	// The MP entry attributes of the large thumbnails, VGA and full HD equivalent
+	constexpr uint32_t MpLargeThumbnailVga = 0x010001;
+	constexpr uint32_t MpLargeThumbnailFullHd = 0x010002;
+	constexpr uint32_t MpTypeMask = 0xFFFFFF;
+
+	constexpr uint16_t TypeShort = 3;
+	constexpr uint16_t TypeLong = 4;
+	constexpr uint16_t TypeUndefined = 7;
+	constexpr uint16_t TypeIfd = 13;
+
+	constexpr uint32_t CompressionOldJpeg = 6;
+	constexpr uint32_t CompressionJpeg = 7;
+
+	// The TIFF magic number, and the ones of Panasonic and Olympus
+	constexpr uint16_t TiffMagic = 42;
+	constexpr uint16_t PanasonicMagic = 0x55;
+	constexpr uint16_t OlympusMagic = 0x4F52;
+	constexpr uint16_t OlympusMagicS = 0x5352;
+
+	// More than any camera writes, a sign of garbage
+	constexpr uint16_t MaxIfdEntries = 1000;
+	constexpr size_t MaxIfds = 64;
+	constexpr uint32_t MaxSubIfds = 16;
+
+	constexpr uint32_t FourCc(const char (&text)[5])
+	{
+		return uint32_t(uint8_t(text[0])) << 24 | uint32_t(uint8_t(text[1])) << 16 | uint32_t(uint8_t(text[2])) << 8 | uint8_t(text[3]);
+	}
+
+	// The Canon boxes of a CR3 file, the metadata in the movie box and the preview next to it
+	constexpr uint8_t CanonUuid[] = { 0x85, 0xC0, 0xB6, 0x87, 0x82, 0x0F, 0x11, 0xE0, 0x81, 0x11, 0xF4, 0xCE, 0x46, 0x2B, 0x6A, 0x48 };
+	constexpr uint8_t CanonPreviewUuid[] = { 0xEA, 0xF4, 0x2B, 0x5E, 0x1C, 0x98, 0x4B, 0x88, 0xB9, 0xFB, 0xB7, 0xDC, 0x40, 0x6E, 0x4D, 0x16 };
+
+	constexpr char FujifilmMagic[] = "FUJIFILMCCD-RAW ";
+	constexpr size_t FujifilmJpegPointer = 84;
+
+	uint16_t BigEndian16(const uint8_t* data)
+	{
+		return static_cast<uint16_t>(data[0] << 8 | data[1]);
+	}
+
+	uint32_t BigEndian32(const uint8_t* data)
+	{
+		return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+	}
+
+	uint64_t BigEndian64(const uint8_t* data)
+	{
+		return uint64_t(BigEndian32(data)) << 32 | BigEndian32(data + 4);
+	}
+
+	// A TIFF header and what follows it, with offsets relative to the header
+	struct Tiff
+	{
+		std::span<const uint8_t> Data;
+		bool BigEndian = false;
+
+		bool Fits(uint64_t offset, uint64_t bytes) const
+		{
+			return offset <= Data.size() && bytes <= Data.size() - offset;
+		}
+
+		uint16_t Read16(uint64_t offset) const
+		{
+			const uint8_t* data = Data.data() + offset;
+			return BigEndian ? BigEndian16(data) : static_cast<uint16_t>(data[0] | data[1] << 8);
+		}
+
+		uint32_t Read32(uint64_t offset) const
+		{
+			const uint8_t* data = Data.data() + offset;
+			return BigEndian ? BigEndian32(data) : uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+		}
+	};
+
+	// "YYYY:MM:DD HH:MM:SS"
+	std::optional<std::chrono::local_seconds> ParseDateTime(std::span<const uint8_t> text)
+	{
+		if (text.size() < 19)
+		{
+			return std::nullopt;
+		}
+
+		const auto number = [&text](size_t offset, size_t digits) -> std::optional<int>
+		{
+			int value = 0;
+
+			for (size_t i = offset; i < offset + digits; ++i)
+			{
+				if (text[i] < '0' || text[i] > '9')
+				{
+					return std::nullopt;
+				}
+
+				value = value * 10 + (text[i] - '0');
+			}
+
+			return value;
+		};
+
+		const auto year = number(0, 4);
+		const auto month = number(5, 2);
+		const auto day = number(8, 2);
+		const auto hour = number(11, 2);
+		const auto minute = number(14, 2);
+		const auto second = number(17, 2);
+
+		if (!year || !month || !day || !hour || !minute || !second ||
+			*hour > 23 || *minute > 59 || *second > 60)
+		{
+			return std::nullopt;
+		}
+
+		const std::chrono::year_month_day date(
+			std::chrono::year(*year),
+			std::chrono::month(static_cast<unsigned>(*month)),
+			std::chrono::day(static_cast<unsigned>(*day)));
+
+		if (!date.ok())
+		{
+			return std::nullopt;
+		}
+
+		return std::chrono::local_days(date) +
+			std::chrono::hours(*hour) +
+			std::chrono::minutes(*minute) +
+			std::chrono::seconds(*second);
+	}
+
+	// Calls the visitor with the tag, type, count and the offset of the value field of each entry.
+	// Returns the offset of the next IFD, zero if there is none or the IFD is broken.
+	template <typename Visitor>
+	uint32_t VisitIfd(const Tiff& tiff, uint32_t offset, Visitor&& visitor)
+	{
+		if (!offset || !tiff.Fits(offset, 2))
+		{
+			return 0;
+		}
+
+		const uint16_t entries = tiff.Read16(offset);
+
+		if (entries > MaxIfdEntries || !tiff.Fits(offset + 2ull, entries * 12ull + 4))
+		{
+			return 0;
+		}
+
+		for (uint32_t i = 0; i < entries; ++i)
+		{
+			const uint64_t entry = offset + 2ull + i * 12ull;
+			visitor(tiff.Read16(entry), tiff.Read16(entry + 2), tiff.Read32(entry + 4), entry + 8);
+		}
+
+		return tiff.Read32(offset + 2ull + entries * 12ull);
+	}
+
+	// SHORT or LONG values which fit in the entry itself
+	std::optional<uint32_t> Number(const Tiff& tiff, uint16_t type, uint32_t count, uint64_t value)
+	{
+		if (count != 1)
+		{
+			return std::nullopt;
+		}
+
+		if (type == TypeShort)
+		{
+			return tiff.Read16(value);
+		}
+
+		if (type == TypeLong)
+		{
+			return tiff.Read32(value);
+		}
+
+		return std::nullopt;
+	}
+
+	bool ParseTiffHeader(std::span<const uint8_t> data, Tiff& tiff)
+	{
+		tiff.Data = data;
+
+		if (!tiff.Fits(0, 8))
+		{
+			return false;
+		}
+
+		if (data[0] == 'M' && data[1] == 'M')
+		{
+			tiff.BigEndian = true;
+		}
+		else if (data[0] != 'I' || data[1] != 'I')
+		{
+			return false;
+		}
+
+		const uint16_t magic = tiff.Read16(2);
+		return magic == TiffMagic || magic == PanasonicMagic || magic == OlympusMagic || magic == OlympusMagicS;
+	}
+
+	// The TIFF files themselves have their size in IFD0, the EXIF blocks of other formats only describe the thumbnail there
+	bool ParseTiff(std::span<const uint8_t> data, uint64_t fileOffset, bool sizeInIfd0, ImageInfo& info)
+	{
+		Tiff tiff;
+
+		if (!ParseTiffHeader(data, tiff))
+		{
+			return false;
+		}
+
+		uint32_t exifIfd = 0;
+
+		const uint32_t ifd1 = VisitIfd(tiff, tiff.Read32(4), [&](uint16_t tag, uint16_t type, uint32_t count, uint64_t value)
+		{
+			const std::optional<uint32_t> number = Number(tiff, type, count, value);
+
+			if (!number)
+			{
+				return;
+			}
+
+			switch (tag)
+			{
+				case TagOrientation:
+					if (*number >= 1 && *number <= 8)
+					{
+						info.Orientation = static_cast<uint16_t>(*number);
+					}
+					break;
+				case TagExifIfd:
+					exifIfd = *number;
+					break;
+				case TagImageWidth:
+					if (sizeInIfd0)
+					{
+						info.Width = *number;
+					}
+					break;
+				case TagImageHeight:
+					if (sizeInIfd0)
+					{
+						info.Height = *number;
+					}
+					break;
+			}
+		});
+
+		VisitIfd(tiff, exifIfd, [&](uint16_t tag, uint16_t, uint32_t count, uint64_t value)
+		{
+			if (tag != TagDateTimeOriginal || count < 19)
+			{
+				return;
+			}
+
+			const uint32_t offset = tiff.Read32(value);
+
+			if (tiff.Fits(offset, count))
+			{
+				info.CaptureTime = ParseDateTime(data.subspan(offset, count));
+			}
+		});
+
+		uint32_t thumbnailOffset = 0;
+		uint32_t thumbnailBytes = 0;
+
+		VisitIfd(tiff, ifd1, [&](uint16_t tag, uint16_t type, uint32_t count, uint64_t value)
+		{
+			const std::optional<uint32_t> number = Number(tiff, type, count, value);
+
+			if (tag == TagThumbnailOffset && number)
+			{
+				thumbnailOffset = *number;
+			}
+			else if (tag == TagThumbnailBytes && number)
+			{
+				thumbnailBytes = *number;
+			}
+		});
+
+		if (thumbnailOffset && thumbnailBytes && tiff.Fits(thumbnailOffset, thumbnailBytes))
+		{
+			info.ThumbnailOffset = fileOffset + thumbnailOffset;
+			info.ThumbnailBytes = thumbnailBytes;
+		}
+
+		return true;
+	}
+
+	// The MP entries point past the APP2 segment, into the rest of the file
+	void ParseMpf(std::span<const uint8_t> segment, uint64_t mpfOffset, uint64_t fileBytes, ImageInfo& info)
+	{
+		Tiff tiff;
+
+		if (!ParseTiffHeader(segment, tiff))
+		{
+			return;
+		}
+
+		VisitIfd(tiff, tiff.Read32(4), [&](uint16_t tag, uint16_t, uint32_t count, uint64_t value)
+		{
+			const uint32_t offset = tiff.Read32(value);
+
+			if (tag != TagMpEntry || count % 16 || !tiff.Fits(offset, count))
+			{
+				return;
+			}
+
+			// The first entry is the primary image itself
+			for (uint32_t entry = offset + 16; entry < offset + count; entry += 16)
+			{
+				const uint32_t attribute = tiff.Read32(entry) & MpTypeMask;
+				const uint32_t bytes = tiff.Read32(entry + 4);
+				const uint64_t start = mpfOffset + tiff.Read32(entry + 8);
+
+				if ((attribute == MpLargeThumbnailVga || attribute == MpLargeThumbnailFullHd) &&
+					bytes > info.PreviewBytes &&
+					start <= fileBytes &&
+					bytes <= fileBytes - start)
+				{
+					info.PreviewOffset = start;
+					info.PreviewBytes = bytes;
+				}
+			}
+		});
+	}
+
+	bool IsStartOfFrame(uint8_t marker)
+	{
+		// C4, C8 and CC are Huffman tables, JPG extensions and arithmetic conditioning
+		return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+	}
+
+	// Calls the visitor with the marker, the payload and the offset of the payload of each segment before the
+	// entropy coded data, for as long as it returns true. Returns false if the markers are broken.
+	template <typename Visitor>
+	bool VisitJpegSegments(std::span<const uint8_t> data, Visitor&& visitor)
+	{
+		size_t offset = 2;
+
+		while (offset + 4 <= data.size())
+		{
+			if (data[offset] != 0xFF)
+			{
+				return false;
+			}
+
+			const uint8_t marker = data[offset + 1];
+
+			if (marker == 0xFF)
+			{
+				// Fill byte
+				++offset;
+				continue;
+			}
+
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+			{
+				offset += 2;
+				continue;
+			}
+
+			if (marker == 0xD9 || marker == 0xDA)
+			{
+				// The end of the image or the start of the entropy coded data, without a frame header
+				break;
+			}
+
+			const size_t length = BigEndian16(data.data() + offset + 2);
+
+			if (length < 2 || offset + 2 + length > data.size())
+			{
+				return false;
+			}
+
+			if (!visitor(marker, data.subspan(offset + 4, length - 2), offset + 4))
+			{
+				break;
+			}
+
+			offset += 2 + length;
+		}
+
+		return true;
+	}
+
+	std::optional<ImageInfo> ProbeJpeg(std::span<const uint8_t> data)
+	{
+		ImageInfo info;
+		info.Format = ImageFormat::Jpeg;
+
+		const bool intact = VisitJpegSegments(data, [&](uint8_t marker, std::span<const uint8_t> segment, size_t offset)
+		{
+			if (marker == 0xE1 && segment.size() > 6 && std::memcmp(segment.data(), "Exif\0\0", 6) == 0)
+			{
+				ParseTiff(segment.subspan(6), offset + 6, false, info);
+			}
+			else if (marker == 0xE2 && segment.size() > 4 && std::memcmp(segment.data(), "MPF\0", 4) == 0)
+			{
+				ParseMpf(segment.subspan(4), offset + 4, data.size(), info);
+			}
+			else if (IsStartOfFrame(marker) && segment.size() >= 5)
+			{
+				// The APP segments come before the frame, nothing after it matters
+				info.Height = BigEndian16(segment.data() + 1);
+				info.Width = BigEndian16(segment.data() + 3);
+				return false;
+			}
+
+			return true;
+		});
+
+		if (!intact)
+		{
+			return std::nullopt;
+		}
+
+		return info;
+	}
+
+	// A JPEG inside of a RAW file, the pixel count tells the previews apart
+	struct EmbeddedJpeg
+	{
+		uint64_t Offset;
+		uint32_t Bytes;
+		uint64_t Pixels;
+	};
+
+	// Keeps the JPEGs which WIC can decode: with their own quantization tables, and neither lossless nor arithmetic coded.
+	// The RAW data itself is often a lossless JPEG.
+	void AddJpeg(std::span<const uint8_t> file, uint64_t offset, uint64_t bytes, std::vector<EmbeddedJpeg>& jpegs)
+	{
+		if (!bytes || bytes > UINT32_MAX || offset > file.size() || bytes > file.size() - offset)
+		{
+			return;
+		}
+
+		const std::span<const uint8_t> data = file.subspan(static_cast<size_t>(offset), static_cast<size_t>(bytes));
+
+		if (data.size() < 4 || data[0] != 0xFF || data[1] != 0xD8)
+		{
+			return;
+		}
+
+		bool tables = false;
+		uint64_t pixels = 0;
+
+		VisitJpegSegments(data, [&](uint8_t marker, std::span<const uint8_t> segment, size_t)
+		{
+			if (marker == 0xDB)
+			{
+				tables = true;
+			}
+			else if (IsStartOfFrame(marker))
+			{
+				// Baseline, extended and progressive
+				if (tables && marker <= 0xC2 && segment.size() >= 5)
+				{
+					pixels = uint64_t(BigEndian16(segment.data() + 1)) * BigEndian16(segment.data() + 3);
+				}
+
+				return false;
+			}
+
+			return true;
+		});
+
+		if (pixels)
+		{
+			jpegs.push_back({ offset, static_cast<uint32_t>(bytes), pixels });
+		}
+	}
+
+	// The largest becomes the preview and the smallest the thumbnail
+	void PickPreviews(const std::vector<EmbeddedJpeg>& jpegs, ImageInfo& info)
+	{
+		if (jpegs.empty())
+		{
+			return;
+		}
+
+		const auto [smallest, largest] = std::minmax_element(jpegs.cbegin(), jpegs.cend(), [](const EmbeddedJpeg& a, const EmbeddedJpeg& b)
+		{
+			return a.Pixels < b.Pixels;
+		});
+
+		info.PreviewOffset = largest->Offset;
+		info.PreviewBytes = largest->Bytes;
+
+		if (smallest->Pixels < largest->Pixels)
+		{
+			info.ThumbnailOffset = smallest->Offset;
+			info.ThumbnailBytes = smallest->Bytes;
+		}
+	}
+
+	// Camera RAW files built on TIFF keep their previews all over the IFD chain and the SubIFDs
+	void FindTiffJpegs(std::span<const uint8_t> data, std::vector<EmbeddedJpeg>& jpegs)
+	{
+		Tiff tiff;
+
+		if (!ParseTiffHeader(data, tiff))
+		{
+			return;
+		}
+
+		std::vector<uint32_t> pending = { tiff.Read32(4) };
+		std::unordered_set<uint32_t> visited;
+
+		while (!pending.empty() && visited.size() < MaxIfds)
+		{
+			const uint32_t ifd = pending.back();
+			pending.pop_back();
+
+			if (!ifd || !visited.insert(ifd).second)
+			{
+				continue;
+			}
+
+			uint32_t compression = 0;
+			uint32_t stripOffset = 0;
+			uint32_t stripBytes = 0;
+			uint32_t jpegOffset = 0;
+			uint32_t jpegBytes = 0;
+
+			const uint32_t next = VisitIfd(tiff, ifd, [&](uint16_t tag, uint16_t type, uint32_t count, uint64_t value)
+			{
+				const std::optional<uint32_t> number = Number(tiff, type, count, value);
+
+				switch (tag)
+				{
+					case TagCompression:
+						compression = number.value_or(0);
+						break;
+					case TagStripOffsets:
+						// Only a single strip is a whole JPEG
+						stripOffset = number.value_or(0);
+						break;
+					case TagStripBytes:
+						stripBytes = number.value_or(0);
+						break;
+					case TagThumbnailOffset:
+						jpegOffset = number.value_or(0);
+						break;
+					case TagThumbnailBytes:
+						jpegBytes = number.value_or(0);
+						break;
+					case TagPanasonicJpeg:
+						if (type == TypeUndefined && count > 4)
+						{
+							AddJpeg(data, tiff.Read32(value), count, jpegs);
+						}
+						break;
+					case TagSubIfds:
+						if (type != TypeLong && type != TypeIfd)
+						{
+							break;
+						}
+
+						if (count == 1)
+						{
+							pending.push_back(tiff.Read32(value));
+							break;
+						}
+
+						for (uint32_t i = 0, offset = tiff.Read32(value); i < std::min(count, MaxSubIfds); ++i)
+						{
+							if (tiff.Fits(offset + i * 4ull, 4))
+							{
+								pending.push_back(tiff.Read32(offset + i * 4ull));
+							}
+						}
+						break;
+				}
+			});
+
+			if (compression == CompressionOldJpeg || compression == CompressionJpeg)
+			{
+				AddJpeg(data, stripOffset, stripBytes, jpegs);
+			}
+
+			AddJpeg(data, jpegOffset, jpegBytes, jpegs);
+			pending.push_back(next);
+		}
+	}
+
+	std::optional<ImageInfo> ProbeTiff(std::span<const uint8_t> data)
+	{
+		ImageInfo info;
+		info.Format = ImageFormat::Tiff;
+
+		if (!ParseTiff(data, 0, true, info))
+		{
+			return std::nullopt;
+		}
+
+		std::vector<EmbeddedJpeg> jpegs;
+		FindTiffJpegs(data, jpegs);
+		PickPreviews(jpegs, info);
+
+		return info;
+	}
+
+	// An ISO base media box, with the offset of its payload in the file
+	struct Box
+	{
+		std::span<const uint8_t> Payload;
+		uint64_t Offset = 0;
+
+		bool IsUuid(const uint8_t (&uuid)[16]) const
+		{
+			return Payload.size() >= 16 && std::memcmp(Payload.data(), uuid, 16) == 0;
+		}
+
+		// The payload of a uuid box after the uuid
+		Box Inner() const
+		{
+			return { Payload.subspan(16), Offset + 16 };
+		}
+	};
+
+	template <typename Visitor>
+	void VisitBoxes(const Box& parent, Visitor&& visitor)
+	{
+		const std::span<const uint8_t> data = parent.Payload;
+		size_t position = 0;
+
+		while (position + 8 <= data.size())
+		{
+			uint64_t size = BigEndian32(data.data() + position);
+			const uint32_t type = BigEndian32(data.data() + position + 4);
+			size_t header = 8;
+
+			if (size == 1)
+			{
+				if (position + 16 > data.size())
+				{
+					return;
+				}
+
+				size = BigEndian64(data.data() + position + 8);
+				header = 16;
+			}
+			else if (size == 0)
+			{
+				// Up to the end
+				size = data.size() - position;
+			}
+
+			if (size < header || size > data.size() - position)
+			{
+				return;
+			}
+
+			const size_t bytes = static_cast<size_t>(size);
+			visitor(type, Box{ data.subspan(position + header, bytes - header), parent.Offset + position + header });
+			position += bytes;
+		}
+	}
+
+	std::optional<Box> FindBox(const Box& parent, uint32_t type)
+	{
+		std::optional<Box> found;
+
+		VisitBoxes(parent, [&](uint32_t childType, const Box& child)
+		{
+			if (!found && childType == type)
+			{
+				found = child;
+			}
+		});
+
+		return found;
+	}
+
+	// Each CR3 track holds a single picture, the first one is a full size JPEG
+	void AddFirstSample(std::span<const uint8_t> file, const Box& track, std::vector<EmbeddedJpeg>& jpegs)
+	{
+		std::optional<Box> table = FindBox(track, FourCc("mdia"));
+
+		for (const uint32_t type : { FourCc("minf"), FourCc("stbl") })
+		{
+			if (table)
+			{
+				table = FindBox(*table, type);
+			}
+		}
+
+		if (!table)
+		{
+			return;
+		}
+
+		const std::optional<Box> sizes = FindBox(*table, FourCc("stsz"));
+		const std::optional<Box> offsets64 = FindBox(*table, FourCc("co64"));
+		const std::optional<Box> offsets32 = FindBox(*table, FourCc("stco"));
+
+		// Version and flags, then a size for all samples, or a count and a size for each
+		if (!sizes || sizes->Payload.size() < 12)
+		{
+			return;
+		}
+
+		const uint8_t* size = sizes->Payload.data();
+		uint32_t bytes = BigEndian32(size + 4);
+
+		if (!bytes && BigEndian32(size + 8) && sizes->Payload.size() >= 16)
+		{
+			bytes = BigEndian32(size + 12);
+		}
+
+		// Version and flags, a count and the offsets
+		uint64_t offset = 0;
+
+		if (offsets64 && offsets64->Payload.size() >= 16 && BigEndian32(offsets64->Payload.data() + 4))
+		{
+			offset = BigEndian64(offsets64->Payload.data() + 8);
+		}
+		else if (offsets32 && offsets32->Payload.size() >= 12 && BigEndian32(offsets32->Payload.data() + 4))
+		{
+			offset = BigEndian32(offsets32->Payload.data() + 8);
+		}
+
+		AddJpeg(file, offset, bytes, jpegs);
+	}
+
+	std::optional<ImageInfo> ProbeCr3(std::span<const uint8_t> data)
+	{
+		ImageInfo info;
+		info.Format = ImageFormat::Raw;
+
+		std::vector<EmbeddedJpeg> jpegs;
+
+		VisitBoxes(Box{ data, 0 }, [&](uint32_t type, const Box& box)
+		{
+			if (type == FourCc("uuid") && box.IsUuid(CanonPreviewUuid))
+			{
+				// Eight unknown bytes, then a PRVW box: eight unknown bytes, the size, the height, two unknown bytes and the JPEG size
+				const Box inner = box.Inner();
+
+				if (inner.Payload.size() >= 36 && BigEndian32(inner.Payload.data() + 12) == FourCc("PRVW"))
+				{
+					AddJpeg(data, inner.Offset + 36, BigEndian32(inner.Payload.data() + 32), jpegs);
+				}
+			}
+
+			if (type != FourCc("moov"))
+			{
+				return;
+			}
+
+			VisitBoxes(box, [&](uint32_t childType, const Box& child)
+			{
+				if (childType == FourCc("trak"))
+				{
+					AddFirstSample(data, child, jpegs);
+				}
+				else if (childType == FourCc("uuid") && child.IsUuid(CanonUuid))
+				{
+					VisitBoxes(child.Inner(), [&](uint32_t canonType, const Box& canon)
+					{
+						if (canonType == FourCc("CMT1"))
+						{
+							// IFD0 of the image, as a TIFF of its own
+							ParseTiff(canon.Payload, canon.Offset, true, info);
+						}
+						else if (canonType == FourCc("THMB") && canon.Payload.size() >= 16)
+						{
+							// Version and flags, the size, the JPEG size and four unknown bytes
+							AddJpeg(data, canon.Offset + 16, BigEndian32(canon.Payload.data() + 8), jpegs);
+						}
+					});
+				}
+			});
+		});
+
+		PickPreviews(jpegs, info);
+		return info;
+	}
+
+	// The header points at a JPEG, which has EXIF of its own
+	std::optional<ImageInfo> ProbeRaf(std::span<const uint8_t> data)
+	{
+		if (data.size() < FujifilmJpegPointer + 8)
+		{
+			return std::nullopt;
+		}
+
+		const uint32_t offset = BigEndian32(data.data() + FujifilmJpegPointer);
+		const uint32_t bytes = BigEndian32(data.data() + FujifilmJpegPointer + 4);
+
+		if (offset > data.size() || bytes > data.size() - offset)
+		{
+			return std::nullopt;
+		}
+
+		std::optional<ImageInfo> info = ProbeJpeg(data.subspan(offset, bytes));
+
+		if (!info)
+		{
+			return std::nullopt;
+		}
+
+		info->Format = ImageFormat::Raw;
+
+		std::vector<EmbeddedJpeg> jpegs;
+		AddJpeg(data, offset, bytes, jpegs);
+		AddJpeg(data, offset + info->ThumbnailOffset, info->ThumbnailBytes, jpegs);
+		AddJpeg(data, offset + info->PreviewOffset, info->PreviewBytes, jpegs);
+
+		info->ThumbnailOffset = 0;
+		info->ThumbnailBytes = 0;
+		PickPreviews(jpegs, *info);
+
+		return info;
+	}
+
+	std::optional<ImageInfo> ProbePng(std::span<const uint8_t> data)
+	{
+		ImageInfo info;
+		info.Format = ImageFormat::Png;
+
+		size_t offset = 8;
+
+		// Length, type, data and CRC
+		while (offset + 12 <= data.size())
+		{
+			const uint32_t length = BigEndian32(data.data() + offset);
+			const uint8_t* type = data.data() + offset + 4;
+
+			if (length > data.size() - offset - 12)
+			{
+				break;
+			}
+
+			const std::span<const uint8_t> chunk = data.subspan(offset + 8, length);
+
+			if (std::memcmp(type, "IHDR", 4) == 0 && length >= 8)
+			{
+				info.Width = BigEndian32(chunk.data());
+				info.Height = BigEndian32(chunk.data() + 4);
+			}
+			else if (std::memcmp(type, "eXIf", 4) == 0)
+			{
+				ParseTiff(chunk, offset + 8, false, info);
+			}
+			else if (std::memcmp(type, "IDAT", 4) == 0 || std::memcmp(type, "IEND", 4) == 0)
+			{
+				break;
+			}
+
+			offset += 12ull + length;
+		}
+
+		if (!info.Width || !info.Height)
+		{
+			return std::nullopt;
+		}
+
+		return info;
+	}
+
+	std::optional<ImageInfo> ProbeImage(std::span<const uint8_t> data)
+	{
+		constexpr uint8_t PngSignature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		if (data.size() >= 2 && data[0] == 0xFF && data[1] == 0xD8)
+		{
+			return ProbeJpeg(data);
+		}
+
+		if (data.size() >= sizeof(PngSignature) && std::memcmp(data.data(), PngSignature, sizeof(PngSignature)) == 0)
+		{
+			return ProbePng(data);
+		}
+
+		if (data.size() >= 12 && BigEndian32(data.data() + 4) == FourCc("ftyp") && BigEndian32(data.data() + 8) == FourCc("crx "))
+		{
+			return ProbeCr3(data);
+		}
+
+		if (data.size() >= sizeof(FujifilmMagic) - 1 && std::memcmp(data.data(), FujifilmMagic, sizeof(FujifilmMagic) - 1) == 0)
+		{
+			return ProbeRaf(data);
+		}
+
+		return ProbeTiff(data);
+	}
+
+	std::optional<ImageInfo> ProbeImage(const std::filesystem::path& path)
+	{
+		try
+		{
+			const MappedFile file(path);
+			return ProbeImage(file.Data());
+		}
+		catch (const std::system_error&)
+		{
+			return std::nullopt;
+		}
+	}
+
+	bool IsPreviewedRawFile(const std::filesystem::path& path)
+	{
+		return IsPreviewedRawExtension(path.extension().wstring());
+	}
+
+	bool IsPreviewedRawExtension(std::wstring_view extension)
+	{
+		return HasExtension(extension, PreviewedRawExtensions);
+	}
+}
\ No newline at end of file
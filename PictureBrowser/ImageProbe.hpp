@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Metrics.hpp"
+
+namespace PictureBrowser
+{
+	// What the headers tell about an image, without decoding any of it
+	struct ImageInfo
+	{
+		ImageFormat Format = ImageFormat::Other;
+
+		// As stored, before the orientation is applied. Zero if the headers do not say.
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+
+		// EXIF orientation, 1 is upright
+		uint16_t Orientation = 1;
+
+		// The EXIF DateTimeOriginal, in the local time of the camera
+		std::optional<std::chrono::local_seconds> CaptureTime;
+
+		// The embedded EXIF JPEG thumbnail, relative to the start of the file. Zero bytes if there is none.
+		uint64_t ThumbnailOffset = 0;
+		uint32_t ThumbnailBytes = 0;
+
+		// The largest Multi-Picture Format preview, usually a JPEG of one or two megapixels.
+		// For camera RAW files the largest embedded JPEG, often full size.
+		uint64_t PreviewOffset = 0;
+		uint32_t PreviewBytes = 0;
+	};
+
+	// Reads only the JPEG markers up to the first frame, the TIFF IFDs or the PNG chunks before the image data.
+	// Understands JPEG, TIFF and PNG, as well as the camera RAW files built on TIFF, CR3 and RAF.
+	// Anything else or a broken header gives nullopt.
+	std::optional<ImageInfo> ProbeImage(std::span<const uint8_t> data);
+
+	// Maps the file, so that only the pages holding the headers are ever read
+	std::optional<ImageInfo> ProbeImage(const std::filesystem::path& path);
+
+	// The camera RAW formats ProbeImage() finds the previews of, these are browsed by their largest preview
+	constexpr std::wstring_view PreviewedRawExtensions[] =
+	{
+		L".3FR", L".ARW", L".CR2", L".CR3", L".DCR", L".DNG", L".ERF", L".IIQ", L".K25", L".KDC", L".MEF",
+		L".MOS", L".NEF", L".NRW", L".ORF", L".PEF", L".RAF", L".RW2", L".RWL", L".SR2", L".SRF", L".SRW"
+	};
+
+	bool IsPreviewedRawFile(const std::filesystem::path& path);
+	bool IsPreviewedRawExtension(std::wstring_view extension);
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "PCH.hpp"
+#include "ImageSource.hpp"
+#include "ReadAhead.hpp"
+
+namespace PictureBrowser
+{
+	// Below this a single read is cheaper than setting up a mapping and faulting its pages in
+	constexpr uint64_t SingleReadBytes = 256 << 10;
+
+	bool IsRemote(const std::filesystem::path& path)
+	{
+		const std::wstring root = path.root_name().wstring();
+
+		if (root.starts_with(L"\\\\"))
+		{
+			return true;
+		}
+
+		return !root.empty() && GetDriveTypeW((root + L"\\").c_str()) == DRIVE_REMOTE;
+	}
+
+	FileBytes::FileBytes(const std::filesystem::path& path)
+	{
+		HANDLE file = CreateFileW(
+			path.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_DELETE,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr);
+
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw std::system_error(GetLastError(), std::system_category(), "CreateFileW");
+		}
+
+		try
+		{
+			LARGE_INTEGER size;
+
+			if (!GetFileSizeEx(file, &size))
+			{
+				throw std::system_error(GetLastError(), std::system_category(), "GetFileSizeEx");
+			}
+
+			const uint64_t bytes = static_cast<uint64_t>(size.QuadPart);
+
+			if (bytes > SingleReadBytes && !IsRemote(path))
+			{
+				// The mapping keeps the file open
+				_mapped = MappedFile(file, bytes);
+			}
+			else if (bytes)
+			{
+				if (bytes > SIZE_MAX)
+				{
+					throw std::runtime_error("The file does not fit in the address space!");
+				}
+
+				_size = static_cast<size_t>(bytes);
+				_buffer = BufferPool::Shared()->Allocate(_size);
+
+				for (size_t offset = 0; offset < _size;)
+				{
+					const DWORD chunk = static_cast<DWORD>(std::min<size_t>(_size - offset, MAXDWORD));
+					DWORD read = 0;
+
+					if (!ReadFile(file, _buffer.get() + offset, chunk, &read, nullptr))
+					{
+						throw std::system_error(GetLastError(), std::system_category(), "ReadFile");
+					}
+
+					if (!read)
+					{
+						throw std::runtime_error("The file was cut short while being read!");
+					}
+
+					offset += read;
+				}
+			}
+		}
+		catch (...)
+		{
+			CloseHandle(file);
+			throw;
+		}
+
+		CloseHandle(file);
+	}
+
+	FileBytes::FileBytes(BufferPool::Buffer&& buffer, size_t size) :
+		_buffer(std::move(buffer)),
+		_size(size)
+	{
+	}
+
+	std::span<const uint8_t> FileBytes::Data() const
+	{
+		return _buffer ? std::span<const uint8_t>(_buffer.get(), _size) : _mapped.Data();
+	}
+
+	uint64_t FileBytes::BytesRead() const
+	{
+		return _buffer ? _size : _mapped.ResidentBytes();
+	}
+
+	ImageSource::ImageSource(const std::filesystem::path& path, Metrics& metrics, ReadAhead& readAhead) :
+		_path(path),
+		_metrics(metrics),
+		_readAhead(readAhead)
+	{
+	}
+
+	ImageSource::~ImageSource()
+	{
+		if (_file)
+		{
+			_metrics.Add(Metrics::Counter::FilesRead);
+			_metrics.Add(Metrics::Counter::BytesRead, _file->BytesRead());
+		}
+	}
+
+	const std::filesystem::path& ImageSource::Path() const
+	{
+		return _path;
+	}
+
+	bool ImageSource::Opened() const
+	{
+		return _asked;
+	}
+
+	std::span<const uint8_t> ImageSource::Data()
+	{
+		std::call_once(_opened, &ImageSource::Open, this);
+		return _file->Data();
+	}
+
+	const std::optional<ImageInfo>& ImageSource::Info()
+	{
+		std::call_once(_opened, &ImageSource::Open, this);
+		return _info;
+	}
+
+	void ImageSource::Open()
+	{
+		_asked = true;
+		_file.emplace(_readAhead.Read(_path));
+
+		const auto start = std::chrono::steady_clock::now();
+
+		// Way cheaper than a metadata query reader, and only reads the pages holding the headers
+		_info = ProbeImage(_file->Data());
+		_metrics.Record(Metrics::Timer::Probe, std::chrono::steady_clock::now() - start);
+	}
+}
\ No newline at end of file
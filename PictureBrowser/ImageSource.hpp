@@ -0,0 +1,67 @@
+#pragma once
+
+#include "BufferPool.hpp"
+#include "ImageProbe.hpp"
+#include "MappedFile.hpp"
+#include "Metrics.hpp"
+
+namespace PictureBrowser
+{
+	class ReadAhead;
+
+	// The encoded bytes of a file, which the probe and the decoders read in place.
+	// Local files are mapped, so that only the pages somebody looks at come off the disk. Small files, where
+	// the mapping costs more than it saves, and files on network drives, where a lost connection would fault
+	// in the middle of a decode, come in with a single read into a pooled buffer.
+	class FileBytes
+	{
+	public:
+		explicit FileBytes(const std::filesystem::path& path);
+
+		// Read already, such as by ReadAhead
+		FileBytes(BufferPool::Buffer&& buffer, size_t size);
+
+		std::span<const uint8_t> Data() const;
+
+		// All of a read file, the resident pages of a mapped one
+		uint64_t BytesRead() const;
+
+	private:
+		MappedFile _mapped;
+		BufferPool::Buffer _buffer;
+		size_t _size = 0;
+	};
+
+	// A file opened and probed by whichever of the jobs sharing it gets there first, so that the embedded
+	// preview and the decode read the same memory. The bytes come from the read-ahead, which reads them on demand
+	// if it has not read them already. The bytes read are counted when the last job lets go of it. Thread safe.
+	class ImageSource
+	{
+	public:
+		ImageSource(const std::filesystem::path& path, Metrics& metrics, ReadAhead& readAhead);
+		~ImageSource();
+
+		ImageSource(const ImageSource&) = delete;
+		ImageSource& operator = (const ImageSource&) = delete;
+
+		const std::filesystem::path& Path() const;
+
+		// True once a job has asked for the bytes
+		bool Opened() const;
+
+		// Open the file on the first call, later calls wait for that. Throw if the file cannot be read.
+		std::span<const uint8_t> Data();
+		const std::optional<ImageInfo>& Info();
+
+	private:
+		void Open();
+
+		const std::filesystem::path _path;
+		Metrics& _metrics;
+		ReadAhead& _readAhead;
+		std::atomic<bool> _asked = false;
+		std::once_flag _opened;
+		std::optional<FileBytes> _file;
+		std::optional<ImageInfo> _info;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "PCH.hpp"
+#include "LibJpegDecoder.hpp"
+#include "ImageProbe.hpp"
+#include "LogWrap.hpp"
+#include "Orientation.hpp"
+
+#include <csetjmp>
+#include <jpeglib.h>
+
+#ifndef JCS_EXTENSIONS
+#error "libjpeg-turbo is needed, for the BGR output"
+#endif
+
+namespace PictureBrowser
+{
+	// libjpeg reports errors by calling error_exit, which must not return. It jumps back to the setjmp of the step
+	// which failed. Only the steps below call libjpeg, and none of them has a local with a destructor to skip.
+	struct JpegDecompress
+	{
+		jpeg_decompress_struct Info = {};
+		jpeg_error_mgr Errors = {};
+		std::jmp_buf Jump = {};
+		char Message[JMSG_LENGTH_MAX] = {};
+		bool Created = false;
+
+		JpegDecompress()
+		{
+			Info.err = jpeg_std_error(&Errors);
+			Info.client_data = this;
+
+			Errors.error_exit = [](j_common_ptr info)
+			{
+				JpegDecompress* self = static_cast<JpegDecompress*>(info->client_data);
+				info->err->format_message(info, self->Message);
+				std::longjmp(self->Jump, 1);
+			};
+
+			// Warnings, such as for a truncated file which is decoded as far as it goes, would go to stderr
+			Errors.output_message = [](j_common_ptr)
+			{
+			};
+		}
+
+		~JpegDecompress()
+		{
+			if (Created)
+			{
+				jpeg_destroy_decompress(&Info);
+			}
+		}
+
+		JpegDecompress(const JpegDecompress&) = delete;
+		JpegDecompress& operator = (const JpegDecompress&) = delete;
+	};
+
+	bool ReadHeader(JpegDecompress& jpeg, const uint8_t* data, size_t size)
+	{
+		if (setjmp(jpeg.Jump))
+		{
+			return false;
+		}
+
+		jpeg_create_decompress(&jpeg.Info);
+		jpeg.Created = true;
+
+		jpeg_mem_src(&jpeg.Info, data, static_cast<unsigned long>(size));
+		jpeg_read_header(&jpeg.Info, TRUE);
+		return true;
+	}
+
+	bool StartDecompress(JpegDecompress& jpeg)
+	{
+		if (setjmp(jpeg.Jump))
+		{
+			return false;
+		}
+
+		jpeg_start_decompress(&jpeg.Info);
+		return true;
+	}
+
+	bool ReadScanlines(JpegDecompress& jpeg, uint8_t* pixels, uint32_t stride)
+	{
+		if (setjmp(jpeg.Jump))
+		{
+			return false;
+		}
+
+		while (jpeg.Info.output_scanline < jpeg.Info.output_height)
+		{
+			JSAMPROW row = pixels + size_t(jpeg.Info.output_scanline) * stride;
+			jpeg_read_scanlines(&jpeg.Info, &row, 1);
+		}
+
+		jpeg_finish_decompress(&jpeg.Info);
+		return true;
+	}
+
+	void ThrowJpegError(const JpegDecompress& jpeg, std::string_view step)
+	{
+		throw std::runtime_error(std::string(step) + ": " + jpeg.Message);
+	}
+
+	// Photoshop writes inverted CMYK with an Adobe marker, as do most others, the rest write it plain.
+	// Turns the four bytes of each pixel into blue, green, red and an unused byte, in place.
+	void CmykToBgr32(std::span<uint8_t> pixels, bool inverted)
+	{
+		for (size_t i = 0; i + 4 <= pixels.size(); i += 4)
+		{
+			uint32_t c = pixels[i];
+			uint32_t m = pixels[i + 1];
+			uint32_t y = pixels[i + 2];
+			uint32_t k = pixels[i + 3];
+
+			if (!inverted)
+			{
+				c = 255 - c;
+				m = 255 - m;
+				y = 255 - y;
+				k = 255 - k;
+			}
+
+			pixels[i] = static_cast<uint8_t>((y * k + 127) / 255);
+			pixels[i + 1] = static_cast<uint8_t>((m * k + 127) / 255);
+			pixels[i + 2] = static_cast<uint8_t>((c * k + 127) / 255);
+			pixels[i + 3] = 0xFF;
+		}
+	}
+
+	// The largest of 1/8, 1/4 and 1/2 which still leaves at least width x height, or 1
+	uint32_t ScaleDenominator(uint32_t frameWidth, uint32_t frameHeight, uint32_t width, uint32_t height)
+	{
+		for (uint32_t denominator : { 8u, 4u, 2u })
+		{
+			const uint32_t scaledWidth = (frameWidth + denominator - 1) / denominator;
+			const uint32_t scaledHeight = (frameHeight + denominator - 1) / denominator;
+
+			if (scaledWidth >= width && scaledHeight >= height)
+			{
+				return denominator;
+			}
+		}
+
+		return 1;
+	}
+
+	std::wstring_view LibJpegDecoder::Name() const
+	{
+		return L"libjpeg-turbo";
+	}
+
+	bool LibJpegDecoder::Supports(ImageFormat format) const
+	{
+		return format == ImageFormat::Jpeg;
+	}
+
+	DecodedImage LibJpegDecoder::Decode(
+		std::span<const uint8_t> data,
+		uint32_t maxWidth,
+		uint32_t maxHeight,
+		std::optional<uint16_t> orientation)
+	{
+		if (!orientation)
+		{
+			const std::optional<ImageInfo> info = ProbeImage(data);
+			orientation = info ? info->Orientation : 1;
+		}
+
+		JpegDecompress jpeg;
+
+		if (!ReadHeader(jpeg, data.data(), data.size()))
+		{
+			ThrowJpegError(jpeg, "jpeg_read_header");
+		}
+
+		const uint32_t frameWidth = jpeg.Info.image_width;
+		const uint32_t frameHeight = jpeg.Info.image_height;
+
+		PixelFormat format = PixelFormat::Bgr24;
+
+		switch (jpeg.Info.jpeg_color_space)
+		{
+			case JCS_GRAYSCALE:
+				jpeg.Info.out_color_space = JCS_GRAYSCALE;
+				format = PixelFormat::Gray8;
+				break;
+			case JCS_CMYK:
+			case JCS_YCCK:
+				// Converted in place once decoded, four bytes either way
+				jpeg.Info.out_color_space = JCS_CMYK;
+				format = PixelFormat::Bgr32;
+				break;
+			default:
+				jpeg.Info.out_color_space = JCS_EXT_BGR;
+				break;
+		}
+
+		// Until oriented, the frame is sideways compared to the canvas
+		if (SwapsSides(*orientation))
+		{
+			std::swap(maxWidth, maxHeight);
+		}
+
+		const bool fits = !maxWidth || !maxHeight || (frameWidth <= maxWidth && frameHeight <= maxHeight);
+
+		if (!fits)
+		{
+			const double scale = std::min(double(maxWidth) / frameWidth, double(maxHeight) / frameHeight);
+
+			jpeg.Info.scale_num = 1;
+			jpeg.Info.scale_denom = ScaleDenominator(
+				frameWidth,
+				frameHeight,
+				std::max(1u, static_cast<uint32_t>(frameWidth * scale)),
+				std::max(1u, static_cast<uint32_t>(frameHeight * scale)));
+
+			// Fast enough, and the downscale below averages away the difference to the accurate one
+			jpeg.Info.dct_method = JDCT_IFAST;
+		}
+
+		if (!StartDecompress(jpeg))
+		{
+			ThrowJpegError(jpeg, "jpeg_start_decompress");
+		}
+
+		auto image = std::make_shared<Image>(jpeg.Info.output_width, jpeg.Info.output_height, format);
+
+		if (!ReadScanlines(jpeg, image->Pixels().data(), image->Stride()))
+		{
+			ThrowJpegError(jpeg, "jpeg_read_scanlines");
+		}
+
+		if (format == PixelFormat::Bgr32)
+		{
+			CmykToBgr32(image->Pixels(), jpeg.Info.saw_Adobe_marker);
+		}
+
+		if (!fits)
+		{
+			LOGD << L"Natively scaled " << frameWidth << L"x" << frameHeight << L" to "
+				<< image->Width() << L"x" << image->Height();
+
+			// The native scaling only goes in powers of two
+			if (image->Width() > maxWidth || image->Height() > maxHeight)
+			{
+				image = Downscale(*image, maxWidth, maxHeight);
+			}
+		}
+
+		image->SetSourceSize(frameWidth, frameHeight);
+		return { image, ImageFormat::Jpeg, *orientation };
+	}
+}
\ No newline at end of file
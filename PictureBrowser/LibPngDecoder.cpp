@@ -0,0 +1,84 @@
+#include "PCH.hpp"
+#include "LibPngDecoder.hpp"
+#include "ImageProbe.hpp"
+#include "Orientation.hpp"
+
+#include <png.h>
+
+namespace PictureBrowser
+{
+	// Frees what libpng allocated unless a failed call did already, which png_image_free allows for
+	struct PngImage : png_image
+	{
+		PngImage() : png_image()
+		{
+			version = PNG_IMAGE_VERSION;
+		}
+
+		~PngImage()
+		{
+			png_image_free(this);
+		}
+
+		PngImage(const PngImage&) = delete;
+		PngImage& operator = (const PngImage&) = delete;
+	};
+
+	std::wstring_view LibPngDecoder::Name() const
+	{
+		return L"libpng";
+	}
+
+	bool LibPngDecoder::Supports(ImageFormat format) const
+	{
+		return format == ImageFormat::Png;
+	}
+
+	DecodedImage LibPngDecoder::Decode(
+		std::span<const uint8_t> data,
+		uint32_t maxWidth,
+		uint32_t maxHeight,
+		std::optional<uint16_t> orientation)
+	{
+		if (!orientation)
+		{
+			const std::optional<ImageInfo> info = ProbeImage(data);
+			orientation = info ? info->Orientation : 1;
+		}
+
+		PngImage png;
+
+		if (!png_image_begin_read_from_memory(&png, data.data(), data.size()))
+		{
+			throw std::runtime_error(std::string("png_image_begin_read_from_memory: ") + png.message);
+		}
+
+		// Palettes are expanded, 16 bits are brought down to 8. Transparency is not shown.
+		const bool gray = !(png.format & PNG_FORMAT_FLAG_COLOR);
+		const PixelFormat format = gray ? PixelFormat::Gray8 : PixelFormat::Bgr24;
+		png.format = gray ? PNG_FORMAT_GRAY : PNG_FORMAT_BGR;
+
+		auto image = std::make_shared<Image>(png.width, png.height, format);
+
+		// The stride counts components, which are bytes at 8 bits
+		const png_color black = { 0, 0, 0 };
+
+		if (!png_image_finish_read(&png, &black, image->Pixels().data(), static_cast<png_int_32>(image->Stride()), nullptr))
+		{
+			throw std::runtime_error(std::string("png_image_finish_read: ") + png.message);
+		}
+
+		// Until oriented, the frame is sideways compared to the canvas
+		if (SwapsSides(*orientation))
+		{
+			std::swap(maxWidth, maxHeight);
+		}
+
+		if (maxWidth && maxHeight && (image->Width() > maxWidth || image->Height() > maxHeight))
+		{
+			image = Downscale(*image, maxWidth, maxHeight);
+		}
+
+		return { image, ImageFormat::Png, *orientation };
+	}
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Decoder.hpp"
+
+namespace PictureBrowser
+{
+	// libpng through its simplified API. Built by CMake where the library is found.
+	class LibPngDecoder : public Decoder
+	{
+	public:
+		std::wstring_view Name() const override;
+		bool Supports(ImageFormat format) const override;
+
+		DecodedImage Decode(
+			std::span<const uint8_t> data,
+			uint32_t maxWidth,
+			uint32_t maxHeight,
+			std::optional<uint16_t> orientation) override;
+	};
+}
\ No newline at end of file
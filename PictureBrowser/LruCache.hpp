@@ -0,0 +1,171 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// A least recently used cache with a byte budget.
+	// The caller tells the size of each entry when inserting,
+	// the least recently used entries are evicted once the budget is exceeded.
+	template <typename K, typename V, typename H = std::hash<K>>
+	class LruCache
+	{
+	public:
+		LruCache() = default;
+
+		explicit LruCache(size_t budget) :
+			_budget(budget)
+		{
+		}
+
+		// Returns nullptr if not found, otherwise marks the entry as most recently used
+		V* Find(const K& key)
+		{
+			const auto iter = _index.find(key);
+
+			if (iter == _index.end())
+			{
+				return nullptr;
+			}
+
+			_entries.splice(_entries.begin(), _entries, iter->second);
+			return &iter->second->Value;
+		}
+
+		bool Contains(const K& key) const
+		{
+			return _index.contains(key);
+		}
+
+		// Returns false if the entry alone would not fit in the budget
+		bool Insert(const K& key, V value, size_t bytes)
+		{
+			Erase(key);
+
+			if (bytes > _budget)
+			{
+				return false;
+			}
+
+			_entries.emplace_front(key, std::move(value), bytes);
+			_index.emplace(key, _entries.begin());
+			_bytes += bytes;
+
+			Shrink(_budget);
+			return true;
+		}
+
+		bool Erase(const K& key)
+		{
+			const auto iter = _index.find(key);
+
+			if (iter == _index.end())
+			{
+				return false;
+			}
+
+			_bytes -= iter->second->Bytes;
+			_entries.erase(iter->second);
+			_index.erase(iter);
+			return true;
+		}
+
+		void Clear()
+		{
+			_index.clear();
+			_entries.clear();
+			_bytes = 0;
+		}
+
+		// Evicts the least recently used entries until at most target bytes are resident
+		void Shrink(size_t target)
+		{
+			while (_bytes > target && !_entries.empty())
+			{
+				const Entry& last = _entries.back();
+				_bytes -= last.Bytes;
+				_index.erase(last.Key);
+				_entries.pop_back();
+				++_evictions;
+			}
+		}
+
+		// Like Shrink, but only evicts the entries the predicate picks, least recently used first
+		template <typename P>
+		void ShrinkIf(size_t target, P predicate)
+		{
+			auto iter = _entries.end();
+
+			while (_bytes > target && iter != _entries.begin())
+			{
+				--iter;
+
+				if (!predicate(iter->Key, iter->Value))
+				{
+					continue;
+				}
+
+				_bytes -= iter->Bytes;
+				_index.erase(iter->Key);
+				iter = _entries.erase(iter);
+				++_evictions;
+			}
+		}
+
+		// Erases whatever the predicate picks, such as entries which went stale. Not counted as evictions.
+		template <typename P>
+		void EraseIf(P predicate)
+		{
+			for (auto iter = _entries.begin(); iter != _entries.end();)
+			{
+				if (!predicate(iter->Key, iter->Value))
+				{
+					++iter;
+					continue;
+				}
+
+				_bytes -= iter->Bytes;
+				_index.erase(iter->Key);
+				iter = _entries.erase(iter);
+			}
+		}
+
+		void SetBudget(size_t budget)
+		{
+			_budget = budget;
+			Shrink(_budget);
+		}
+
+		size_t Budget() const
+		{
+			return _budget;
+		}
+
+		size_t Bytes() const
+		{
+			return _bytes;
+		}
+
+		size_t Count() const
+		{
+			return _index.size();
+		}
+
+		size_t Evictions() const
+		{
+			return _evictions;
+		}
+
+	private:
+		struct Entry
+		{
+			K Key;
+			V Value;
+			size_t Bytes;
+		};
+
+		std::list<Entry> _entries;
+		std::unordered_map<K, typename std::list<Entry>::iterator, H> _index;
+		size_t _budget = 0;
+		size_t _bytes = 0;
+		size_t _evictions = 0;
+	};
+}
\ No newline at end of file
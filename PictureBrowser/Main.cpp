@@ -1,10 +1,15 @@
 #include "PCH.hpp"
+#include "Benchmark.hpp"
 #include "MainWindow.hpp"
+#include "PreviewStore.hpp"
 #include "Resource.h"
 #include "LogWrap.hpp"
 
 namespace PictureBrowser
 {
+	// PictureBrowser.exe /benchmark <folder> decodes the folder without a window and exits
+	constexpr std::wstring_view BenchmarkSwitch = L"/benchmark ";
+
 	class ComEnvironment
 	{
 	public:
@@ -31,7 +36,7 @@ namespace PictureBrowser
 
 	std::filesystem::path TrimQuotes(std::wstring_view path)
 	{
-		if (path.front() == '"' && path.back() == '"')
+		if (path.size() >= 2 && path.front() == '"' && path.back() == '"')
 		{
 			path.remove_prefix(1);
 			path.remove_suffix(1);
@@ -59,6 +64,25 @@ int APIENTRY wWinMain(
 		return ERROR_BAD_ENVIRONMENT;
 	}
 
+	if (commandLine && std::wstring_view(commandLine).starts_with(BenchmarkSwitch))
+	{
+		try
+		{
+			RunDecodeBenchmark(
+				TrimQuotes(std::wstring_view(commandLine).substr(BenchmarkSwitch.size())),
+				PreviewStore::DefaultPath().replace_filename(L"Benchmark.json"),
+				static_cast<uint32_t>(GetSystemMetrics(SM_CXSCREEN)),
+				static_cast<uint32_t>(GetSystemMetrics(SM_CYSCREEN)));
+
+			return 0;
+		}
+		catch (const std::exception&)
+		{
+			LOGD << L"The benchmark failed!";
+			return ERROR_INVALID_FUNCTION;
+		}
+	}
+
 	MSG message;
 	ZeroInit(message);
 
@@ -9,6 +9,19 @@ namespace PictureBrowser
 	constexpr UINT ButtonWidth = 50;
 	constexpr UINT ButtonHeight = 25;
 	constexpr UINT FileListWidth = 250;
+	constexpr uint32_t DefaultCacheBudgetMB = sizeof(void*) == 8 ? 2048 : 512;
+	constexpr uint32_t DefaultPrefetchDepth = 2;
+	constexpr uint32_t DefaultPreviewStoreMB = sizeof(void*) == 8 ? 1024 : 256;
+	constexpr uint32_t DefaultTileCacheMB = sizeof(void*) == 8 ? 256 : 64;
+	constexpr UINT_PTR MemoryPressureTimer = 1;
+	constexpr UINT MemoryPressureInterval = 1000;
+
+	constexpr size_t CacheBudgetBytes(uint32_t megabytes)
+	{
+		// Keep the x86 build well within its address space
+		constexpr uint64_t limit = sizeof(void*) == 8 ? UINT64_MAX : 1024ull << 20;
+		return static_cast<size_t>(std::min(uint64_t(megabytes) << 20, limit));
+	}
 
 	MainWindow::MainWindow(HINSTANCE instance) :
 		Window(instance, 
@@ -46,6 +59,7 @@ namespace PictureBrowser
 			}
 			case WM_DESTROY:
 			{
+				KillTimer(*this, MemoryPressureTimer);
 				_fileListWidget->Clear();
 				PostQuitMessage(0);
 				break;
@@ -66,6 +80,15 @@ namespace PictureBrowser
 				OnDoubleClick();
 				break;
 			}
+			case WM_TIMER:
+			{
+				if (wParam == MemoryPressureTimer)
+				{
+					_imageCache->CheckMemoryPressure();
+				}
+
+				break;
+			}
 		}
 
 		return false;
@@ -147,7 +170,45 @@ namespace PictureBrowser
 		const bool useCaching = Registry::Get(L"Software\\PictureBrowser\\UseCaching", true);
 		SetCheckedState(IDM_OPTIONS_USE_CACHING, useCaching ? MFS_CHECKED : MFS_UNCHECKED);
 
-		_imageCache = std::make_shared<ImageCache>(useCaching);
+		const uint32_t cacheBudget = Registry::Get(L"Software\\PictureBrowser\\CacheBudgetMB", DefaultCacheBudgetMB);
+		const uint32_t prefetchDepth = Registry::Get(L"Software\\PictureBrowser\\PrefetchDepth", DefaultPrefetchDepth);
+		const uint32_t tileCacheBudget = Registry::Get(L"Software\\PictureBrowser\\TileCacheMB", DefaultTileCacheMB);
+		const size_t decodeThreads = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+
+		std::unique_ptr<PreviewStore> previewStore;
+
+		if (useCaching)
+		{
+			const uint32_t previewStoreSize = Registry::Get(L"Software\\PictureBrowser\\PreviewStoreMB", DefaultPreviewStoreMB);
+
+			try
+			{
+				previewStore = std::make_unique<PreviewStore>(
+					PreviewStore::DefaultPath(),
+					static_cast<uint32_t>(GetSystemMetrics(SM_CXSCREEN)),
+					static_cast<uint32_t>(GetSystemMetrics(SM_CYSCREEN)),
+					CacheBudgetBytes(previewStoreSize));
+			}
+			catch (const std::exception&)
+			{
+				LOGD << L"The preview store is not available!";
+			}
+		}
+
+		_imageCache = std::make_shared<ImageCache>(
+			useCaching,
+			CacheBudgetBytes(cacheBudget),
+			CacheBudgetBytes(tileCacheBudget),
+			decodeThreads,
+			std::move(previewStore));
+
+		// Simulates slow removable media, such as to see the reads going on while the decoders work.
+		// Widened before scaling, as anything from 4 GiB/s up would wrap around in 32 bits.
+		const uint32_t readThrottle = Registry::Get(L"Software\\PictureBrowser\\ReadThrottleKBps", 0u);
+		_imageCache->SetReadThrottle(uint64_t(readThrottle) * 1024);
+
+		_imageCache->SetMemoryPressureSource(std::make_unique<SystemMemoryPressure>());
+		SetTimer(*this, MemoryPressureTimer, MemoryPressureInterval, nullptr);
 
 		_canvasWidget = std::make_unique<CanvasWidget>(
 			Instance(),
@@ -164,7 +225,8 @@ namespace PictureBrowser
 			this,
 			_imageCache,
 			std::bind(&CanvasWidget::OnImageChanged, _canvasWidget.get(), std::placeholders::_1),
-			promptRawFileRemove);
+			promptRawFileRemove,
+			prefetchDepth);
 
 		_fileListWidget->Intercept(this);
 	}
@@ -275,6 +337,35 @@ namespace PictureBrowser
 
 				break;
 			}
+			case IDM_OPTIONS_SAVE_METRICS:
+			{
+				SaveMetrics();
+				break;
+			}
+		}
+	}
+
+	void MainWindow::SaveMetrics() const
+	{
+		try
+		{
+			const std::filesystem::path path = PreviewStore::DefaultPath().replace_filename(L"Metrics.json");
+			std::filesystem::create_directories(path.parent_path());
+
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file << _imageCache->StatsJson();
+
+			if (!file)
+			{
+				throw std::runtime_error("Failed to write the metrics!");
+			}
+
+			const std::wstring message = L"Saved to " + path.wstring();
+			MessageBoxW(message.c_str(), L"Metrics", MB_ICONINFORMATION | MB_OK);
+		}
+		catch (const std::exception& e)
+		{
+			::MessageBoxA(*this, e.what(), "An exception occurred!", MB_ICONSTOP | MB_OK);
 		}
 	}
 
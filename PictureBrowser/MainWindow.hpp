@@ -22,6 +22,7 @@ namespace PictureBrowser
 		void OnResize();
 		void OnCommand(WPARAM);
 		void OnDoubleClick();
+		void SaveMetrics() const;
 
 		UINT CheckedState(UINT menuEntry) const;
 		void SetCheckedState(UINT menuEntry, UINT state) const;
@@ -0,0 +1,248 @@
+#include "PCH.hpp"
+#include "MappedFile.hpp"
+
+namespace PictureBrowser
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::filesystem::path& path) :
+		_file(CreateFileW(
+			path.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_DELETE,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr)),
+		_ownsFile(true)
+	{
+		if (_file == INVALID_HANDLE_VALUE)
+		{
+			throw std::system_error(GetLastError(), std::system_category(), "CreateFileW");
+		}
+
+		LARGE_INTEGER size;
+
+		if (!GetFileSizeEx(_file, &size))
+		{
+			const DWORD error = GetLastError();
+			Close();
+			throw std::system_error(error, std::system_category(), "GetFileSizeEx");
+		}
+
+		Map(static_cast<uint64_t>(size.QuadPart));
+	}
+#else
+	MappedFile::MappedFile(const std::filesystem::path& path) :
+		_file(open(path.c_str(), O_RDONLY | O_CLOEXEC)),
+		_ownsFile(true)
+	{
+		if (_file == InvalidFile)
+		{
+			throw std::system_error(errno, std::generic_category(), "open");
+		}
+
+		struct stat status;
+
+		if (fstat(_file, &status) != 0)
+		{
+			const int error = errno;
+			Close();
+			throw std::system_error(error, std::generic_category(), "fstat");
+		}
+
+		// What FILE_FLAG_SEQUENTIAL_SCAN asks for on Windows, a failure costs only speed
+		posix_fadvise(_file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+		Map(static_cast<uint64_t>(status.st_size));
+	}
+#endif
+
+	MappedFile::MappedFile(FileHandle file, uint64_t size) :
+		_file(file),
+		_ownsFile(false)
+	{
+		Map(size);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept :
+		_file(std::exchange(other._file, InvalidFile)),
+		_ownsFile(std::exchange(other._ownsFile, false)),
+#ifdef _WIN32
+		_mapping(std::exchange(other._mapping, nullptr)),
+#endif
+		_view(std::exchange(other._view, nullptr)),
+		_size(std::exchange(other._size, 0))
+	{
+	}
+
+	MappedFile& MappedFile::operator = (MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			_file = std::exchange(other._file, InvalidFile);
+			_ownsFile = std::exchange(other._ownsFile, false);
+#ifdef _WIN32
+			_mapping = std::exchange(other._mapping, nullptr);
+#endif
+			_view = std::exchange(other._view, nullptr);
+			_size = std::exchange(other._size, 0);
+		}
+
+		return *this;
+	}
+
+	std::span<const uint8_t> MappedFile::Data() const
+	{
+		return { _view, _size };
+	}
+
+	uint64_t MappedFile::ResidentBytes() const
+	{
+		if (!_view)
+		{
+			return 0;
+		}
+
+#ifdef _WIN32
+		SYSTEM_INFO system;
+		GetSystemInfo(&system);
+
+		const size_t pageSize = system.dwPageSize;
+		std::vector<PSAPI_WORKING_SET_EX_INFORMATION> pages((_size + pageSize - 1) / pageSize);
+
+		for (size_t i = 0; i < pages.size(); ++i)
+		{
+			pages[i].VirtualAddress = const_cast<uint8_t*>(_view + i * pageSize);
+		}
+
+		if (!QueryWorkingSetEx(
+			GetCurrentProcess(),
+			pages.data(),
+			static_cast<DWORD>(pages.size() * sizeof(PSAPI_WORKING_SET_EX_INFORMATION))))
+		{
+			return 0;
+		}
+
+		uint64_t resident = 0;
+
+		for (const PSAPI_WORKING_SET_EX_INFORMATION& page : pages)
+		{
+			resident += page.VirtualAttributes.Valid ? pageSize : 0;
+		}
+#else
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		std::vector<unsigned char> pages((_size + pageSize - 1) / pageSize);
+
+		if (mincore(const_cast<uint8_t*>(_view), _size, pages.data()) != 0)
+		{
+			return 0;
+		}
+
+		uint64_t resident = 0;
+
+		for (unsigned char page : pages)
+		{
+			resident += (page & 1) ? pageSize : 0;
+		}
+#endif
+
+		return std::min<uint64_t>(resident, _size);
+	}
+
+	void MappedFile::Map(uint64_t size)
+	{
+		// Empty files cannot be mapped
+		if (!size)
+		{
+			return;
+		}
+
+		if (size > SIZE_MAX)
+		{
+			Close();
+			throw std::runtime_error("The file does not fit in the address space!");
+		}
+
+#ifdef _WIN32
+		_mapping = CreateFileMappingW(
+			_file,
+			nullptr,
+			PAGE_READONLY,
+			static_cast<DWORD>(size >> 32),
+			static_cast<DWORD>(size),
+			nullptr);
+
+		if (!_mapping)
+		{
+			const DWORD error = GetLastError();
+			Close();
+			throw std::system_error(error, std::system_category(), "CreateFileMappingW");
+		}
+
+		_view = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(size)));
+
+		if (!_view)
+		{
+			const DWORD error = GetLastError();
+			Close();
+			throw std::system_error(error, std::system_category(), "MapViewOfFile");
+		}
+#else
+		void* view = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, _file, 0);
+
+		if (view == MAP_FAILED)
+		{
+			const int error = errno;
+			Close();
+			throw std::system_error(error, std::generic_category(), "mmap");
+		}
+
+		_view = static_cast<const uint8_t*>(view);
+#endif
+
+		_size = static_cast<size_t>(size);
+	}
+
+	void MappedFile::Close()
+	{
+#ifdef _WIN32
+		if (_view)
+		{
+			UnmapViewOfFile(_view);
+			_view = nullptr;
+		}
+
+		if (_mapping)
+		{
+			CloseHandle(_mapping);
+			_mapping = nullptr;
+		}
+
+		if (_ownsFile && _file != InvalidFile)
+		{
+			CloseHandle(_file);
+		}
+#else
+		if (_view)
+		{
+			munmap(const_cast<uint8_t*>(_view), _size);
+			_view = nullptr;
+		}
+
+		if (_ownsFile && _file != InvalidFile)
+		{
+			close(_file);
+		}
+#endif
+
+		_file = InvalidFile;
+		_ownsFile = false;
+		_size = 0;
+	}
+}
\ No newline at end of file
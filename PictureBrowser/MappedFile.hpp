@@ -0,0 +1,48 @@
+#pragma once
+
+namespace PictureBrowser
+{
+#ifdef _WIN32
+	using FileHandle = HANDLE;
+	inline const FileHandle InvalidFile = INVALID_HANDLE_VALUE;
+#else
+	// A file descriptor
+	using FileHandle = int;
+	inline const FileHandle InvalidFile = -1;
+#endif
+
+	// A read-only view of a whole file
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::filesystem::path& path);
+
+		// Maps the first size bytes of an already opened file, which stays owned by the caller
+		MappedFile(FileHandle file, uint64_t size);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator = (const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator = (MappedFile&& other) noexcept;
+
+		std::span<const uint8_t> Data() const;
+
+		// The bytes of the view in the working set, which is about what has been read off the disk.
+		// Zero if that cannot be told.
+		uint64_t ResidentBytes() const;
+
+	private:
+		void Map(uint64_t size);
+		void Close();
+
+		FileHandle _file = InvalidFile;
+		bool _ownsFile = false;
+#ifdef _WIN32
+		HANDLE _mapping = nullptr;
+#endif
+		const uint8_t* _view = nullptr;
+		size_t _size = 0;
+	};
+}
\ No newline at end of file
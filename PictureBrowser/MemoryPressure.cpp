@@ -0,0 +1,133 @@
+#include "PCH.hpp"
+#include "MemoryPressure.hpp"
+#include "LogWrap.hpp"
+
+namespace PictureBrowser
+{
+	constexpr uint32_t ModerateMemoryLoad = 80;
+	constexpr uint32_t HighMemoryLoad = 90;
+
+	MemoryPressure PressureForLoad(uint32_t memoryLoad)
+	{
+		if (memoryLoad >= HighMemoryLoad)
+		{
+			return MemoryPressure::High;
+		}
+
+		if (memoryLoad >= ModerateMemoryLoad)
+		{
+			return MemoryPressure::Moderate;
+		}
+
+		return MemoryPressure::None;
+	}
+
+#ifdef _WIN32
+	constexpr uint64_t MinAvailableVirtual = 256ull << 20;
+
+	SystemMemoryPressure::SystemMemoryPressure() :
+		_lowMemory(CreateMemoryResourceNotification(LowMemoryResourceNotification))
+	{
+		if (!_lowMemory)
+		{
+			LOGD << L"CreateMemoryResourceNotification failed: " << GetLastError();
+		}
+	}
+
+	SystemMemoryPressure::~SystemMemoryPressure()
+	{
+		if (_lowMemory)
+		{
+			CloseHandle(_lowMemory);
+		}
+	}
+
+	MemoryPressure SystemMemoryPressure::Sample()
+	{
+		BOOL low = FALSE;
+
+		if (_lowMemory && QueryMemoryResourceNotification(_lowMemory, &low) && low)
+		{
+			return MemoryPressure::High;
+		}
+
+		MEMORYSTATUSEX status;
+		ZeroInit(status);
+		status.dwLength = sizeof(MEMORYSTATUSEX);
+
+		if (!GlobalMemoryStatusEx(&status))
+		{
+			return MemoryPressure::None;
+		}
+
+		// The x86 build runs out of address space long before the system runs out of memory
+		if (status.ullAvailVirtual < MinAvailableVirtual)
+		{
+			return MemoryPressure::High;
+		}
+
+		return PressureForLoad(status.dwMemoryLoad);
+	}
+#else
+	SystemMemoryPressure::SystemMemoryPressure() = default;
+	SystemMemoryPressure::~SystemMemoryPressure() = default;
+
+	MemoryPressure SystemMemoryPressure::Sample()
+	{
+		std::ifstream meminfo("/proc/meminfo");
+
+		uint64_t total = 0;
+		uint64_t available = 0;
+		std::string name;
+		uint64_t kilobytes = 0;
+		std::string unit;
+
+		while (meminfo >> name >> kilobytes >> unit)
+		{
+			if (name == "MemTotal:")
+			{
+				total = kilobytes;
+			}
+			else if (name == "MemAvailable:")
+			{
+				available = kilobytes;
+			}
+		}
+
+		if (!total || available > total)
+		{
+			return MemoryPressure::None;
+		}
+
+		return PressureForLoad(static_cast<uint32_t>(100 - available * 100 / total));
+	}
+#endif
+
+	FixedMemoryPressure::FixedMemoryPressure(MemoryPressure pressure) :
+		_pressure(pressure)
+	{
+	}
+
+	void FixedMemoryPressure::Set(MemoryPressure pressure)
+	{
+		_pressure = pressure;
+	}
+
+	MemoryPressure FixedMemoryPressure::Sample()
+	{
+		return _pressure;
+	}
+
+	size_t PressureTarget(size_t resident, MemoryPressure pressure)
+	{
+		switch (pressure)
+		{
+		case MemoryPressure::High:
+			return resident - resident / 4;
+		case MemoryPressure::Moderate:
+			return resident - resident / 8;
+		default:
+			return resident;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	enum class MemoryPressure
+	{
+		None,
+		Moderate,
+		High
+	};
+
+	// Tells how badly the system, or the process, is running out of memory
+	class MemoryPressureSource
+	{
+	public:
+		virtual ~MemoryPressureSource() = default;
+		virtual MemoryPressure Sample() = 0;
+	};
+
+	// On Windows the low memory resource notification, the system memory load and on x86 the free address space.
+	// Elsewhere the share of memory /proc/meminfo does not count as available.
+	class SystemMemoryPressure : public MemoryPressureSource
+	{
+	public:
+		SystemMemoryPressure();
+		~SystemMemoryPressure();
+
+		SystemMemoryPressure(const SystemMemoryPressure&) = delete;
+		SystemMemoryPressure& operator = (const SystemMemoryPressure&) = delete;
+
+		MemoryPressure Sample() override;
+
+#ifdef _WIN32
+	private:
+		HANDLE _lowMemory = nullptr;
+#endif
+	};
+
+	// Whatever it was told, so that the eviction order can be reproduced
+	class FixedMemoryPressure : public MemoryPressureSource
+	{
+	public:
+		explicit FixedMemoryPressure(MemoryPressure pressure = MemoryPressure::None);
+
+		void Set(MemoryPressure pressure);
+		MemoryPressure Sample() override;
+
+	private:
+		MemoryPressure _pressure;
+	};
+
+	// What a cache keeps of its resident bytes under the pressure.
+	// A slice at a time, so that a short spike does not wipe the whole cache.
+	size_t PressureTarget(size_t resident, MemoryPressure pressure);
+
+	// Evicts down to the target for the pressure, the entries matching the predicate first
+	// and the least recently used after them
+	template <typename Cache, typename Predicate>
+	void ShrinkForPressure(Cache& cache, MemoryPressure pressure, Predicate evictFirst)
+	{
+		const size_t target = PressureTarget(cache.Bytes(), pressure);
+
+		cache.ShrinkIf(target, evictFirst);
+		cache.Shrink(target);
+	}
+}
\ No newline at end of file
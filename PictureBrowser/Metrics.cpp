@@ -0,0 +1,192 @@
+#include "PCH.hpp"
+#include "Metrics.hpp"
+
+namespace PictureBrowser
+{
+	constexpr std::array<std::string_view, size_t(Metrics::Counter::Count)> CounterNames =
+	{
+		"cacheHits",
+		"cacheMisses",
+		"prefetchHits",
+		"previewHits",
+		"previewMisses",
+		"decodes",
+		"decodeFailures",
+		"dropped",
+		"refines",
+		"tilesCut",
+		"pressureShrinks",
+		"pressureEvictedBytes",
+		"embeddedPreviews",
+		"filesRead",
+		"bytesRead",
+		"readAheadHits",
+		"readAheadMisses"
+	};
+
+	constexpr std::array<std::string_view, size_t(Metrics::Timer::Count)> TimerNames =
+	{
+		"ready",
+		"firstPaint",
+		"firstPixels",
+		"previewLoad",
+		"tileCut",
+		"read",
+		"probe",
+		"orient",
+		"storePreview",
+		"upload",
+		"openFirstImage",
+		"openListed"
+	};
+
+	constexpr std::array<std::string_view, size_t(ImageFormat::Count)> FormatNames =
+	{
+		"jpeg",
+		"png",
+		"tiff",
+		"bmp",
+		"gif",
+		"heif",
+		"webp",
+		"raw",
+		"other"
+	};
+
+	void Histogram::Record(std::chrono::steady_clock::duration duration)
+	{
+		const uint64_t microseconds = static_cast<uint64_t>(
+			std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0));
+
+		const size_t bucket = std::min(static_cast<size_t>(std::bit_width(microseconds)), Buckets - 1);
+
+		_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		_count.fetch_add(1, std::memory_order_relaxed);
+		_total.fetch_add(microseconds, std::memory_order_relaxed);
+
+		uint64_t max = _max.load(std::memory_order_relaxed);
+
+		while (microseconds > max && !_max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	uint64_t Histogram::Count() const
+	{
+		return _count.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Histogram::TotalMicroseconds() const
+	{
+		return _total.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Histogram::MaxMicroseconds() const
+	{
+		return _max.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Histogram::PercentileMicroseconds(double percentile) const
+	{
+		const uint64_t count = Count();
+
+		if (!count)
+		{
+			return 0;
+		}
+
+		const uint64_t wanted = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(double(count) * percentile / 100.0)));
+		uint64_t seen = 0;
+
+		for (size_t bucket = 0; bucket < Buckets; ++bucket)
+		{
+			seen += _buckets[bucket].load(std::memory_order_relaxed);
+
+			if (seen >= wanted)
+			{
+				// Bucket n holds [2^(n-1), 2^n)
+				return std::min(uint64_t(1) << bucket, MaxMicroseconds());
+			}
+		}
+
+		return MaxMicroseconds();
+	}
+
+	std::string Histogram::ToJson() const
+	{
+		const uint64_t count = Count();
+
+		return std::format(
+			"{{\"count\": {}, \"meanUs\": {}, \"p50Us\": {}, \"p90Us\": {}, \"p99Us\": {}, \"maxUs\": {}}}",
+			count,
+			count ? TotalMicroseconds() / count : 0,
+			PercentileMicroseconds(50.0),
+			PercentileMicroseconds(90.0),
+			PercentileMicroseconds(99.0),
+			MaxMicroseconds());
+	}
+
+	void Metrics::Add(Counter counter, uint64_t value)
+	{
+		_counters[size_t(counter)].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	uint64_t Metrics::Value(Counter counter) const
+	{
+		return _counters[size_t(counter)].load(std::memory_order_relaxed);
+	}
+
+	void Metrics::Record(Timer timer, std::chrono::steady_clock::duration duration)
+	{
+		_timers[size_t(timer)].Record(duration);
+	}
+
+	void Metrics::RecordDecode(ImageFormat format, std::chrono::steady_clock::duration duration)
+	{
+		_decodes[size_t(format)].Record(duration);
+	}
+
+	const Histogram& Metrics::Get(Timer timer) const
+	{
+		return _timers[size_t(timer)];
+	}
+
+	const Histogram& Metrics::Decode(ImageFormat format) const
+	{
+		return _decodes[size_t(format)];
+	}
+
+	std::string Metrics::ToJson(const std::vector<std::pair<std::string_view, uint64_t>>& gauges) const
+	{
+		std::string json = "{\n\t\"counters\": {";
+
+		for (size_t i = 0; i < CounterNames.size(); ++i)
+		{
+			json += std::format("{}\n\t\t\"{}\": {}", i ? "," : "", CounterNames[i], _counters[i].load(std::memory_order_relaxed));
+		}
+
+		json += "\n\t},\n\t\"gauges\": {";
+
+		for (size_t i = 0; i < gauges.size(); ++i)
+		{
+			json += std::format("{}\n\t\t\"{}\": {}", i ? "," : "", gauges[i].first, gauges[i].second);
+		}
+
+		json += "\n\t},\n\t\"timers\": {";
+
+		for (size_t i = 0; i < TimerNames.size(); ++i)
+		{
+			json += std::format("{}\n\t\t\"{}\": {}", i ? "," : "", TimerNames[i], _timers[i].ToJson());
+		}
+
+		json += "\n\t},\n\t\"decode\": {";
+
+		for (size_t i = 0; i < FormatNames.size(); ++i)
+		{
+			json += std::format("{}\n\t\t\"{}\": {}", i ? "," : "", FormatNames[i], _decodes[i].ToJson());
+		}
+
+		json += "\n\t}\n}\n";
+		return json;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// Latencies in power of two buckets of microseconds. Lock free, may be recorded from any thread.
+	class Histogram
+	{
+	public:
+		static constexpr size_t Buckets = 32;
+
+		void Record(std::chrono::steady_clock::duration duration);
+
+		uint64_t Count() const;
+		uint64_t TotalMicroseconds() const;
+		uint64_t MaxMicroseconds() const;
+
+		// The upper bound of the bucket the percentile falls into
+		uint64_t PercentileMicroseconds(double percentile) const;
+
+		std::string ToJson() const;
+
+	private:
+		std::array<std::atomic<uint64_t>, Buckets> _buckets = {};
+		std::atomic<uint64_t> _count = 0;
+		std::atomic<uint64_t> _total = 0;
+		std::atomic<uint64_t> _max = 0;
+	};
+
+	enum class ImageFormat
+	{
+		Jpeg,
+		Png,
+		Tiff,
+		Bmp,
+		Gif,
+		Heif,
+		Webp,
+		// Camera RAW, shown by its embedded preview
+		Raw,
+		Other,
+		Count
+	};
+
+	// Always on, unlike LOGD, so that release builds can be measured on real workloads
+	class Metrics
+	{
+	public:
+		enum class Counter
+		{
+			CacheHits,
+			CacheMisses,
+			PrefetchHits,
+			PreviewHits,
+			PreviewMisses,
+			Decodes,
+			DecodeFailures,
+			Dropped,
+			Refines,
+			TilesCut,
+			PressureShrinks,
+			PressureEvictedBytes,
+			EmbeddedPreviews,
+			// Image files opened for decoding, and how many of their bytes came off the disk
+			FilesRead,
+			BytesRead,
+			// Files a decoder found read ahead, and ones it had to read itself
+			ReadAheadHits,
+			ReadAheadMisses,
+			Count
+		};
+
+		enum class Timer
+		{
+			// From the selection to the image being ready to draw
+			Ready,
+			// From the selection to the first paint which shows it
+			FirstPaint,
+			// From the selection to the first paint with any of its pixels, an embedded preview counts
+			FirstPixels,
+			PreviewLoad,
+			TileCut,
+			// From a decoder asking for the bytes of a file to having them, less with the read-ahead
+			Read,
+			// Reading the headers of a file, before decoding it
+			Probe,
+			// The later stages of the decode pipeline, the decode itself is timed by format
+			Orient,
+			StorePreview,
+			Upload,
+			// From opening a file or a folder to the first paint with pixels of any image in it
+			OpenFirstImage,
+			// From opening a file or a folder to the end of its enumeration
+			OpenListed,
+			Count
+		};
+
+		void Add(Counter counter, uint64_t value = 1);
+		uint64_t Value(Counter counter) const;
+
+		void Record(Timer timer, std::chrono::steady_clock::duration duration);
+		void RecordDecode(ImageFormat format, std::chrono::steady_clock::duration duration);
+
+		const Histogram& Get(Timer timer) const;
+		const Histogram& Decode(ImageFormat format) const;
+
+		// Gauges are owned by whoever asks for the dump, such as the resident bytes of a cache
+		std::string ToJson(const std::vector<std::pair<std::string_view, uint64_t>>& gauges) const;
+
+	private:
+		std::array<std::atomic<uint64_t>, size_t(Counter::Count)> _counters = {};
+		std::array<Histogram, size_t(Timer::Count)> _timers;
+		std::array<Histogram, size_t(ImageFormat::Count)> _decodes;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "PCH.hpp"
+#include "Orientation.hpp"
+
+namespace PictureBrowser
+{
+	// Transposes go through blocks of this many pixels per side, so that the source rows stay in the cache
+	constexpr uint32_t BlockSize = 64;
+
+	// Where the source pixel of the target pixel (x, y) is: Origin + x * StepX + y * StepY
+	struct Walk
+	{
+		const uint8_t* Origin;
+		ptrdiff_t StepX;
+		ptrdiff_t StepY;
+	};
+
+	Walk SourceWalk(const Image& source, uint16_t orientation)
+	{
+		const ptrdiff_t bytesPerPixel = BytesPerPixel(source.Format());
+		const ptrdiff_t stride = source.Stride();
+		const ptrdiff_t right = (ptrdiff_t(source.Width()) - 1) * bytesPerPixel;
+		const ptrdiff_t bottom = (ptrdiff_t(source.Height()) - 1) * stride;
+		const uint8_t* pixels = source.Pixels().data();
+
+		switch (orientation)
+		{
+			case 2: // Mirrored
+				return { pixels + right, -bytesPerPixel, stride };
+			case 3: // Upside down
+				return { pixels + bottom + right, -bytesPerPixel, -stride };
+			case 4: // Mirrored upside down
+				return { pixels + bottom, bytesPerPixel, -stride };
+			case 5: // Transposed
+				return { pixels, stride, bytesPerPixel };
+			case 6: // Needs a quarter turn clockwise
+				return { pixels + bottom, -stride, bytesPerPixel };
+			case 7: // Transversed
+				return { pixels + bottom + right, -stride, -bytesPerPixel };
+			case 8: // Needs a quarter turn counterclockwise
+				return { pixels + right, stride, -bytesPerPixel };
+			default:
+				return { pixels, bytesPerPixel, stride };
+		}
+	}
+
+	const uint8_t* At(const Walk& walk, uint32_t x, uint32_t y)
+	{
+		return walk.Origin + ptrdiff_t(x) * walk.StepX + ptrdiff_t(y) * walk.StepY;
+	}
+
+	__m128i ReverseDwords(__m128i value)
+	{
+		return _mm_shuffle_epi32(value, _MM_SHUFFLE(0, 1, 2, 3));
+	}
+
+	__m128i ReverseBytes(__m128i value)
+	{
+		value = ReverseDwords(value);
+		value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+		return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+	}
+
+	// Sixteen bytes of the source walking in the given direction, which is either 1 or -1
+	__m128i LoadRun(const uint8_t* first, ptrdiff_t step)
+	{
+		if (step > 0)
+		{
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		}
+
+		return ReverseBytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first - 15)));
+	}
+
+	// Four pixels of 32 bits, the step is either 4 or -4
+	__m128i LoadRun32(const uint8_t* first, ptrdiff_t step)
+	{
+		if (step > 0)
+		{
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		}
+
+		return ReverseDwords(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first - 12)));
+	}
+
+	template <uint32_t Bytes>
+	void CopyPixel(const uint8_t* source, uint8_t* target)
+	{
+		std::memcpy(target, source, Bytes);
+	}
+
+	// The source pixels of a target row are next to each other, forwards or backwards
+	template <uint32_t Bytes>
+	void CopyRows(const Walk& walk, Image& target)
+	{
+		const uint32_t width = target.Width();
+
+		for (uint32_t y = 0; y < target.Height(); ++y)
+		{
+			const uint8_t* source = At(walk, 0, y);
+			uint8_t* row = target.Pixels().data() + size_t(y) * target.Stride();
+
+			if (walk.StepX > 0)
+			{
+				std::memcpy(row, source, size_t(width) * Bytes);
+				continue;
+			}
+
+			uint32_t x = 0;
+
+			if constexpr (Bytes == 4)
+			{
+				for (; x + 4 <= width; x += 4)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x * 4), LoadRun32(At(walk, x, y), walk.StepX));
+				}
+			}
+			else if constexpr (Bytes == 1)
+			{
+				for (; x + 16 <= width; x += 16)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), LoadRun(At(walk, x, y), walk.StepX));
+				}
+			}
+
+			for (; x < width; ++x)
+			{
+				CopyPixel<Bytes>(At(walk, x, y), row + size_t(x) * Bytes);
+			}
+		}
+	}
+
+	// Four by four pixels of 32 bits. Each source row run becomes a target column.
+	void Transpose4x4(const Walk& walk, uint32_t x, uint32_t y, uint8_t* target, size_t stride)
+	{
+		const uint8_t* first = At(walk, x, y);
+
+		const __m128i column0 = LoadRun32(first, walk.StepY);
+		const __m128i column1 = LoadRun32(first + walk.StepX, walk.StepY);
+		const __m128i column2 = LoadRun32(first + 2 * walk.StepX, walk.StepY);
+		const __m128i column3 = LoadRun32(first + 3 * walk.StepX, walk.StepY);
+
+		const __m128i low01 = _mm_unpacklo_epi32(column0, column1);
+		const __m128i low23 = _mm_unpacklo_epi32(column2, column3);
+		const __m128i high01 = _mm_unpackhi_epi32(column0, column1);
+		const __m128i high23 = _mm_unpackhi_epi32(column2, column3);
+
+		uint8_t* row = target + size_t(y) * stride + size_t(x) * 4;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row), _mm_unpacklo_epi64(low01, low23));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row + stride), _mm_unpackhi_epi64(low01, low23));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row + 2 * stride), _mm_unpacklo_epi64(high01, high23));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row + 3 * stride), _mm_unpackhi_epi64(high01, high23));
+	}
+
+	// Sixteen by sixteen pixels of 8 bits. Four rounds of interleaving row i with row i + 8 transpose the block.
+	void Transpose16x16(const Walk& walk, uint32_t x, uint32_t y, uint8_t* target, size_t stride)
+	{
+		const uint8_t* first = At(walk, x, y);
+
+		__m128i rows[16];
+		__m128i mixed[16];
+
+		for (ptrdiff_t i = 0; i < 16; ++i)
+		{
+			rows[i] = LoadRun(first + i * walk.StepX, walk.StepY);
+		}
+
+		for (int round = 0; round < 4; ++round)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				mixed[2 * i] = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+				mixed[2 * i + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+			}
+
+			std::copy(std::begin(mixed), std::end(mixed), std::begin(rows));
+		}
+
+		uint8_t* row = target + size_t(y) * stride + x;
+
+		for (size_t i = 0; i < 16; ++i)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i * stride), rows[i]);
+		}
+	}
+
+	// The source pixels of a target row are in a column
+	template <uint32_t Bytes>
+	void Transpose(const Walk& walk, Image& target)
+	{
+		constexpr uint32_t Kernel = Bytes == 4 ? 4 : Bytes == 1 ? 16 : 1;
+
+		const uint32_t width = target.Width();
+		const uint32_t height = target.Height();
+		const size_t stride = target.Stride();
+		uint8_t* pixels = target.Pixels().data();
+
+		for (uint32_t top = 0; top < height; top += BlockSize)
+		{
+			const uint32_t bottom = std::min(top + BlockSize, height);
+
+			for (uint32_t left = 0; left < width; left += BlockSize)
+			{
+				const uint32_t right = std::min(left + BlockSize, width);
+
+				uint32_t y = top;
+
+				if constexpr (Kernel > 1)
+				{
+					for (; y + Kernel <= bottom; y += Kernel)
+					{
+						uint32_t x = left;
+
+						for (; x + Kernel <= right; x += Kernel)
+						{
+							if constexpr (Bytes == 4)
+							{
+								Transpose4x4(walk, x, y, pixels, stride);
+							}
+							else
+							{
+								Transpose16x16(walk, x, y, pixels, stride);
+							}
+						}
+
+						for (uint32_t row = y; row < y + Kernel; ++row)
+						{
+							for (uint32_t column = x; column < right; ++column)
+							{
+								CopyPixel<Bytes>(At(walk, column, row), pixels + row * stride + size_t(column) * Bytes);
+							}
+						}
+					}
+				}
+
+				for (; y < bottom; ++y)
+				{
+					for (uint32_t x = left; x < right; ++x)
+					{
+						CopyPixel<Bytes>(At(walk, x, y), pixels + y * stride + size_t(x) * Bytes);
+					}
+				}
+			}
+		}
+	}
+
+	template <uint32_t Bytes>
+	void Orient(const Walk& walk, Image& target)
+	{
+		if (walk.StepX == ptrdiff_t(Bytes) || walk.StepX == -ptrdiff_t(Bytes))
+		{
+			CopyRows<Bytes>(walk, target);
+		}
+		else
+		{
+			Transpose<Bytes>(walk, target);
+		}
+	}
+
+	bool SwapsSides(uint16_t orientation)
+	{
+		return orientation >= 5 && orientation <= 8;
+	}
+
+	void Orient(const Image& source, Image& target, uint16_t orientation)
+	{
+		_ASSERTE(source.Format() == target.Format());
+		_ASSERTE(SwapsSides(orientation) ?
+			target.Width() == source.Height() && target.Height() == source.Width() :
+			target.Width() == source.Width() && target.Height() == source.Height());
+
+		const Walk walk = SourceWalk(source, orientation);
+
+		switch (BytesPerPixel(source.Format()))
+		{
+			case 1:
+				Orient<1>(walk, target);
+				break;
+			case 3:
+				Orient<3>(walk, target);
+				break;
+			default:
+				Orient<4>(walk, target);
+				break;
+		}
+	}
+
+	std::shared_ptr<Image> Oriented(const Image& source, uint16_t orientation)
+	{
+		const bool sideways = SwapsSides(orientation);
+
+		auto target = std::make_shared<Image>(
+			sideways ? source.Height() : source.Width(),
+			sideways ? source.Width() : source.Height(),
+			source.Format());
+
+		target->SetSourceSize(
+			sideways ? source.SourceHeight() : source.SourceWidth(),
+			sideways ? source.SourceWidth() : source.SourceHeight());
+
+		Orient(source, *target, orientation);
+		return target;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Image.hpp"
+
+namespace PictureBrowser
+{
+	// True for the EXIF orientations 5 to 8, which turn the image sideways
+	bool SwapsSides(uint16_t orientation);
+
+	// Writes the source turned upright according to its EXIF orientation into the target,
+	// which must have the same format and the oriented size. Values out of range count as upright.
+	void Orient(const Image& source, Image& target, uint16_t orientation);
+
+	std::shared_ptr<Image> Oriented(const Image& source, uint16_t orientation);
+}
\ No newline at end of file
@@ -5,17 +5,40 @@
 #include <Windows.h>
 #include <Shlobj.h>
 #include <CommCtrl.h>
+#include <Psapi.h>
 #include <d2d1.h>
 #include <wincodec.h>
+#include <intrin.h>
 #include <wrl/client.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cwctype>
+#include <deque>
 #include <filesystem>
 #include <format>
+#include <fstream>
 #include <functional>
+#include <future>
+#include <list>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace PictureBrowser
 {
@@ -0,0 +1,49 @@
+#include "PCH.hpp"
+#include "PathTable.hpp"
+
+namespace PictureBrowser
+{
+	PathId PathTable::Intern(const std::filesystem::path& path)
+	{
+		const auto [iter, inserted] = _index.try_emplace(Key(path), static_cast<PathId>(_paths.size()));
+
+		if (inserted)
+		{
+			_paths.emplace_back(path);
+		}
+
+		return iter->second;
+	}
+
+	PathId PathTable::Find(const std::filesystem::path& path) const
+	{
+		const auto iter = _index.find(Key(path));
+		return iter == _index.end() ? NoPath : iter->second;
+	}
+
+	const std::filesystem::path& PathTable::Path(PathId id) const
+	{
+		static const std::filesystem::path empty;
+		return id < _paths.size() ? _paths[id] : empty;
+	}
+
+	size_t PathTable::Count() const
+	{
+		return _paths.size();
+	}
+
+	void PathTable::Clear()
+	{
+		_paths.clear();
+		_index.clear();
+	}
+
+	std::wstring PathTable::Key(const std::filesystem::path& path)
+	{
+		std::wstring key = path.lexically_normal().wstring();
+#ifdef _WIN32
+		CharLowerBuffW(key.data(), static_cast<DWORD>(key.size()));
+#endif
+		return key;
+	}
+}
\ No newline at end of file
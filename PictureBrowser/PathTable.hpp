@@ -0,0 +1,33 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	using PathId = uint32_t;
+	constexpr PathId NoPath = UINT32_MAX;
+
+	// Interns the paths of a directory listing into small integer IDs,
+	// so that the hot lookups hash and compare integers instead of paths.
+	// For the UI thread only.
+	class PathTable
+	{
+	public:
+		// Returns the existing ID, if the path has one
+		PathId Intern(const std::filesystem::path& path);
+
+		// Returns NoPath if the path has not been interned
+		PathId Find(const std::filesystem::path& path) const;
+
+		// Returns an empty path for NoPath
+		const std::filesystem::path& Path(PathId id) const;
+
+		size_t Count() const;
+		void Clear();
+
+		// Windows paths are case insensitive, so are the keys there
+		static std::wstring Key(const std::filesystem::path& path);
+
+	private:
+		std::vector<std::filesystem::path> _paths;
+		std::unordered_map<std::wstring, PathId> _index;
+	};
+}
\ No newline at end of file
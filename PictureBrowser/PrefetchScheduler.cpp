@@ -0,0 +1,72 @@
+#include "PCH.hpp"
+#include "PrefetchScheduler.hpp"
+
+namespace PictureBrowser
+{
+	PrefetchScheduler::PrefetchScheduler(size_t depth) :
+		_depth(depth)
+	{
+	}
+
+	std::vector<size_t> PrefetchScheduler::Neighbors(size_t current, size_t count)
+	{
+		if (_previous != SIZE_MAX && _previous != current)
+		{
+			_forward = current > _previous;
+		}
+
+		_previous = current;
+
+		std::vector<size_t> result;
+
+		if (current >= count)
+		{
+			return result;
+		}
+
+		result.reserve(_depth * 2);
+
+		for (size_t distance = 1; distance <= _depth; ++distance)
+		{
+			const bool hasNext = distance < count - current;
+			const bool hasPrevious = distance <= current;
+
+			if (_forward)
+			{
+				if (hasNext)
+				{
+					result.emplace_back(current + distance);
+				}
+
+				if (hasPrevious)
+				{
+					result.emplace_back(current - distance);
+				}
+			}
+			else
+			{
+				if (hasPrevious)
+				{
+					result.emplace_back(current - distance);
+				}
+
+				if (hasNext)
+				{
+					result.emplace_back(current + distance);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	size_t PrefetchScheduler::Depth() const
+	{
+		return _depth;
+	}
+
+	void PrefetchScheduler::SetDepth(size_t depth)
+	{
+		_depth = depth;
+	}
+}
\ No newline at end of file
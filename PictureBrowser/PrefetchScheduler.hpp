@@ -0,0 +1,22 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// Decides which neighbors of the current image are worth decoding ahead.
+	// Closest first, the direction of travel before the opposite one.
+	class PrefetchScheduler
+	{
+	public:
+		explicit PrefetchScheduler(size_t depth = 2);
+
+		std::vector<size_t> Neighbors(size_t current, size_t count);
+
+		size_t Depth() const;
+		void SetDepth(size_t depth);
+
+	private:
+		size_t _depth = 0;
+		size_t _previous = SIZE_MAX;
+		bool _forward = true;
+	};
+}
\ No newline at end of file
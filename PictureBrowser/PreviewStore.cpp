@@ -0,0 +1,633 @@
+#include "PCH.hpp"
+#include "PreviewStore.hpp"
+#include "LogWrap.hpp"
+
+namespace PictureBrowser
+{
+	constexpr uint32_t PackMagic = 0x4B504250; // "PBPK"
+	constexpr uint32_t PackVersion = 2;
+	constexpr uint32_t RecordMagic = 0x43525042; // "PBRC"
+
+	// Far larger than any screen, small enough that a record size cannot overflow
+	constexpr uint32_t MaxDimension = 1 << 16;
+
+	struct PackHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+	};
+
+	// Followed by the key padded to eight bytes and the packed pixels
+	struct RecordHeader
+	{
+		uint32_t Magic;
+		uint32_t KeyBytes;
+		uint64_t FileSize;
+		uint64_t WriteTime;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t SourceWidth;
+		uint32_t SourceHeight;
+		PixelFormat Format;
+		uint32_t Reserved;
+	};
+
+	constexpr uint64_t AlignUp(uint64_t value)
+	{
+		return (value + 7) & ~uint64_t(7);
+	}
+
+	uint64_t RecordBytes(const RecordHeader& header)
+	{
+		return sizeof(RecordHeader) + AlignUp(header.KeyBytes) + uint64_t(header.Width) * BytesPerPixel(header.Format) * header.Height;
+	}
+
+	// Whether the header can be trusted as far as to compute the size of its record
+	constexpr bool Plausible(const RecordHeader& header)
+	{
+		return header.Magic == RecordMagic &&
+			header.KeyBytes % sizeof(wchar_t) == 0 &&
+			header.Format <= PixelFormat::Gray8 &&
+			header.Width <= MaxDimension &&
+			header.Height <= MaxDimension;
+	}
+
+	// Full packs are compacted down to this share of their budget, the oldest previews go first
+	constexpr uint64_t LowWaterBytes(uint64_t maxBytes)
+	{
+		return maxBytes / 4 * 3;
+	}
+
+#ifdef _WIN32
+	// The pack is read and written, shared with readers, and created if missing
+	FileHandle OpenPack(const std::filesystem::path& path)
+	{
+		return CreateFileW(
+			path.c_str(),
+			GENERIC_READ | GENERIC_WRITE,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr);
+	}
+
+	// Created, or emptied, to be written only
+	FileHandle CreateTemporary(const std::filesystem::path& path)
+	{
+		return CreateFileW(
+			path.c_str(),
+			GENERIC_WRITE,
+			0,
+			nullptr,
+			CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr);
+	}
+
+	void CloseFile(FileHandle file)
+	{
+		CloseHandle(file);
+	}
+
+	// Of the last failed call
+	std::system_error LastError(const char* function)
+	{
+		return std::system_error(GetLastError(), std::system_category(), function);
+	}
+
+	bool FileSize(FileHandle file, uint64_t& bytes)
+	{
+		LARGE_INTEGER size;
+
+		if (!GetFileSizeEx(file, &size))
+		{
+			return false;
+		}
+
+		bytes = static_cast<uint64_t>(size.QuadPart);
+		return true;
+	}
+
+	bool ReplaceFile(const std::filesystem::path& source, const std::filesystem::path& target)
+	{
+		return MoveFileExW(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING);
+	}
+
+	void RemoveFile(const std::filesystem::path& path)
+	{
+		DeleteFileW(path.c_str());
+	}
+
+	bool WriteAt(FileHandle file, uint64_t offset, std::span<const uint8_t> data)
+	{
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(offset);
+
+		if (!SetFilePointerEx(file, position, nullptr, FILE_BEGIN))
+		{
+			return false;
+		}
+
+		while (!data.empty())
+		{
+			const DWORD chunk = static_cast<DWORD>(std::min<size_t>(data.size(), 0x1000000));
+			DWORD written = 0;
+
+			if (!WriteFile(file, data.data(), chunk, &written, nullptr) || written != chunk)
+			{
+				return false;
+			}
+
+			data = data.subspan(chunk);
+		}
+
+		return true;
+	}
+
+	bool Truncate(FileHandle file, uint64_t size)
+	{
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(size);
+
+		return SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+	}
+#else
+	FileHandle OpenPack(const std::filesystem::path& path)
+	{
+		return open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	}
+
+	FileHandle CreateTemporary(const std::filesystem::path& path)
+	{
+		return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	}
+
+	void CloseFile(FileHandle file)
+	{
+		close(file);
+	}
+
+	std::system_error LastError(const char* function)
+	{
+		return std::system_error(errno, std::generic_category(), function);
+	}
+
+	bool FileSize(FileHandle file, uint64_t& bytes)
+	{
+		struct stat status;
+
+		if (fstat(file, &status) != 0)
+		{
+			return false;
+		}
+
+		bytes = static_cast<uint64_t>(status.st_size);
+		return true;
+	}
+
+	bool ReplaceFile(const std::filesystem::path& source, const std::filesystem::path& target)
+	{
+		return rename(source.c_str(), target.c_str()) == 0;
+	}
+
+	void RemoveFile(const std::filesystem::path& path)
+	{
+		unlink(path.c_str());
+	}
+
+	bool WriteAt(FileHandle file, uint64_t offset, std::span<const uint8_t> data)
+	{
+		while (!data.empty())
+		{
+			const ssize_t written = pwrite(file, data.data(), data.size(), static_cast<off_t>(offset));
+
+			if (written < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if (written <= 0)
+			{
+				return false;
+			}
+
+			data = data.subspan(static_cast<size_t>(written));
+			offset += static_cast<uint64_t>(written);
+		}
+
+		return true;
+	}
+
+	bool Truncate(FileHandle file, uint64_t size)
+	{
+		return ftruncate(file, static_cast<off_t>(size)) == 0;
+	}
+#endif
+
+	template <typename T>
+	std::span<const uint8_t> AsBytes(const T& value)
+	{
+		return { reinterpret_cast<const uint8_t*>(&value), sizeof(T) };
+	}
+
+	PreviewStore::PreviewStore(
+		const std::filesystem::path& packPath,
+		uint32_t maxWidth,
+		uint32_t maxHeight,
+		uint64_t maxBytes) :
+		_packPath(packPath),
+		_maxWidth(maxWidth),
+		_maxHeight(maxHeight),
+		_maxBytes(maxBytes)
+	{
+		Open();
+	}
+
+	PreviewStore::~PreviewStore()
+	{
+		_mapped = MappedFile();
+
+		if (_file != InvalidFile)
+		{
+			CloseFile(_file);
+		}
+	}
+
+	std::filesystem::path PreviewStore::DefaultPath()
+	{
+#ifdef _WIN32
+		wchar_t* localAppData = nullptr;
+
+		HRESULT hr = SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &localAppData);
+
+		if (FAILED(hr))
+		{
+			CoTaskMemFree(localAppData);
+			throw std::system_error(hr, std::system_category(), "SHGetKnownFolderPath");
+		}
+
+		std::filesystem::path path(localAppData);
+		CoTaskMemFree(localAppData);
+
+		return path / L"PictureBrowser" / L"Previews.pack";
+#else
+		const char* cache = std::getenv("XDG_CACHE_HOME");
+		const char* home = std::getenv("HOME");
+
+		if ((!cache || !*cache) && (!home || !*home))
+		{
+			throw std::runtime_error("Neither XDG_CACHE_HOME nor HOME is set!");
+		}
+
+		const std::filesystem::path path = cache && *cache ? std::filesystem::path(cache) : std::filesystem::path(home) / ".cache";
+		return path / "PictureBrowser" / "Previews.pack";
+#endif
+	}
+
+	std::shared_ptr<Image> PreviewStore::Find(const std::filesystem::path& path)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		FileStamp stamp;
+
+		if (!ReadStamp(path, stamp))
+		{
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		const auto iter = _index.find(PathTable::Key(path));
+
+		if (iter == _index.end() || iter->second.Stamp != stamp)
+		{
+			return nullptr;
+		}
+
+		const uint64_t offset = iter->second.Offset;
+		const uint64_t bytes = iter->second.Bytes;
+
+		if (offset + bytes > _mapped.Data().size())
+		{
+			// Inserted after the file was mapped
+			Remap();
+		}
+
+		const std::span<const uint8_t> data = _mapped.Data();
+		RecordHeader header;
+
+		if (offset + bytes > data.size())
+		{
+			return nullptr;
+		}
+
+		std::memcpy(&header, data.data() + offset, sizeof(RecordHeader));
+
+		// Checked before the allocation, a damaged pack must not ask for more than it holds
+		if (!Plausible(header) || RecordBytes(header) != bytes)
+		{
+			LOGD << L"Damaged preview of " << path;
+			return nullptr;
+		}
+
+		const uint64_t pixelOffset = offset + sizeof(RecordHeader) + AlignUp(header.KeyBytes);
+		auto preview = std::make_shared<Image>(header.Width, header.Height, header.Format);
+
+		if (pixelOffset + preview->Bytes() > data.size())
+		{
+			return nullptr;
+		}
+
+		std::memcpy(preview->Pixels().data(), data.data() + pixelOffset, preview->Bytes());
+		preview->SetSourceSize(header.SourceWidth, header.SourceHeight);
+
+		const auto diff = std::chrono::steady_clock::now() - start;
+		LOGD << L"Preview of " << path << L" found in " << int64_t(std::chrono::duration_cast<std::chrono::microseconds>(diff).count()) << L"us";
+
+		return preview;
+	}
+
+	void PreviewStore::Insert(const std::filesystem::path& path, const Image& preview)
+	{
+		_ASSERTE(preview.Width() <= _maxWidth && preview.Height() <= _maxHeight);
+		_ASSERTE(preview.Stride() == preview.Width() * BytesPerPixel(preview.Format()));
+
+		FileStamp stamp;
+
+		if (!ReadStamp(path, stamp))
+		{
+			return;
+		}
+
+		const std::wstring key = PathTable::Key(path);
+
+		RecordHeader header;
+		header.Magic = RecordMagic;
+		header.KeyBytes = static_cast<uint32_t>(key.size() * sizeof(wchar_t));
+		header.FileSize = stamp.Size;
+		header.WriteTime = stamp.WriteTime;
+		header.Width = preview.Width();
+		header.Height = preview.Height();
+		header.SourceWidth = preview.SourceWidth();
+		header.SourceHeight = preview.SourceHeight();
+		header.Format = preview.Format();
+		header.Reserved = 0;
+
+		const uint64_t bytes = RecordBytes(header);
+
+		std::vector<uint8_t> prefix(sizeof(RecordHeader) + AlignUp(header.KeyBytes), 0);
+		std::memcpy(prefix.data(), &header, sizeof(RecordHeader));
+		std::memcpy(prefix.data() + sizeof(RecordHeader), key.data(), header.KeyBytes);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		const auto iter = _index.find(key);
+
+		if (iter != _index.end() && iter->second.Stamp == stamp)
+		{
+			return;
+		}
+
+		if (_end + bytes > _maxBytes)
+		{
+			LOGD << L"The preview store is full, dropping the oldest previews";
+			Compact(LowWaterBytes(_maxBytes) > bytes ? LowWaterBytes(_maxBytes) - bytes : 0);
+
+			if (_end + bytes > _maxBytes)
+			{
+				return;
+			}
+		}
+
+		// Compacting may have dropped the one being replaced
+		const auto replaced = _index.find(key);
+
+		if (!WriteAt(_file, _end, prefix) ||
+			!WriteAt(_file, _end + prefix.size(), preview.Pixels()))
+		{
+			LOGD << L"Failed to write to the preview store!";
+			return;
+		}
+
+		if (replaced != _index.end())
+		{
+			_liveBytes -= replaced->second.Bytes;
+		}
+
+		_index[key] = { _end, bytes, stamp };
+		_liveBytes += bytes;
+		_end += bytes;
+	}
+
+	uint32_t PreviewStore::MaxWidth() const
+	{
+		return _maxWidth;
+	}
+
+	uint32_t PreviewStore::MaxHeight() const
+	{
+		return _maxHeight;
+	}
+
+	bool PreviewStore::ReadStamp(const std::filesystem::path& path, FileStamp& stamp)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA data;
+
+		if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+		{
+			return false;
+		}
+
+		stamp.Size = (uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+		stamp.WriteTime = (uint64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+		struct stat status;
+
+		if (stat(path.c_str(), &status) != 0)
+		{
+			return false;
+		}
+
+		stamp.Size = static_cast<uint64_t>(status.st_size);
+		stamp.WriteTime = uint64_t(status.st_mtim.tv_sec) * 1000000000 + uint64_t(status.st_mtim.tv_nsec);
+#endif
+		return true;
+	}
+
+	void PreviewStore::Open()
+	{
+		std::filesystem::create_directories(_packPath.parent_path());
+
+		_file = OpenPack(_packPath);
+
+		if (_file == InvalidFile)
+		{
+			throw LastError("OpenPack");
+		}
+
+		if (!FileSize(_file, _end))
+		{
+			throw LastError("FileSize");
+		}
+
+		Remap();
+
+		PackHeader header = { 0, 0 };
+
+		if (_mapped.Data().size() >= sizeof(PackHeader))
+		{
+			std::memcpy(&header, _mapped.Data().data(), sizeof(PackHeader));
+		}
+
+		if (header.Magic != PackMagic || header.Version != PackVersion)
+		{
+			// Missing, foreign or from an older version; start over
+			const PackHeader fresh = { PackMagic, PackVersion };
+
+			_mapped = MappedFile();
+
+			if (!Truncate(_file, 0) || !WriteAt(_file, 0, AsBytes(fresh)))
+			{
+				throw LastError("WriteAt");
+			}
+
+			_end = sizeof(PackHeader);
+			Remap();
+			return;
+		}
+
+		Scan();
+
+		const uint64_t garbage = _end - sizeof(PackHeader) - _liveBytes;
+
+		if (_end > _maxBytes || garbage > _liveBytes)
+		{
+			Compact(_end > _maxBytes ? LowWaterBytes(_maxBytes) : _maxBytes);
+		}
+
+		LOGD << _packPath << L": " << uint64_t(_index.size()) << L" previews, " << _end << L" bytes";
+	}
+
+	void PreviewStore::Scan()
+	{
+		const std::span<const uint8_t> data = _mapped.Data();
+		uint64_t offset = sizeof(PackHeader);
+
+		while (offset + sizeof(RecordHeader) <= data.size())
+		{
+			RecordHeader header;
+			std::memcpy(&header, data.data() + offset, sizeof(RecordHeader));
+
+			const uint64_t bytes = RecordBytes(header);
+
+			if (!Plausible(header) || offset + bytes > data.size())
+			{
+				break;
+			}
+
+			const wchar_t* key = reinterpret_cast<const wchar_t*>(data.data() + offset + sizeof(RecordHeader));
+			Entry& entry = _index[std::wstring(key, header.KeyBytes / sizeof(wchar_t))];
+
+			// Later records replace earlier ones
+			_liveBytes -= entry.Bytes;
+			_liveBytes += bytes;
+			entry = { offset, bytes, { header.FileSize, header.WriteTime } };
+
+			offset += bytes;
+		}
+
+		if (offset != _end)
+		{
+			// Torn by a crash in the middle of a write
+			LOGD << L"Truncating the preview store at " << offset;
+			_mapped = MappedFile();
+
+			if (Truncate(_file, offset))
+			{
+				_end = offset;
+			}
+
+			Remap();
+		}
+	}
+
+	void PreviewStore::Compact(uint64_t keepBytes)
+	{
+		const std::filesystem::path temporaryPath = _packPath.wstring() + L".tmp";
+
+		const FileHandle temporary = CreateTemporary(temporaryPath);
+
+		if (temporary == InvalidFile)
+		{
+			LOGD << L"Failed to compact the preview store!";
+			return;
+		}
+
+		if (_mapped.Data().size() < _end)
+		{
+			// Inserted after the file was mapped
+			Remap();
+		}
+
+		const std::span<const uint8_t> data = _mapped.Data();
+		const PackHeader fresh = { PackMagic, PackVersion };
+		uint64_t end = sizeof(PackHeader);
+		bool success = WriteAt(temporary, 0, AsBytes(fresh));
+
+		// Appended in order, so the newest previews are the ones furthest in
+		std::vector<const Entry*> entries;
+		entries.reserve(_index.size());
+
+		for (const auto& [key, entry] : _index)
+		{
+			entries.emplace_back(&entry);
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const Entry* left, const Entry* right)
+		{
+			return left->Offset > right->Offset;
+		});
+
+		uint64_t kept = 0;
+		size_t count = 0;
+
+		while (count < entries.size() && sizeof(PackHeader) + kept + entries[count]->Bytes <= keepBytes)
+		{
+			kept += entries[count++]->Bytes;
+		}
+
+		// Written oldest first, so that the order survives the next compaction
+		for (size_t i = count; i-- > 0;)
+		{
+			const Entry& entry = *entries[i];
+			success = success && WriteAt(temporary, end, data.subspan(static_cast<size_t>(entry.Offset), static_cast<size_t>(entry.Bytes)));
+			end += entry.Bytes;
+		}
+
+		CloseFile(temporary);
+
+		_mapped = MappedFile();
+		CloseFile(_file);
+		_file = InvalidFile;
+
+		if (!success || !ReplaceFile(temporaryPath, _packPath))
+		{
+			LOGD << L"Failed to replace the preview store!";
+			RemoveFile(temporaryPath);
+			RemoveFile(_packPath);
+		}
+
+		// Scans the compacted file, or starts over if that failed
+		_index.clear();
+		_liveBytes = 0;
+		Open();
+	}
+
+	void PreviewStore::Remap()
+	{
+		_mapped = MappedFile();
+		_mapped = MappedFile(_file, _end);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Image.hpp"
+#include "MappedFile.hpp"
+#include "PathTable.hpp"
+
+namespace PictureBrowser
+{
+	// Screen sized, already oriented previews which survive restarts.
+	// A single append-only pack file, memory mapped for reading.
+	// An entry is stale once the size or the modification time of its file changes.
+	// When the pack reaches its budget it is compacted, the oldest previews are dropped to make room.
+	// All methods are thread safe.
+	class PreviewStore
+	{
+	public:
+		PreviewStore(
+			const std::filesystem::path& packPath,
+			uint32_t maxWidth,
+			uint32_t maxHeight,
+			uint64_t maxBytes);
+		~PreviewStore();
+
+		PreviewStore(const PreviewStore&) = delete;
+		PreviewStore& operator = (const PreviewStore&) = delete;
+
+		// The default location under the local application data folder
+		static std::filesystem::path DefaultPath();
+
+		// Returns nullptr if not found or stale
+		std::shared_ptr<Image> Find(const std::filesystem::path& path);
+
+		// The preview must already fit in MaxWidth x MaxHeight
+		void Insert(const std::filesystem::path& path, const Image& preview);
+
+		uint32_t MaxWidth() const;
+		uint32_t MaxHeight() const;
+
+	private:
+		struct FileStamp
+		{
+			uint64_t Size = 0;
+			uint64_t WriteTime = 0;
+
+			bool operator == (const FileStamp&) const = default;
+		};
+
+		struct Entry
+		{
+			uint64_t Offset = 0;
+			uint64_t Bytes = 0;
+			FileStamp Stamp;
+		};
+
+		static bool ReadStamp(const std::filesystem::path& path, FileStamp& stamp);
+
+		void Open();
+		void Scan();
+		// Keeps the newest live previews which fit in the given bytes
+		void Compact(uint64_t keepBytes);
+		void Remap();
+
+		const std::filesystem::path _packPath;
+		const uint32_t _maxWidth;
+		const uint32_t _maxHeight;
+		const uint64_t _maxBytes;
+
+		std::mutex _mutex;
+		FileHandle _file = InvalidFile;
+		MappedFile _mapped;
+		uint64_t _end = 0;
+		uint64_t _liveBytes = 0;
+		std::unordered_map<std::wstring, Entry> _index;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,481 @@
+#include "PCH.hpp"
+#include "ReadAhead.hpp"
+#include "LogWrap.hpp"
+
+namespace PictureBrowser
+{
+	// A few reads keep the queue of the device busy without splitting its bandwidth too thin
+	constexpr size_t MaxReads = 4;
+
+	// A file comes in with reads of this size, one after the other
+	constexpr size_t ChunkBytes = 1 << 20;
+
+	constexpr ULONG_PTR ReadKey = 1;
+	constexpr ULONG_PTR WakeKey = 2;
+
+	ReadThrottle::ReadThrottle(uint64_t bytesPerSecond) :
+		_bytesPerSecond(std::max(bytesPerSecond, uint64_t(1))),
+		_idle(std::chrono::steady_clock::now())
+	{
+	}
+
+	std::chrono::steady_clock::time_point ReadThrottle::Schedule(uint64_t bytes)
+	{
+		const auto duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(double(bytes) / double(_bytesPerSecond)));
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_idle = std::max(_idle, std::chrono::steady_clock::now()) + duration;
+		return _idle;
+	}
+
+	ReadAhead::Entry::Entry(const std::filesystem::path& path) :
+		Path(path)
+	{
+		ZeroInit(Overlapped);
+	}
+
+	ReadAhead::ReadAhead(uint64_t budget, Metrics& metrics) :
+		_budget(budget),
+		_metrics(metrics),
+		_port(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1))
+	{
+		if (!_port)
+		{
+			LOGD << L"CreateIoCompletionPort failed, every file is read on demand!";
+			return;
+		}
+
+		_thread = std::thread(&ReadAhead::Run, this);
+	}
+
+	ReadAhead::~ReadAhead()
+	{
+		if (_thread.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+
+			PostQueuedCompletionStatus(_port, 0, WakeKey, nullptr);
+			_thread.join();
+		}
+
+		for (const std::unique_ptr<Entry>& entry : _entries)
+		{
+			if (entry->File != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(entry->File);
+			}
+		}
+
+		if (_port)
+		{
+			CloseHandle(_port);
+		}
+	}
+
+	void ReadAhead::SetThrottle(uint64_t bytesPerSecond)
+	{
+		_throttle = bytesPerSecond ? std::make_unique<ReadThrottle>(bytesPerSecond) : nullptr;
+	}
+
+	void ReadAhead::Schedule(const std::vector<std::filesystem::path>& paths)
+	{
+		if (!_thread.joinable())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			std::vector<std::unique_ptr<Entry>> entries;
+			entries.reserve(paths.size());
+
+			for (const std::filesystem::path& path : paths)
+			{
+				const auto match = [&path](const std::unique_ptr<Entry>& entry)
+				{
+					return entry && entry->Path == path;
+				};
+
+				if (std::any_of(entries.cbegin(), entries.cend(), match))
+				{
+					continue;
+				}
+
+				const auto iter = std::find_if(_entries.begin(), _entries.end(), match);
+
+				if (iter != _entries.end())
+				{
+					entries.emplace_back(std::move(*iter));
+				}
+				else
+				{
+					entries.emplace_back(std::make_unique<Entry>(path));
+				}
+			}
+
+			// Whatever is left fell out of the schedule
+			for (std::unique_ptr<Entry>& entry : _entries)
+			{
+				if (!entry)
+				{
+					continue;
+				}
+
+				if (entry->Claimed)
+				{
+					entries.emplace_back(std::move(entry));
+				}
+				else
+				{
+					Cancel(std::move(entry));
+				}
+			}
+
+			_entries = std::move(entries);
+		}
+
+		PostQueuedCompletionStatus(_port, 0, WakeKey, nullptr);
+	}
+
+	FileBytes ReadAhead::Read(const std::filesystem::path& path)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		auto iter = std::find_if(_entries.begin(), _entries.end(), [&path](const std::unique_ptr<Entry>& entry)
+		{
+			return entry->Path == path;
+		});
+
+		if (iter != _entries.end() && (*iter)->Status != Entry::State::Queued && (*iter)->Status != Entry::State::Failed)
+		{
+			Entry* const entry = iter->get();
+			entry->Claimed = true;
+
+			_condition.wait(lock, [entry]
+			{
+				return entry->Status != Entry::State::Reading;
+			});
+
+			// The schedule may have changed meanwhile, but a claimed entry stays in it
+			iter = std::find_if(_entries.begin(), _entries.end(), [entry](const std::unique_ptr<Entry>& other)
+			{
+				return other.get() == entry;
+			});
+
+			std::unique_ptr<Entry> taken = std::move(*iter);
+			_entries.erase(iter);
+
+			if (taken->Status == Entry::State::Ready)
+			{
+				_bytes -= taken->Size;
+				lock.unlock();
+
+				// There is room in the budget again
+				PostQueuedCompletionStatus(_port, 0, WakeKey, nullptr);
+
+				std::this_thread::sleep_until(taken->ReadyTime);
+
+				_metrics.Add(Metrics::Counter::ReadAheadHits);
+				_metrics.Record(Metrics::Timer::Read, std::chrono::steady_clock::now() - start);
+				return FileBytes(std::move(taken->Buffer), taken->Size);
+			}
+		}
+		else if (iter != _entries.end())
+		{
+			// Not started yet, or failed, the decoder reads it itself
+			Cancel(std::move(*iter));
+			_entries.erase(iter);
+		}
+
+		lock.unlock();
+
+		FileBytes bytes = ReadNow(path);
+
+		_metrics.Add(Metrics::Counter::ReadAheadMisses);
+		_metrics.Record(Metrics::Timer::Read, std::chrono::steady_clock::now() - start);
+		return bytes;
+	}
+
+	void ReadAhead::Drop(const std::filesystem::path& path)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		const auto iter = std::find_if(_entries.begin(), _entries.end(), [&path](const std::unique_ptr<Entry>& entry)
+		{
+			return entry->Path == path && !entry->Claimed;
+		});
+
+		if (iter != _entries.end())
+		{
+			Cancel(std::move(*iter));
+			_entries.erase(iter);
+		}
+	}
+
+	void ReadAhead::Clear()
+	{
+		Schedule({});
+	}
+
+	uint64_t ReadAhead::Bytes() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _bytes;
+	}
+
+	void ReadAhead::Run()
+	{
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				if (_stopping)
+				{
+					break;
+				}
+
+				Issue();
+			}
+
+			DWORD bytes = 0;
+			ULONG_PTR key = 0;
+			OVERLAPPED* overlapped = nullptr;
+
+			const BOOL succeeded = GetQueuedCompletionStatus(_port, &bytes, &key, &overlapped, INFINITE);
+
+			if (overlapped)
+			{
+				Complete(overlapped, bytes, succeeded != FALSE);
+			}
+			else if (!succeeded)
+			{
+				LOGD << L"GetQueuedCompletionStatus failed, reading ahead stops!";
+				break;
+			}
+		}
+
+		// The reads under way write into their buffers until the system acknowledges the cancellation
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stopping = true;
+
+		for (const std::unique_ptr<Entry>& entry : _entries)
+		{
+			if (entry->Status == Entry::State::Reading)
+			{
+				CancelIoEx(entry->File, &entry->Overlapped);
+			}
+		}
+
+		while (_reading)
+		{
+			lock.unlock();
+
+			DWORD bytes = 0;
+			ULONG_PTR key = 0;
+			OVERLAPPED* overlapped = nullptr;
+
+			const BOOL succeeded = GetQueuedCompletionStatus(_port, &bytes, &key, &overlapped, INFINITE);
+
+			if (overlapped)
+			{
+				Complete(overlapped, bytes, succeeded != FALSE);
+			}
+			else if (!succeeded)
+			{
+				return;
+			}
+
+			lock.lock();
+		}
+	}
+
+	// Starts reading the files in the order of the schedule, as long as there is room in the budget
+	void ReadAhead::Issue()
+	{
+		for (const std::unique_ptr<Entry>& entry : _entries)
+		{
+			if (_reading >= MaxReads)
+			{
+				break;
+			}
+
+			if (entry->Status != Entry::State::Queued)
+			{
+				continue;
+			}
+
+			if (entry->File == INVALID_HANDLE_VALUE)
+			{
+				entry->File = CreateFileW(
+					entry->Path.c_str(),
+					GENERIC_READ,
+					FILE_SHARE_READ | FILE_SHARE_DELETE,
+					nullptr,
+					OPEN_EXISTING,
+					FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+					nullptr);
+
+				LARGE_INTEGER size;
+
+				if (entry->File == INVALID_HANDLE_VALUE ||
+					!GetFileSizeEx(entry->File, &size) ||
+					static_cast<uint64_t>(size.QuadPart) > _budget ||
+					!CreateIoCompletionPort(entry->File, _port, ReadKey, 0))
+				{
+					// Too large or unreadable, left to the decoder
+					LOGD << L"Not reading ahead " << entry->Path;
+					Finish(*entry, Entry::State::Failed);
+					continue;
+				}
+
+				entry->Size = static_cast<size_t>(size.QuadPart);
+			}
+
+			if (_bytes + entry->Size > _budget)
+			{
+				// The closer neighbors come first, the rest waits for room
+				break;
+			}
+
+			_bytes += entry->Size;
+			entry->ReadyTime = _throttle ? _throttle->Schedule(entry->Size) : std::chrono::steady_clock::time_point();
+
+			if (!entry->Size)
+			{
+				Finish(*entry, Entry::State::Ready);
+				continue;
+			}
+
+			entry->Buffer = BufferPool::Shared()->Allocate(entry->Size);
+			entry->Status = Entry::State::Reading;
+			++_reading;
+
+			Continue(*entry);
+		}
+	}
+
+	void ReadAhead::Continue(Entry& entry)
+	{
+		const uint64_t offset = entry.Done;
+		const DWORD chunk = static_cast<DWORD>(std::min(entry.Size - entry.Done, ChunkBytes));
+
+		ZeroInit(entry.Overlapped);
+		entry.Overlapped.Offset = static_cast<DWORD>(offset);
+		entry.Overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+		// Completes on the port even when it completes right away
+		if (!ReadFile(entry.File, entry.Buffer.get() + entry.Done, chunk, nullptr, &entry.Overlapped) &&
+			GetLastError() != ERROR_IO_PENDING)
+		{
+			LOGD << L"ReadFile failed for " << entry.Path;
+			Finish(entry, Entry::State::Failed);
+		}
+	}
+
+	void ReadAhead::Complete(OVERLAPPED* overlapped, DWORD bytes, bool succeeded)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		const auto owns = [overlapped](const std::unique_ptr<Entry>& entry)
+		{
+			return &entry->Overlapped == overlapped;
+		};
+
+		const auto cancelled = std::find_if(_cancelled.begin(), _cancelled.end(), owns);
+
+		if (cancelled != _cancelled.end())
+		{
+			Finish(**cancelled, Entry::State::Failed);
+			_cancelled.erase(cancelled);
+			return;
+		}
+
+		const auto iter = std::find_if(_entries.begin(), _entries.end(), owns);
+
+		if (iter == _entries.end())
+		{
+			return;
+		}
+
+		Entry& entry = **iter;
+
+		if (!succeeded || !bytes)
+		{
+			LOGD << L"Reading ahead failed for " << entry.Path;
+			Finish(entry, Entry::State::Failed);
+			return;
+		}
+
+		entry.Done += bytes;
+
+		if (entry.Done < entry.Size && !_stopping)
+		{
+			Continue(entry);
+			return;
+		}
+
+		Finish(entry, entry.Done < entry.Size ? Entry::State::Failed : Entry::State::Ready);
+	}
+
+	void ReadAhead::Finish(Entry& entry, Entry::State status)
+	{
+		if (entry.File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(entry.File);
+			entry.File = INVALID_HANDLE_VALUE;
+		}
+
+		if (entry.Status == Entry::State::Reading)
+		{
+			--_reading;
+		}
+
+		if (status == Entry::State::Failed && (entry.Status == Entry::State::Reading || entry.Status == Entry::State::Ready))
+		{
+			_bytes -= entry.Size;
+			entry.Buffer.reset();
+		}
+
+		entry.Status = status;
+		_condition.notify_all();
+	}
+
+	void ReadAhead::Cancel(std::unique_ptr<Entry>&& entry)
+	{
+		switch (entry->Status)
+		{
+			case Entry::State::Reading:
+				// The buffer stays until the system is done with it
+				CancelIoEx(entry->File, &entry->Overlapped);
+				_cancelled.emplace_back(std::move(entry));
+				break;
+			case Entry::State::Ready:
+				_bytes -= entry->Size;
+				break;
+			default:
+				Finish(*entry, Entry::State::Failed);
+				break;
+		}
+	}
+
+	FileBytes ReadAhead::ReadNow(const std::filesystem::path& path)
+	{
+		FileBytes bytes(path);
+
+		if (_throttle)
+		{
+			// A mapped file counts in full, even though only the pages the decoder touches are read
+			std::this_thread::sleep_until(_throttle->Schedule(bytes.Data().size()));
+		}
+
+		return bytes;
+	}
+}
\ No newline at end of file
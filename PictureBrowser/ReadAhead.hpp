@@ -0,0 +1,119 @@
+#pragma once
+
+#include "BufferPool.hpp"
+#include "ImageSource.hpp"
+#include "Metrics.hpp"
+
+namespace PictureBrowser
+{
+	// Stands in for slow storage, such as an SD card in a USB 2 reader, to see how the reads overlap with the decodes.
+	// All reads share the bandwidth, a read is done only once the device got through the ones before it. Thread safe.
+	class ReadThrottle
+	{
+	public:
+		explicit ReadThrottle(uint64_t bytesPerSecond);
+
+		// When a read of the given size, issued now, would be done
+		std::chrono::steady_clock::time_point Schedule(uint64_t bytes);
+
+	private:
+		const uint64_t _bytesPerSecond;
+
+		std::mutex _mutex;
+		std::chrono::steady_clock::time_point _idle;
+	};
+
+	// Reads the files which are about to be decoded into pooled buffers ahead of the decoders, so that the storage
+	// and the cores are busy side by side. A thread of its own keeps a few overlapped reads going on a completion port,
+	// the bytes being read or waiting to be taken stay within a budget. Thread safe, stops and joins when destroyed.
+	class ReadAhead
+	{
+	public:
+		// The neighbors being read or waiting for their decoders stay within this
+		static constexpr uint64_t DefaultBudget = uint64_t(sizeof(void*) == 8 ? 256 : 64) << 20;
+
+		ReadAhead(uint64_t budget, Metrics& metrics);
+		~ReadAhead();
+
+		ReadAhead(const ReadAhead&) = delete;
+		ReadAhead& operator = (const ReadAhead&) = delete;
+
+		// Slows every read down to the given rate, zero turns it off. Call before reading anything.
+		void SetThrottle(uint64_t bytesPerSecond);
+
+		// Reads the files in the given order, as far as the budget goes.
+		// Files no longer listed are cancelled and freed, unless a decoder is already waiting for them.
+		void Schedule(const std::vector<std::filesystem::path>& paths);
+
+		// The bytes of a file, which a decoder wants now. Read ahead, waiting for the read if it is under way,
+		// or opened right away if it was not scheduled or its read failed.
+		FileBytes Read(const std::filesystem::path& path);
+
+		// Forgets a file, such as one which changed since it was read
+		void Drop(const std::filesystem::path& path);
+
+		// Cancels everything not yet taken
+		void Clear();
+
+		// Being read or waiting to be taken
+		uint64_t Bytes() const;
+
+	private:
+		struct Entry
+		{
+			enum class State
+			{
+				Queued,
+				Reading,
+				Ready,
+				Failed
+			};
+
+			explicit Entry(const std::filesystem::path& path);
+
+			const std::filesystem::path Path;
+			State Status = State::Queued;
+
+			// A decoder waits for it, so it must not be cancelled
+			bool Claimed = false;
+
+			HANDLE File = INVALID_HANDLE_VALUE;
+			OVERLAPPED Overlapped;
+			BufferPool::Buffer Buffer;
+			size_t Size = 0;
+			size_t Done = 0;
+
+			// When the throttled device would have it done
+			std::chrono::steady_clock::time_point ReadyTime;
+		};
+
+		void Run();
+		void Issue();
+		void Continue(Entry& entry);
+		void Complete(OVERLAPPED* overlapped, DWORD bytes, bool succeeded);
+		void Finish(Entry& entry, Entry::State status);
+		void Cancel(std::unique_ptr<Entry>&& entry);
+		FileBytes ReadNow(const std::filesystem::path& path);
+
+		const uint64_t _budget;
+		Metrics& _metrics;
+		std::unique_ptr<ReadThrottle> _throttle;
+
+		HANDLE _port = nullptr;
+
+		mutable std::mutex _mutex;
+		std::condition_variable _condition;
+
+		// In the order they were scheduled in
+		std::vector<std::unique_ptr<Entry>> _entries;
+
+		// Unlisted while their reads were under way, freed once the system is done with them
+		std::vector<std::unique_ptr<Entry>> _cancelled;
+
+		uint64_t _bytes = 0;
+		size_t _reading = 0;
+		bool _stopping = false;
+
+		std::thread _thread;
+	};
+}
\ No newline at end of file
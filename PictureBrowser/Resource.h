@@ -21,4 +21,5 @@
 #define IDM_POPUP_OPEN_PATH					607
 #define IDM_POPUP_COPY_PATH					608
 #define IDM_POPUP_DELETE_PATH				609
+#define IDM_OPTIONS_SAVE_METRICS			610
 #define IDC_STATIC							-1
@@ -0,0 +1,190 @@
+#include "PCH.hpp"
+#include "SidecarIndex.hpp"
+#include "FileNames.hpp"
+#include "LogWrap.hpp"
+
+namespace PictureBrowser
+{
+	// Source: https://en.wikipedia.org/wiki/Raw_image_format
+	// TODO: move these under a registry key. 
+	// This way the whole binary does not have to be rebuilt each time this list is updated
+	constexpr std::wstring_view RawFileExtensions[] =
+	{
+		L".3FR",
+		L".ARI", L".ARW",
+		L".BAY",
+		L".BRAW", L".CRW", L".CR2", L".CR3",
+		L".CAP",
+		L".DATA", L".DCS", L".DCR", L".DNG",
+		L".DRF",
+		L".EIP", L".ERF",
+		L".FFF",
+		L".GPR",
+		L".IIQ",
+		L".K25", L".KDC",
+		L".MDC", L".MEF", L".MOS", L".MRW",
+		L".NEF", L".NRW",
+		L".OBM", L".ORF",
+		L".PEF", L".PTX", L".PXN",
+		L".R3D", L".RAF", L".RAW", L".RWL", L".RW2", L".RWZ",
+		L".SR2", L".SRF", L".SRW",
+		L".TIF",
+		L".X3F"
+	};
+
+	constexpr std::wstring_view SidecarExtension = L".xmp";
+
+	constexpr std::wstring_view ImageExtensions[] =
+	{
+		L".jpg", L".jpeg", L".png"
+	};
+
+	bool IsCompanion(std::wstring_view filename)
+	{
+		const std::wstring_view extension = FileExtension(filename);
+
+		return HasExtension(extension, RawFileExtensions) ||
+			HasExtension(extension, ImageExtensions) ||
+			EqualsIgnoringCase(extension, SidecarExtension);
+	}
+
+	bool IsRawFile(const std::filesystem::path& path)
+	{
+		return HasExtension(FileExtension(path.filename().wstring()), RawFileExtensions);
+	}
+
+	SidecarIndex::SidecarIndex(const std::filesystem::path& directory) :
+		_directory(directory)
+	{
+		std::error_code error;
+
+		for (auto it = std::filesystem::directory_iterator(directory, error);
+			!error && it != std::filesystem::directory_iterator();
+			it.increment(error))
+		{
+			std::error_code typeError;
+
+			if (it->is_regular_file(typeError))
+			{
+				Add(it->path().filename().wstring());
+			}
+		}
+
+		if (error)
+		{
+			LOGD << L"Failed to enumerate " << directory;
+		}
+	}
+
+	const std::filesystem::path& SidecarIndex::Directory() const
+	{
+		return _directory;
+	}
+
+	void SidecarIndex::Reset(const std::filesystem::path& directory)
+	{
+		Clear();
+		_directory = directory;
+	}
+
+	void SidecarIndex::Add(std::wstring_view filename)
+	{
+		if (!IsCompanion(filename))
+		{
+			return;
+		}
+
+		std::vector<std::wstring>& files = _stems[Key(filename)];
+
+		if (std::find(files.cbegin(), files.cend(), filename) == files.cend())
+		{
+			files.emplace_back(filename);
+			++_count;
+		}
+	}
+
+	void SidecarIndex::Remove(const std::filesystem::path& path)
+	{
+		const std::wstring name = path.filename().wstring();
+		const auto iter = _stems.find(Key(name));
+
+		if (iter == _stems.end())
+		{
+			return;
+		}
+
+		std::vector<std::wstring>& files = iter->second;
+
+		const auto file = std::find_if(files.begin(), files.end(), [&](const std::wstring& other)
+		{
+			return EqualsIgnoringCase(other, name);
+		});
+
+		if (file != files.end())
+		{
+			files.erase(file);
+			--_count;
+		}
+
+		if (files.empty())
+		{
+			_stems.erase(iter);
+		}
+	}
+
+	std::vector<std::filesystem::path> SidecarIndex::Companions(const std::filesystem::path& path) const
+	{
+		std::vector<std::filesystem::path> companions;
+		const std::wstring name = path.filename().wstring();
+		const auto iter = _stems.find(Key(name));
+
+		if (iter == _stems.end())
+		{
+			return companions;
+		}
+
+		std::vector<std::wstring> files = iter->second;
+		std::sort(files.begin(), files.end());
+
+		for (const std::wstring& file : files)
+		{
+			if (!EqualsIgnoringCase(file, name))
+			{
+				companions.push_back(_directory / file);
+			}
+		}
+
+		return companions;
+	}
+
+	std::span<const std::wstring> SidecarIndex::Group(std::wstring_view filename) const
+	{
+		const auto iter = _stems.find(Key(filename));
+		return iter == _stems.end() ? std::span<const std::wstring>() : std::span<const std::wstring>(iter->second);
+	}
+
+	size_t SidecarIndex::Count() const
+	{
+		return _count;
+	}
+
+	void SidecarIndex::Clear()
+	{
+		_directory.clear();
+		_stems.clear();
+		_count = 0;
+	}
+
+	std::wstring SidecarIndex::Key(std::wstring_view filename)
+	{
+		std::wstring_view shot = filename;
+
+		if (EqualsIgnoringCase(FileExtension(shot), SidecarExtension))
+		{
+			// IMG_1.CR2.xmp
+			shot = FileStem(shot);
+		}
+
+		return FoldedCase(FileStem(shot));
+	}
+}
\ No newline at end of file
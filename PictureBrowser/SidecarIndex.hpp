@@ -0,0 +1,46 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// The files of a directory grouped by stem, so that the companions of an image (its RAW files, XMP sidecars,
+	// or the JPG of a RAW) are found without touching the disk. "IMG_1.CR2.xmp" counts towards IMG_1 as well.
+	// Only the standard library, so that it works on any file system.
+	class SidecarIndex
+	{
+	public:
+		SidecarIndex() = default;
+
+		// Enumerates the directory once, unreadable entries are skipped
+		explicit SidecarIndex(const std::filesystem::path& directory);
+
+		const std::filesystem::path& Directory() const;
+
+		// Empties the index for the directory, without enumerating it
+		void Reset(const std::filesystem::path& directory);
+
+		// For files found by other means, such as a directory listing. Takes the name only, not a path.
+		void Add(std::wstring_view filename);
+		void Remove(const std::filesystem::path& path);
+
+		// The other files sharing the stem of the path, as full paths sorted by name. Other files include
+		// the RAW files, the XMP sidecars and the JPG, JPEG or PNG images, anything else is not a companion.
+		std::vector<std::filesystem::path> Companions(const std::filesystem::path& path) const;
+
+		// The names sharing the stem of the filename, itself included if it was added. In no particular order.
+		std::span<const std::wstring> Group(std::wstring_view filename) const;
+
+		size_t Count() const;
+		void Clear();
+
+	private:
+		// The case insensitive stem, "IMG_1" for both "IMG_1.CR2" and "IMG_1.CR2.xmp"
+		static std::wstring Key(std::wstring_view filename);
+
+		std::filesystem::path _directory;
+		std::unordered_map<std::wstring, std::vector<std::wstring>> _stems;
+		size_t _count = 0;
+	};
+
+	// Every known camera RAW extension, not only the ones ProbeImage() finds previews in
+	bool IsRawFile(const std::filesystem::path& path);
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "PCH.hpp"
+#include "Swizzle.hpp"
+
+namespace PictureBrowser
+{
+	constexpr uint32_t Opaque = 0xFF000000;
+
+	// MSVC compiles any intrinsic, GCC and Clang only in functions built for the instruction set
+#ifdef _MSC_VER
+#define SIMD_TARGET(features)
+#else
+#define SIMD_TARGET(features) __attribute__((target(features)))
+#endif
+
+	void Bgr24Scalar(const uint8_t* source, uint8_t* target, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const uint8_t* pixel = source + i * 3;
+			const uint32_t value = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16) | Opaque;
+			std::memcpy(target + i * 4, &value, 4);
+		}
+	}
+
+	void Gray8Scalar(const uint8_t* source, uint8_t* target, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const uint32_t value = source[i] * 0x010101u | Opaque;
+			std::memcpy(target + i * 4, &value, 4);
+		}
+	}
+
+	// Four pixels at a time. Shifts each pixel into its own dword, as SSE2 has no byte shuffle.
+	size_t Bgr24Sse2(const uint8_t* source, uint8_t* target, size_t pixels)
+	{
+		const __m128i first = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+		const __m128i second = _mm_setr_epi32(0, 0x00FFFFFF, 0, 0);
+		const __m128i third = _mm_setr_epi32(0, 0, 0x00FFFFFF, 0);
+		const __m128i fourth = _mm_setr_epi32(0, 0, 0, 0x00FFFFFF);
+		const __m128i opaque = _mm_set1_epi32(static_cast<int>(Opaque));
+
+		size_t i = 0;
+
+		// The loads take 16 bytes for 12, stay away from the end
+		for (; i + 6 <= pixels; i += 4)
+		{
+			const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+
+			__m128i expanded = _mm_and_si128(packed, first);
+			expanded = _mm_or_si128(expanded, _mm_and_si128(_mm_slli_si128(packed, 1), second));
+			expanded = _mm_or_si128(expanded, _mm_and_si128(_mm_slli_si128(packed, 2), third));
+			expanded = _mm_or_si128(expanded, _mm_and_si128(_mm_slli_si128(packed, 3), fourth));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(target + i * 4), _mm_or_si128(expanded, opaque));
+		}
+
+		return i;
+	}
+
+	// Sixteen pixels at a time
+	size_t Gray8Sse2(const uint8_t* source, uint8_t* target, size_t pixels)
+	{
+		const __m128i opaque = _mm_set1_epi32(static_cast<int>(Opaque));
+
+		size_t i = 0;
+
+		for (; i + 16 <= pixels; i += 16)
+		{
+			const __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			const __m128i low = _mm_unpacklo_epi8(gray, gray);
+			const __m128i high = _mm_unpackhi_epi8(gray, gray);
+
+			__m128i* output = reinterpret_cast<__m128i*>(target + i * 4);
+			_mm_storeu_si128(output, _mm_or_si128(_mm_unpacklo_epi16(low, low), opaque));
+			_mm_storeu_si128(output + 1, _mm_or_si128(_mm_unpackhi_epi16(low, low), opaque));
+			_mm_storeu_si128(output + 2, _mm_or_si128(_mm_unpacklo_epi16(high, high), opaque));
+			_mm_storeu_si128(output + 3, _mm_or_si128(_mm_unpackhi_epi16(high, high), opaque));
+		}
+
+		return i;
+	}
+
+	// Eight pixels at a time, four from each 128 bit lane
+	SIMD_TARGET("avx2") size_t Bgr24Avx2(const uint8_t* source, uint8_t* target, size_t pixels)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m256i opaque = _mm256_set1_epi32(static_cast<int>(Opaque));
+
+		size_t i = 0;
+
+		// The second load ends 28 bytes in
+		for (; i + 10 <= pixels; i += 8)
+		{
+			const uint8_t* input = source + i * 3;
+			const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+			const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 12));
+			const __m256i packed = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+
+			_mm256_storeu_si256(
+				reinterpret_cast<__m256i*>(target + i * 4),
+				_mm256_or_si256(_mm256_shuffle_epi8(packed, shuffle), opaque));
+		}
+
+		return i;
+	}
+
+	// Sixteen pixels at a time, the same sixteen bytes in both lanes
+	SIMD_TARGET("avx2") size_t Gray8Avx2(const uint8_t* source, uint8_t* target, size_t pixels)
+	{
+		const __m256i first = _mm256_setr_epi8(
+			0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+			4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+		const __m256i second = _mm256_setr_epi8(
+			8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1,
+			12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+		const __m256i opaque = _mm256_set1_epi32(static_cast<int>(Opaque));
+
+		size_t i = 0;
+
+		for (; i + 16 <= pixels; i += 16)
+		{
+			const __m256i gray = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+
+			__m256i* output = reinterpret_cast<__m256i*>(target + i * 4);
+			_mm256_storeu_si256(output, _mm256_or_si256(_mm256_shuffle_epi8(gray, first), opaque));
+			_mm256_storeu_si256(output + 1, _mm256_or_si256(_mm256_shuffle_epi8(gray, second), opaque));
+		}
+
+		return i;
+	}
+
+	SIMD_TARGET("xsave") SimdLevel Detect()
+	{
+		int info[4] = {};
+		__cpuid(info, 0);
+
+		if (info[0] >= 7)
+		{
+			__cpuid(info, 1);
+
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+
+			__cpuidex(info, 7, 0);
+
+			const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+			// The OS has to save the YMM registers too
+			if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6)
+			{
+				return SimdLevel::Avx2;
+			}
+		}
+
+		// Both x64 and the /arch:SSE2 default of x86 have it
+		return SimdLevel::Sse2;
+	}
+
+	SimdLevel DetectSimdLevel()
+	{
+		static const SimdLevel level = Detect();
+		return level;
+	}
+
+	void ExpandToBgr32(PixelFormat format, const uint8_t* source, uint8_t* target, size_t pixels)
+	{
+		ExpandToBgr32(format, source, target, pixels, DetectSimdLevel());
+	}
+
+	void ExpandToBgr32(PixelFormat format, const uint8_t* source, uint8_t* target, size_t pixels, SimdLevel level)
+	{
+		size_t done = 0;
+
+		switch (format)
+		{
+			case PixelFormat::Bgr24:
+				if (level == SimdLevel::Avx2)
+				{
+					done = Bgr24Avx2(source, target, pixels);
+				}
+				else if (level == SimdLevel::Sse2)
+				{
+					done = Bgr24Sse2(source, target, pixels);
+				}
+
+				Bgr24Scalar(source, target, done, pixels);
+				break;
+			case PixelFormat::Gray8:
+				if (level == SimdLevel::Avx2)
+				{
+					done = Gray8Avx2(source, target, pixels);
+				}
+				else if (level == SimdLevel::Sse2)
+				{
+					done = Gray8Sse2(source, target, pixels);
+				}
+
+				Gray8Scalar(source, target, done, pixels);
+				break;
+			default:
+				std::memcpy(target, source, pixels * 4);
+				break;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Image.hpp"
+
+namespace PictureBrowser
+{
+	enum class SimdLevel
+	{
+		Scalar,
+		Sse2,
+		Avx2
+	};
+
+	// The best this processor and OS support, checked once
+	SimdLevel DetectSimdLevel();
+
+	// Expands a row of compact pixels to the 32 bits per pixel Direct2D takes, with the unused byte set to 0xFF.
+	// The kernels handle any length and alignment, the overloads without the level pick the best one.
+	void ExpandToBgr32(PixelFormat format, const uint8_t* source, uint8_t* target, size_t pixels);
+	void ExpandToBgr32(PixelFormat format, const uint8_t* source, uint8_t* target, size_t pixels, SimdLevel level);
+}
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "PCH.hpp"
+#include "ThreadPool.hpp"
+#include "LogWrap.hpp"
+
+namespace PictureBrowser
+{
+	namespace
+	{
+		// Which pool the current thread works for, if any, and its own queues in it
+		thread_local const ThreadPool* t_pool = nullptr;
+		thread_local size_t t_index = 0;
+	}
+
+	ThreadPool::ThreadPool(
+		size_t threads,
+		const std::function<void()>& threadStart,
+		const std::function<void()>& threadStop,
+		size_t capacity) :
+		_threadStart(threadStart),
+		_threadStop(threadStop),
+		_capacity(capacity)
+	{
+		_ASSERTE(threads > 0);
+
+		for (size_t i = 0; i < threads; ++i)
+		{
+			_queues.emplace_back(std::make_unique<Queue>());
+		}
+
+		for (size_t i = 0; i < threads; ++i)
+		{
+			_threads.emplace_back(std::bind_front(&ThreadPool::Work, this, i));
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		for (std::jthread& thread : _threads)
+		{
+			thread.request_stop();
+		}
+
+		// Joins, the queues drop whatever was not started yet
+		_threads.clear();
+	}
+
+	void ThreadPool::Submit(std::function<void()>&& job, Priority priority, std::stop_token cancel)
+	{
+		_ASSERTE(priority < Priority::Count);
+
+		if (_capacity)
+		{
+			// The slot is taken before the lock is let go, so that submitters woken together cannot overshoot
+			std::unique_lock<std::mutex> lock(_mutex);
+			_room.wait(lock, [this] { return Pending() + _reserved < _capacity; });
+			++_reserved;
+		}
+
+		const size_t index = t_pool == this ? t_index : _next.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+		Queue& queue = *_queues[index];
+
+		{
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+			std::deque<Entry>& entries = queue.Entries[size_t(priority)];
+
+			if (priority == Priority::Visible)
+			{
+				entries.push_front({ std::move(job), std::move(cancel) });
+			}
+			else
+			{
+				entries.push_back({ std::move(job), std::move(cancel) });
+			}
+
+			_queued[size_t(priority)].fetch_add(1);
+		}
+
+		const size_t pending = Pending();
+		size_t highWater = _highWater.load(std::memory_order_relaxed);
+
+		while (pending > highWater && !_highWater.compare_exchange_weak(highWater, pending, std::memory_order_relaxed))
+		{
+		}
+
+		{
+			// A worker checks the counts under this lock before it goes to sleep
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if (_capacity)
+			{
+				// Counted as queued by now
+				--_reserved;
+			}
+		}
+
+		_condition.notify_one();
+	}
+
+	size_t ThreadPool::Pending() const
+	{
+		size_t pending = 0;
+
+		for (const std::atomic<size_t>& queued : _queued)
+		{
+			pending += queued.load();
+		}
+
+		return pending;
+	}
+
+	ThreadPool::Stats ThreadPool::Statistics() const
+	{
+		Stats stats;
+
+		for (size_t i = 0; i < stats.Queued.size(); ++i)
+		{
+			stats.Queued[i] = _queued[i].load();
+		}
+
+		stats.HighWaterQueued = _highWater.load();
+		stats.Steals = _steals.load();
+		stats.Cancelled = _cancelled.load();
+		return stats;
+	}
+
+	void ThreadPool::Work(size_t index, std::stop_token stopToken)
+	{
+		t_pool = this;
+		t_index = index;
+
+		if (_threadStart)
+		{
+			_threadStart();
+		}
+
+		while (!stopToken.stop_requested())
+		{
+			Entry entry;
+
+			if (!Take(index, entry))
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+
+				if (!_condition.wait(lock, stopToken, [this] { return Pending() > 0; }))
+				{
+					break;
+				}
+
+				continue;
+			}
+
+			if (_capacity)
+			{
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+				}
+
+				_room.notify_one();
+			}
+
+			if (entry.Cancel.stop_requested())
+			{
+				_cancelled.fetch_add(1);
+				continue;
+			}
+
+			try
+			{
+				entry.Job();
+			}
+			catch (const std::exception&)
+			{
+				LOGD << L"Unhandled exception in a job!";
+			}
+			catch (...)
+			{
+				LOGD << L"Unhandled non-standard exception in a job!";
+			}
+		}
+
+		if (_threadStop)
+		{
+			_threadStop();
+		}
+
+		t_pool = nullptr;
+	}
+
+	bool ThreadPool::Take(size_t index, Entry& entry)
+	{
+		for (size_t priority = 0; priority < size_t(Priority::Count); ++priority)
+		{
+			if (!_queued[priority].load())
+			{
+				continue;
+			}
+
+			// Its own queue first, then the others, in the order their owners would take them
+			for (size_t i = 0; i < _queues.size(); ++i)
+			{
+				Queue& queue = *_queues[(index + i) % _queues.size()];
+				std::lock_guard<std::mutex> lock(queue.Mutex);
+				std::deque<Entry>& entries = queue.Entries[priority];
+
+				if (entries.empty())
+				{
+					continue;
+				}
+
+				entry = std::move(entries.front());
+				entries.pop_front();
+				_queued[priority].fetch_sub(1);
+
+				if (i)
+				{
+					_steals.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
\ No newline at end of file
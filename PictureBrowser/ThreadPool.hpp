@@ -0,0 +1,91 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// Workers take the queued jobs of a higher class first, whichever worker they were queued to
+	enum class Priority
+	{
+		// On screen right now
+		Visible,
+		// Likely to be on screen next
+		Prefetch,
+		// Worth doing only when nothing else is
+		Background,
+		Count
+	};
+
+	// Each worker has queues of its own, one per priority. Jobs submitted by a worker go to its own queues,
+	// the others are dealt out in turn. A worker whose queues run dry steals from the others.
+	class ThreadPool
+	{
+	public:
+		struct Stats
+		{
+			std::array<size_t, size_t(Priority::Count)> Queued = {};
+			size_t HighWaterQueued = 0;
+			// Jobs a worker took from the queues of another
+			uint64_t Steals = 0;
+			// Jobs dropped before they started, their token was stopped
+			uint64_t Cancelled = 0;
+		};
+
+		// The start and stop hooks run on each worker thread, e.g. to initialize COM.
+		// With a capacity, Submit() waits while that many jobs are queued, so that a slow pool holds back
+		// whoever feeds it. Never submit to a bounded pool from its own workers.
+		ThreadPool(
+			size_t threads,
+			const std::function<void()>& threadStart = nullptr,
+			const std::function<void()>& threadStop = nullptr,
+			size_t capacity = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool& operator = (const ThreadPool&) = delete;
+		ThreadPool& operator = (ThreadPool&&) = delete;
+
+		// Visible jobs go in front of their class, the newest first, the other classes run in order.
+		// A job whose token is stopped before a worker gets to it is dropped along with whatever it captured,
+		// a long job should check the token on its own as well.
+		void Submit(std::function<void()>&& job, Priority priority, std::stop_token cancel = {});
+		size_t Pending() const;
+		Stats Statistics() const;
+
+	private:
+		struct Entry
+		{
+			std::function<void()> Job;
+			std::stop_token Cancel;
+		};
+
+		struct Queue
+		{
+			std::mutex Mutex;
+			std::array<std::deque<Entry>, size_t(Priority::Count)> Entries;
+		};
+
+		void Work(size_t index, std::stop_token stopToken);
+		bool Take(size_t index, Entry& entry);
+
+		std::function<void()> _threadStart;
+		std::function<void()> _threadStop;
+		const size_t _capacity;
+
+		// The counts change under the lock of the queue they count for
+		std::vector<std::unique_ptr<Queue>> _queues;
+		std::array<std::atomic<size_t>, size_t(Priority::Count)> _queued = {};
+		std::atomic<size_t> _highWater = 0;
+		std::atomic<size_t> _next = 0;
+		std::atomic<uint64_t> _steals = 0;
+		std::atomic<uint64_t> _cancelled = 0;
+
+		// Idle workers and full submitters wait on these
+		std::mutex _mutex;
+		// Room taken by submitters which have yet to queue their job
+		size_t _reserved = 0;
+		std::condition_variable_any _condition;
+		std::condition_variable _room;
+
+		std::vector<std::jthread> _threads;
+	};
+}
\ No newline at end of file
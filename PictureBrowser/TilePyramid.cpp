@@ -0,0 +1,163 @@
+#include "PCH.hpp"
+#include "TilePyramid.hpp"
+
+namespace PictureBrowser
+{
+	constexpr uint32_t MaxBitmapSide = 8192;
+	constexpr uint64_t MaxBitmapPixels = 4096 * 4096;
+
+	// Averaging more than this many samples per side of a block does not show
+	constexpr uint32_t MaxSamples = 4;
+
+	TilePyramid::TilePyramid(uint32_t width, uint32_t height) :
+		_width(width),
+		_height(height)
+	{
+		while ((std::max(_width, _height) >> (_levels - 1)) > TileSize)
+		{
+			++_levels;
+		}
+	}
+
+	bool TilePyramid::Wanted(uint32_t width, uint32_t height)
+	{
+		return width > MaxBitmapSide ||
+			height > MaxBitmapSide ||
+			uint64_t(width) * height > MaxBitmapPixels;
+	}
+
+	uint32_t TilePyramid::Width() const
+	{
+		return _width;
+	}
+
+	uint32_t TilePyramid::Height() const
+	{
+		return _height;
+	}
+
+	uint32_t TilePyramid::Levels() const
+	{
+		return _levels;
+	}
+
+	uint32_t TilePyramid::LevelFor(float scale) const
+	{
+		uint32_t level = 0;
+
+		while (level + 1 < _levels && scale * float(2u << level) <= 1.0f)
+		{
+			++level;
+		}
+
+		return level;
+	}
+
+	std::vector<TileKey> TilePyramid::Tiles(uint32_t level, const D2D_RECT_F& visible) const
+	{
+		std::vector<TileKey> tiles;
+
+		const float left = std::max(visible.left, 0.0f);
+		const float top = std::max(visible.top, 0.0f);
+		const float right = std::min(visible.right, float(_width));
+		const float bottom = std::min(visible.bottom, float(_height));
+
+		if (left >= right || top >= bottom)
+		{
+			return tiles;
+		}
+
+		const float span = float(TileSize << level);
+
+		const uint32_t firstColumn = static_cast<uint32_t>(left / span);
+		const uint32_t firstRow = static_cast<uint32_t>(top / span);
+		const uint32_t lastColumn = static_cast<uint32_t>(std::ceil(right / span));
+		const uint32_t lastRow = static_cast<uint32_t>(std::ceil(bottom / span));
+
+		for (uint32_t row = firstRow; row < lastRow; ++row)
+		{
+			for (uint32_t column = firstColumn; column < lastColumn; ++column)
+			{
+				tiles.push_back({ level, column, row });
+			}
+		}
+
+		return tiles;
+	}
+
+	D2D_RECT_F TilePyramid::SourceRect(const TileKey& key) const
+	{
+		const uint64_t span = uint64_t(TileSize) << key.Level;
+		const uint64_t left = key.Column * span;
+		const uint64_t top = key.Row * span;
+
+		return {
+			float(left),
+			float(top),
+			float(std::min(left + span, uint64_t(_width))),
+			float(std::min(top + span, uint64_t(_height)))
+		};
+	}
+
+	std::shared_ptr<Image> TilePyramid::Cut(const Image& source, const TileKey& key) const
+	{
+		_ASSERTE(source.Width() == _width && source.Height() == _height);
+
+		const D2D_RECT_F rect = SourceRect(key);
+		const uint32_t left = static_cast<uint32_t>(rect.left);
+		const uint32_t top = static_cast<uint32_t>(rect.top);
+		const uint32_t right = static_cast<uint32_t>(rect.right);
+		const uint32_t bottom = static_cast<uint32_t>(rect.bottom);
+
+		const uint32_t block = 1u << key.Level;
+		const uint32_t step = std::max(1u, block / MaxSamples);
+
+		auto tile = std::make_shared<Image>(
+			(right - left + block - 1) / block,
+			(bottom - top + block - 1) / block,
+			source.Format());
+
+		const uint32_t bytesPerPixel = BytesPerPixel(source.Format());
+
+		for (uint32_t y = 0; y < tile->Height(); ++y)
+		{
+			const uint32_t sourceTop = top + y * block;
+			const uint32_t sourceBottom = std::min(sourceTop + block, bottom);
+
+			uint8_t* row = tile->Pixels().data() + size_t(y) * tile->Stride();
+
+			for (uint32_t x = 0; x < tile->Width(); ++x)
+			{
+				const uint32_t sourceLeft = left + x * block;
+				const uint32_t sourceRight = std::min(sourceLeft + block, right);
+
+				uint32_t sum[4] = {};
+				uint32_t count = 0;
+
+				for (uint32_t sourceY = sourceTop; sourceY < sourceBottom; sourceY += step)
+				{
+					const uint8_t* sourceRow = source.Pixels().data() + size_t(sourceY) * source.Stride();
+
+					for (uint32_t sourceX = sourceLeft; sourceX < sourceRight; sourceX += step)
+					{
+						const uint8_t* pixel = sourceRow + size_t(sourceX) * bytesPerPixel;
+
+						for (uint32_t channel = 0; channel < bytesPerPixel; ++channel)
+						{
+							sum[channel] += pixel[channel];
+						}
+
+						++count;
+					}
+				}
+
+				for (uint32_t channel = 0; channel < bytesPerPixel; ++channel)
+				{
+					row[x * bytesPerPixel + channel] = static_cast<uint8_t>(sum[channel] / count);
+				}
+			}
+		}
+
+		return tile;
+	}
+}
\ No newline at end of file
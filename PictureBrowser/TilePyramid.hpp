@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Image.hpp"
+
+namespace PictureBrowser
+{
+	struct TileKey
+	{
+		uint32_t Level = 0;
+		uint32_t Column = 0;
+		uint32_t Row = 0;
+
+		bool operator == (const TileKey&) const = default;
+	};
+
+	struct TileKeyHash
+	{
+		// Mixes in 64 bits and folds down, as size_t is only 32 bits wide on x86.
+		// Column and row sit side by side, so that only the level has to be spread over them.
+		size_t operator()(const TileKey& key) const noexcept
+		{
+			uint64_t hash = ((uint64_t(key.Column) << 32) | key.Row) ^ (key.Level * 0x9E3779B97F4A7C15ull);
+			hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+			hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+			hash ^= hash >> 31;
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+	};
+
+	// Splits a very large image into fixed size tiles at power of two levels.
+	// Level zero has the full resolution, each level above halves it.
+	class TilePyramid
+	{
+	public:
+		static constexpr uint32_t TileSize = 512;
+
+		TilePyramid(uint32_t width, uint32_t height);
+
+		// True if the image is too large to be drawn as a single bitmap
+		static bool Wanted(uint32_t width, uint32_t height);
+
+		uint32_t Width() const;
+		uint32_t Height() const;
+		uint32_t Levels() const;
+
+		// The coarsest level, which still has as many pixels as drawn
+		uint32_t LevelFor(float scale) const;
+
+		// The tiles of the level which intersect the given rectangle of source pixels
+		std::vector<TileKey> Tiles(uint32_t level, const D2D_RECT_F& visible) const;
+
+		// The area the tile covers in source pixels
+		D2D_RECT_F SourceRect(const TileKey& key) const;
+
+		// Averages the source pixels of the tile down to its level
+		std::shared_ptr<Image> Cut(const Image& source, const TileKey& key) const;
+
+	private:
+		uint32_t _width = 0;
+		uint32_t _height = 0;
+		uint32_t _levels = 1;
+	};
+}
\ No newline at end of file
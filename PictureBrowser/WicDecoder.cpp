@@ -0,0 +1,484 @@
+#include "PCH.hpp"
+#include "WicDecoder.hpp"
+#include "LogWrap.hpp"
+#include "Orientation.hpp"
+
+namespace PictureBrowser
+{
+	struct PropertyVariant : PROPVARIANT
+	{
+		PropertyVariant()
+		{
+			PropVariantInit(this);
+		}
+
+		~PropertyVariant()
+		{
+			PropVariantClear(this);
+		}
+	};
+
+	ComPtr<IWICImagingFactory> CreateWicFactory()
+	{
+		ComPtr<IWICImagingFactory> factory;
+
+		HRESULT hr = CoCreateInstance(
+			CLSID_WICImagingFactory,
+			NULL,
+			CLSCTX_INPROC_SERVER,
+			IID_PPV_ARGS(&factory));
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "CoCreateInstance");
+		}
+
+		return factory;
+	}
+
+	struct DecodedSource
+	{
+		ComPtr<IWICBitmapSource> Source;
+
+		// The size of the full frame, as stored
+		UINT Width = 0;
+		UINT Height = 0;
+
+		ImageFormat Format = ImageFormat::Other;
+		PixelFormat Pixels = PixelFormat::Bgr32;
+
+		// The source is not turned upright, the pipeline does it after the copy
+		uint16_t Orientation = 1;
+	};
+
+	ImageFormat ContainerFormat(IWICBitmapDecoder* decoder)
+	{
+		GUID format = GUID_NULL;
+
+		if (FAILED(decoder->GetContainerFormat(&format)))
+		{
+			return ImageFormat::Other;
+		}
+
+		if (format == GUID_ContainerFormatJpeg)
+		{
+			return ImageFormat::Jpeg;
+		}
+
+		if (format == GUID_ContainerFormatPng)
+		{
+			return ImageFormat::Png;
+		}
+
+		if (format == GUID_ContainerFormatTiff)
+		{
+			return ImageFormat::Tiff;
+		}
+
+		if (format == GUID_ContainerFormatBmp)
+		{
+			return ImageFormat::Bmp;
+		}
+
+		if (format == GUID_ContainerFormatGif)
+		{
+			return ImageFormat::Gif;
+		}
+
+		if (format == GUID_ContainerFormatHeif)
+		{
+			return ImageFormat::Heif;
+		}
+
+		if (format == GUID_ContainerFormatWebp)
+		{
+			return ImageFormat::Webp;
+		}
+
+		return ImageFormat::Other;
+	}
+
+	// The most compact format which loses nothing the canvas would show. Transparency is not shown.
+	PixelFormat CompactFormat(IWICImagingFactory* factory, IWICBitmapFrameDecode* frame)
+	{
+		WICPixelFormatGUID format = GUID_NULL;
+
+		if (FAILED(frame->GetPixelFormat(&format)))
+		{
+			return PixelFormat::Bgr32;
+		}
+
+		if (format == GUID_WICPixelFormatBlackWhite ||
+			format == GUID_WICPixelFormat2bppGray ||
+			format == GUID_WICPixelFormat4bppGray ||
+			format == GUID_WICPixelFormat8bppGray ||
+			format == GUID_WICPixelFormat16bppGray ||
+			format == GUID_WICPixelFormat16bppGrayFixedPoint ||
+			format == GUID_WICPixelFormat16bppGrayHalf ||
+			format == GUID_WICPixelFormat32bppGrayFloat ||
+			format == GUID_WICPixelFormat32bppGrayFixedPoint)
+		{
+			return PixelFormat::Gray8;
+		}
+
+		if (format == GUID_WICPixelFormat1bppIndexed ||
+			format == GUID_WICPixelFormat2bppIndexed ||
+			format == GUID_WICPixelFormat4bppIndexed ||
+			format == GUID_WICPixelFormat8bppIndexed)
+		{
+			// Palettes are expanded, but a gray one fits in a byte
+			ComPtr<IWICPalette> palette;
+			BOOL gray = FALSE;
+
+			if (SUCCEEDED(factory->CreatePalette(&palette)) &&
+				SUCCEEDED(frame->CopyPalette(palette.Get())) &&
+				SUCCEEDED(palette->IsGrayscale(&gray)) &&
+				gray)
+			{
+				return PixelFormat::Gray8;
+			}
+		}
+
+		return PixelFormat::Bgr24;
+	}
+
+	const WICPixelFormatGUID& WicFormat(PixelFormat format)
+	{
+		switch (format)
+		{
+			case PixelFormat::Bgr24:
+				return GUID_WICPixelFormat24bppBGR;
+			case PixelFormat::Gray8:
+				return GUID_WICPixelFormat8bppGray;
+			default:
+				return GUID_WICPixelFormat32bppBGR;
+		}
+	}
+
+	// The JPEG decoder, among others, can scale by 1/2, 1/4 and 1/8 while decoding.
+	// Returns nullptr if the frame cannot, or if it would not get down to at least the given size.
+	ComPtr<IWICBitmapSource> NativeScale(IWICImagingFactory* factory, IWICBitmapFrameDecode* frame, UINT width, UINT height)
+	{
+		ComPtr<IWICBitmapSourceTransform> transform;
+
+		if (FAILED(frame->QueryInterface(IID_PPV_ARGS(&transform))))
+		{
+			return nullptr;
+		}
+
+		UINT frameWidth = 0;
+		UINT frameHeight = 0;
+
+		HRESULT hr = frame->GetSize(&frameWidth, &frameHeight);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapFrameDecode::GetSize");
+		}
+
+		UINT scaledWidth = width;
+		UINT scaledHeight = height;
+
+		hr = transform->GetClosestSize(&scaledWidth, &scaledHeight);
+
+		if (FAILED(hr) ||
+			scaledWidth < width ||
+			scaledHeight < height ||
+			scaledWidth >= frameWidth)
+		{
+			return nullptr;
+		}
+
+		WICPixelFormatGUID format = GUID_WICPixelFormat32bppBGR;
+
+		hr = transform->GetClosestPixelFormat(&format);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapSourceTransform::GetClosestPixelFormat");
+		}
+
+		ComPtr<IWICBitmap> bitmap;
+
+		hr = factory->CreateBitmap(scaledWidth, scaledHeight, format, WICBitmapCacheOnLoad, &bitmap);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICImagingFactory::CreateBitmap");
+		}
+
+		const WICRect rect = { 0, 0, static_cast<INT>(scaledWidth), static_cast<INT>(scaledHeight) };
+		ComPtr<IWICBitmapLock> lock;
+
+		hr = bitmap->Lock(&rect, WICBitmapLockWrite, &lock);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmap::Lock");
+		}
+
+		UINT stride = 0;
+		UINT size = 0;
+		BYTE* data = nullptr;
+
+		hr = lock->GetStride(&stride);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapLock::GetStride");
+		}
+
+		hr = lock->GetDataPointer(&size, &data);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapLock::GetDataPointer");
+		}
+
+		hr = transform->CopyPixels(
+			nullptr,
+			scaledWidth,
+			scaledHeight,
+			&format,
+			WICBitmapTransformRotate0,
+			stride,
+			size,
+			data);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapSourceTransform::CopyPixels");
+		}
+
+		LOGD << L"Natively scaled " << frameWidth << L"x" << frameHeight << L" to " << scaledWidth << L"x" << scaledHeight;
+		return bitmap;
+	}
+
+	// For the formats ProbeImage() does not know
+	uint16_t MetadataOrientation(IWICBitmapFrameDecode* frame)
+	{
+		ComPtr<IWICMetadataQueryReader> metadata;
+
+		HRESULT hr = frame->GetMetadataQueryReader(&metadata);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapFrameDecode::GetMetadataQueryReader");
+		}
+
+		PropertyVariant orientation;
+		hr = metadata->GetMetadataByName(L"/app1/ifd/{ushort=274}", &orientation);
+
+		if (FAILED(hr) && hr != WINCODEC_ERR_PROPERTYNOTFOUND)
+		{
+			throw std::system_error(hr, std::system_category(), "IWICMetadataQueryReader::GetMetadataByName");
+		}
+
+		return SUCCEEDED(hr) && orientation.vt == VT_UI2 ? orientation.uiVal : 1;
+	}
+
+	// Scales the first frame down to fit maxWidth x maxHeight, unless either is zero.
+	// Without a known orientation, the metadata of the frame is asked.
+	DecodedSource DecodeFrame(
+		IWICImagingFactory* factory,
+		IWICBitmapDecoder* decoder,
+		UINT maxWidth,
+		UINT maxHeight,
+		std::optional<uint16_t> orientation)
+	{
+		ComPtr<IWICBitmapFrameDecode> frame;
+
+		HRESULT hr = decoder->GetFrame(0, &frame);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapDecoder::GetFrame");
+		}
+
+		DecodedSource decoded;
+		decoded.Format = ContainerFormat(decoder);
+		decoded.Pixels = CompactFormat(factory, frame.Get());
+		decoded.Orientation = orientation ? *orientation : MetadataOrientation(frame.Get());
+
+		hr = frame->GetSize(&decoded.Width, &decoded.Height);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapFrameDecode::GetSize");
+		}
+
+		// Until oriented, the frame is sideways compared to the canvas
+		const bool sideways = SwapsSides(decoded.Orientation);
+
+		if (sideways)
+		{
+			std::swap(maxWidth, maxHeight);
+		}
+
+		ComPtr<IWICBitmapSource> source = frame;
+		UINT width = decoded.Width;
+		UINT height = decoded.Height;
+
+		if (maxWidth && maxHeight && (width > maxWidth || height > maxHeight))
+		{
+			const double scale = std::min(double(maxWidth) / width, double(maxHeight) / height);
+
+			width = std::max(1u, static_cast<UINT>(width * scale));
+			height = std::max(1u, static_cast<UINT>(height * scale));
+
+			ComPtr<IWICBitmapSource> scaled = NativeScale(factory, frame.Get(), width, height);
+
+			if (scaled)
+			{
+				source = scaled;
+			}
+		}
+
+		ComPtr<IWICFormatConverter> formatConverter;
+
+		hr = factory->CreateFormatConverter(&formatConverter);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICImagingFactory::CreateFormatConverter");
+		}
+
+		// Direct2D takes no 24 or 8 bpp bitmaps, Upload() expands them
+		hr = formatConverter->Initialize(
+			source.Get(),
+			WicFormat(decoded.Pixels),
+			WICBitmapDitherTypeNone,
+			nullptr,
+			0.0f,
+			WICBitmapPaletteTypeCustom);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICFormatConverter::Initialize");
+		}
+
+		source = formatConverter;
+
+		UINT sourceWidth = 0;
+		UINT sourceHeight = 0;
+
+		hr = source->GetSize(&sourceWidth, &sourceHeight);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapSource::GetSize");
+		}
+
+		if (sourceWidth != width || sourceHeight != height)
+		{
+			// The native scaling only goes in powers of two, or there was none
+			ComPtr<IWICBitmapScaler> scaler;
+
+			hr = factory->CreateBitmapScaler(&scaler);
+
+			if (FAILED(hr))
+			{
+				throw std::system_error(hr, std::system_category(), "IWICImagingFactory::CreateBitmapScaler");
+			}
+
+			hr = scaler->Initialize(source.Get(), width, height, WICBitmapInterpolationModeFant);
+
+			if (FAILED(hr))
+			{
+				throw std::system_error(hr, std::system_category(), "IWICBitmapScaler::Initialize");
+			}
+
+			source = scaler;
+		}
+
+		decoded.Source = source;
+		return decoded;
+	}
+
+	// Copies the pixels out of WIC, so that the result belongs to no device
+	std::shared_ptr<Image> CopyOut(const DecodedSource& decoded)
+	{
+		UINT width = 0;
+		UINT height = 0;
+
+		HRESULT hr = decoded.Source->GetSize(&width, &height);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapSource::GetSize");
+		}
+
+		auto image = std::make_shared<Image>(width, height, decoded.Pixels);
+
+		hr = decoded.Source->CopyPixels(
+			nullptr,
+			image->Stride(),
+			static_cast<UINT>(image->Bytes()),
+			image->Pixels().data());
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICBitmapSource::CopyPixels");
+		}
+
+		image->SetSourceSize(decoded.Width, decoded.Height);
+		return image;
+	}
+
+	WicDecoder::WicDecoder() :
+		_factory(CreateWicFactory())
+	{
+	}
+
+	std::wstring_view WicDecoder::Name() const
+	{
+		return L"WIC";
+	}
+
+	bool WicDecoder::Supports(ImageFormat format) const
+	{
+		// The RAW codecs are slow, where there are any. Only the previews embedded in RAW files come here.
+		return format != ImageFormat::Raw;
+	}
+
+	DecodedImage WicDecoder::Decode(
+		std::span<const uint8_t> data,
+		uint32_t maxWidth,
+		uint32_t maxHeight,
+		std::optional<uint16_t> orientation)
+	{
+		if (data.size() > MAXDWORD)
+		{
+			throw std::runtime_error("The image does not fit in a WIC stream!");
+		}
+
+		ComPtr<IWICStream> stream;
+
+		HRESULT hr = _factory->CreateStream(&stream);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICImagingFactory::CreateStream");
+		}
+
+		// Only read from, despite the signature
+		hr = stream->InitializeFromMemory(const_cast<BYTE*>(data.data()), static_cast<DWORD>(data.size()));
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICStream::InitializeFromMemory");
+		}
+
+		ComPtr<IWICBitmapDecoder> decoder;
+
+		hr = _factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder);
+
+		if (FAILED(hr))
+		{
+			throw std::system_error(hr, std::system_category(), "IWICImagingFactory::CreateDecoderFromStream");
+		}
+
+		const DecodedSource decoded = DecodeFrame(_factory.Get(), decoder.Get(), maxWidth, maxHeight, orientation);
+		return { CopyOut(decoded), decoded.Format, decoded.Orientation };
+	}
+}
\ No newline at end of file
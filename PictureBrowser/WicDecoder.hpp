@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Decoder.hpp"
+
+namespace PictureBrowser
+{
+	// Windows Imaging Component, which decodes whatever there is a codec installed for.
+	// Must be created on a thread which has initialized COM, and released before it uninitializes.
+	class WicDecoder : public Decoder
+	{
+	public:
+		WicDecoder();
+
+		std::wstring_view Name() const override;
+		bool Supports(ImageFormat format) const override;
+
+		DecodedImage Decode(
+			std::span<const uint8_t> data,
+			uint32_t maxWidth,
+			uint32_t maxHeight,
+			std::optional<uint16_t> orientation) override;
+
+	private:
+		ComPtr<IWICImagingFactory> _factory;
+	};
+}
\ No newline at end of file
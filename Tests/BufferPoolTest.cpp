@@ -0,0 +1,176 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "BufferPool.hpp"
+
+using namespace PictureBrowser;
+
+TEST(SmallSizesRoundUpToTheAlignment)
+{
+	CHECK(BufferPool::SizeClass(0) == 64);
+	CHECK(BufferPool::SizeClass(1) == 64);
+	CHECK(BufferPool::SizeClass(64) == 64);
+	CHECK(BufferPool::SizeClass(65) == 128);
+	CHECK(BufferPool::SizeClass(4096) == 4096);
+}
+
+TEST(LargeClassesAreAtMostAnEighthApart)
+{
+	bool fits = true;
+
+	for (size_t bytes = 4097; bytes < (256ull << 20); bytes = bytes * 9 / 7 + 13)
+	{
+		const size_t size = BufferPool::SizeClass(bytes);
+		fits &= size >= bytes && size - bytes <= bytes / 8 && size % BufferPool::Alignment == 0;
+	}
+
+	CHECK(fits);
+	CHECK(BufferPool::SizeClass(6000 * 4000 * 3) == BufferPool::SizeClass(6000 * 4000 * 3 - 1000));
+}
+
+TEST(BuffersAreAligned)
+{
+	const auto pool = std::make_shared<BufferPool>(1 << 20);
+
+	for (size_t bytes : { 1, 100, 5000, 300000 })
+	{
+		const BufferPool::Buffer buffer = pool->Allocate(bytes);
+		CHECK(reinterpret_cast<uintptr_t>(buffer.get()) % BufferPool::Alignment == 0);
+	}
+}
+
+TEST(ReleasedBuffersAreReused)
+{
+	const auto pool = std::make_shared<BufferPool>(1 << 20);
+
+	uint8_t* first = nullptr;
+
+	{
+		BufferPool::Buffer buffer = pool->Allocate(10000);
+		first = buffer.get();
+	}
+
+	const BufferPool::Buffer again = pool->Allocate(9999);
+	CHECK(again.get() == first);
+
+	const BufferPool::Stats stats = pool->Statistics();
+	CHECK(stats.Misses == 1);
+	CHECK(stats.Hits == 1);
+	CHECK(stats.IdleBytes == 0);
+}
+
+TEST(StatisticsFollowTheBuffers)
+{
+	const auto pool = std::make_shared<BufferPool>(1 << 20);
+	const size_t size = BufferPool::SizeClass(20000);
+
+	{
+		BufferPool::Buffer a = pool->Allocate(20000);
+		BufferPool::Buffer b = pool->Allocate(20000);
+		BufferPool::Buffer c = pool->Allocate(20000);
+
+		const BufferPool::Stats stats = pool->Statistics();
+		CHECK(stats.InUseBytes == 3 * size);
+		CHECK(stats.HighWaterBytes == 3 * size);
+		CHECK(stats.IdleBytes == 0);
+	}
+
+	BufferPool::Stats stats = pool->Statistics();
+	CHECK(stats.InUseBytes == 0);
+	CHECK(stats.IdleBytes == 3 * size);
+	CHECK(stats.HighWaterBytes == 3 * size);
+
+	{
+		BufferPool::Buffer a = pool->Allocate(20000);
+		BufferPool::Buffer b = pool->Allocate(64);
+	}
+
+	stats = pool->Statistics();
+	CHECK(stats.Hits == 1);
+	CHECK(stats.Misses == 4);
+	CHECK(stats.IdleBytes == 3 * size + 64);
+	CHECK(stats.HighWaterBytes == 3 * size);
+}
+
+TEST(IdleBytesAreCapped)
+{
+	const size_t size = BufferPool::SizeClass(100000);
+	const auto pool = std::make_shared<BufferPool>(2 * size + size / 2);
+
+	{
+		BufferPool::Buffer a = pool->Allocate(100000);
+		BufferPool::Buffer b = pool->Allocate(100000);
+		BufferPool::Buffer c = pool->Allocate(100000);
+	}
+
+	CHECK(pool->Statistics().IdleBytes == 2 * size);
+}
+
+TEST(TrimKeepsWhatItIsTold)
+{
+	const size_t size = BufferPool::SizeClass(50000);
+	const auto pool = std::make_shared<BufferPool>(1 << 20);
+
+	{
+		BufferPool::Buffer a = pool->Allocate(50000);
+		BufferPool::Buffer b = pool->Allocate(50000);
+		BufferPool::Buffer c = pool->Allocate(50000);
+		BufferPool::Buffer d = pool->Allocate(50000);
+	}
+
+	pool->Trim(2 * size);
+	CHECK(pool->Statistics().IdleBytes == 2 * size);
+
+	pool->Trim(2 * size - 1);
+	CHECK(pool->Statistics().IdleBytes == size);
+
+	pool->Trim();
+	CHECK(pool->Statistics().IdleBytes == 0);
+
+	const BufferPool::Buffer again = pool->Allocate(50000);
+	CHECK(pool->Statistics().Misses == 5);
+}
+
+TEST(BuffersKeepThePoolAlive)
+{
+	auto pool = std::make_shared<BufferPool>(1 << 20);
+	const std::weak_ptr<BufferPool> weak = pool;
+
+	{
+		BufferPool::Buffer buffer = pool->Allocate(1000);
+
+		pool.reset();
+		CHECK(!weak.expired());
+
+		buffer[999] = 1;
+	}
+
+	CHECK(weak.expired());
+}
+
+TEST(ThreadsShareThePool)
+{
+	const auto pool = std::make_shared<BufferPool>(64 << 20);
+	std::vector<std::thread> threads;
+
+	for (size_t thread = 0; thread < 4; ++thread)
+	{
+		threads.emplace_back([&pool, thread]()
+		{
+			for (size_t i = 0; i < 1000; ++i)
+			{
+				BufferPool::Buffer buffer = pool->Allocate(1000 * (thread + 1) + i % 7);
+				buffer[0] = 1;
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	const BufferPool::Stats stats = pool->Statistics();
+	CHECK(stats.Hits + stats.Misses == 4000);
+	CHECK(stats.InUseBytes == 0);
+	CHECK(stats.Hits > 0);
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+
+namespace PictureBrowser::Tests
+{
+	struct TestCase
+	{
+		const char* Name;
+		void (*Run)();
+	};
+
+	std::vector<TestCase>& TestCases()
+	{
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	size_t Failures = 0;
+
+	int Register(const char* name, void (*run)())
+	{
+		TestCases().push_back({ name, run });
+		return 0;
+	}
+
+	void Fail(const char* expression, const char* file, int line)
+	{
+		std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+		++Failures;
+	}
+
+	TemporaryDirectory::TemporaryDirectory()
+	{
+		static std::atomic<uint32_t> counter = 0;
+
+		_path = std::filesystem::temp_directory_path() /
+			("PictureBrowser-" + std::to_string(getpid()) + "-" + std::to_string(counter++));
+
+		std::filesystem::remove_all(_path);
+		std::filesystem::create_directories(_path);
+	}
+
+	TemporaryDirectory::~TemporaryDirectory()
+	{
+		std::error_code error;
+		std::filesystem::remove_all(_path, error);
+	}
+
+	const std::filesystem::path& TemporaryDirectory::Path() const
+	{
+		return _path;
+	}
+
+	std::filesystem::path TemporaryDirectory::Write(const std::filesystem::path& name, std::span<const uint8_t> content) const
+	{
+		const std::filesystem::path path = _path / name;
+		std::filesystem::create_directories(path.parent_path());
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+
+		if (!file)
+		{
+			throw std::runtime_error("Failed to write a test file!");
+		}
+
+		return path;
+	}
+}
+
+// Runs the test cases whose name contains the first argument, all of them without one
+int main(int argc, char** argv)
+{
+	using namespace PictureBrowser::Tests;
+
+	const std::string_view filter = argc > 1 ? argv[1] : "";
+	size_t failed = 0;
+	size_t run = 0;
+
+	for (const TestCase& testCase : TestCases())
+	{
+		if (!std::string_view(testCase.Name).contains(filter))
+		{
+			continue;
+		}
+
+		const size_t before = Failures;
+
+		try
+		{
+			testCase.Run();
+		}
+		catch (const std::exception& e)
+		{
+			std::fprintf(stderr, "%s threw: %s\n", testCase.Name, e.what());
+			++Failures;
+		}
+
+		const bool passed = Failures == before;
+		std::printf("%s %s\n", passed ? "[ OK ]" : "[FAIL]", testCase.Name);
+
+		failed += passed ? 0 : 1;
+		++run;
+	}
+
+	std::printf("%zu of %zu passed\n", run - failed, run);
+	return failed || !run ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#define TEST(name) \
+	static void name(); \
+	[[maybe_unused]] static const int name##Registered = PictureBrowser::Tests::Register(#name, name); \
+	static void name()
+
+// Keeps going on failure, so that one run reports every broken check
+#define CHECK(expression) \
+	((expression) ? void() : PictureBrowser::Tests::Fail(#expression, __FILE__, __LINE__))
+
+namespace PictureBrowser::Tests
+{
+	// Adds a test case to the ones main() runs, returns nothing of interest
+	int Register(const char* name, void (*run)());
+
+	// Reports the failed check and counts it against the current test case
+	void Fail(const char* expression, const char* file, int line);
+
+	// A directory of its own under the system temporary directory, removed with everything in it
+	class TemporaryDirectory
+	{
+	public:
+		TemporaryDirectory();
+		~TemporaryDirectory();
+
+		TemporaryDirectory(const TemporaryDirectory&) = delete;
+		TemporaryDirectory& operator = (const TemporaryDirectory&) = delete;
+
+		const std::filesystem::path& Path() const;
+
+		// Creates the file with the given content, and the directories on the way
+		std::filesystem::path Write(const std::filesystem::path& name, std::span<const uint8_t> content = {}) const;
+
+	private:
+		std::filesystem::path _path;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,602 @@
+#pragma once
+
+namespace PictureBrowser::Tests
+{
+	// Appends numbers in either byte order, and patches them in later
+	class ByteWriter
+	{
+	public:
+		explicit ByteWriter(bool bigEndian = true) :
+			_bigEndian(bigEndian)
+		{
+		}
+
+		std::vector<uint8_t> Data;
+
+		size_t Size() const
+		{
+			return Data.size();
+		}
+
+		void U8(uint8_t value)
+		{
+			Data.push_back(value);
+		}
+
+		void U16(uint16_t value)
+		{
+			Patch16(Grow(2), value);
+		}
+
+		void U32(uint32_t value)
+		{
+			Patch32(Grow(4), value);
+		}
+
+		void U64(uint64_t value)
+		{
+			const uint32_t high = static_cast<uint32_t>(value >> 32);
+			const uint32_t low = static_cast<uint32_t>(value);
+			U32(_bigEndian ? high : low);
+			U32(_bigEndian ? low : high);
+		}
+
+		void Bytes(std::span<const uint8_t> bytes)
+		{
+			if (!bytes.empty())
+			{
+				const size_t at = Grow(bytes.size());
+				std::memcpy(Data.data() + at, bytes.data(), bytes.size());
+			}
+		}
+
+		// Without a terminating zero
+		void Text(std::string_view text)
+		{
+			Bytes({ reinterpret_cast<const uint8_t*>(text.data()), text.size() });
+		}
+
+		void Zeros(size_t count)
+		{
+			Data.resize(Data.size() + count);
+		}
+
+		void Patch16(size_t at, uint16_t value)
+		{
+			for (size_t i = 0; i < 2; ++i)
+			{
+				Data[at + i] = static_cast<uint8_t>(value >> (_bigEndian ? 8 - i * 8 : i * 8));
+			}
+		}
+
+		void Patch32(size_t at, uint32_t value)
+		{
+			for (size_t i = 0; i < 4; ++i)
+			{
+				Data[at + i] = static_cast<uint8_t>(value >> (_bigEndian ? 24 - i * 8 : i * 8));
+			}
+		}
+
+	private:
+		size_t Grow(size_t bytes)
+		{
+			Data.resize(Data.size() + bytes);
+			return Data.size() - bytes;
+		}
+
+		bool _bigEndian;
+	};
+
+	struct IfdEntry
+	{
+		uint16_t Tag = 0;
+		uint16_t Type = 0;
+		uint32_t Count = 0;
+
+		// The number itself if it fits, the offset of the values otherwise
+		uint32_t Value = 0;
+	};
+
+	inline IfdEntry Short(uint16_t tag, uint16_t value)
+	{
+		return { tag, 3, 1, value };
+	}
+
+	inline IfdEntry Long(uint16_t tag, uint32_t value)
+	{
+		return { tag, 4, 1, value };
+	}
+
+	// A TIFF header with IFDs and the data they point at, offsets relative to the header
+	class TiffWriter
+	{
+	public:
+		explicit TiffWriter(bool bigEndian = false, uint16_t magic = 42) :
+			_writer(bigEndian),
+			_bigEndian(bigEndian)
+		{
+			_writer.Text(bigEndian ? "MM" : "II");
+			_writer.U16(magic);
+			_writer.U32(0);
+		}
+
+		// Data for the entries to point at
+		uint32_t Append(std::span<const uint8_t> data)
+		{
+			_writer.Zeros(_writer.Size() % 2);
+
+			const uint32_t offset = static_cast<uint32_t>(_writer.Size());
+			_writer.Bytes(data);
+			return offset;
+		}
+
+		// With the terminating zero, as in ASCII entries
+		uint32_t Append(std::string_view text)
+		{
+			std::vector<uint8_t> data(text.begin(), text.end());
+			data.push_back(0);
+			return Append(data);
+		}
+
+		// A chained IFD follows the one before it, or the header, the others are for SubIFD entries to point at
+		uint32_t Ifd(const std::vector<IfdEntry>& entries, bool chained = true)
+		{
+			_writer.Zeros(_writer.Size() % 2);
+
+			const uint32_t offset = static_cast<uint32_t>(_writer.Size());
+			_writer.U16(static_cast<uint16_t>(entries.size()));
+
+			for (const IfdEntry& entry : entries)
+			{
+				_writer.U16(entry.Tag);
+				_writer.U16(entry.Type);
+				_writer.U32(entry.Count);
+
+				if (entry.Type == 3 && entry.Count == 1)
+				{
+					_writer.U16(static_cast<uint16_t>(entry.Value));
+					_writer.U16(0);
+				}
+				else
+				{
+					_writer.U32(entry.Value);
+				}
+			}
+
+			const size_t next = _writer.Size();
+			_writer.U32(0);
+
+			if (chained)
+			{
+				_writer.Patch32(_next, offset);
+				_next = next;
+			}
+
+			return offset;
+		}
+
+		bool BigEndian() const
+		{
+			return _bigEndian;
+		}
+
+		const std::vector<uint8_t>& Data() const
+		{
+			return _writer.Data;
+		}
+
+	private:
+		ByteWriter _writer;
+		bool _bigEndian;
+		size_t _next = 4;
+	};
+
+	// A JPEG which decoders would not get far into, but with all the markers the probe looks at
+	class JpegWriter
+	{
+	public:
+		JpegWriter()
+		{
+			_writer.U16(0xFFD8);
+		}
+
+		void Segment(uint8_t marker, std::span<const uint8_t> payload)
+		{
+			_writer.U8(0xFF);
+			_writer.U8(marker);
+			_writer.U16(static_cast<uint16_t>(payload.size() + 2));
+			_writer.Bytes(payload);
+		}
+
+		// "Exif\0\0" and the TIFF
+		void Exif(const TiffWriter& tiff)
+		{
+			std::vector<uint8_t> payload = { 'E', 'x', 'i', 'f', 0, 0 };
+			payload.insert(payload.end(), tiff.Data().begin(), tiff.Data().end());
+			Segment(0xE1, payload);
+		}
+
+		// A quantization table and a baseline frame header
+		void Frame(uint16_t width, uint16_t height, uint8_t marker = 0xC0)
+		{
+			std::vector<uint8_t> table(65, 1);
+			table[0] = 0;
+			Segment(0xDB, table);
+
+			ByteWriter frame;
+			frame.U8(8);
+			frame.U16(height);
+			frame.U16(width);
+			frame.U8(1);
+			frame.U8(1);
+			frame.U8(0x11);
+			frame.U8(0);
+			Segment(marker, frame.Data);
+		}
+
+		// The scan header, a few bytes of scan or as many as asked for and the end of the image
+		std::vector<uint8_t> Finish(size_t scanBytes = 0)
+		{
+			Segment(0xDA, std::vector<uint8_t>{ 1, 1, 0, 0, 63, 0 });
+			_writer.Bytes(std::vector<uint8_t>{ 0x12, 0x34, 0xFF, 0x00, 0x56 });
+			_writer.Bytes(std::vector<uint8_t>(scanBytes, 0x55));
+			_writer.U16(0xFFD9);
+			return std::move(_writer.Data);
+		}
+
+		size_t Size() const
+		{
+			return _writer.Size();
+		}
+
+	private:
+		ByteWriter _writer;
+	};
+
+	inline std::vector<uint8_t> MinimalJpeg(uint16_t width, uint16_t height, size_t scanBytes = 0)
+	{
+		JpegWriter jpeg;
+		jpeg.Frame(width, height);
+		return jpeg.Finish(scanBytes);
+	}
+
+	struct ExifFields
+	{
+		uint16_t Orientation = 1;
+		std::string DateTimeOriginal;
+		std::vector<uint8_t> Thumbnail;
+
+		// Only TIFF files have their size in IFD0
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+	};
+
+	// IFD0 with the orientation, the EXIF IFD with the capture time and IFD1 with the thumbnail
+	inline TiffWriter Exif(bool bigEndian, const ExifFields& fields)
+	{
+		TiffWriter tiff(bigEndian);
+
+		uint32_t dateTime = 0;
+
+		if (!fields.DateTimeOriginal.empty())
+		{
+			dateTime = tiff.Append(fields.DateTimeOriginal);
+		}
+
+		const uint32_t thumbnail = fields.Thumbnail.empty() ? 0 : tiff.Append(fields.Thumbnail);
+		const uint32_t exifIfd = tiff.Ifd({ { 0x9003, 2, static_cast<uint32_t>(fields.DateTimeOriginal.size() + 1), dateTime } }, false);
+
+		std::vector<IfdEntry> ifd0 = { Short(0x0112, fields.Orientation), Long(0x8769, exifIfd) };
+
+		if (fields.Width && fields.Height)
+		{
+			ifd0.push_back(Long(0x0100, fields.Width));
+			ifd0.push_back(Long(0x0101, fields.Height));
+		}
+
+		tiff.Ifd(ifd0);
+
+		if (thumbnail)
+		{
+			tiff.Ifd({ Short(0x0103, 6), Long(0x0201, thumbnail), Long(0x0202, static_cast<uint32_t>(fields.Thumbnail.size())) });
+		}
+
+		return tiff;
+	}
+
+	inline std::vector<uint8_t> JpegWithExif(uint16_t width, uint16_t height, const TiffWriter& exif)
+	{
+		JpegWriter jpeg;
+		jpeg.Exif(exif);
+		jpeg.Frame(width, height);
+		return jpeg.Finish();
+	}
+
+	struct MpImage
+	{
+		uint32_t Attribute = 0;
+		std::vector<uint8_t> Data;
+	};
+
+	// A primary image with an MPF segment pointing at the ones appended after it, as cameras write them
+	inline std::vector<uint8_t> JpegWithMpf(uint16_t width, uint16_t height, const std::vector<MpImage>& images)
+	{
+		// The primary image entry and one for each appended image, the offsets are patched in below
+		ByteWriter entries;
+
+		for (size_t i = 0; i <= images.size(); ++i)
+		{
+			entries.U32(i ? images[i - 1].Attribute : 0x030000);
+			entries.U32(i ? static_cast<uint32_t>(images[i - 1].Data.size()) : 0);
+			entries.U32(0);
+			entries.U32(0);
+		}
+
+		TiffWriter mpf(true);
+		const uint32_t entryOffset = mpf.Append(entries.Data);
+		mpf.Ifd({ { 0xB002, 7, static_cast<uint32_t>(entries.Size()), entryOffset } });
+
+		JpegWriter jpeg;
+		std::vector<uint8_t> payload = { 'M', 'P', 'F', 0 };
+		payload.insert(payload.end(), mpf.Data().begin(), mpf.Data().end());
+
+		// The marker and length before the payload, then the identifier
+		const size_t header = jpeg.Size() + 4 + 4;
+		jpeg.Segment(0xE2, payload);
+		jpeg.Frame(width, height);
+
+		ByteWriter file;
+		file.Data = jpeg.Finish();
+
+		for (size_t i = 0; i < images.size(); ++i)
+		{
+			file.Patch32(header + entryOffset + (i + 1) * 16 + 8, static_cast<uint32_t>(file.Size() - header));
+			file.Bytes(images[i].Data);
+		}
+
+		return file.Data;
+	}
+
+	// The signature, IHDR, an optional eXIf chunk, a little IDAT and IEND. The CRCs are left zero.
+	inline std::vector<uint8_t> Png(uint32_t width, uint32_t height, const TiffWriter* exif = nullptr)
+	{
+		ByteWriter png;
+		png.Bytes(std::vector<uint8_t>{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' });
+
+		const auto chunk = [&png](std::string_view type, std::span<const uint8_t> data)
+		{
+			png.U32(static_cast<uint32_t>(data.size()));
+			png.Text(type);
+			png.Bytes(data);
+			png.U32(0);
+		};
+
+		ByteWriter header;
+		header.U32(width);
+		header.U32(height);
+		header.Bytes(std::vector<uint8_t>{ 8, 2, 0, 0, 0 });
+		chunk("IHDR", header.Data);
+
+		if (exif)
+		{
+			chunk("eXIf", exif->Data());
+		}
+
+		chunk("IDAT", std::vector<uint8_t>{ 0x78, 0x9C, 0x03, 0x00 });
+		chunk("IEND", {});
+
+		return png.Data;
+	}
+
+	// A camera RAW file with the embedded JPEGs the probe should find in it
+	struct RawFile
+	{
+		std::vector<uint8_t> Data;
+		std::vector<uint8_t> Preview;
+		std::vector<uint8_t> Thumbnail;
+	};
+
+	// A lossless JPEG, as the RAW data itself often is. No decoder for previews takes it.
+	inline std::vector<uint8_t> LosslessJpeg(uint16_t width, uint16_t height, size_t scanBytes)
+	{
+		JpegWriter jpeg;
+		jpeg.Frame(width, height, 0xC3);
+		return jpeg.Finish(scanBytes);
+	}
+
+	// As Nikon, Sony and DNG lay them out: a thumbnail as the strip of IFD0,
+	// a full size preview in one SubIFD and the RAW data in another
+	inline RawFile TiffRaw(bool bigEndian, size_t rawBytes, size_t previewBytes = 0)
+	{
+		RawFile raw;
+		raw.Thumbnail = MinimalJpeg(160, 120);
+		raw.Preview = MinimalJpeg(6000, 4000, previewBytes);
+
+		TiffWriter tiff(bigEndian);
+
+		const uint32_t thumbnail = tiff.Append(raw.Thumbnail);
+		const uint32_t preview = tiff.Append(raw.Preview);
+		const std::vector<uint8_t> rawJpeg = LosslessJpeg(6048, 4024, rawBytes);
+		const uint32_t rawData = tiff.Append(rawJpeg);
+
+		const uint32_t previewIfd = tiff.Ifd({
+			Short(0x0103, 6),
+			Long(0x0201, preview),
+			Long(0x0202, static_cast<uint32_t>(raw.Preview.size())) }, false);
+
+		const uint32_t rawIfd = tiff.Ifd({
+			Short(0x0103, 7),
+			Long(0x0100, 6048),
+			Long(0x0101, 4024),
+			Long(0x0111, rawData),
+			Long(0x0117, static_cast<uint32_t>(rawJpeg.size())) }, false);
+
+		ByteWriter subIfds(bigEndian);
+		subIfds.U32(previewIfd);
+		subIfds.U32(rawIfd);
+		const uint32_t subIfdList = tiff.Append(subIfds.Data);
+
+		tiff.Ifd({
+			Short(0x0103, 6),
+			Long(0x0100, 160),
+			Long(0x0101, 120),
+			Long(0x0111, thumbnail),
+			Short(0x0112, 8),
+			Long(0x0117, static_cast<uint32_t>(raw.Thumbnail.size())),
+			{ 0x014A, 4, 2, subIfdList } });
+
+		raw.Data = tiff.Data();
+		return raw;
+	}
+
+	// Panasonic keeps its preview in a tag of IFD0, in a TIFF with a magic number of its own
+	inline RawFile PanasonicRaw(size_t rawBytes, size_t previewBytes = 0)
+	{
+		RawFile raw;
+		raw.Preview = MinimalJpeg(1920, 1440, previewBytes);
+
+		TiffWriter tiff(false, 0x55);
+		const uint32_t preview = tiff.Append(raw.Preview);
+		const uint32_t rawData = tiff.Append(std::vector<uint8_t>(rawBytes, 0x55));
+
+		tiff.Ifd({
+			{ 0x002E, 7, static_cast<uint32_t>(raw.Preview.size()), preview },
+			Long(0x0111, rawData),
+			Long(0x0117, static_cast<uint32_t>(rawBytes)) });
+
+		raw.Data = tiff.Data();
+		return raw;
+	}
+
+	// The Fujifilm header points at a JPEG with EXIF and a thumbnail of its own
+	inline RawFile FujifilmRaw(size_t rawBytes, size_t previewBytes = 0)
+	{
+		RawFile raw;
+		raw.Thumbnail = MinimalJpeg(160, 120);
+
+		ExifFields fields;
+		fields.Orientation = 6;
+		fields.DateTimeOriginal = "2022:08:01 07:30:00";
+		fields.Thumbnail = raw.Thumbnail;
+		JpegWriter preview;
+		preview.Exif(Exif(true, fields));
+		preview.Frame(1920, 1280);
+		raw.Preview = preview.Finish(previewBytes);
+
+		ByteWriter file;
+		file.Text("FUJIFILMCCD-RAW 0201FF129502");
+		file.Zeros(84 - file.Size());
+		file.U32(0);
+		file.U32(static_cast<uint32_t>(raw.Preview.size()));
+		file.Zeros(160 - file.Size());
+
+		file.Patch32(84, static_cast<uint32_t>(file.Size()));
+		file.Bytes(raw.Preview);
+		file.Zeros(rawBytes);
+
+		raw.Data = std::move(file.Data);
+		return raw;
+	}
+
+	// An ISO base media file as Canon writes it: the metadata and a thumbnail in the movie box,
+	// a medium preview in a box of its own and the full size JPEG as the first track
+	inline RawFile CanonCr3(size_t rawBytes, size_t previewBytes = 0)
+	{
+		constexpr uint8_t CanonUuid[] = { 0x85, 0xC0, 0xB6, 0x87, 0x82, 0x0F, 0x11, 0xE0, 0x81, 0x11, 0xF4, 0xCE, 0x46, 0x2B, 0x6A, 0x48 };
+		constexpr uint8_t PreviewUuid[] = { 0xEA, 0xF4, 0x2B, 0x5E, 0x1C, 0x98, 0x4B, 0x88, 0xB9, 0xFB, 0xB7, 0xDC, 0x40, 0x6E, 0x4D, 0x16 };
+
+		RawFile raw;
+		raw.Thumbnail = MinimalJpeg(160, 120);
+		raw.Preview = MinimalJpeg(6000, 4000, previewBytes);
+
+		const std::vector<uint8_t> medium = MinimalJpeg(1620, 1080);
+
+		const auto box = [](std::string_view type, std::span<const uint8_t> payload)
+		{
+			ByteWriter writer;
+			writer.U32(static_cast<uint32_t>(payload.size() + 8));
+			writer.Text(type);
+			writer.Bytes(payload);
+			return writer.Data;
+		};
+
+		const auto join = [](std::initializer_list<std::span<const uint8_t>> parts)
+		{
+			ByteWriter writer;
+
+			for (std::span<const uint8_t> part : parts)
+			{
+				writer.Bytes(part);
+			}
+
+			return writer.Data;
+		};
+
+		ExifFields fields;
+		fields.Orientation = 3;
+		fields.Width = 6000;
+		fields.Height = 4000;
+
+		// Version and flags, the size, the JPEG size and four unknown bytes
+		ByteWriter thumbnail;
+		thumbnail.U32(0);
+		thumbnail.U16(160);
+		thumbnail.U16(120);
+		thumbnail.U32(static_cast<uint32_t>(raw.Thumbnail.size()));
+		thumbnail.U32(0);
+		thumbnail.Bytes(raw.Thumbnail);
+
+		const std::vector<uint8_t> canon = box("uuid", join({
+			CanonUuid,
+			box("CMT1", Exif(false, fields).Data()),
+			box("THMB", thumbnail.Data) }));
+
+		// Version and flags, one size for all samples and the count. Version and flags, the count and the offset.
+		ByteWriter sizes;
+		sizes.U32(0);
+		sizes.U32(static_cast<uint32_t>(raw.Preview.size()));
+		sizes.U32(1);
+
+		ByteWriter offsets;
+		offsets.U32(0);
+		offsets.U32(1);
+		const size_t offsetAt = offsets.Size();
+		offsets.U64(0);
+
+		const std::vector<uint8_t> table = box("stbl", join({ box("stsz", sizes.Data), box("co64", offsets.Data) }));
+		const std::vector<uint8_t> track = box("trak", box("mdia", box("minf", table)));
+		const std::vector<uint8_t> movie = box("moov", join({ canon, track }));
+
+		// Eight unknown bytes, then the PRVW box with the JPEG size 24 bytes in
+		ByteWriter prvw;
+		prvw.Zeros(8);
+		prvw.U32(static_cast<uint32_t>(medium.size() + 28));
+		prvw.Text("PRVW");
+		prvw.Zeros(16);
+		prvw.U32(static_cast<uint32_t>(medium.size()));
+		prvw.Bytes(medium);
+
+		const std::vector<uint8_t> preview = box("uuid", join({ PreviewUuid, prvw.Data }));
+
+		ByteWriter type;
+		type.Text("crx ");
+		type.U32(1);
+		type.Text("crx isom");
+
+		ByteWriter file;
+		file.Bytes(box("ftyp", type.Data));
+		file.Bytes(movie);
+		file.Bytes(preview);
+
+		// The track offset points into the media data box, which comes last
+		const size_t movieAt = file.Size() - preview.size() - movie.size();
+		const size_t trackOffsetAt = movieAt + movie.size() - track.size() + 8 + 8 + 8 + 8 + 8 + sizes.Size() + 8 + offsetAt;
+		const size_t mediaAt = file.Size() + 8;
+
+		file.Bytes(box("mdat", join({ raw.Preview, std::vector<uint8_t>(rawBytes, 0x55) })));
+		file.Patch32(trackOffsetAt + 4, static_cast<uint32_t>(mediaAt));
+
+		raw.Data = std::move(file.Data);
+		return raw;
+	}
+}
\ No newline at end of file
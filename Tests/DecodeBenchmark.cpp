@@ -0,0 +1,218 @@
+#include "PCH.hpp"
+#include "Encoders.hpp"
+#include "ImageProbe.hpp"
+#include "LibJpegDecoder.hpp"
+#include "LibPngDecoder.hpp"
+#include "Orientation.hpp"
+#include "ThreadPool.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	// As in the application, each decode worker has decoders of its own
+	thread_local Decoders WorkerDecoders;
+
+	struct Run
+	{
+		size_t DecodeThreads = 0;
+		size_t FinishThreads = 0;
+		double Seconds = 0.0;
+		size_t Failures = 0;
+		uint64_t Steals = 0;
+
+		// Summed over the workers, in seconds
+		std::atomic<double> Probe = 0.0;
+		std::atomic<double> Decode = 0.0;
+		std::atomic<double> Orient = 0.0;
+	};
+
+	void Add(std::atomic<double>& total, double seconds)
+	{
+		double value = total.load();
+
+		while (!total.compare_exchange_weak(value, value + seconds))
+		{
+		}
+	}
+
+	// The stages of the application's pipeline without the Windows ones: probe and decode on one pool,
+	// orient on another, half its size
+	void TimeRun(Run& run, const std::vector<std::vector<uint8_t>>& images, uint32_t width, uint32_t height)
+	{
+		run.FinishThreads = std::max(run.DecodeThreads / 2, size_t(1));
+
+		std::vector<std::promise<std::shared_ptr<const Image>>> promises(images.size());
+		std::vector<std::future<std::shared_ptr<const Image>>> results;
+
+		for (auto& promise : promises)
+		{
+			results.emplace_back(promise.get_future());
+		}
+
+		const auto start = Clock::now();
+
+		{
+			ThreadPool finishers(run.FinishThreads);
+
+			ThreadPool decoders(
+				run.DecodeThreads,
+				[]()
+				{
+					WorkerDecoders.Add(std::make_unique<LibJpegDecoder>());
+					WorkerDecoders.Add(std::make_unique<LibPngDecoder>());
+				},
+				[]()
+				{
+					WorkerDecoders.Clear();
+				});
+
+			for (size_t i = 0; i < images.size(); ++i)
+			{
+				decoders.Submit([&, i]()
+				{
+					try
+					{
+						auto stage = Clock::now();
+						const std::optional<ImageInfo> info = ProbeImage(images[i]);
+						const ImageFormat format = info ? info->Format : ImageFormat::Other;
+						Add(run.Probe, SecondsSince(stage));
+
+						stage = Clock::now();
+						std::optional<uint16_t> orientation;
+
+						if (info)
+						{
+							orientation = info->Orientation;
+						}
+
+						auto decoded = std::make_shared<DecodedImage>(
+							WorkerDecoders.For(format).Decode(images[i], width, height, orientation));
+
+						Add(run.Decode, SecondsSince(stage));
+
+						finishers.Submit([&, i, decoded]()
+						{
+							const auto stage = Clock::now();
+							std::shared_ptr<Image> oriented = Oriented(*decoded->Pixels, decoded->Orientation);
+							oriented->SetSourceSize(decoded->Pixels->SourceWidth(), decoded->Pixels->SourceHeight());
+							Add(run.Orient, SecondsSince(stage));
+
+							promises[i].set_value(std::move(oriented));
+						}, Priority::Prefetch);
+					}
+					catch (...)
+					{
+						promises[i].set_exception(std::current_exception());
+					}
+				}, Priority::Prefetch);
+			}
+
+			for (auto& result : results)
+			{
+				try
+				{
+					const std::shared_ptr<const Image> image = result.get();
+
+					if (!image || image->Width() > width || image->Height() > height)
+					{
+						++run.Failures;
+					}
+				}
+				catch (const std::exception&)
+				{
+					++run.Failures;
+				}
+			}
+
+			run.Steals = decoders.Statistics().Steals;
+		}
+
+		run.Seconds = SecondsSince(start);
+	}
+
+	// Every fourth one is turned sideways, every fourth one is a PNG
+	std::vector<std::vector<uint8_t>> Images(size_t count)
+	{
+		std::vector<std::vector<uint8_t>> images;
+		const std::vector<uint8_t> jpegPixels = Gradient(3000, 2000, 3);
+		const std::vector<uint8_t> pngPixels = Gradient(1500, 1000, 3);
+
+		// EXIF orientation 6, little endian: "Exif\0\0", the TIFF header and an IFD of one entry
+		const std::vector<uint8_t> sideways = {
+			'E', 'x', 'i', 'f', 0, 0, 'I', 'I', 42, 0, 8, 0, 0, 0,
+			1, 0, 0x12, 0x01, 3, 0, 1, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0 };
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (i % 4 == 3)
+			{
+				images.emplace_back(EncodePng(1500, 1000, PNG_FORMAT_RGB, pngPixels));
+			}
+			else
+			{
+				const bool turned = i % 4 == 1;
+				images.emplace_back(EncodeJpeg(3000, 2000, JCS_RGB, jpegPixels, 85, turned ? std::span(sideways) : std::span<const uint8_t>()));
+			}
+		}
+
+		return images;
+	}
+}
+
+// Decodes the same in-memory images to fit a 1920 x 1080 canvas with growing thread counts, like
+// PictureBrowser.exe /benchmark does with WIC. The optional argument is the number of images.
+int main(int argc, char** argv)
+{
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 16;
+	constexpr uint32_t Width = 1920;
+	constexpr uint32_t Height = 1080;
+
+	const std::vector<std::vector<uint8_t>> images = Images(count);
+	const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::vector<size_t> threadCounts;
+
+	for (size_t threads = 1; threads < cores; threads *= 2)
+	{
+		threadCounts.emplace_back(threads);
+	}
+
+	threadCounts.emplace_back(cores);
+
+	// Warms up the buffer pool and the caches
+	Run warmUp;
+	warmUp.DecodeThreads = cores;
+	TimeRun(warmUp, images, Width, Height);
+
+	size_t failures = warmUp.Failures;
+
+	std::printf("{\n\t\"images\": %zu,\n\t\"width\": %u,\n\t\"height\": %u,\n\t\"runs\": [", count, Width, Height);
+
+	for (size_t i = 0; i < threadCounts.size(); ++i)
+	{
+		Run run;
+		run.DecodeThreads = threadCounts[i];
+		TimeRun(run, images, Width, Height);
+		failures += run.Failures;
+
+		std::printf(
+			"%s\n\t\t{\"decodeThreads\": %zu, \"finishThreads\": %zu, \"seconds\": %.3f, \"imagesPerSecond\": %.1f, "
+			"\"failures\": %zu, \"steals\": %llu, \"probeMs\": %.2f, \"decodeMs\": %.2f, \"orientMs\": %.2f}",
+			i ? "," : "",
+			run.DecodeThreads,
+			run.FinishThreads,
+			run.Seconds,
+			run.Seconds > 0.0 ? double(count) / run.Seconds : 0.0,
+			run.Failures,
+			static_cast<unsigned long long>(run.Steals),
+			run.Probe * 1000.0,
+			run.Decode * 1000.0,
+			run.Orient * 1000.0);
+	}
+
+	std::printf("\n\t]\n}\n");
+	return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "Corpus.hpp"
+#include "Encoders.hpp"
+#include "LibJpegDecoder.hpp"
+#include "LibPngDecoder.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	bool Near(std::span<const uint8_t> pixel, std::vector<int> expected, int tolerance = 8)
+	{
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			if (std::abs(int(pixel[i]) - expected[i]) > tolerance)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	std::span<const uint8_t> Pixel(const Image& image, uint32_t x, uint32_t y)
+	{
+		return image.Pixels().subspan(size_t(y) * image.Stride() + size_t(x) * BytesPerPixel(image.Format()));
+	}
+
+	double MeanDifference(const Image& a, const Image& b)
+	{
+		uint64_t sum = 0;
+
+		for (size_t i = 0; i < a.Bytes(); ++i)
+		{
+			sum += std::abs(int(a.Pixels()[i]) - int(b.Pixels()[i]));
+		}
+
+		return double(sum) / double(a.Bytes());
+	}
+}
+
+TEST(JpegColorsComeOutBgr)
+{
+	const auto jpeg = EncodeJpeg(64, 48, JCS_RGB, Solid(64, 48, { 255, 0, 0 }));
+	const DecodedImage decoded = LibJpegDecoder().Decode(jpeg, 0, 0, 1);
+
+	CHECK(decoded.Format == ImageFormat::Jpeg);
+	CHECK(decoded.Pixels->Format() == PixelFormat::Bgr24);
+	CHECK(decoded.Pixels->Width() == 64);
+	CHECK(decoded.Pixels->Height() == 48);
+	CHECK(!decoded.Pixels->IsPartial());
+	CHECK(Near(Pixel(*decoded.Pixels, 10, 10), { 0, 0, 255 }));
+}
+
+TEST(GrayJpegStaysGray)
+{
+	const auto jpeg = EncodeJpeg(32, 32, JCS_GRAYSCALE, Solid(32, 32, { 100 }));
+	const DecodedImage decoded = LibJpegDecoder().Decode(jpeg, 0, 0, 1);
+
+	CHECK(decoded.Pixels->Format() == PixelFormat::Gray8);
+	CHECK(Near(Pixel(*decoded.Pixels, 5, 5), { 100 }, 2));
+}
+
+TEST(CmykJpegIsConverted)
+{
+	// Red in the inverted CMYK which goes with the Adobe marker libjpeg writes
+	const auto jpeg = EncodeJpeg(32, 32, JCS_CMYK, Solid(32, 32, { 255, 0, 0, 255 }));
+	const DecodedImage decoded = LibJpegDecoder().Decode(jpeg, 0, 0, 1);
+
+	CHECK(decoded.Pixels->Format() == PixelFormat::Bgr32);
+	CHECK(Near(Pixel(*decoded.Pixels, 5, 5), { 0, 0, 255, 255 }));
+}
+
+TEST(LargeJpegIsScaledWhileDecoding)
+{
+	const auto jpeg = EncodeJpeg(1600, 1200, JCS_RGB, Gradient(1600, 1200, 3));
+	LibJpegDecoder decoder;
+
+	const DecodedImage scaled = decoder.Decode(jpeg, 200, 200, 1);
+	CHECK(scaled.Pixels->Width() == 200);
+	CHECK(scaled.Pixels->Height() == 150);
+	CHECK(scaled.Pixels->SourceWidth() == 1600);
+	CHECK(scaled.Pixels->SourceHeight() == 1200);
+	CHECK(scaled.Pixels->IsPartial());
+
+	// Close to averaging the full decode down
+	const DecodedImage full = decoder.Decode(jpeg, 0, 0, 1);
+	CHECK(full.Pixels->Width() == 1600);
+
+	const std::shared_ptr<Image> reference = Downscale(*full.Pixels, 200, 200);
+	CHECK(MeanDifference(*scaled.Pixels, *reference) < 3.0);
+}
+
+TEST(SidewaysJpegFitsOnceTurned)
+{
+	const auto jpeg = EncodeJpeg(1600, 1200, JCS_RGB, Gradient(1600, 1200, 3));
+	const DecodedImage decoded = LibJpegDecoder().Decode(jpeg, 300, 100, 6);
+
+	// Stored as it was, 75 wide and 100 high once turned
+	CHECK(decoded.Orientation == 6);
+	CHECK(decoded.Pixels->Width() == 100);
+	CHECK(decoded.Pixels->Height() == 75);
+}
+
+TEST(JpegOrientationComesFromExif)
+{
+	ExifFields fields;
+	fields.Orientation = 8;
+
+	const TiffWriter exif = Exif(false, fields);
+	std::vector<uint8_t> app1 = { 'E', 'x', 'i', 'f', 0, 0 };
+	app1.insert(app1.end(), exif.Data().begin(), exif.Data().end());
+
+	const auto jpeg = EncodeJpeg(16, 16, JCS_RGB, Solid(16, 16, { 0, 0, 0 }), 90, app1);
+	LibJpegDecoder decoder;
+
+	CHECK(decoder.Decode(jpeg, 0, 0, std::nullopt).Orientation == 8);
+	CHECK(decoder.Decode(jpeg, 0, 0, 3).Orientation == 3);
+}
+
+TEST(BrokenJpegThrowsAndTheDecoderGoesOn)
+{
+	const auto jpeg = EncodeJpeg(64, 64, JCS_RGB, Gradient(64, 64, 3));
+	const std::vector<uint8_t> header(jpeg.begin(), jpeg.begin() + 20);
+	const std::vector<uint8_t> garbage = { 0xFF, 0xD8, 0xFF, 0x00, 0x12, 0x34 };
+
+	LibJpegDecoder decoder;
+
+	for (const std::vector<uint8_t>& data : { header, garbage, std::vector<uint8_t>() })
+	{
+		bool thrown = false;
+
+		try
+		{
+			decoder.Decode(data, 0, 0, 1);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+
+		CHECK(thrown);
+	}
+
+	CHECK(decoder.Decode(jpeg, 0, 0, 1).Pixels->Width() == 64);
+}
+
+TEST(TruncatedJpegDecodesAsFarAsItGoes)
+{
+	const auto jpeg = EncodeJpeg(256, 256, JCS_RGB, Gradient(256, 256, 3));
+	const std::vector<uint8_t> truncated(jpeg.begin(), jpeg.begin() + jpeg.size() / 2);
+
+	const DecodedImage decoded = LibJpegDecoder().Decode(truncated, 0, 0, 1);
+	CHECK(decoded.Pixels->Width() == 256);
+	CHECK(decoded.Pixels->Height() == 256);
+}
+
+TEST(PngColorsComeOutBgr)
+{
+	const auto png = EncodePng(40, 30, PNG_FORMAT_RGB, Solid(40, 30, { 10, 20, 30 }));
+	const DecodedImage decoded = LibPngDecoder().Decode(png, 0, 0, 1);
+
+	CHECK(decoded.Format == ImageFormat::Png);
+	CHECK(decoded.Pixels->Format() == PixelFormat::Bgr24);
+	CHECK(decoded.Pixels->Width() == 40);
+	CHECK(decoded.Pixels->Height() == 30);
+	CHECK(Near(Pixel(*decoded.Pixels, 39, 29), { 30, 20, 10 }, 0));
+}
+
+TEST(GrayPngStaysGray)
+{
+	const auto png = EncodePng(8, 8, PNG_FORMAT_GRAY, Solid(8, 8, { 77 }));
+	const DecodedImage decoded = LibPngDecoder().Decode(png, 0, 0, 1);
+
+	CHECK(decoded.Pixels->Format() == PixelFormat::Gray8);
+	CHECK(Near(Pixel(*decoded.Pixels, 7, 7), { 77 }, 0));
+}
+
+TEST(TransparentPngIsOnBlack)
+{
+	std::vector<uint8_t> pixels = Solid(2, 1, { 255, 0, 0, 255 });
+	pixels[7] = 0;
+
+	const auto png = EncodePng(2, 1, PNG_FORMAT_RGBA, pixels);
+	const DecodedImage decoded = LibPngDecoder().Decode(png, 0, 0, 1);
+
+	CHECK(decoded.Pixels->Format() == PixelFormat::Bgr24);
+	CHECK(Near(Pixel(*decoded.Pixels, 0, 0), { 0, 0, 255 }, 0));
+	CHECK(Near(Pixel(*decoded.Pixels, 1, 0), { 0, 0, 0 }, 0));
+}
+
+TEST(SixteenBitPngComesDownToEight)
+{
+	std::vector<uint16_t> pixels(4 * 4 * 3, 0xFFFF);
+	const auto png = EncodePng(
+		4,
+		4,
+		PNG_FORMAT_LINEAR_RGB,
+		{ reinterpret_cast<const uint8_t*>(pixels.data()), pixels.size() * sizeof(uint16_t) });
+
+	const DecodedImage decoded = LibPngDecoder().Decode(png, 0, 0, 1);
+
+	CHECK(decoded.Pixels->Format() == PixelFormat::Bgr24);
+	CHECK(Near(Pixel(*decoded.Pixels, 3, 3), { 255, 255, 255 }, 0));
+}
+
+TEST(LargePngIsScaledDown)
+{
+	const auto png = EncodePng(400, 100, PNG_FORMAT_RGB, Gradient(400, 100, 3));
+	const DecodedImage decoded = LibPngDecoder().Decode(png, 100, 100, 1);
+
+	CHECK(decoded.Pixels->Width() == 100);
+	CHECK(decoded.Pixels->Height() == 25);
+	CHECK(decoded.Pixels->SourceWidth() == 400);
+}
+
+TEST(BrokenPngThrows)
+{
+	auto png = EncodePng(8, 8, PNG_FORMAT_RGB, Gradient(8, 8, 3));
+	png.resize(png.size() / 2);
+
+	bool thrown = false;
+
+	try
+	{
+		LibPngDecoder().Decode(png, 0, 0, 1);
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+
+	CHECK(thrown);
+}
+
+TEST(EachFormatGoesToItsBackend)
+{
+	Decoders decoders;
+	decoders.Add(std::make_unique<LibJpegDecoder>());
+	decoders.Add(std::make_unique<LibPngDecoder>());
+
+	CHECK(decoders.For(ImageFormat::Jpeg).Name() == L"libjpeg-turbo");
+	CHECK(decoders.For(ImageFormat::Png).Name() == L"libpng");
+
+	bool thrown = false;
+
+	try
+	{
+		decoders.For(ImageFormat::Tiff);
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+
+	CHECK(thrown);
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "PCH.hpp"
+#include "DirectoryScanner.hpp"
+#include "FileNames.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	// What listing a folder used to do: a pass over the directory for each extension, a path kept for each image
+	std::vector<std::filesystem::path> ScanPerExtension(const std::filesystem::path& directory)
+	{
+		std::vector<std::filesystem::path> paths;
+
+		for (std::wstring_view extension : { L".JPG", L".JPEG", L".PNG" })
+		{
+			for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory))
+			{
+				if (entry.is_regular_file() && EqualsIgnoringCase(entry.path().extension().wstring(), extension))
+				{
+					paths.push_back(entry.path());
+				}
+			}
+		}
+
+		std::sort(paths.begin(), paths.end());
+		return paths;
+	}
+}
+
+// A card dump of JPEGs, every tenth with a RAW file and every fourth with a sidecar. Lists it in one pass,
+// in batches on a thread, and in a pass per extension, then looks up every name in the listing.
+int main(int argc, char** argv)
+{
+	const size_t shots = argc > 1 ? std::stoul(argv[1]) : 20000;
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+		("PictureBrowser-DirectoryScanBenchmark-" + std::to_string(getpid()));
+
+	std::filesystem::create_directories(directory);
+	std::vector<std::wstring> names;
+
+	for (size_t i = 0; i < shots; ++i)
+	{
+		const std::string stem = "DSC_" + std::to_string(100000 + i);
+		names.push_back(std::filesystem::path(stem + ".JPG").wstring());
+
+		std::ofstream(directory / (stem + ".JPG")).put('x');
+
+		if (i % 10 == 0)
+		{
+			std::ofstream(directory / (stem + ".NEF")).put('x');
+		}
+
+		if (i % 4 == 0)
+		{
+			std::ofstream(directory / (stem + ".xmp")).put('x');
+		}
+	}
+
+	SidecarIndex sidecars;
+	auto start = Clock::now();
+	const FileModel model = ScanDirectory(directory, sidecars);
+	const double scanMs = SecondsSince(start) * 1000.0;
+
+	start = Clock::now();
+	const std::vector<std::filesystem::path> paths = ScanPerExtension(directory);
+	const double perExtensionMs = SecondsSince(start) * 1000.0;
+
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::optional<double> firstBatchMs;
+
+	FileModel batched(directory);
+	SidecarIndex batchedSidecars;
+	start = Clock::now();
+
+	{
+		DirectoryScan scan(directory, [&]()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (!firstBatchMs)
+			{
+				firstBatchMs = SecondsSince(start) * 1000.0;
+			}
+
+			ready.notify_one();
+		});
+
+		for (bool done = false; !done;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				ready.wait_for(lock, std::chrono::milliseconds(10));
+			}
+
+			DirectoryScan::Batch batch = scan.Take();
+			AddEntries(batch.Filenames, batched, batchedSidecars);
+			done = batch.Done;
+		}
+	}
+
+	const double batchedMs = SecondsSince(start) * 1000.0;
+
+	std::vector<double> findUs;
+	findUs.reserve(names.size());
+	size_t found = 0;
+
+	for (const std::wstring& name : names)
+	{
+		const auto lookup = Clock::now();
+		found += model.Find(name) ? 1 : 0;
+		findUs.push_back(SecondsSince(lookup) * 1e6);
+	}
+
+	std::filesystem::remove_all(directory);
+
+	std::printf(
+		"{\n\t\"shots\": %zu,\n\t\"listed\": %zu,\n\t\"scanMs\": %.2f,\n\t\"perExtensionMs\": %.2f,\n"
+		"\t\"batchedMs\": %.2f,\n\t\"firstBatchMs\": %.2f,\n\t\"findP50Us\": %.3f,\n\t\"findP99Us\": %.3f\n}\n",
+		shots,
+		model.Count(),
+		scanMs,
+		perExtensionMs,
+		batchedMs,
+		firstBatchMs.value_or(0.0),
+		Percentile(findUs, 0.5),
+		Percentile(findUs, 0.99));
+
+	const bool listed = model.Count() == shots && batched.Count() == shots && paths.size() == shots;
+	return listed && found == shots ? 0 : 1;
+}
\ No newline at end of file
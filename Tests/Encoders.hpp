@@ -0,0 +1,121 @@
+#pragma once
+
+#include <jpeglib.h>
+#include <png.h>
+
+namespace PictureBrowser::Tests
+{
+	// Encodes interleaved pixels with libjpeg, the APP1 payload, such as "Exif\0\0" and a TIFF, written first.
+	// A failure ends the process, which only invalid arguments could cause.
+	inline std::vector<uint8_t> EncodeJpeg(
+		uint32_t width,
+		uint32_t height,
+		J_COLOR_SPACE space,
+		std::span<const uint8_t> pixels,
+		int quality = 90,
+		std::span<const uint8_t> app1 = {})
+	{
+		jpeg_compress_struct info = {};
+		jpeg_error_mgr errors = {};
+		info.err = jpeg_std_error(&errors);
+		jpeg_create_compress(&info);
+
+		unsigned char* buffer = nullptr;
+		unsigned long size = 0;
+		jpeg_mem_dest(&info, &buffer, &size);
+
+		info.image_width = width;
+		info.image_height = height;
+		info.in_color_space = space;
+		info.input_components = space == JCS_GRAYSCALE ? 1 : space == JCS_CMYK ? 4 : 3;
+
+		jpeg_set_defaults(&info);
+		jpeg_set_quality(&info, quality, TRUE);
+		jpeg_start_compress(&info, TRUE);
+
+		if (!app1.empty())
+		{
+			jpeg_write_marker(&info, JPEG_APP0 + 1, app1.data(), static_cast<unsigned int>(app1.size()));
+		}
+
+		const size_t stride = size_t(width) * info.input_components;
+
+		while (info.next_scanline < info.image_height)
+		{
+			JSAMPROW row = const_cast<uint8_t*>(pixels.data()) + info.next_scanline * stride;
+			jpeg_write_scanlines(&info, &row, 1);
+		}
+
+		jpeg_finish_compress(&info);
+		jpeg_destroy_compress(&info);
+
+		std::vector<uint8_t> data(buffer, buffer + size);
+		std::free(buffer);
+		return data;
+	}
+
+	// Encodes pixels in one of the PNG_FORMAT_ formats with libpng, 16 bit ones in native byte order
+	inline std::vector<uint8_t> EncodePng(uint32_t width, uint32_t height, uint32_t format, std::span<const uint8_t> pixels)
+	{
+		png_image png = {};
+		png.version = PNG_IMAGE_VERSION;
+		png.width = width;
+		png.height = height;
+		png.format = format;
+
+		png_alloc_size_t size = 0;
+
+		if (!png_image_write_to_memory(&png, nullptr, &size, 0, pixels.data(), 0, nullptr))
+		{
+			throw std::runtime_error(png.message);
+		}
+
+		std::vector<uint8_t> data(size);
+
+		if (!png_image_write_to_memory(&png, data.data(), &size, 0, pixels.data(), 0, nullptr))
+		{
+			throw std::runtime_error(png.message);
+		}
+
+		data.resize(size);
+		return data;
+	}
+
+	// Smooth enough for the scaled decodes to be compared with the full ones
+	inline std::vector<uint8_t> Gradient(uint32_t width, uint32_t height, uint32_t components)
+	{
+		std::vector<uint8_t> pixels(size_t(width) * height * components);
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				uint8_t* pixel = &pixels[(size_t(y) * width + x) * components];
+
+				for (uint32_t c = 0; c < components; ++c)
+				{
+					pixel[c] = static_cast<uint8_t>((x * 255 / width + y * 255 / height * c) / (c + 1));
+				}
+			}
+		}
+
+		return pixels;
+	}
+
+	// Every pixel the same
+	inline std::vector<uint8_t> Solid(uint32_t width, uint32_t height, std::vector<uint8_t> pixel)
+	{
+		std::vector<uint8_t> pixels;
+		pixels.reserve(size_t(width) * height * pixel.size());
+
+		for (size_t i = 0; i < size_t(width) * height; ++i)
+		{
+			for (uint8_t component : pixel)
+			{
+				pixels.push_back(component);
+			}
+		}
+
+		return pixels;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "DirectoryScanner.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	std::vector<std::wstring> Names(const FileModel& model)
+	{
+		std::vector<std::wstring> names;
+
+		for (size_t i = 0; i < model.Count(); ++i)
+		{
+			names.emplace_back(model.Name(i));
+		}
+
+		return names;
+	}
+
+	using Names_ = std::vector<std::wstring>;
+}
+
+TEST(SortedModelFindsNamesIgnoringCase)
+{
+	FileModel model("/photos");
+	model.Add(L"b.jpg");
+	model.Add(L"A.jpg");
+	model.Add(L"c.PNG");
+	model.Sort();
+
+	CHECK(Names(model) == Names_({ L"A.jpg", L"b.jpg", L"c.PNG" }));
+	CHECK(model.Find(L"a.JPG") == 0);
+	CHECK(model.Find(L"C.png") == 2);
+	CHECK(!model.Find(L"d.jpg"));
+	CHECK(model.Path(1) == std::filesystem::path("/photos/b.jpg"));
+}
+
+TEST(OutOfRangeIsEmpty)
+{
+	FileModel model("/photos");
+	model.Add(L"a.jpg");
+
+	CHECK(model.Name(1).empty());
+	CHECK(model.Path(5).empty());
+	CHECK(!model.Empty());
+	CHECK(FileModel().Empty());
+}
+
+TEST(LaterAdditionsMergeIntoTheSortedOnes)
+{
+	FileModel model("/photos");
+	model.Add(L"b.jpg");
+	model.Add(L"d.jpg");
+	model.Sort();
+
+	model.Add(L"e.jpg");
+	model.Add(L"a.jpg");
+	model.Add(L"c.jpg");
+
+	// Not sorted yet
+	CHECK(!model.Find(L"c.jpg"));
+
+	model.Sort();
+	CHECK(Names(model) == Names_({ L"a.jpg", L"b.jpg", L"c.jpg", L"d.jpg", L"e.jpg" }));
+	CHECK(model.Find(L"c.jpg") == 2);
+}
+
+TEST(ErasedEntriesAreGone)
+{
+	FileModel model("/photos");
+
+	for (const wchar_t* name : { L"a.jpg", L"b.jpg", L"c.jpg" })
+	{
+		model.Add(name);
+	}
+
+	model.Sort();
+	model.Erase(1);
+	model.Erase(7);
+
+	CHECK(Names(model) == Names_({ L"a.jpg", L"c.jpg" }));
+	CHECK(model.Find(L"c.jpg") == 1);
+	CHECK(!model.Find(L"b.jpg"));
+}
+
+TEST(OnlyImagesAndUnshadowedRawFilesAreListed)
+{
+	FileModel model("/photos");
+	SidecarIndex sidecars;
+
+	const std::vector<std::wstring> filenames = {
+		L"IMG_1.JPG", L"IMG_1.CR2", L"IMG_1.xmp",
+		L"IMG_2.NEF",
+		L"IMG_3.png", L"IMG_3.ARW",
+		L"IMG_4.jpeg",
+		L"notes.txt", L"IMG_5.mov" };
+
+	AddEntries(filenames, model, sidecars);
+
+	CHECK(Names(model) == Names_({ L"IMG_1.JPG", L"IMG_2.NEF", L"IMG_3.png", L"IMG_4.jpeg" }));
+	CHECK(sidecars.Group(L"IMG_1.JPG").size() == 3);
+}
+
+TEST(LaterImagesShadowEarlierRawFiles)
+{
+	FileModel model("/photos");
+	SidecarIndex sidecars;
+
+	AddEntries(std::vector<std::wstring>{ L"IMG_1.NEF", L"IMG_2.NEF" }, model, sidecars);
+	CHECK(Names(model) == Names_({ L"IMG_1.NEF", L"IMG_2.NEF" }));
+
+	AddEntries(std::vector<std::wstring>{ L"IMG_1.JPG", L"IMG_2.NEF" }, model, sidecars);
+	CHECK(Names(model) == Names_({ L"IMG_1.JPG", L"IMG_2.NEF" }));
+}
+
+TEST(RemovingTheImageBringsBackItsRawFile)
+{
+	FileModel model("/photos");
+	SidecarIndex sidecars;
+	sidecars.Reset("/photos");
+
+	AddEntries(std::vector<std::wstring>{ L"IMG_1.JPG", L"IMG_1.NEF", L"IMG_2.JPG" }, model, sidecars);
+	RemoveEntry(L"IMG_1.JPG", model, sidecars);
+
+	CHECK(Names(model) == Names_({ L"IMG_1.NEF", L"IMG_2.JPG" }));
+
+	RemoveEntry(L"IMG_1.NEF", model, sidecars);
+	CHECK(Names(model) == Names_({ L"IMG_2.JPG" }));
+	CHECK(sidecars.Group(L"IMG_1.JPG").empty());
+}
+
+TEST(ScanReadsTheDirectoryOnce)
+{
+	const TemporaryDirectory directory;
+
+	for (const char* name : { "b.jpg", "A.JPG", "c.png", "c.dng", "d.NEF", "readme.txt" })
+	{
+		directory.Write(name);
+	}
+
+	std::filesystem::create_directories(directory.Path() / "folder.jpg");
+
+	SidecarIndex sidecars;
+	const FileModel model = ScanDirectory(directory.Path(), sidecars);
+
+	CHECK(model.Directory() == directory.Path());
+	CHECK(Names(model) == Names_({ L"A.JPG", L"b.jpg", L"c.png", L"d.NEF" }));
+	CHECK(sidecars.Directory() == directory.Path());
+	CHECK(sidecars.Companions(directory.Path() / "c.png") == std::vector<std::filesystem::path>{ directory.Path() / "c.dng" });
+}
+
+TEST(ScanOfAMissingDirectoryIsEmpty)
+{
+	const TemporaryDirectory directory;
+	SidecarIndex sidecars;
+
+	CHECK(ScanDirectory(directory.Path() / "missing", sidecars).Empty());
+}
+
+TEST(BackgroundScanDeliversEveryName)
+{
+	const TemporaryDirectory directory;
+
+	for (size_t i = 0; i < 2500; ++i)
+	{
+		directory.Write("IMG_" + std::to_string(i) + ".JPG");
+	}
+
+	std::mutex mutex;
+	std::condition_variable ready;
+	size_t callbacks = 0;
+
+	DirectoryScan scan(directory.Path(), [&]()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++callbacks;
+		ready.notify_one();
+	}, 1000);
+
+	FileModel model(directory.Path());
+	SidecarIndex sidecars;
+	bool done = false;
+
+	for (size_t round = 0; !done && round < 1000; ++round)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			ready.wait_for(lock, std::chrono::milliseconds(10));
+		}
+
+		DirectoryScan::Batch batch = scan.Take();
+		AddEntries(batch.Filenames, model, sidecars);
+		done = batch.Done;
+	}
+
+	CHECK(done);
+	CHECK(model.Count() == 2500);
+	CHECK(model.Find(L"img_1234.jpg").has_value());
+
+	std::lock_guard<std::mutex> lock(mutex);
+	CHECK(callbacks >= 3);
+}
+
+TEST(BackgroundScanOfAMissingDirectoryIsDone)
+{
+	const TemporaryDirectory directory;
+	std::atomic<bool> called = false;
+
+	DirectoryScan scan(directory.Path() / "missing", [&]() { called = true; });
+
+	for (size_t round = 0; !called && round < 1000; ++round)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	const DirectoryScan::Batch batch = scan.Take();
+	CHECK(batch.Done);
+	CHECK(batch.Filenames.empty());
+}
+
+TEST(DestroyingAScanStopsIt)
+{
+	const TemporaryDirectory directory;
+
+	for (size_t i = 0; i < 500; ++i)
+	{
+		directory.Write("IMG_" + std::to_string(i) + ".JPG");
+	}
+
+	for (size_t i = 0; i < 20; ++i)
+	{
+		DirectoryScan scan(directory.Path(), nullptr, 1);
+	}
+
+	CHECK(true);
+}
\ No newline at end of file
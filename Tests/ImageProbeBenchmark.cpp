@@ -0,0 +1,98 @@
+#include "PCH.hpp"
+#include "Corpus.hpp"
+#include "ImageProbe.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	// A camera JPEG: EXIF with a thumbnail and the scan behind the headers
+	std::vector<uint8_t> CameraJpeg(size_t scanBytes)
+	{
+		ExifFields fields;
+		fields.Orientation = 6;
+		fields.DateTimeOriginal = "2024:05:17 13:45:09";
+		fields.Thumbnail = MinimalJpeg(160, 120);
+
+		JpegWriter jpeg;
+		jpeg.Exif(Exif(true, fields));
+		jpeg.Frame(6000, 4000);
+		return jpeg.Finish(scanBytes);
+	}
+}
+
+// Probes synthetic camera files in memory and through the mapped files on disk, as the directory scan does
+int main(int argc, char** argv)
+{
+	const size_t files = argc > 1 ? std::stoul(argv[1]) : 1000;
+	const size_t scanBytes = (argc > 2 ? std::stoul(argv[2]) : 256) << 10;
+	const size_t rounds = 20000;
+
+	const std::vector<uint8_t> jpeg = CameraJpeg(scanBytes);
+	const std::vector<uint8_t> mpf = JpegWithMpf(6000, 4000, { { 0x010002, MinimalJpeg(1920, 1080) } });
+	const std::vector<uint8_t> png = Png(6000, 4000, nullptr);
+
+	std::printf("{\n\t\"inMemoryNsPerProbe\": {");
+
+	const char* separator = "";
+
+	for (const auto& [name, data] : { std::pair{ "jpegExif", &jpeg }, std::pair{ "jpegMpf", &mpf }, std::pair{ "png", &png } })
+	{
+		const auto start = Clock::now();
+
+		for (size_t round = 0; round < rounds; ++round)
+		{
+			KeepAlive(ProbeImage(*data));
+		}
+
+		std::printf("%s\"%s\": %.0f", separator, name, SecondsSince(start) * 1e9 / double(rounds));
+		separator = ", ";
+	}
+
+	std::printf("},\n");
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+		("PictureBrowser-ImageProbeBenchmark-" + std::to_string(getpid()));
+
+	std::filesystem::create_directories(directory);
+	std::vector<std::filesystem::path> paths;
+
+	for (size_t i = 0; i < files; ++i)
+	{
+		paths.push_back(directory / ("IMG_" + std::to_string(10000 + i) + ".JPG"));
+
+		std::ofstream file(paths.back(), std::ios::binary);
+		file.write(reinterpret_cast<const char*>(jpeg.data()), static_cast<std::streamsize>(jpeg.size()));
+	}
+
+	std::vector<double> probeUs;
+	size_t probed = 0;
+
+	const auto start = Clock::now();
+
+	for (const std::filesystem::path& path : paths)
+	{
+		const auto probeStart = Clock::now();
+		const std::optional<ImageInfo> info = ProbeImage(path);
+		probeUs.push_back(SecondsSince(probeStart) * 1e6);
+
+		probed += info && info->Width == 6000 && info->Orientation == 6 ? 1 : 0;
+	}
+
+	const double seconds = SecondsSince(start);
+	std::filesystem::remove_all(directory);
+
+	std::printf(
+		"\t\"files\": %zu,\n\t\"fileBytes\": %zu,\n\t\"filesPerSecond\": %.0f,\n"
+		"\t\"fileProbeUs\": {\"p50\": %.1f, \"p95\": %.1f, \"p99\": %.1f}\n}\n",
+		files,
+		jpeg.size(),
+		double(files) / seconds,
+		Percentile(probeUs, 0.50),
+		Percentile(probeUs, 0.95),
+		Percentile(probeUs, 0.99));
+
+	return probed == files ? 0 : 1;
+}
\ No newline at end of file
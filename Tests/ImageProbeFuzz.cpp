@@ -0,0 +1,36 @@
+#include "PCH.hpp"
+#include "ImageProbe.hpp"
+
+namespace PictureBrowser::Tests
+{
+	// Whatever the probe makes of the bytes, what it points at has to be inside of them
+	bool ProbeStaysInside(std::span<const uint8_t> data)
+	{
+		const std::optional<ImageInfo> info = ProbeImage(data);
+
+		if (!info)
+		{
+			return true;
+		}
+
+		const auto inside = [&data](uint64_t offset, uint32_t bytes)
+		{
+			return !bytes || (offset <= data.size() && bytes <= data.size() - offset);
+		};
+
+		return inside(info->ThumbnailOffset, info->ThumbnailBytes) &&
+			inside(info->PreviewOffset, info->PreviewBytes) &&
+			info->Orientation >= 1 && info->Orientation <= 8;
+	}
+}
+
+// The libFuzzer entry point, built into a fuzzer by Clang with -fsanitize=fuzzer
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	if (!PictureBrowser::Tests::ProbeStaysInside({ data, size }))
+	{
+		std::abort();
+	}
+
+	return 0;
+}
\ No newline at end of file
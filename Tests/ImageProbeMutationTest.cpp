@@ -0,0 +1,119 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "Corpus.hpp"
+#include <random>
+
+using namespace PictureBrowser::Tests;
+
+namespace PictureBrowser::Tests
+{
+	bool ProbeStaysInside(std::span<const uint8_t> data);
+}
+
+namespace
+{
+	std::vector<std::vector<uint8_t>> Seeds()
+	{
+		ExifFields fields;
+		fields.Orientation = 6;
+		fields.DateTimeOriginal = "2024:05:17 13:45:09";
+		fields.Thumbnail = MinimalJpeg(160, 120);
+
+		ExifFields tiffFields = fields;
+		tiffFields.Width = 7000;
+		tiffFields.Height = 5000;
+
+		const TiffWriter exif = Exif(false, fields);
+
+		return {
+			JpegWithExif(6000, 4000, Exif(true, fields)),
+			JpegWithExif(6000, 4000, exif),
+			JpegWithMpf(6000, 4000, { { 0x010001, MinimalJpeg(640, 480) }, { 0x010002, MinimalJpeg(1920, 1080) } }),
+			Png(1234, 567, &exif),
+			Exif(true, tiffFields).Data(),
+			TiffRaw(false, 64).Data,
+			TiffRaw(true, 64).Data,
+			PanasonicRaw(64).Data,
+			FujifilmRaw(64).Data,
+			CanonCr3(64).Data
+		};
+	}
+
+	// Counts the inputs the probe points outside of
+	size_t Escapes(const std::vector<uint8_t>& input)
+	{
+		return ProbeStaysInside(input) ? 0 : 1;
+	}
+}
+
+TEST(SeedsStayInside)
+{
+	for (const std::vector<uint8_t>& seed : Seeds())
+	{
+		CHECK(Escapes(seed) == 0);
+	}
+}
+
+TEST(EveryTruncationStaysInside)
+{
+	for (const std::vector<uint8_t>& seed : Seeds())
+	{
+		size_t escapes = 0;
+
+		for (size_t size = 0; size < seed.size(); ++size)
+		{
+			escapes += Escapes({ seed.begin(), seed.begin() + static_cast<ptrdiff_t>(size) });
+		}
+
+		CHECK(escapes == 0);
+	}
+}
+
+TEST(EveryByteFlipStaysInside)
+{
+	for (const std::vector<uint8_t>& seed : Seeds())
+	{
+		size_t escapes = 0;
+		std::vector<uint8_t> mutated = seed;
+
+		for (size_t i = 0; i < seed.size(); ++i)
+		{
+			for (uint8_t value : { uint8_t(0x00), uint8_t(0xFF), uint8_t(seed[i] ^ 0x80), uint8_t(seed[i] + 1) })
+			{
+				mutated[i] = value;
+				escapes += Escapes(mutated);
+			}
+
+			mutated[i] = seed[i];
+		}
+
+		CHECK(escapes == 0);
+	}
+}
+
+TEST(RandomMutationsStayInside)
+{
+	std::mt19937 random(2024);
+	size_t escapes = 0;
+
+	for (const std::vector<uint8_t>& seed : Seeds())
+	{
+		std::uniform_int_distribution<size_t> position(0, seed.size() - 1);
+		std::uniform_int_distribution<int> byte(0, 255);
+
+		for (size_t round = 0; round < 5000; ++round)
+		{
+			std::vector<uint8_t> mutated = seed;
+
+			for (size_t change = 0; change < 1 + round % 8; ++change)
+			{
+				mutated[position(random)] = static_cast<uint8_t>(byte(random));
+			}
+
+			mutated.resize(round % 3 ? mutated.size() : position(random));
+			escapes += Escapes(mutated);
+		}
+	}
+
+	CHECK(escapes == 0);
+}
\ No newline at end of file
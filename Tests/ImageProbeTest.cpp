@@ -0,0 +1,235 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "Corpus.hpp"
+#include "ImageProbe.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	bool Points(std::span<const uint8_t> file, uint64_t offset, uint32_t bytes, std::span<const uint8_t> expected)
+	{
+		return bytes == expected.size() &&
+			offset + bytes <= file.size() &&
+			std::equal(expected.begin(), expected.end(), file.begin() + static_cast<ptrdiff_t>(offset));
+	}
+
+	std::chrono::local_seconds LocalTime(int year, unsigned month, unsigned day, int hour, int minute, int second)
+	{
+		return std::chrono::local_days(std::chrono::year(year) / std::chrono::month(month) / std::chrono::day(day)) +
+			std::chrono::hours(hour) + std::chrono::minutes(minute) + std::chrono::seconds(second);
+	}
+
+	ExifFields CameraFields()
+	{
+		ExifFields fields;
+		fields.Orientation = 6;
+		fields.DateTimeOriginal = "2024:05:17 13:45:09";
+		fields.Thumbnail = MinimalJpeg(160, 120);
+		return fields;
+	}
+}
+
+TEST(JpegWithBigEndianExif)
+{
+	const ExifFields fields = CameraFields();
+	const std::vector<uint8_t> file = JpegWithExif(6000, 4000, Exif(true, fields));
+
+	const std::optional<ImageInfo> info = ProbeImage(file);
+	CHECK(info.has_value());
+	CHECK(info->Format == ImageFormat::Jpeg);
+	CHECK(info->Width == 6000 && info->Height == 4000);
+	CHECK(info->Orientation == 6);
+	CHECK(info->CaptureTime == LocalTime(2024, 5, 17, 13, 45, 9));
+	CHECK(Points(file, info->ThumbnailOffset, info->ThumbnailBytes, fields.Thumbnail));
+	CHECK(info->PreviewBytes == 0);
+}
+
+TEST(JpegWithLittleEndianExif)
+{
+	ExifFields fields = CameraFields();
+	fields.Orientation = 8;
+
+	const std::vector<uint8_t> file = JpegWithExif(4000, 3000, Exif(false, fields));
+
+	const std::optional<ImageInfo> info = ProbeImage(file);
+	CHECK(info.has_value());
+	CHECK(info->Width == 4000 && info->Height == 3000);
+	CHECK(info->Orientation == 8);
+	CHECK(info->CaptureTime == LocalTime(2024, 5, 17, 13, 45, 9));
+	CHECK(Points(file, info->ThumbnailOffset, info->ThumbnailBytes, fields.Thumbnail));
+}
+
+TEST(JpegWithoutExif)
+{
+	const std::optional<ImageInfo> info = ProbeImage(MinimalJpeg(640, 480));
+
+	CHECK(info.has_value());
+	CHECK(info->Width == 640 && info->Height == 480);
+	CHECK(info->Orientation == 1);
+	CHECK(!info->CaptureTime);
+	CHECK(info->ThumbnailBytes == 0);
+}
+
+TEST(ProgressiveJpeg)
+{
+	JpegWriter jpeg;
+	jpeg.Frame(1024, 768, 0xC2);
+
+	const std::optional<ImageInfo> info = ProbeImage(jpeg.Finish());
+	CHECK(info && info->Width == 1024 && info->Height == 768);
+}
+
+TEST(BrokenFieldsAreIgnored)
+{
+	ExifFields fields;
+	fields.Orientation = 9;
+	fields.DateTimeOriginal = "2024:13:17 13:45:09";
+
+	const std::optional<ImageInfo> info = ProbeImage(JpegWithExif(100, 100, Exif(false, fields)));
+	CHECK(info.has_value());
+	CHECK(info->Orientation == 1);
+	CHECK(!info->CaptureTime);
+
+	fields.DateTimeOriginal = "2024:05:17 25:00:00";
+	CHECK(!ProbeImage(JpegWithExif(100, 100, Exif(true, fields)))->CaptureTime);
+
+	fields.DateTimeOriginal = "    :  :     :  :  ";
+	CHECK(!ProbeImage(JpegWithExif(100, 100, Exif(true, fields)))->CaptureTime);
+}
+
+TEST(MpfPicksTheLargestPreview)
+{
+	// The sizes in bytes tell the previews apart
+	const std::vector<uint8_t> vga = MinimalJpeg(640, 480);
+	std::vector<uint8_t> fullHd = MinimalJpeg(1920, 1080);
+	fullHd.resize(fullHd.size() + 500);
+	std::vector<uint8_t> disparity = MinimalJpeg(1920, 1080);
+	disparity.resize(disparity.size() + 1000);
+
+	// The disparity image is larger, but not a preview
+	const std::vector<uint8_t> file = JpegWithMpf(6000, 4000, {
+		{ 0x010001, vga },
+		{ 0x020002, disparity },
+		{ 0x010002, fullHd } });
+
+	const std::optional<ImageInfo> info = ProbeImage(file);
+	CHECK(info.has_value());
+	CHECK(info->Width == 6000 && info->Height == 4000);
+	CHECK(Points(file, info->PreviewOffset, info->PreviewBytes, fullHd));
+}
+
+TEST(MpfEntriesPastTheEndAreIgnored)
+{
+	const std::vector<uint8_t> preview = MinimalJpeg(1920, 1080);
+	std::vector<uint8_t> file = JpegWithMpf(6000, 4000, { { 0x010002, preview } });
+
+	file.resize(file.size() - 10);
+
+	const std::optional<ImageInfo> info = ProbeImage(file);
+	CHECK(info.has_value());
+	CHECK(info->PreviewBytes == 0);
+}
+
+TEST(PngWithExif)
+{
+	ExifFields fields;
+	fields.Orientation = 3;
+	fields.DateTimeOriginal = "2023:12:31 23:59:59";
+
+	const TiffWriter exif = Exif(true, fields);
+	const std::optional<ImageInfo> info = ProbeImage(Png(1234, 567, &exif));
+
+	CHECK(info.has_value());
+	CHECK(info->Format == ImageFormat::Png);
+	CHECK(info->Width == 1234 && info->Height == 567);
+	CHECK(info->Orientation == 3);
+	CHECK(info->CaptureTime == LocalTime(2023, 12, 31, 23, 59, 59));
+}
+
+TEST(PngWithoutExif)
+{
+	const std::optional<ImageInfo> info = ProbeImage(Png(31, 17));
+
+	CHECK(info && info->Width == 31 && info->Height == 17 && info->Orientation == 1);
+}
+
+TEST(TiffHasItsSizeInIfd0)
+{
+	ExifFields fields;
+	fields.Orientation = 5;
+	fields.Width = 7000;
+	fields.Height = 5000;
+
+	const TiffWriter tiff = Exif(false, fields);
+	const std::optional<ImageInfo> info = ProbeImage(tiff.Data());
+
+	CHECK(info.has_value());
+	CHECK(info->Format == ImageFormat::Tiff);
+	CHECK(info->Width == 7000 && info->Height == 5000);
+	CHECK(info->Orientation == 5);
+}
+
+TEST(TruncatedFilesAreRejected)
+{
+	const std::vector<uint8_t> file = JpegWithExif(6000, 4000, Exif(true, CameraFields()));
+
+	// Inside of the EXIF segment, the markers are broken
+	CHECK(!ProbeImage(std::span(file).first(40)));
+
+	std::vector<uint8_t> png = Png(10, 10);
+	png.resize(20);
+	CHECK(!ProbeImage(png));
+}
+
+TEST(GarbageIsRejected)
+{
+	std::vector<uint8_t> garbage(4096);
+
+	for (size_t i = 0; i < garbage.size(); ++i)
+	{
+		garbage[i] = static_cast<uint8_t>(i * 131 + 7);
+	}
+
+	CHECK(!ProbeImage(garbage));
+	CHECK(!ProbeImage(std::span<const uint8_t>()));
+	CHECK(!ProbeImage(std::vector<uint8_t>{ 0xFF }));
+	CHECK(!ProbeImage(std::vector<uint8_t>{ 0xFF, 0xD8, 0x00, 0x00, 0x00, 0x00 }));
+}
+
+TEST(IfdLoopsEnd)
+{
+	TiffWriter tiff(false);
+	const uint32_t ifd0 = tiff.Ifd({ Short(0x0112, 6), Long(0x0100, 10), Long(0x0101, 10) });
+
+	// IFD0 names itself as the next IFD
+	std::vector<uint8_t> data = tiff.Data();
+	ByteWriter patch(false);
+	patch.Data = std::move(data);
+	patch.Patch32(ifd0 + 2 + 3 * 12, ifd0);
+
+	const std::optional<ImageInfo> info = ProbeImage(patch.Data);
+	CHECK(info && info->Orientation == 6);
+}
+
+TEST(ProbesFilesOnDisk)
+{
+	const TemporaryDirectory directory;
+	const std::filesystem::path path = directory.Write("IMG_0001.JPG", JpegWithExif(300, 200, Exif(true, CameraFields())));
+
+	const std::optional<ImageInfo> info = ProbeImage(path);
+	CHECK(info && info->Width == 300 && info->Orientation == 6);
+
+	CHECK(!ProbeImage(directory.Path() / "missing.jpg"));
+	CHECK(!ProbeImage(directory.Write("empty.jpg")));
+}
+
+TEST(RawExtensionsIgnoreCase)
+{
+	CHECK(IsPreviewedRawExtension(L".NEF"));
+	CHECK(IsPreviewedRawExtension(L".cr3"));
+	CHECK(!IsPreviewedRawExtension(L".jpg"));
+	CHECK(IsPreviewedRawFile("/photos/DSC_0001.arw"));
+	CHECK(!IsPreviewedRawFile("/photos/DSC_0001.xmp"));
+}
\ No newline at end of file
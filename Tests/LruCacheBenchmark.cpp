@@ -0,0 +1,97 @@
+#include "PCH.hpp"
+#include "LruCache.hpp"
+#include "Timing.hpp"
+#include <random>
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+// Browses a folder of camera frames with synthetic entries the size of their pixels:
+// mostly stepping forward, sometimes back, now and then jumping somewhere else.
+// Each step looks the image up, inserts it on a miss and prefetches its neighbors.
+int main(int argc, char** argv)
+{
+	const size_t frames = argc > 1 ? std::stoul(argv[1]) : 3000;
+	const size_t steps = argc > 2 ? std::stoul(argv[2]) : 1000000;
+	const size_t budget = 2048ull << 20;
+	const int neighbors = 2;
+
+	// 45 megapixels at 24 bits, give or take a crop
+	std::mt19937 random(42);
+	std::uniform_int_distribution<size_t> frameBytes(100ull << 20, 136ull << 20);
+	std::vector<size_t> sizes(frames);
+
+	for (size_t& size : sizes)
+	{
+		size = frameBytes(random);
+	}
+
+	LruCache<uint32_t, uint32_t> cache(budget);
+	std::uniform_int_distribution<int> move(0, 99);
+	std::uniform_int_distribution<size_t> anywhere(0, frames - 1);
+
+	size_t current = 0;
+	size_t hits = 0;
+	size_t prefetches = 0;
+
+	const auto start = Clock::now();
+
+	for (size_t step = 0; step < steps; ++step)
+	{
+		const int roll = move(random);
+
+		if (roll < 80)
+		{
+			current = (current + 1) % frames;
+		}
+		else if (roll < 98)
+		{
+			current = (current + frames - 1) % frames;
+		}
+		else
+		{
+			current = anywhere(random);
+		}
+
+		const uint32_t key = static_cast<uint32_t>(current);
+
+		if (cache.Find(key))
+		{
+			++hits;
+		}
+		else
+		{
+			cache.Insert(key, key, sizes[key]);
+		}
+
+		for (int offset = -neighbors; offset <= neighbors; ++offset)
+		{
+			const uint32_t neighbor = static_cast<uint32_t>((current + frames + offset) % frames);
+
+			if (offset && !cache.Contains(neighbor))
+			{
+				cache.Insert(neighbor, neighbor, sizes[neighbor]);
+				++prefetches;
+			}
+		}
+
+		// What was just looked at stays the most recently used
+		cache.Find(key);
+	}
+
+	const double seconds = SecondsSince(start);
+
+	std::printf(
+		"{\n\t\"frames\": %zu,\n\t\"steps\": %zu,\n\t\"budgetBytes\": %zu,\n\t\"hitRate\": %.4f,\n\t\"prefetches\": %zu,\n"
+		"\t\"evictions\": %zu,\n\t\"residentImages\": %zu,\n\t\"nsPerStep\": %.1f\n}\n",
+		frames,
+		steps,
+		budget,
+		double(hits) / double(steps),
+		prefetches,
+		cache.Evictions(),
+		cache.Count(),
+		seconds * 1e9 / double(steps));
+
+	return cache.Bytes() <= budget ? 0 : 1;
+}
\ No newline at end of file
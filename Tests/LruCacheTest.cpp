@@ -0,0 +1,206 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "LruCache.hpp"
+
+using namespace PictureBrowser;
+
+using Cache = LruCache<int, int>;
+
+TEST(EvictsTheLeastRecentlyUsedOverBudget)
+{
+	Cache cache(300);
+
+	CHECK(cache.Insert(1, 10, 100));
+	CHECK(cache.Insert(2, 20, 100));
+	CHECK(cache.Insert(3, 30, 100));
+	CHECK(cache.Bytes() == 300);
+
+	CHECK(cache.Insert(4, 40, 100));
+	CHECK(!cache.Contains(1));
+	CHECK(cache.Contains(2) && cache.Contains(3) && cache.Contains(4));
+	CHECK(cache.Bytes() == 300);
+	CHECK(cache.Evictions() == 1);
+}
+
+TEST(FindMakesTheEntryMostRecentlyUsed)
+{
+	Cache cache(300);
+
+	cache.Insert(1, 10, 100);
+	cache.Insert(2, 20, 100);
+	cache.Insert(3, 30, 100);
+
+	const int* found = cache.Find(1);
+	CHECK(found && *found == 10);
+
+	cache.Insert(4, 40, 100);
+	CHECK(cache.Contains(1));
+	CHECK(!cache.Contains(2));
+
+	CHECK(!cache.Find(2));
+}
+
+TEST(LargeEntriesEvictSeveral)
+{
+	Cache cache(300);
+
+	cache.Insert(1, 10, 100);
+	cache.Insert(2, 20, 100);
+	cache.Insert(3, 30, 100);
+	cache.Insert(4, 40, 250);
+
+	CHECK(cache.Count() == 1);
+	CHECK(cache.Contains(4));
+	CHECK(cache.Bytes() == 250);
+	CHECK(cache.Evictions() == 3);
+}
+
+TEST(EntryLargerThanTheBudgetIsRefused)
+{
+	Cache cache(300);
+
+	cache.Insert(1, 10, 100);
+	CHECK(!cache.Insert(2, 20, 301));
+	CHECK(!cache.Contains(2));
+	CHECK(cache.Contains(1));
+	CHECK(cache.Bytes() == 100);
+	CHECK(cache.Evictions() == 0);
+}
+
+TEST(ReinsertReplacesTheValueAndSize)
+{
+	Cache cache(300);
+
+	cache.Insert(1, 10, 100);
+	cache.Insert(1, 11, 50);
+
+	CHECK(cache.Count() == 1);
+	CHECK(cache.Bytes() == 50);
+	CHECK(*cache.Find(1) == 11);
+	CHECK(cache.Evictions() == 0);
+}
+
+TEST(ZeroBudgetKeepsNothing)
+{
+	Cache cache;
+
+	CHECK(!cache.Insert(1, 10, 1));
+	CHECK(cache.Insert(2, 20, 0));
+	CHECK(cache.Bytes() == 0);
+}
+
+TEST(ShrinkIfEvictsOnlyPickedEntriesOldestFirst)
+{
+	Cache cache(1000);
+
+	for (int key = 1; key <= 6; ++key)
+	{
+		cache.Insert(key, key * 10, 100);
+	}
+
+	// Oldest first: 1, 2, 3, 4, 5, 6. The even ones are picked.
+	cache.ShrinkIf(450, [](int key, int)
+	{
+		return key % 2 == 0;
+	});
+
+	CHECK(!cache.Contains(2));
+	CHECK(!cache.Contains(4));
+	CHECK(cache.Contains(6));
+	CHECK(cache.Contains(1) && cache.Contains(3) && cache.Contains(5));
+	CHECK(cache.Bytes() == 400);
+	CHECK(cache.Evictions() == 2);
+}
+
+TEST(ShrinkIfStopsWhenNothingIsLeftToPick)
+{
+	Cache cache(1000);
+
+	for (int key = 1; key <= 4; ++key)
+	{
+		cache.Insert(key, key * 10, 100);
+	}
+
+	cache.ShrinkIf(0, [](int key, int)
+	{
+		return key == 3;
+	});
+
+	CHECK(cache.Count() == 3);
+	CHECK(!cache.Contains(3));
+
+	// Whatever is still over the target goes in plain LRU order
+	cache.Shrink(150);
+	CHECK(cache.Count() == 1);
+	CHECK(cache.Contains(4));
+}
+
+TEST(ShrinkIfLeavesRecencyAlone)
+{
+	Cache cache(300);
+
+	cache.Insert(1, 10, 100);
+	cache.Insert(2, 20, 100);
+	cache.Insert(3, 30, 100);
+
+	cache.ShrinkIf(300, [](int, int)
+	{
+		return true;
+	});
+
+	CHECK(cache.Count() == 3);
+
+	cache.Insert(4, 40, 100);
+	CHECK(!cache.Contains(1));
+}
+
+TEST(EraseIfIsNoEviction)
+{
+	Cache cache(1000);
+
+	for (int key = 1; key <= 5; ++key)
+	{
+		cache.Insert(key, key * 10, 100);
+	}
+
+	cache.EraseIf([](int, int value)
+	{
+		return value > 30;
+	});
+
+	CHECK(cache.Count() == 3);
+	CHECK(cache.Bytes() == 300);
+	CHECK(cache.Evictions() == 0);
+}
+
+TEST(SetBudgetShrinksAtOnce)
+{
+	Cache cache(1000);
+
+	for (int key = 1; key <= 5; ++key)
+	{
+		cache.Insert(key, key * 10, 100);
+	}
+
+	cache.SetBudget(250);
+	CHECK(cache.Budget() == 250);
+	CHECK(cache.Count() == 2);
+	CHECK(cache.Contains(4) && cache.Contains(5));
+
+	cache.SetBudget(1000);
+	CHECK(cache.Count() == 2);
+}
+
+TEST(ClearForgetsEverything)
+{
+	Cache cache(1000);
+
+	cache.Insert(1, 10, 100);
+	cache.Insert(2, 20, 100);
+	cache.Clear();
+
+	CHECK(cache.Count() == 0);
+	CHECK(cache.Bytes() == 0);
+	CHECK(!cache.Find(1));
+	CHECK(cache.Insert(1, 10, 1000));
+}
\ No newline at end of file
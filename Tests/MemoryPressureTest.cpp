@@ -0,0 +1,129 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "LruCache.hpp"
+#include "MemoryPressure.hpp"
+
+using namespace PictureBrowser;
+
+namespace
+{
+	using Cache = LruCache<int, int>;
+
+	// Eight images of 100 bytes, one the least recently used
+	Cache Filled()
+	{
+		Cache cache(1000);
+
+		for (int key = 1; key <= 8; ++key)
+		{
+			cache.Insert(key, key, 100);
+		}
+
+		return cache;
+	}
+
+	std::vector<int> Keys(const Cache& cache)
+	{
+		std::vector<int> keys;
+
+		for (int key = 1; key <= 8; ++key)
+		{
+			if (cache.Contains(key))
+			{
+				keys.push_back(key);
+			}
+		}
+
+		return keys;
+	}
+}
+
+TEST(PressureKeepsASliceAtATime)
+{
+	CHECK(PressureTarget(800, MemoryPressure::None) == 800);
+	CHECK(PressureTarget(800, MemoryPressure::Moderate) == 700);
+	CHECK(PressureTarget(800, MemoryPressure::High) == 600);
+	CHECK(PressureTarget(0, MemoryPressure::High) == 0);
+}
+
+TEST(FixedPressureIsWhatItWasTold)
+{
+	FixedMemoryPressure pressure;
+	CHECK(pressure.Sample() == MemoryPressure::None);
+
+	pressure.Set(MemoryPressure::High);
+	CHECK(pressure.Sample() == MemoryPressure::High);
+	CHECK(pressure.Sample() == MemoryPressure::High);
+
+	pressure.Set(MemoryPressure::Moderate);
+	CHECK(pressure.Sample() == MemoryPressure::Moderate);
+}
+
+TEST(NoPressureEvictsNothing)
+{
+	Cache cache = Filled();
+	FixedMemoryPressure pressure;
+
+	ShrinkForPressure(cache, pressure.Sample(), [](int, int) { return true; });
+
+	CHECK(cache.Count() == 8);
+	CHECK(cache.Evictions() == 0);
+}
+
+TEST(UnseenImagesAreEvictedFirst)
+{
+	Cache cache = Filled();
+	FixedMemoryPressure pressure(MemoryPressure::High);
+	const std::unordered_set<int> unseen = { 3, 6 };
+
+	ShrinkForPressure(cache, pressure.Sample(), [&](int key, int) { return unseen.contains(key); });
+
+	CHECK(cache.Bytes() == 600);
+	CHECK((Keys(cache) == std::vector<int>{ 1, 2, 4, 5, 7, 8 }));
+}
+
+TEST(TheLeastRecentlyUsedFollow)
+{
+	Cache cache = Filled();
+	FixedMemoryPressure pressure(MemoryPressure::High);
+	const std::unordered_set<int> unseen = { 6 };
+
+	// Viewed again, so the second least recently used
+	cache.Find(1);
+
+	ShrinkForPressure(cache, pressure.Sample(), [&](int key, int) { return unseen.contains(key); });
+
+	CHECK(cache.Bytes() == 600);
+	CHECK((Keys(cache) == std::vector<int>{ 1, 3, 4, 5, 7, 8 }));
+
+	pressure.Set(MemoryPressure::Moderate);
+	ShrinkForPressure(cache, pressure.Sample(), [&](int key, int) { return unseen.contains(key); });
+
+	// 600 down to 525 takes one more image, the least recently used one
+	CHECK(cache.Bytes() == 500);
+	CHECK((Keys(cache) == std::vector<int>{ 1, 4, 5, 7, 8 }));
+}
+
+TEST(LastingPressureDrainsTheCache)
+{
+	Cache cache = Filled();
+	FixedMemoryPressure pressure(MemoryPressure::High);
+	std::vector<size_t> resident;
+
+	while (cache.Bytes())
+	{
+		ShrinkForPressure(cache, pressure.Sample(), [](int, int) { return false; });
+		resident.push_back(cache.Bytes());
+	}
+
+	CHECK((resident == std::vector<size_t>{ 600, 400, 300, 200, 100, 0 }));
+	CHECK(cache.Evictions() == 8);
+}
+
+TEST(SystemPressureCanBeSampled)
+{
+	SystemMemoryPressure pressure;
+	const MemoryPressure sample = pressure.Sample();
+
+	CHECK(sample == MemoryPressure::None || sample == MemoryPressure::Moderate || sample == MemoryPressure::High);
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "PCH.hpp"
+#include "Orientation.hpp"
+#include "OrientationReference.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	const char* Name(PixelFormat format)
+	{
+		switch (format)
+		{
+		case PixelFormat::Bgr24:
+			return "bgr24";
+		case PixelFormat::Gray8:
+			return "gray8";
+		default:
+			return "bgr32";
+		}
+	}
+
+	template <typename F>
+	double BestSeconds(size_t repeats, F&& function)
+	{
+		double best = std::numeric_limits<double>::max();
+
+		for (size_t repeat = 0; repeat < repeats; ++repeat)
+		{
+			const auto start = Clock::now();
+			KeepAlive(function());
+			best = std::min(best, SecondsSince(start));
+		}
+
+		return best;
+	}
+}
+
+// Turns a 24 megapixel frame upright for each EXIF orientation and pixel format,
+// with the kernels and with the pixel by pixel reference, as the flip rotator does it
+int main(int argc, char** argv)
+{
+	const uint32_t width = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 6000;
+	const uint32_t height = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 4000;
+	const size_t repeats = argc > 3 ? std::stoul(argv[3]) : 3;
+
+	const double pixels = double(width) * height;
+
+	std::printf("{\n\t\"width\": %u,\n\t\"height\": %u,\n\t\"results\": [", width, height);
+
+	const char* separator = "";
+
+	for (PixelFormat format : { PixelFormat::Bgr32, PixelFormat::Bgr24, PixelFormat::Gray8 })
+	{
+		Image source(width, height, format);
+		std::fill(source.Pixels().begin(), source.Pixels().end(), uint8_t(0x5A));
+
+		for (uint16_t orientation = 1; orientation <= 8; ++orientation)
+		{
+			const double kernel = BestSeconds(repeats, [&]() { return Oriented(source, orientation); });
+			const double reference = BestSeconds(1, [&]() { return ReferenceOriented(source, orientation); });
+
+			std::printf(
+				"%s\n\t\t{\"format\": \"%s\", \"orientation\": %u, \"ms\": %.2f, \"megapixelsPerSecond\": %.0f, \"referenceMs\": %.2f, \"speedup\": %.1f}",
+				separator,
+				Name(format),
+				orientation,
+				kernel * 1000.0,
+				pixels / kernel / 1e6,
+				reference * 1000.0,
+				reference / kernel);
+
+			separator = ",";
+		}
+	}
+
+	std::printf("\n\t]\n}\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Image.hpp"
+
+namespace PictureBrowser::Tests
+{
+	// Turns the image upright pixel by pixel, straight from the EXIF specification:
+	// where the stored row 0 and column 0 end up when the image is viewed.
+	inline std::shared_ptr<Image> ReferenceOriented(const Image& source, uint16_t orientation)
+	{
+		const uint32_t width = source.Width();
+		const uint32_t height = source.Height();
+		const bool sideways = orientation >= 5 && orientation <= 8;
+		const uint32_t bytesPerPixel = BytesPerPixel(source.Format());
+
+		auto target = std::make_shared<Image>(sideways ? height : width, sideways ? width : height, source.Format());
+
+		for (uint32_t y = 0; y < target->Height(); ++y)
+		{
+			for (uint32_t x = 0; x < target->Width(); ++x)
+			{
+				uint32_t column = x;
+				uint32_t row = y;
+
+				switch (orientation)
+				{
+				case 2: // Row 0 at the top, column 0 on the right
+					column = width - 1 - x;
+					break;
+				case 3: // Row 0 at the bottom, column 0 on the right
+					column = width - 1 - x;
+					row = height - 1 - y;
+					break;
+				case 4: // Row 0 at the bottom, column 0 on the left
+					row = height - 1 - y;
+					break;
+				case 5: // Row 0 on the left, column 0 at the top
+					column = y;
+					row = x;
+					break;
+				case 6: // Row 0 on the right, column 0 at the top
+					column = y;
+					row = height - 1 - x;
+					break;
+				case 7: // Row 0 on the right, column 0 at the bottom
+					column = width - 1 - y;
+					row = height - 1 - x;
+					break;
+				case 8: // Row 0 on the left, column 0 at the bottom
+					column = width - 1 - y;
+					row = x;
+					break;
+				default:
+					break;
+				}
+
+				std::memcpy(
+					target->Pixels().data() + size_t(y) * target->Stride() + size_t(x) * bytesPerPixel,
+					source.Pixels().data() + size_t(row) * source.Stride() + size_t(column) * bytesPerPixel,
+					bytesPerPixel);
+			}
+		}
+
+		return target;
+	}
+}
\ No newline at end of file
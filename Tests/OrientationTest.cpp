@@ -0,0 +1,139 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "Orientation.hpp"
+#include "OrientationReference.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	constexpr PixelFormat Formats[] = { PixelFormat::Bgr32, PixelFormat::Bgr24, PixelFormat::Gray8 };
+
+	// Every byte differs from its neighbors in all directions
+	Image Numbered(uint32_t width, uint32_t height, PixelFormat format)
+	{
+		Image image(width, height, format);
+		const uint32_t bytes = width * BytesPerPixel(format);
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			uint8_t* row = image.Pixels().data() + size_t(y) * image.Stride();
+
+			for (uint32_t x = 0; x < bytes; ++x)
+			{
+				row[x] = static_cast<uint8_t>(x * 7 + y * 101 + (x >> 5) + (y >> 3) * 13);
+			}
+		}
+
+		return image;
+	}
+
+	// Only the pixels count, not whatever pads the rows
+	bool SamePixels(const Image& left, const Image& right)
+	{
+		if (left.Width() != right.Width() || left.Height() != right.Height() || left.Format() != right.Format())
+		{
+			return false;
+		}
+
+		const size_t bytes = size_t(left.Width()) * BytesPerPixel(left.Format());
+
+		for (uint32_t y = 0; y < left.Height(); ++y)
+		{
+			if (std::memcmp(
+				left.Pixels().data() + size_t(y) * left.Stride(),
+				right.Pixels().data() + size_t(y) * right.Stride(),
+				bytes))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Odd sizes around the 4 and 16 pixel kernels and the 64 pixel blocks
+	size_t Mismatches(uint32_t width, uint32_t height)
+	{
+		size_t mismatches = 0;
+
+		for (PixelFormat format : Formats)
+		{
+			const Image source = Numbered(width, height, format);
+
+			for (uint16_t orientation = 1; orientation <= 8; ++orientation)
+			{
+				mismatches += !SamePixels(*Oriented(source, orientation), *ReferenceOriented(source, orientation));
+			}
+		}
+
+		return mismatches;
+	}
+}
+
+TEST(OnlyFiveToEightSwapSides)
+{
+	for (uint16_t orientation = 0; orientation < 10; ++orientation)
+	{
+		CHECK(SwapsSides(orientation) == (orientation >= 5 && orientation <= 8));
+	}
+}
+
+TEST(SinglePixelsAndLines)
+{
+	CHECK(Mismatches(1, 1) == 0);
+	CHECK(Mismatches(1, 37) == 0);
+	CHECK(Mismatches(37, 1) == 0);
+}
+
+TEST(SmallerThanTheKernels)
+{
+	CHECK(Mismatches(3, 5) == 0);
+	CHECK(Mismatches(15, 3) == 0);
+}
+
+TEST(KernelsWithLeftovers)
+{
+	CHECK(Mismatches(17, 33) == 0);
+	CHECK(Mismatches(35, 19) == 0);
+}
+
+TEST(AcrossBlocks)
+{
+	CHECK(Mismatches(67, 131) == 0);
+	CHECK(Mismatches(130, 65) == 0);
+	CHECK(Mismatches(128, 64) == 0);
+}
+
+TEST(OutOfRangeIsUpright)
+{
+	const Image source = Numbered(19, 7, PixelFormat::Bgr24);
+
+	for (uint16_t orientation : { 0, 9, 65535 })
+	{
+		CHECK(SamePixels(*Oriented(source, orientation), source));
+	}
+}
+
+TEST(SourceSizeTurnsWithTheImage)
+{
+	Image source = Numbered(20, 10, PixelFormat::Gray8);
+	source.SetSourceSize(200, 100);
+
+	const std::shared_ptr<Image> sideways = Oriented(source, 6);
+	CHECK(sideways->Width() == 10 && sideways->Height() == 20);
+	CHECK(sideways->SourceWidth() == 100 && sideways->SourceHeight() == 200);
+
+	const std::shared_ptr<Image> upsideDown = Oriented(source, 3);
+	CHECK(upsideDown->SourceWidth() == 200 && upsideDown->SourceHeight() == 100);
+}
+
+TEST(OrientsIntoAnExistingTarget)
+{
+	const Image source = Numbered(21, 13, PixelFormat::Bgr32);
+	Image target(13, 21, PixelFormat::Bgr32);
+
+	Orient(source, target, 8);
+	CHECK(SamePixels(target, *ReferenceOriented(source, 8)));
+}
\ No newline at end of file
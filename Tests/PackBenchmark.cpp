@@ -0,0 +1,129 @@
+#include "PCH.hpp"
+#include "PreviewStore.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+void Fill(Image& image, size_t seed)
+{
+	std::span<uint8_t> pixels = image.Pixels();
+
+	for (size_t i = 0; i < pixels.size(); ++i)
+	{
+		pixels[i] = static_cast<uint8_t>(i * 31 + seed * 17);
+	}
+}
+
+void WriteFile(const std::filesystem::path& path, size_t bytes)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	const std::string content(bytes, 'x');
+	file.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+// Builds a pack of synthetic previews for as many files, opens it again and verifies every preview,
+// timing the lookups. Then changes every tenth file, whose previews must then be stale.
+int main(int argc, char** argv)
+{
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000;
+	const uint32_t width = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 320;
+	const uint32_t height = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 213;
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+		("PictureBrowser-PackBenchmark-" + std::to_string(getpid()));
+	const std::filesystem::path pack = directory / "Previews.pack";
+
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory / "images");
+
+	std::vector<std::filesystem::path> files;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		files.emplace_back(directory / "images" / ("IMG_" + std::to_string(10000 + i) + ".JPG"));
+		WriteFile(files.back(), 100 + i % 100);
+	}
+
+	const uint64_t previewBytes = uint64_t(width) * height * BytesPerPixel(PixelFormat::Bgr24);
+	const uint64_t maxBytes = (previewBytes + 4096) * count * 2;
+
+	double buildSeconds = 0.0;
+
+	{
+		Image preview(width, height, PixelFormat::Bgr24);
+		PreviewStore store(pack, width, height, maxBytes);
+
+		const auto start = Clock::now();
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			Fill(preview, i);
+			store.Insert(files[i], preview);
+		}
+
+		buildSeconds = SecondsSince(start);
+	}
+
+	const auto openStart = Clock::now();
+	PreviewStore store(pack, width, height, maxBytes);
+	const double openSeconds = SecondsSince(openStart);
+
+	Image expected(width, height, PixelFormat::Bgr24);
+	std::vector<double> lookupUs;
+	size_t missing = 0;
+	size_t corrupt = 0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto start = Clock::now();
+		const std::shared_ptr<Image> found = store.Find(files[i]);
+		lookupUs.push_back(SecondsSince(start) * 1e6);
+
+		Fill(expected, i);
+
+		if (!found)
+		{
+			++missing;
+		}
+		else if (found->Width() != width || found->Height() != height || !std::ranges::equal(found->Pixels(), expected.Pixels()))
+		{
+			++corrupt;
+		}
+	}
+
+	size_t stale = 0;
+	size_t changed = 0;
+
+	for (size_t i = 0; i < count; i += 10)
+	{
+		WriteFile(files[i], 1000);
+		++changed;
+		stale += store.Find(files[i]) ? 0 : 1;
+	}
+
+	const uint64_t packBytes = std::filesystem::file_size(pack);
+
+	std::printf(
+		"{\n\t\"previews\": %zu,\n\t\"width\": %u,\n\t\"height\": %u,\n\t\"packBytes\": %llu,\n"
+		"\t\"buildSeconds\": %.3f,\n\t\"buildMBPerSecond\": %.1f,\n\t\"openMs\": %.2f,\n"
+		"\t\"missing\": %zu,\n\t\"corrupt\": %zu,\n\t\"staleDetected\": %zu,\n\t\"changed\": %zu,\n"
+		"\t\"lookupUs\": {\"p50\": %.1f, \"p95\": %.1f, \"p99\": %.1f}\n}\n",
+		count,
+		width,
+		height,
+		static_cast<unsigned long long>(packBytes),
+		buildSeconds,
+		buildSeconds > 0.0 ? double(packBytes) / buildSeconds / 1e6 : 0.0,
+		openSeconds * 1000.0,
+		missing,
+		corrupt,
+		stale,
+		changed,
+		Percentile(lookupUs, 0.50),
+		Percentile(lookupUs, 0.95),
+		Percentile(lookupUs, 0.99));
+
+	std::filesystem::remove_all(directory);
+	return missing || corrupt || stale != changed ? 1 : 0;
+}
\ No newline at end of file
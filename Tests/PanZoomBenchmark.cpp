@@ -0,0 +1,158 @@
+#include "PCH.hpp"
+#include "LruCache.hpp"
+#include "TilePyramid.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	struct View
+	{
+		float CenterX = 0.0f;
+		float CenterY = 0.0f;
+		float Scale = 1.0f;
+	};
+
+	// Zooms in from fitting the window to full resolution, pans around a circle at it,
+	// zooms out halfway and in again, so that the second zoom finds tiles from the first.
+	std::vector<View> Path(uint32_t width, uint32_t height, float fit, size_t frames)
+	{
+		std::vector<View> path;
+
+		const float centerX = width / 2.0f;
+		const float centerY = height / 2.0f;
+		const size_t zoom = frames / 4;
+		const size_t pan = frames - 3 * zoom;
+
+		for (size_t i = 0; i < zoom; ++i)
+		{
+			path.push_back({ centerX, centerY, fit * std::pow(1.0f / fit, float(i) / float(zoom)) });
+		}
+
+		const float radius = std::min(width, height) / 4.0f;
+
+		for (size_t i = 0; i < pan; ++i)
+		{
+			const float angle = 2.0f * std::numbers::pi_v<float> * float(i) / float(pan);
+			path.push_back({ centerX + radius * std::sin(angle), centerY - radius * (1.0f - std::cos(angle)), 1.0f });
+		}
+
+		for (size_t i = 0; i < 2 * zoom; ++i)
+		{
+			const float share = float(i < zoom ? i : 2 * zoom - i) / float(zoom);
+			path.push_back({ centerX, centerY, std::pow(0.25f, share) });
+		}
+
+		return path;
+	}
+}
+
+// Follows a pan and zoom path over a 200 megapixel image in a full HD window the way the
+// image cache does: the tiles of the level for the scale, found in a tile cache with a
+// budget or cut from the full resolution on the spot. Only frames drawn larger than the
+// downscaled version need tiles at all.
+int main(int argc, char** argv)
+{
+	const uint32_t width = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 16384;
+	const uint32_t height = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 12288;
+	const size_t frames = argc > 3 ? std::stoul(argv[3]) : 400;
+	const size_t budget = (argc > 4 ? std::stoul(argv[4]) : 256) << 20;
+
+	const float viewportWidth = 1920.0f;
+	const float viewportHeight = 1080.0f;
+
+	Image source(width, height, PixelFormat::Gray8);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		uint8_t* row = source.Pixels().data() + size_t(y) * source.Stride();
+
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			row[x] = static_cast<uint8_t>((x ^ y) + (x >> 6));
+		}
+	}
+
+	const TilePyramid pyramid(width, height);
+	LruCache<TileKey, std::shared_ptr<Image>, TileKeyHash> tiles(budget);
+
+	const float fit = std::min(viewportWidth / float(width), viewportHeight / float(height));
+
+	size_t tiled = 0;
+	size_t drawn = 0;
+	size_t hits = 0;
+	size_t highWater = 0;
+	std::vector<double> frameMs;
+	std::vector<double> cutMs;
+
+	const auto start = Clock::now();
+
+	for (const View& view : Path(width, height, fit, frames))
+	{
+		const auto frameStart = Clock::now();
+
+		if (view.Scale > fit)
+		{
+			++tiled;
+
+			const D2D_RECT_F visible = {
+				view.CenterX - viewportWidth / 2.0f / view.Scale,
+				view.CenterY - viewportHeight / 2.0f / view.Scale,
+				view.CenterX + viewportWidth / 2.0f / view.Scale,
+				view.CenterY + viewportHeight / 2.0f / view.Scale
+			};
+
+			for (const TileKey& key : pyramid.Tiles(pyramid.LevelFor(view.Scale), visible))
+			{
+				++drawn;
+
+				if (tiles.Find(key))
+				{
+					++hits;
+					continue;
+				}
+
+				const auto cutStart = Clock::now();
+				std::shared_ptr<Image> tile = pyramid.Cut(source, key);
+				cutMs.push_back(SecondsSince(cutStart) * 1000.0);
+
+				const size_t bytes = tile->Bytes();
+				tiles.Insert(key, std::move(tile), bytes);
+				highWater = std::max(highWater, tiles.Bytes());
+			}
+		}
+
+		frameMs.push_back(SecondsSince(frameStart) * 1000.0);
+	}
+
+	const double seconds = SecondsSince(start);
+
+	std::printf(
+		"{\n\t\"width\": %u,\n\t\"height\": %u,\n\t\"levels\": %u,\n\t\"frames\": %zu,\n\t\"tiledFrames\": %zu,\n"
+		"\t\"tilesDrawn\": %zu,\n\t\"tilesCut\": %zu,\n\t\"hitRate\": %.4f,\n\t\"evictions\": %zu,\n"
+		"\t\"tileBudgetBytes\": %zu,\n\t\"tileHighWaterBytes\": %zu,\n\t\"fullResolutionBytes\": %zu,\n"
+		"\t\"cutMs\": {\"p50\": %.3f, \"p95\": %.3f},\n\t\"frameMs\": {\"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f},\n"
+		"\t\"seconds\": %.3f\n}\n",
+		width,
+		height,
+		pyramid.Levels(),
+		frameMs.size(),
+		tiled,
+		drawn,
+		cutMs.size(),
+		drawn ? double(hits) / double(drawn) : 0.0,
+		tiles.Evictions(),
+		budget,
+		highWater,
+		source.Bytes(),
+		Percentile(cutMs, 0.50),
+		Percentile(cutMs, 0.95),
+		Percentile(frameMs, 0.50),
+		Percentile(frameMs, 0.95),
+		Percentile(frameMs, 0.99),
+		seconds);
+
+	return highWater <= budget ? 0 : 1;
+}
\ No newline at end of file
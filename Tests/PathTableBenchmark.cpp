@@ -0,0 +1,105 @@
+#include "PCH.hpp"
+#include "PathTable.hpp"
+#include "Timing.hpp"
+#include <random>
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+// Looks images of a large directory up the old way, by path in an ordered map,
+// and the new way, by the ID interned for the path when the directory was listed.
+// Finding the ID for a path is timed too, as it happens once per selection change.
+int main(int argc, char** argv)
+{
+	const size_t entries = argc > 1 ? std::stoul(argv[1]) : 100000;
+	const size_t lookups = argc > 2 ? std::stoul(argv[2]) : 1000000;
+
+	std::vector<std::filesystem::path> paths;
+	paths.reserve(entries);
+
+	for (size_t i = 0; i < entries; ++i)
+	{
+		paths.emplace_back(std::filesystem::path("/home/user/Pictures/2024/Trip to the mountains") /
+			("IMG_" + std::to_string(100000 + i) + ".JPG"));
+	}
+
+	std::mt19937 random(42);
+	std::uniform_int_distribution<size_t> anywhere(0, entries - 1);
+	std::vector<size_t> order(lookups);
+
+	for (size_t& index : order)
+	{
+		index = anywhere(random);
+	}
+
+	std::map<std::filesystem::path, size_t> byPath;
+
+	for (size_t i = 0; i < entries; ++i)
+	{
+		byPath.emplace(paths[i], i);
+	}
+
+	const auto internStart = Clock::now();
+	PathTable table;
+	std::vector<PathId> ids;
+	ids.reserve(entries);
+
+	for (const std::filesystem::path& path : paths)
+	{
+		ids.push_back(table.Intern(path));
+	}
+
+	const double internSeconds = SecondsSince(internStart);
+
+	std::unordered_map<PathId, size_t> byId;
+
+	for (size_t i = 0; i < entries; ++i)
+	{
+		byId.emplace(ids[i], i);
+	}
+
+	size_t sum = 0;
+
+	auto start = Clock::now();
+
+	for (size_t index : order)
+	{
+		sum += byPath.find(paths[index])->second;
+	}
+
+	const double pathSeconds = SecondsSince(start);
+
+	start = Clock::now();
+
+	for (size_t index : order)
+	{
+		sum += byId.find(ids[index])->second;
+	}
+
+	const double idSeconds = SecondsSince(start);
+
+	start = Clock::now();
+
+	for (size_t index : order)
+	{
+		sum += table.Find(paths[index]);
+	}
+
+	const double findSeconds = SecondsSince(start);
+
+	KeepAlive(sum);
+
+	std::printf(
+		"{\n\t\"entries\": %zu,\n\t\"lookups\": %zu,\n\t\"internNsPerPath\": %.1f,\n"
+		"\t\"mapByPathNsPerLookup\": %.1f,\n\t\"hashByIdNsPerLookup\": %.1f,\n\t\"findIdNsPerPath\": %.1f,\n"
+		"\t\"speedup\": %.1f\n}\n",
+		entries,
+		lookups,
+		internSeconds * 1e9 / double(entries),
+		pathSeconds * 1e9 / double(lookups),
+		idSeconds * 1e9 / double(lookups),
+		findSeconds * 1e9 / double(lookups),
+		idSeconds > 0.0 ? pathSeconds / idSeconds : 0.0);
+
+	return table.Count() == entries ? 0 : 1;
+}
\ No newline at end of file
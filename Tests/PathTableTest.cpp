@@ -0,0 +1,71 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "PathTable.hpp"
+
+using namespace PictureBrowser;
+
+TEST(InterningTwiceGivesTheSameId)
+{
+	PathTable table;
+
+	const PathId first = table.Intern("/photos/IMG_0001.JPG");
+	const PathId second = table.Intern("/photos/IMG_0002.JPG");
+
+	CHECK(first == 0 && second == 1);
+	CHECK(table.Intern("/photos/IMG_0001.JPG") == first);
+	CHECK(table.Count() == 2);
+}
+
+TEST(FindDoesNotIntern)
+{
+	PathTable table;
+	const PathId id = table.Intern("/photos/IMG_0001.JPG");
+
+	CHECK(table.Find("/photos/IMG_0001.JPG") == id);
+	CHECK(table.Find("/photos/IMG_0003.JPG") == NoPath);
+	CHECK(table.Count() == 1);
+}
+
+TEST(PathsAreNormalizedForTheKey)
+{
+	PathTable table;
+	const PathId id = table.Intern("/photos/2024/../2024/./IMG_0001.JPG");
+
+	CHECK(table.Find("/photos/2024/IMG_0001.JPG") == id);
+	CHECK(table.Path(id) == std::filesystem::path("/photos/2024/../2024/./IMG_0001.JPG"));
+}
+
+TEST(CaseMattersOnlyOnWindows)
+{
+	PathTable table;
+	const PathId id = table.Intern("/photos/IMG_0001.JPG");
+
+#ifdef _WIN32
+	CHECK(table.Find("/PHOTOS/img_0001.jpg") == id);
+#else
+	CHECK(table.Find("/PHOTOS/img_0001.jpg") == NoPath);
+	CHECK(table.Intern("/PHOTOS/img_0001.jpg") != id);
+#endif
+}
+
+TEST(UnknownIdsHaveAnEmptyPath)
+{
+	PathTable table;
+	table.Intern("/photos/IMG_0001.JPG");
+
+	CHECK(table.Path(NoPath).empty());
+	CHECK(table.Path(1).empty());
+	CHECK(table.Path(0) == std::filesystem::path("/photos/IMG_0001.JPG"));
+}
+
+TEST(ClearStartsTheIdsOver)
+{
+	PathTable table;
+	table.Intern("/photos/IMG_0001.JPG");
+	table.Intern("/photos/IMG_0002.JPG");
+	table.Clear();
+
+	CHECK(table.Count() == 0);
+	CHECK(table.Find("/photos/IMG_0001.JPG") == NoPath);
+	CHECK(table.Intern("/photos/IMG_0002.JPG") == 0);
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "PCH.hpp"
+#include "PrefetchScheduler.hpp"
+#include "ThreadPool.hpp"
+#include "Timing.hpp"
+#include <random>
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+struct BrowseRun
+{
+	size_t Depth = 0;
+	size_t Hits = 0;
+	std::vector<double> WaitMs;
+	size_t Decodes = 0;
+	size_t Unviewed = 0;
+};
+
+// Steps through a folder, mostly forward, looking at each image for a while.
+// Decodes take a fixed time on two workers, the image looked at goes in front of the prefetches.
+BrowseRun Browse(size_t depth, size_t steps, std::chrono::milliseconds decode, std::chrono::milliseconds dwell)
+{
+	constexpr size_t Count = 1000;
+
+	BrowseRun run;
+	run.Depth = depth;
+
+	ThreadPool pool(2);
+	PrefetchScheduler scheduler(depth);
+	std::unordered_map<size_t, std::shared_future<void>> decodes;
+	std::unordered_set<size_t> viewed;
+
+	std::mt19937 random(7);
+	std::uniform_int_distribution<int> move(0, 9);
+	size_t current = Count / 2;
+
+	const auto submit = [&](size_t index, Priority priority)
+	{
+		if (decodes.contains(index))
+		{
+			return;
+		}
+
+		auto promise = std::make_shared<std::promise<void>>();
+		decodes.emplace(index, promise->get_future().share());
+
+		pool.Submit([promise, decode]()
+		{
+			std::this_thread::sleep_for(decode);
+			promise->set_value();
+		}, priority);
+	};
+
+	for (size_t step = 0; step < steps; ++step)
+	{
+		current = move(random) < 8 ? current + 1 : current - 1;
+
+		const auto start = Clock::now();
+
+		submit(current, Priority::Visible);
+
+		const std::shared_future<void> result = decodes.at(current);
+
+		if (result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			++run.Hits;
+		}
+
+		result.wait();
+		run.WaitMs.push_back(SecondsSince(start) * 1000.0);
+		viewed.insert(current);
+
+		for (size_t neighbor : scheduler.Neighbors(current, Count))
+		{
+			submit(neighbor, Priority::Prefetch);
+		}
+
+		std::this_thread::sleep_for(dwell);
+	}
+
+	run.Decodes = decodes.size();
+	run.Unviewed = decodes.size() - viewed.size();
+	return run;
+}
+
+// Hit rate and the wait for each image looked at, by prefetch depth
+int main(int argc, char** argv)
+{
+	const size_t steps = argc > 1 ? std::stoul(argv[1]) : 40;
+	const std::chrono::milliseconds decode(argc > 2 ? std::stoul(argv[2]) : 25);
+	const std::chrono::milliseconds dwell(argc > 3 ? std::stoul(argv[3]) : 30);
+
+	std::printf(
+		"{\n\t\"steps\": %zu,\n\t\"decodeMs\": %lld,\n\t\"dwellMs\": %lld,\n\t\"runs\": [",
+		steps,
+		static_cast<long long>(decode.count()),
+		static_cast<long long>(dwell.count()));
+
+	for (size_t depth = 0; depth <= 3; ++depth)
+	{
+		BrowseRun run = Browse(depth, steps, decode, dwell);
+
+		double total = 0.0;
+
+		for (double wait : run.WaitMs)
+		{
+			total += wait;
+		}
+
+		std::printf(
+			"%s\n\t\t{\"depth\": %zu, \"hitRate\": %.3f, \"meanWaitMs\": %.2f, \"p95WaitMs\": %.2f, \"decodes\": %zu, \"unviewedDecodes\": %zu}",
+			depth ? "," : "",
+			run.Depth,
+			double(run.Hits) / double(steps),
+			total / double(steps),
+			Percentile(run.WaitMs, 0.95),
+			run.Decodes,
+			run.Unviewed);
+	}
+
+	std::printf("\n\t]\n}\n");
+	return 0;
+}
\ No newline at end of file
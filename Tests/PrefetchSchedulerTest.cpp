@@ -0,0 +1,59 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "PrefetchScheduler.hpp"
+
+using namespace PictureBrowser;
+
+using Indices = std::vector<size_t>;
+
+TEST(ClosestFirstForwardBeforeBackward)
+{
+	PrefetchScheduler scheduler(3);
+
+	CHECK(scheduler.Neighbors(10, 100) == Indices({ 11, 9, 12, 8, 13, 7 }));
+}
+
+TEST(StepsBackPutTheDirectionOfTravelFirst)
+{
+	PrefetchScheduler scheduler(2);
+
+	scheduler.Neighbors(10, 100);
+	CHECK(scheduler.Neighbors(9, 100) == Indices({ 8, 10, 7, 11 }));
+
+	// Same index again keeps the direction
+	CHECK(scheduler.Neighbors(9, 100) == Indices({ 8, 10, 7, 11 }));
+
+	CHECK(scheduler.Neighbors(20, 100) == Indices({ 21, 19, 22, 18 }));
+}
+
+TEST(StopsAtTheEnds)
+{
+	PrefetchScheduler scheduler(3);
+
+	CHECK(scheduler.Neighbors(0, 5) == Indices({ 1, 2, 3 }));
+	CHECK(scheduler.Neighbors(4, 5) == Indices({ 3, 2, 1 }));
+
+	PrefetchScheduler backward(2);
+	backward.Neighbors(3, 5);
+	CHECK(backward.Neighbors(1, 5) == Indices({ 0, 2, 3 }));
+}
+
+TEST(NothingOutsideTheList)
+{
+	PrefetchScheduler scheduler(2);
+
+	CHECK(scheduler.Neighbors(0, 1).empty());
+	CHECK(scheduler.Neighbors(5, 5).empty());
+	CHECK(scheduler.Neighbors(0, 0).empty());
+}
+
+TEST(DepthZeroPrefetchesNothing)
+{
+	PrefetchScheduler scheduler(0);
+
+	CHECK(scheduler.Neighbors(10, 100).empty());
+
+	scheduler.SetDepth(1);
+	CHECK(scheduler.Depth() == 1);
+	CHECK(scheduler.Neighbors(11, 100) == Indices({ 12, 10 }));
+}
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "PreviewStore.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+std::shared_ptr<Image> MakePreview(uint32_t width, uint32_t height, PixelFormat format, uint8_t seed)
+{
+	auto image = std::make_shared<Image>(width, height, format);
+	std::span<uint8_t> pixels = image->Pixels();
+
+	for (size_t i = 0; i < pixels.size(); ++i)
+	{
+		pixels[i] = static_cast<uint8_t>(i * 7 + seed);
+	}
+
+	image->SetSourceSize(width * 4, height * 4);
+	return image;
+}
+
+bool SamePixels(const Image& left, const Image& right)
+{
+	return left.Width() == right.Width() &&
+		left.Height() == right.Height() &&
+		left.Format() == right.Format() &&
+		left.SourceWidth() == right.SourceWidth() &&
+		left.SourceHeight() == right.SourceHeight() &&
+		std::ranges::equal(left.Pixels(), right.Pixels());
+}
+
+std::vector<uint8_t> Bytes(size_t count, uint8_t value = 0x55)
+{
+	return std::vector<uint8_t>(count, value);
+}
+
+TEST(FindsWhatWasInserted)
+{
+	TemporaryDirectory directory;
+	PreviewStore store(directory.Path() / "Previews.pack", 64, 64, 1 << 20);
+
+	for (PixelFormat format : { PixelFormat::Bgr32, PixelFormat::Bgr24, PixelFormat::Gray8 })
+	{
+		const std::filesystem::path file = directory.Write(std::to_string(int(format)) + ".jpg", Bytes(100));
+		CHECK(!store.Find(file));
+
+		const auto preview = MakePreview(33, 17, format, 3);
+		store.Insert(file, *preview);
+
+		const auto found = store.Find(file);
+		CHECK(found && SamePixels(*found, *preview));
+	}
+}
+
+TEST(SurvivesReopening)
+{
+	TemporaryDirectory directory;
+	const std::filesystem::path first = directory.Write("first.jpg", Bytes(100));
+	const std::filesystem::path second = directory.Write("second.jpg", Bytes(200));
+	const auto firstPreview = MakePreview(20, 10, PixelFormat::Bgr24, 1);
+	const auto secondPreview = MakePreview(10, 20, PixelFormat::Gray8, 2);
+
+	{
+		PreviewStore store(directory.Path() / "Previews.pack", 64, 64, 1 << 20);
+		store.Insert(first, *firstPreview);
+		store.Insert(second, *secondPreview);
+	}
+
+	PreviewStore store(directory.Path() / "Previews.pack", 64, 64, 1 << 20);
+
+	const auto firstFound = store.Find(first);
+	const auto secondFound = store.Find(second);
+
+	CHECK(firstFound && SamePixels(*firstFound, *firstPreview));
+	CHECK(secondFound && SamePixels(*secondFound, *secondPreview));
+}
+
+TEST(ChangedFilesAreStale)
+{
+	TemporaryDirectory directory;
+	const std::filesystem::path resized = directory.Write("resized.jpg", Bytes(100));
+	const std::filesystem::path touched = directory.Write("touched.jpg", Bytes(100));
+	const std::filesystem::path removed = directory.Write("removed.jpg", Bytes(100));
+	const auto preview = MakePreview(8, 8, PixelFormat::Bgr24, 0);
+
+	PreviewStore store(directory.Path() / "Previews.pack", 64, 64, 1 << 20);
+
+	for (const std::filesystem::path& path : { resized, touched, removed })
+	{
+		store.Insert(path, *preview);
+		CHECK(store.Find(path));
+	}
+
+	directory.Write("resized.jpg", Bytes(101));
+	std::filesystem::last_write_time(touched, std::filesystem::last_write_time(touched) + std::chrono::seconds(10));
+	std::filesystem::remove(removed);
+
+	CHECK(!store.Find(resized));
+	CHECK(!store.Find(touched));
+	CHECK(!store.Find(removed));
+
+	// Inserted again for the file as it is now
+	store.Insert(resized, *preview);
+	CHECK(store.Find(resized));
+}
+
+TEST(FullPackDropsTheOldestPreviews)
+{
+	TemporaryDirectory directory;
+	const std::filesystem::path pack = directory.Path() / "Previews.pack";
+	constexpr uint64_t MaxBytes = 16 << 10;
+
+	std::vector<std::filesystem::path> files;
+
+	{
+		PreviewStore store(pack, 64, 64, MaxBytes);
+
+		for (int i = 0; i < 40; ++i)
+		{
+			files.emplace_back(directory.Write("image" + std::to_string(i) + ".jpg", Bytes(10)));
+			store.Insert(files.back(), *MakePreview(16, 16, PixelFormat::Bgr24, static_cast<uint8_t>(i)));
+
+			CHECK(std::filesystem::file_size(pack) <= MaxBytes);
+			CHECK(store.Find(files.back()));
+		}
+
+		CHECK(!store.Find(files.front()));
+	}
+
+	// The newest ones are kept, and no older one in between
+	PreviewStore store(pack, 64, 64, MaxBytes);
+	std::vector<bool> kept;
+
+	for (const std::filesystem::path& file : files)
+	{
+		kept.push_back(store.Find(file) != nullptr);
+	}
+
+	const auto oldestKept = std::find(kept.cbegin(), kept.cend(), true);
+
+	CHECK(oldestKept != kept.cbegin());
+	CHECK(kept.cend() - oldestKept > 10);
+	CHECK(std::all_of(oldestKept, kept.cend(), [](bool hit) { return hit; }));
+}
+
+TEST(TornPackKeepsTheWholeRecords)
+{
+	TemporaryDirectory directory;
+	const std::filesystem::path pack = directory.Path() / "Previews.pack";
+	const std::filesystem::path first = directory.Write("first.jpg", Bytes(10));
+	const std::filesystem::path second = directory.Write("second.jpg", Bytes(10));
+
+	uint64_t intact = 0;
+
+	{
+		PreviewStore store(pack, 64, 64, 1 << 20);
+		store.Insert(first, *MakePreview(16, 16, PixelFormat::Bgr24, 1));
+		intact = std::filesystem::file_size(pack);
+		store.Insert(second, *MakePreview(16, 16, PixelFormat::Bgr24, 2));
+	}
+
+	std::filesystem::resize_file(pack, std::filesystem::file_size(pack) - 5);
+
+	PreviewStore store(pack, 64, 64, 1 << 20);
+
+	CHECK(store.Find(first));
+	CHECK(!store.Find(second));
+	CHECK(std::filesystem::file_size(pack) == intact);
+}
+
+TEST(ForeignPackStartsOver)
+{
+	TemporaryDirectory directory;
+	const std::filesystem::path file = directory.Write("a.jpg", Bytes(10));
+	const std::filesystem::path pack = directory.Write("Previews.pack", Bytes(4096, 0xEE));
+
+	PreviewStore store(pack, 64, 64, 1 << 20);
+
+	CHECK(!store.Find(file));
+	CHECK(std::filesystem::file_size(pack) == 8);
+
+	store.Insert(file, *MakePreview(4, 4, PixelFormat::Gray8, 0));
+	CHECK(store.Find(file));
+}
+
+TEST(ImplausibleRecordEndsTheScan)
+{
+	TemporaryDirectory directory;
+	const std::filesystem::path pack = directory.Path() / "Previews.pack";
+	const std::filesystem::path file = directory.Write("a.jpg", Bytes(10));
+
+	uint64_t intact = 0;
+
+	{
+		PreviewStore store(pack, 64, 64, 1 << 20);
+		store.Insert(file, *MakePreview(4, 4, PixelFormat::Gray8, 0));
+		intact = std::filesystem::file_size(pack);
+	}
+
+	// A record claiming to be a few billion pixels large
+	std::vector<uint8_t> garbage(48, 0);
+	const uint32_t magic = 0x43525042;
+	const uint32_t huge = 1 << 30;
+	std::memcpy(garbage.data(), &magic, 4);
+	std::memcpy(garbage.data() + 24, &huge, 4);
+	std::memcpy(garbage.data() + 28, &huge, 4);
+
+	{
+		std::ofstream stream(pack, std::ios::binary | std::ios::app);
+		stream.write(reinterpret_cast<const char*>(garbage.data()), static_cast<std::streamsize>(garbage.size()));
+	}
+
+	PreviewStore store(pack, 64, 64, 1 << 20);
+
+	CHECK(store.Find(file));
+	CHECK(std::filesystem::file_size(pack) == intact);
+}
\ No newline at end of file
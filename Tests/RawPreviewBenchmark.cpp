@@ -0,0 +1,144 @@
+#include "PCH.hpp"
+#include "Corpus.hpp"
+#include "ImageProbe.hpp"
+#include "MappedFile.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	void WriteFile(const std::filesystem::path& path, std::span<const uint8_t> data)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	}
+
+	// Probes the file and reads its preview out of the mapping, as browsing a RAW file does
+	uint64_t ReadPreview(const std::filesystem::path& path)
+	{
+		const MappedFile file(path);
+		const std::optional<ImageInfo> info = ProbeImage(file.Data());
+
+		if (!info || !info->PreviewBytes)
+		{
+			return 0;
+		}
+
+		uint64_t sum = 0;
+
+		for (uint8_t byte : file.Data().subspan(info->PreviewOffset, info->PreviewBytes))
+		{
+			sum += byte;
+		}
+
+		return sum;
+	}
+
+	// The least a RAW decoder would have to do
+	uint64_t ReadWhole(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::vector<char> data(std::filesystem::file_size(path));
+		file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+		return data.empty() ? 0 : uint64_t(uint8_t(data.back()));
+	}
+}
+
+// Writes a card dump of each RAW container, then finds and reads the embedded previews
+// and compares that with reading the whole files
+int main(int argc, char** argv)
+{
+	const size_t files = argc > 1 ? std::stoul(argv[1]) : 25;
+	const size_t rawBytes = (argc > 2 ? std::stoul(argv[2]) : 16) << 20;
+	const size_t previewBytes = (argc > 3 ? std::stoul(argv[3]) : 2048) << 10;
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+		("PictureBrowser-RawPreviewBenchmark-" + std::to_string(getpid()));
+
+	std::filesystem::create_directories(directory);
+
+	const std::pair<const char*, RawFile> formats[] = {
+		{ "nef", TiffRaw(false, rawBytes, previewBytes) },
+		{ "rw2", PanasonicRaw(rawBytes, previewBytes) },
+		{ "raf", FujifilmRaw(rawBytes, previewBytes) },
+		{ "cr3", CanonCr3(rawBytes, previewBytes) }
+	};
+
+	std::printf("{\n\t\"files\": %zu,\n\t\"rawBytes\": %zu,\n\t\"results\": [", files, rawBytes);
+
+	const char* separator = "";
+	size_t missing = 0;
+
+	for (const auto& [name, raw] : formats)
+	{
+		const size_t rounds = 20000;
+		auto start = Clock::now();
+
+		for (size_t round = 0; round < rounds; ++round)
+		{
+			KeepAlive(ProbeImage(raw.Data));
+		}
+
+		const double probeNs = SecondsSince(start) * 1e9 / double(rounds);
+
+		std::vector<std::filesystem::path> paths;
+
+		for (size_t i = 0; i < files; ++i)
+		{
+			paths.push_back(directory / (std::string("RAW_") + std::to_string(i) + "." + name));
+			WriteFile(paths.back(), raw.Data);
+		}
+
+		std::vector<double> previewMs;
+		uint64_t sum = 0;
+
+		for (const std::filesystem::path& path : paths)
+		{
+			const auto fileStart = Clock::now();
+			const uint64_t previewSum = ReadPreview(path);
+			previewMs.push_back(SecondsSince(fileStart) * 1000.0);
+
+			missing += previewSum ? 0 : 1;
+			sum += previewSum;
+		}
+
+		start = Clock::now();
+
+		for (const std::filesystem::path& path : paths)
+		{
+			sum += ReadWhole(path);
+		}
+
+		const double wholeMs = SecondsSince(start) * 1000.0 / double(files);
+		KeepAlive(sum);
+
+		const double medianMs = Percentile(previewMs, 0.50);
+
+		std::printf(
+			"%s\n\t\t{\"format\": \"%s\", \"probeNs\": %.0f, \"previewBytes\": %zu, \"previewMs\": {\"p50\": %.3f, \"p95\": %.3f}, "
+			"\"wholeFileMs\": %.3f, \"speedup\": %.0f}",
+			separator,
+			name,
+			probeNs,
+			raw.Preview.size(),
+			medianMs,
+			Percentile(previewMs, 0.95),
+			wholeMs,
+			medianMs > 0.0 ? wholeMs / medianMs : 0.0);
+
+		separator = ",";
+
+		for (const std::filesystem::path& path : paths)
+		{
+			std::filesystem::remove(path);
+		}
+	}
+
+	std::printf("\n\t]\n}\n");
+	std::filesystem::remove_all(directory);
+
+	return missing ? 1 : 0;
+}
\ No newline at end of file
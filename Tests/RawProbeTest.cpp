@@ -0,0 +1,147 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "Corpus.hpp"
+#include "ImageProbe.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	bool Points(std::span<const uint8_t> file, uint64_t offset, uint32_t bytes, std::span<const uint8_t> expected)
+	{
+		return bytes == expected.size() &&
+			offset + bytes <= file.size() &&
+			std::equal(expected.begin(), expected.end(), file.begin() + static_cast<ptrdiff_t>(offset));
+	}
+}
+
+TEST(TiffRawFindsTheSubIfdPreview)
+{
+	for (bool bigEndian : { false, true })
+	{
+		const RawFile raw = TiffRaw(bigEndian, 4096);
+		const std::optional<ImageInfo> info = ProbeImage(raw.Data);
+
+		CHECK(info.has_value());
+		CHECK(info->Format == ImageFormat::Tiff);
+		CHECK(info->Orientation == 8);
+		CHECK(Points(raw.Data, info->PreviewOffset, info->PreviewBytes, raw.Preview));
+		CHECK(Points(raw.Data, info->ThumbnailOffset, info->ThumbnailBytes, raw.Thumbnail));
+	}
+}
+
+TEST(LosslessRawDataIsNoPreview)
+{
+	TiffWriter tiff;
+	const std::vector<uint8_t> lossless = LosslessJpeg(6048, 4024, 100);
+	const uint32_t data = tiff.Append(lossless);
+
+	tiff.Ifd({ Short(0x0103, 7), Long(0x0111, data), Long(0x0117, static_cast<uint32_t>(lossless.size())) });
+
+	const std::optional<ImageInfo> info = ProbeImage(tiff.Data());
+	CHECK(info.has_value());
+	CHECK(info->PreviewBytes == 0 && info->ThumbnailBytes == 0);
+}
+
+TEST(JpegWithoutTablesIsNoPreview)
+{
+	// A frame header without a quantization table before it, as in some motion JPEG
+	JpegWriter jpeg;
+	ByteWriter frame;
+	frame.U8(8);
+	frame.U16(4000);
+	frame.U16(6000);
+	frame.U8(0);
+	jpeg.Segment(0xC0, frame.Data);
+	const std::vector<uint8_t> tableless = jpeg.Finish();
+
+	TiffWriter tiff;
+	const uint32_t data = tiff.Append(tableless);
+	tiff.Ifd({ Long(0x0201, data), Long(0x0202, static_cast<uint32_t>(tableless.size())) });
+
+	CHECK(ProbeImage(tiff.Data())->PreviewBytes == 0);
+}
+
+TEST(PanasonicKeepsItsPreviewInATag)
+{
+	const RawFile raw = PanasonicRaw(4096);
+	const std::optional<ImageInfo> info = ProbeImage(raw.Data);
+
+	CHECK(info.has_value());
+	CHECK(Points(raw.Data, info->PreviewOffset, info->PreviewBytes, raw.Preview));
+
+	// A single JPEG is no thumbnail of itself
+	CHECK(info->ThumbnailBytes == 0);
+}
+
+TEST(FujifilmPointsAtAJpeg)
+{
+	const RawFile raw = FujifilmRaw(4096);
+	const std::optional<ImageInfo> info = ProbeImage(raw.Data);
+
+	CHECK(info.has_value());
+	CHECK(info->Format == ImageFormat::Raw);
+	CHECK(info->Width == 1920 && info->Height == 1280);
+	CHECK(info->Orientation == 6);
+	CHECK(info->CaptureTime.has_value());
+	CHECK(Points(raw.Data, info->PreviewOffset, info->PreviewBytes, raw.Preview));
+	CHECK(Points(raw.Data, info->ThumbnailOffset, info->ThumbnailBytes, raw.Thumbnail));
+}
+
+TEST(FujifilmPointerPastTheEnd)
+{
+	RawFile raw = FujifilmRaw(0);
+	raw.Data.resize(raw.Data.size() - 1);
+
+	CHECK(!ProbeImage(raw.Data));
+}
+
+TEST(Cr3FindsTheFullSizeTrack)
+{
+	const RawFile raw = CanonCr3(4096);
+	const std::optional<ImageInfo> info = ProbeImage(raw.Data);
+
+	CHECK(info.has_value());
+	CHECK(info->Format == ImageFormat::Raw);
+	CHECK(info->Width == 6000 && info->Height == 4000);
+	CHECK(info->Orientation == 3);
+	CHECK(Points(raw.Data, info->PreviewOffset, info->PreviewBytes, raw.Preview));
+	CHECK(Points(raw.Data, info->ThumbnailOffset, info->ThumbnailBytes, raw.Thumbnail));
+}
+
+TEST(Cr3WithoutTheTrackFallsBackToTheMediumPreview)
+{
+	// Cutting the media data box off leaves the track pointing nowhere
+	RawFile raw = CanonCr3(0);
+	raw.Data.resize(raw.Data.size() - raw.Preview.size() - 8);
+
+	const std::optional<ImageInfo> info = ProbeImage(raw.Data);
+	CHECK(info.has_value());
+	CHECK(info->PreviewOffset + info->PreviewBytes <= raw.Data.size());
+
+	const std::optional<ImageInfo> preview = ProbeImage(std::span(raw.Data).subspan(info->PreviewOffset, info->PreviewBytes));
+	CHECK(preview && preview->Width == 1620 && preview->Height == 1080);
+	CHECK(Points(raw.Data, info->ThumbnailOffset, info->ThumbnailBytes, raw.Thumbnail));
+}
+
+TEST(TruncatedRawFilesStayInside)
+{
+	for (const RawFile& raw : { TiffRaw(false, 256), PanasonicRaw(256), FujifilmRaw(256), CanonCr3(256) })
+	{
+		size_t escapes = 0;
+
+		for (size_t size = 0; size < raw.Data.size(); size += 7)
+		{
+			const std::span<const uint8_t> data(raw.Data.data(), size);
+			const std::optional<ImageInfo> info = ProbeImage(data);
+
+			if (info && (info->PreviewOffset + info->PreviewBytes > size || info->ThumbnailOffset + info->ThumbnailBytes > size))
+			{
+				++escapes;
+			}
+		}
+
+		CHECK(escapes == 0);
+	}
+}
\ No newline at end of file
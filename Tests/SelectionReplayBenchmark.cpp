@@ -0,0 +1,124 @@
+#include "PCH.hpp"
+#include "ThreadPool.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+struct ReplayRun
+{
+	bool LatestWins = false;
+	size_t Started = 0;
+	size_t Dropped = 0;
+	size_t Backlog = 0;
+	double FinalLatencyMs = 0.0;
+};
+
+// Replays an arrow key held down: one selection change per interval, each queueing a decode.
+// With latest wins each job is visible, the newest first, and carries the generation of its change.
+// It is dropped before decoding once a newer change came, the way ImageCache tickets its decodes.
+// Without, every change is decoded in order, as they were before.
+ReplayRun Replay(bool latestWins, size_t changes, std::chrono::milliseconds interval, std::chrono::milliseconds decode)
+{
+	ReplayRun run;
+	run.LatestWins = latestWins;
+
+	std::atomic<uint64_t> generation = 0;
+	std::atomic<size_t> started = 0;
+	std::atomic<size_t> dropped = 0;
+	std::promise<void> final;
+	std::future<void> finalReady = final.get_future();
+	auto lastChange = Clock::now();
+
+	{
+		ThreadPool decoders(2);
+
+		for (size_t change = 1; change <= changes; ++change)
+		{
+			const uint64_t ticket = ++generation;
+			const bool last = change == changes;
+			lastChange = Clock::now();
+
+			decoders.Submit([&, ticket, last]()
+			{
+				if (latestWins && ticket != generation.load())
+				{
+					++dropped;
+					return;
+				}
+
+				++started;
+				std::this_thread::sleep_for(decode);
+
+				if (last)
+				{
+					final.set_value();
+				}
+			}, latestWins ? Priority::Visible : Priority::Prefetch);
+
+			if (!last)
+			{
+				std::this_thread::sleep_for(interval);
+			}
+		}
+
+		finalReady.wait();
+		run.FinalLatencyMs = SecondsSince(lastChange) * 1000.0;
+		run.Started = started;
+		run.Dropped = dropped;
+
+		// Older changes still queued once the final frame is ready, dropped along with the pool
+		run.Backlog = decoders.Pending();
+	}
+
+	return run;
+}
+
+// The decodes started for images nobody got to see and how long the last one took to show
+int main(int argc, char** argv)
+{
+	const size_t changes = argc > 1 ? std::stoul(argv[1]) : 200;
+	const std::chrono::milliseconds interval(argc > 2 ? std::stoul(argv[2]) : 10);
+	const std::chrono::milliseconds decode(argc > 3 ? std::stoul(argv[3]) : 40);
+
+	std::printf(
+		"{\n\t\"changes\": %zu,\n\t\"intervalMs\": %lld,\n\t\"decodeMs\": %lld,\n\t\"runs\": [",
+		changes,
+		static_cast<long long>(interval.count()),
+		static_cast<long long>(decode.count()));
+
+	bool latestWinsBetter = false;
+	size_t wastedWithout = 0;
+
+	for (bool latestWins : { false, true })
+	{
+		const ReplayRun run = Replay(latestWins, changes, interval, decode);
+
+		// Everything but the final frame
+		const size_t wasted = run.Started - 1;
+
+		std::printf(
+			"%s\n\t\t{\"latestWins\": %s, \"decodesStarted\": %zu, \"wastedDecodes\": %zu, \"wastedMs\": %lld, "
+			"\"droppedBeforeDecode\": %zu, \"leftQueued\": %zu, \"finalFrameLatencyMs\": %.1f}",
+			latestWins ? "," : "",
+			latestWins ? "true" : "false",
+			run.Started,
+			wasted,
+			static_cast<long long>(wasted * decode.count()),
+			run.Dropped,
+			run.Backlog,
+			run.FinalLatencyMs);
+
+		if (latestWins)
+		{
+			latestWinsBetter = wasted < wastedWithout;
+		}
+		else
+		{
+			wastedWithout = wasted;
+		}
+	}
+
+	std::printf("\n\t]\n}\n");
+	return latestWinsBetter ? 0 : 1;
+}
\ No newline at end of file
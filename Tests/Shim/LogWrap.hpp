@@ -0,0 +1,17 @@
+#pragma once
+
+namespace PictureBrowser
+{
+	// The log needs std::format and Windows, without them it goes nowhere
+	class NullStream
+	{
+	public:
+		template <typename T>
+		constexpr NullStream& operator << (T)
+		{
+			return *this;
+		}
+	};
+}
+
+#define LOGD PictureBrowser::NullStream()
\ No newline at end of file
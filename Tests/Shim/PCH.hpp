@@ -0,0 +1,79 @@
+#pragma once
+
+// Stands in for PictureBrowser/PCH.hpp when the portable modules are built with GCC or Clang.
+// The standard library, POSIX and the few Windows names those modules use.
+
+#include <cpuid.h>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#define _ASSERTE assert
+
+// <cpuid.h> has __cpuidex, and a macro named __cpuid with another signature
+#undef __cpuid
+
+inline void __cpuid(int info[4], int leaf)
+{
+	__cpuidex(info, leaf, 0);
+}
+
+struct D2D_RECT_F
+{
+	float left;
+	float top;
+	float right;
+	float bottom;
+};
+
+namespace PictureBrowser
+{
+	template <typename T>
+	constexpr void ZeroInit(T& x)
+	{
+		uint8_t* begin = reinterpret_cast<uint8_t*>(&x);
+		const uint8_t* const end = reinterpret_cast<uint8_t*>(&x) + sizeof(T);
+
+		while (begin < end)
+		{
+			*begin = 0;
+			++begin;
+		}
+	}
+}
\ No newline at end of file
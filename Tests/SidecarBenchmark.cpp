@@ -0,0 +1,97 @@
+#include "PCH.hpp"
+#include "SidecarIndex.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	// What deleting an image used to do: a stat call for each RAW extension and the sidecar
+	constexpr const char* ProbedExtensions[] =
+	{
+		".3FR", ".ARI", ".ARW", ".BAY", ".BRAW", ".CRW", ".CR2", ".CR3", ".CAP", ".DATA", ".DCS", ".DCR", ".DNG",
+		".DRF", ".EIP", ".ERF", ".FFF", ".GPR", ".IIQ", ".K25", ".KDC", ".MDC", ".MEF", ".MOS", ".MRW", ".NEF",
+		".NRW", ".OBM", ".ORF", ".PEF", ".PTX", ".PXN", ".R3D", ".RAF", ".RAW", ".RWL", ".RW2", ".RWZ", ".SR2",
+		".SRF", ".SRW", ".TIF", ".X3F", ".xmp"
+	};
+
+	size_t ProbeCompanions(std::filesystem::path path)
+	{
+		size_t found = 0;
+
+		for (const char* extension : ProbedExtensions)
+		{
+			std::error_code error;
+			found += std::filesystem::exists(path.replace_extension(extension), error) ? 1 : 0;
+		}
+
+		return found;
+	}
+}
+
+// A card dump of JPEGs, each with a RAW file and every fourth with a sidecar. Finds the companions of every JPEG
+// with the index, built in one enumeration, and with a stat call per extension.
+int main(int argc, char** argv)
+{
+	const size_t shots = argc > 1 ? std::stoul(argv[1]) : 2000;
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+		("PictureBrowser-SidecarBenchmark-" + std::to_string(getpid()));
+
+	std::filesystem::create_directories(directory);
+	std::vector<std::filesystem::path> images;
+
+	for (size_t i = 0; i < shots; ++i)
+	{
+		const std::string stem = "DSC_" + std::to_string(10000 + i);
+		images.push_back(directory / (stem + ".JPG"));
+
+		std::ofstream(images.back()).put('x');
+		std::ofstream(directory / (stem + ".NEF")).put('x');
+
+		if (i % 4 == 0)
+		{
+			std::ofstream(directory / (stem + ".xmp")).put('x');
+		}
+	}
+
+	auto start = Clock::now();
+	const SidecarIndex index(directory);
+	const double buildMs = SecondsSince(start) * 1000.0;
+
+	size_t indexed = 0;
+	start = Clock::now();
+
+	for (const std::filesystem::path& image : images)
+	{
+		indexed += index.Companions(image).size();
+	}
+
+	const double indexUs = SecondsSince(start) * 1e6 / double(shots);
+
+	size_t probed = 0;
+	start = Clock::now();
+
+	for (const std::filesystem::path& image : images)
+	{
+		probed += ProbeCompanions(image);
+	}
+
+	const double probeUs = SecondsSince(start) * 1e6 / double(shots);
+
+	std::filesystem::remove_all(directory);
+
+	std::printf(
+		"{\n\t\"shots\": %zu,\n\t\"files\": %zu,\n\t\"buildMs\": %.2f,\n\t\"indexUsPerImage\": %.2f,\n"
+		"\t\"statUsPerImage\": %.2f,\n\t\"statCallsPerImage\": %zu,\n\t\"speedup\": %.0f\n}\n",
+		shots,
+		index.Count(),
+		buildMs,
+		indexUs,
+		probeUs,
+		std::size(ProbedExtensions),
+		indexUs > 0.0 ? probeUs / indexUs : 0.0);
+
+	return indexed == probed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "SidecarIndex.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	// A card dump: JPEGs with their RAW files and sidecars, and some files which are no companions
+	void WriteShots(const TemporaryDirectory& directory)
+	{
+		for (const char* name : {
+			"IMG_1.JPG", "IMG_1.CR2", "IMG_1.CR2.xmp", "IMG_1.xmp",
+			"IMG_2.JPG", "IMG_2.NEF",
+			"IMG_3.jpeg",
+			"notes.txt", "IMG_1.txt" })
+		{
+			directory.Write(name);
+		}
+
+		// A directory with the name of a companion is none
+		std::filesystem::create_directories(directory.Path() / "IMG_2.dng");
+	}
+
+	std::vector<std::filesystem::path> Paths(const TemporaryDirectory& directory, std::initializer_list<const char*> names)
+	{
+		std::vector<std::filesystem::path> paths;
+
+		for (const char* name : names)
+		{
+			paths.push_back(directory.Path() / name);
+		}
+
+		return paths;
+	}
+}
+
+TEST(OneEnumerationFindsTheCompanions)
+{
+	const TemporaryDirectory directory;
+	WriteShots(directory);
+
+	const SidecarIndex index(directory.Path());
+
+	CHECK(index.Directory() == directory.Path());
+	CHECK(index.Count() == 7);
+	CHECK(index.Companions(directory.Path() / "IMG_1.JPG") == Paths(directory, { "IMG_1.CR2", "IMG_1.CR2.xmp", "IMG_1.xmp" }));
+	CHECK(index.Companions(directory.Path() / "IMG_2.JPG") == Paths(directory, { "IMG_2.NEF" }));
+	CHECK(index.Companions(directory.Path() / "IMG_3.jpeg").empty());
+}
+
+TEST(RawFilesFindTheirJpeg)
+{
+	const TemporaryDirectory directory;
+	WriteShots(directory);
+
+	const SidecarIndex index(directory.Path());
+
+	CHECK(index.Companions(directory.Path() / "IMG_2.NEF") == Paths(directory, { "IMG_2.JPG" }));
+	CHECK(index.Companions(directory.Path() / "IMG_1.CR2") == Paths(directory, { "IMG_1.CR2.xmp", "IMG_1.JPG", "IMG_1.xmp" }));
+}
+
+TEST(StemsIgnoreCase)
+{
+	SidecarIndex index;
+	index.Reset("/photos");
+	index.Add(L"IMG_1.JPG");
+	index.Add(L"img_1.cr2");
+	index.Add(L"Img_1.XMP");
+
+	CHECK(index.Group(L"IMG_1.JPG").size() == 3);
+	CHECK(index.Companions("/photos/img_1.jpg") == std::vector<std::filesystem::path>({ "/photos/Img_1.XMP", "/photos/img_1.cr2" }));
+}
+
+TEST(OnlyTheLastExtensionIsCut)
+{
+	SidecarIndex index;
+	index.Add(L"IMG.1.JPG");
+	index.Add(L"IMG.1.ARW");
+	index.Add(L"IMG.1.ARW.xmp");
+	index.Add(L"IMG.2.ARW");
+
+	CHECK(index.Group(L"IMG.1.JPG").size() == 3);
+	CHECK(index.Group(L"IMG.2.ARW").size() == 1);
+	CHECK(index.Group(L"IMG.JPG").empty());
+}
+
+TEST(AddingTwiceCountsOnce)
+{
+	SidecarIndex index;
+	index.Add(L"IMG_1.JPG");
+	index.Add(L"IMG_1.JPG");
+	index.Add(L"IMG_1.mov");
+
+	CHECK(index.Count() == 1);
+	CHECK(index.Group(L"IMG_1.CR3").size() == 1);
+}
+
+TEST(RemovedFilesAreNoCompanions)
+{
+	const TemporaryDirectory directory;
+	WriteShots(directory);
+
+	SidecarIndex index(directory.Path());
+	index.Remove(directory.Path() / "img_1.cr2");
+	index.Remove(directory.Path() / "IMG_9.JPG");
+
+	CHECK(index.Count() == 6);
+	CHECK(index.Companions(directory.Path() / "IMG_1.JPG") == Paths(directory, { "IMG_1.CR2.xmp", "IMG_1.xmp" }));
+
+	// The image itself is gone, its companions are still there to be deleted with it
+	index.Remove(directory.Path() / "IMG_2.JPG");
+	CHECK(index.Companions(directory.Path() / "IMG_2.JPG") == Paths(directory, { "IMG_2.NEF" }));
+
+	index.Remove(directory.Path() / "IMG_2.NEF");
+	CHECK(index.Group(L"IMG_2.JPG").empty());
+	CHECK(index.Count() == 4);
+}
+
+TEST(ResetForgetsTheOldDirectory)
+{
+	const TemporaryDirectory directory;
+	WriteShots(directory);
+
+	SidecarIndex index(directory.Path());
+	index.Reset("/elsewhere");
+
+	CHECK(index.Count() == 0);
+	CHECK(index.Directory() == std::filesystem::path("/elsewhere"));
+	CHECK(index.Companions(directory.Path() / "IMG_1.JPG").empty());
+}
+
+TEST(MissingDirectoryIsEmpty)
+{
+	const TemporaryDirectory directory;
+	const SidecarIndex index(directory.Path() / "missing");
+
+	CHECK(index.Count() == 0);
+	CHECK(index.Companions(directory.Path() / "missing" / "IMG_1.JPG").empty());
+}
+
+TEST(RawFilesAreKnownByExtension)
+{
+	CHECK(IsRawFile("/photos/IMG_1.CR3"));
+	CHECK(IsRawFile("/photos/img_1.braw"));
+	CHECK(IsRawFile("/photos/DSC_0001.nef"));
+	CHECK(!IsRawFile("/photos/IMG_1.JPG"));
+	CHECK(!IsRawFile("/photos/IMG_1.CR2.xmp"));
+	CHECK(!IsRawFile("/photos/CR2"));
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "PCH.hpp"
+#include "Swizzle.hpp"
+#include "Timing.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	const char* Name(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::Avx2:
+			return "avx2";
+		case SimdLevel::Sse2:
+			return "sse2";
+		default:
+			return "scalar";
+		}
+	}
+
+	// The best of a few uploads of the whole frame, row by row as Upload does
+	double Seconds(PixelFormat format, SimdLevel level, uint32_t width, uint32_t height, size_t repeats)
+	{
+		const Image source(width, height, format);
+		std::vector<uint8_t> target(size_t(width) * 4);
+		double best = std::numeric_limits<double>::max();
+
+		for (size_t repeat = 0; repeat < repeats; ++repeat)
+		{
+			const auto start = Clock::now();
+
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				ExpandToBgr32(format, source.Pixels().data() + size_t(y) * source.Stride(), target.data(), width, level);
+				KeepAlive(target);
+			}
+
+			best = std::min(best, SecondsSince(start));
+		}
+
+		return best;
+	}
+}
+
+// Expands a 24 megapixel frame to 32 bits per pixel with each kernel
+int main(int argc, char** argv)
+{
+	const uint32_t width = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 6000;
+	const uint32_t height = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 4000;
+	const size_t repeats = argc > 3 ? std::stoul(argv[3]) : 5;
+
+	std::vector<SimdLevel> levels = { SimdLevel::Scalar, SimdLevel::Sse2 };
+
+	if (DetectSimdLevel() == SimdLevel::Avx2)
+	{
+		levels.push_back(SimdLevel::Avx2);
+	}
+
+	const double pixels = double(width) * height;
+
+	std::printf("{\n\t\"width\": %u,\n\t\"height\": %u,\n\t\"detected\": \"%s\",\n\t\"results\": [", width, height, Name(DetectSimdLevel()));
+
+	const char* separator = "";
+
+	for (PixelFormat format : { PixelFormat::Bgr24, PixelFormat::Gray8 })
+	{
+		const double scalar = Seconds(format, SimdLevel::Scalar, width, height, repeats);
+
+		for (SimdLevel level : levels)
+		{
+			const double seconds = level == SimdLevel::Scalar ? scalar : Seconds(format, level, width, height, repeats);
+
+			std::printf(
+				"%s\n\t\t{\"format\": \"%s\", \"kernel\": \"%s\", \"ms\": %.2f, \"megapixelsPerSecond\": %.0f, \"speedup\": %.2f}",
+				separator,
+				format == PixelFormat::Bgr24 ? "bgr24" : "gray8",
+				Name(level),
+				seconds * 1000.0,
+				pixels / seconds / 1e6,
+				scalar / seconds);
+
+			separator = ",";
+		}
+	}
+
+	std::printf("\n\t]\n}\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "Swizzle.hpp"
+#include <numeric>
+
+using namespace PictureBrowser;
+
+namespace
+{
+	constexpr uint8_t Guard = 0xCD;
+
+	std::vector<SimdLevel> Levels()
+	{
+		std::vector<SimdLevel> levels = { SimdLevel::Scalar, SimdLevel::Sse2 };
+
+		if (DetectSimdLevel() == SimdLevel::Avx2)
+		{
+			levels.push_back(SimdLevel::Avx2);
+		}
+
+		return levels;
+	}
+
+	// Written out pixel by pixel, independent of the kernels
+	uint32_t Expected(PixelFormat format, const uint8_t* source, size_t i)
+	{
+		if (format == PixelFormat::Gray8)
+		{
+			return 0xFF000000u | source[i] << 16 | source[i] << 8 | source[i];
+		}
+
+		return 0xFF000000u | source[i * 3 + 2] << 16 | source[i * 3 + 1] << 8 | source[i * 3];
+	}
+
+	// Every length up to a few vectors and some odd ones past them, at every offset within a vector,
+	// into a target with guard bytes on both sides. Returns the number of wrong pixels and guard bytes.
+	size_t Mismatches(PixelFormat format, SimdLevel level)
+	{
+		const size_t bytesPerPixel = BytesPerPixel(format);
+
+		std::vector<size_t> lengths;
+
+		for (size_t pixels = 0; pixels <= 67; ++pixels)
+		{
+			lengths.push_back(pixels);
+		}
+
+		lengths.insert(lengths.end(), { 127, 255, 1001, 4097 });
+
+		size_t mismatches = 0;
+
+		for (size_t pixels : lengths)
+		{
+			for (size_t sourceOffset = 0; sourceOffset < 32; sourceOffset += 3)
+			{
+				for (size_t targetOffset = 0; targetOffset < 32; targetOffset += 5)
+				{
+					std::vector<uint8_t> source(sourceOffset + pixels * bytesPerPixel);
+
+					for (size_t i = 0; i < source.size(); ++i)
+					{
+						source[i] = static_cast<uint8_t>(i * 37 + pixels);
+					}
+
+					std::vector<uint8_t> target(targetOffset + pixels * 4 + 64, Guard);
+					const uint8_t* input = source.data() + sourceOffset;
+					uint8_t* output = target.data() + targetOffset;
+
+					ExpandToBgr32(format, input, output, pixels, level);
+
+					for (size_t i = 0; i < pixels; ++i)
+					{
+						uint32_t value = 0;
+						std::memcpy(&value, output + i * 4, 4);
+						mismatches += value != Expected(format, input, i);
+					}
+
+					for (size_t i = 0; i < targetOffset; ++i)
+					{
+						mismatches += target[i] != Guard;
+					}
+
+					for (size_t i = targetOffset + pixels * 4; i < target.size(); ++i)
+					{
+						mismatches += target[i] != Guard;
+					}
+				}
+			}
+		}
+
+		return mismatches;
+	}
+}
+
+TEST(Bgr24MatchesTheReferenceAtEveryLevel)
+{
+	for (SimdLevel level : Levels())
+	{
+		CHECK(Mismatches(PixelFormat::Bgr24, level) == 0);
+	}
+}
+
+TEST(Gray8MatchesTheReferenceAtEveryLevel)
+{
+	for (SimdLevel level : Levels())
+	{
+		CHECK(Mismatches(PixelFormat::Gray8, level) == 0);
+	}
+}
+
+TEST(Bgr32IsCopied)
+{
+	std::vector<uint8_t> source(4 * 13);
+	std::iota(source.begin(), source.end(), uint8_t(1));
+
+	std::vector<uint8_t> target(source.size());
+	ExpandToBgr32(PixelFormat::Bgr32, source.data(), target.data(), 13);
+
+	CHECK(target == source);
+}
+
+TEST(DetectionIsStable)
+{
+	const SimdLevel level = DetectSimdLevel();
+
+	CHECK(level == SimdLevel::Sse2 || level == SimdLevel::Avx2);
+	CHECK(DetectSimdLevel() == level);
+}
\ No newline at end of file
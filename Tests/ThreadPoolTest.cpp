@@ -0,0 +1,220 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "ThreadPool.hpp"
+
+using namespace PictureBrowser;
+using namespace PictureBrowser::Tests;
+
+namespace
+{
+	// Holds a worker in a job until opened, so that what is submitted meanwhile stays queued
+	class Gate
+	{
+	public:
+		explicit Gate(ThreadPool& pool)
+		{
+			std::promise<void> started;
+
+			pool.Submit([&started, opened = _open.get_future().share()]()
+			{
+				started.set_value();
+				opened.wait();
+			}, Priority::Visible);
+
+			started.get_future().wait();
+		}
+
+		~Gate()
+		{
+			Open();
+		}
+
+		void Open()
+		{
+			if (!_opened)
+			{
+				_opened = true;
+				_open.set_value();
+			}
+		}
+
+	private:
+		std::promise<void> _open;
+		bool _opened = false;
+	};
+
+	// Waits for the jobs of a pool to be done without joining it
+	void Drain(ThreadPool& pool)
+	{
+		std::promise<void> done;
+		pool.Submit([&done]() { done.set_value(); }, Priority::Background);
+		done.get_future().wait();
+	}
+}
+
+TEST(HigherClassesRunFirstVisibleNewestFirst)
+{
+	ThreadPool pool(1);
+	std::vector<char> order;
+
+	{
+		Gate gate(pool);
+
+		for (auto [name, priority] : std::initializer_list<std::pair<char, Priority>>{
+			{ 'a', Priority::Background },
+			{ 'b', Priority::Prefetch },
+			{ 'c', Priority::Visible },
+			{ 'd', Priority::Prefetch },
+			{ 'e', Priority::Visible } })
+		{
+			pool.Submit([&order, name]() { order.push_back(name); }, priority);
+		}
+
+		const ThreadPool::Stats stats = pool.Statistics();
+		CHECK(stats.Queued[size_t(Priority::Visible)] == 2);
+		CHECK(stats.Queued[size_t(Priority::Prefetch)] == 2);
+		CHECK(stats.Queued[size_t(Priority::Background)] == 1);
+		CHECK(pool.Pending() == 5);
+	}
+
+	Drain(pool);
+	CHECK((order == std::vector<char>{ 'e', 'c', 'b', 'd', 'a' }));
+	CHECK(pool.Pending() == 0);
+}
+
+TEST(CancelledJobsAreDroppedWithWhatTheyCaptured)
+{
+	ThreadPool pool(1);
+	auto captured = std::make_shared<int>(0);
+	std::stop_source cancel;
+	bool ran = false;
+
+	{
+		Gate gate(pool);
+		pool.Submit([captured, &ran]() { ran = true; }, Priority::Prefetch, cancel.get_token());
+		cancel.request_stop();
+	}
+
+	Drain(pool);
+	CHECK(!ran);
+	CHECK(captured.use_count() == 1);
+	CHECK(pool.Statistics().Cancelled == 1);
+}
+
+TEST(FullPoolHoldsBackTheSubmitter)
+{
+	ThreadPool pool(1, nullptr, nullptr, 2);
+	std::atomic<size_t> done = 0;
+	std::atomic<bool> submitted = false;
+
+	Gate gate(pool);
+	pool.Submit([&done]() { ++done; }, Priority::Prefetch);
+	pool.Submit([&done]() { ++done; }, Priority::Prefetch);
+
+	std::jthread submitter([&]()
+	{
+		pool.Submit([&done]() { ++done; }, Priority::Prefetch);
+		submitted = true;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(!submitted);
+	CHECK(pool.Pending() == 2);
+
+	gate.Open();
+	submitter.join();
+	CHECK(submitted);
+
+	Drain(pool);
+	CHECK(done == 3);
+	CHECK(pool.Statistics().HighWaterQueued == 2);
+}
+
+TEST(IdleWorkersStealFromBusyOnes)
+{
+	ThreadPool pool(2);
+	constexpr size_t Jobs = 100;
+	std::atomic<size_t> done = 0;
+	std::promise<void> all;
+
+	// Queued to the worker which submits them, which is busy until the other one has run them all
+	pool.Submit([&]()
+	{
+		for (size_t i = 0; i < Jobs; ++i)
+		{
+			pool.Submit([&]()
+			{
+				if (++done == Jobs)
+				{
+					all.set_value();
+				}
+			}, Priority::Prefetch);
+		}
+
+		all.get_future().wait();
+	}, Priority::Visible);
+
+	Drain(pool);
+	CHECK(done == Jobs);
+	CHECK(pool.Statistics().Steals >= Jobs);
+}
+
+TEST(ThrowingJobsLeaveTheWorkerRunning)
+{
+	ThreadPool pool(1);
+	bool ran = false;
+
+	pool.Submit([]() { throw std::runtime_error("Job"); }, Priority::Visible);
+	pool.Submit([]() { throw 42; }, Priority::Visible);
+	pool.Submit([&ran]() { ran = true; }, Priority::Prefetch);
+
+	Drain(pool);
+	CHECK(ran);
+}
+
+TEST(HooksRunOnEachWorker)
+{
+	std::atomic<size_t> started = 0;
+	std::atomic<size_t> stopped = 0;
+
+	{
+		ThreadPool pool(3, [&started]() { ++started; }, [&stopped]() { ++stopped; });
+		Drain(pool);
+	}
+
+	CHECK(started == 3);
+	CHECK(stopped == 3);
+}
+
+TEST(DestroyingThePoolDropsWhatWasNotStarted)
+{
+	auto captured = std::make_shared<int>(0);
+	bool ran = false;
+
+	std::promise<void> open;
+	std::jthread opener;
+
+	{
+		ThreadPool pool(1);
+		std::promise<void> started;
+
+		pool.Submit([&started, opened = open.get_future().share()]()
+		{
+			started.set_value();
+			opened.wait();
+		}, Priority::Visible);
+
+		started.get_future().wait();
+		pool.Submit([captured, &ran]() { ran = true; }, Priority::Prefetch);
+
+		// Lets the worker go once the destructor has asked it to stop
+		opener = std::jthread([&open]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			open.set_value();
+		});
+	}
+
+	CHECK(!ran);
+	CHECK(captured.use_count() == 1);
+}
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "PCH.hpp"
+#include "Check.hpp"
+#include "TilePyramid.hpp"
+
+using namespace PictureBrowser;
+
+namespace
+{
+	constexpr uint32_t Tile = TilePyramid::TileSize;
+
+	// Gray pixels whose value follows from where they are
+	Image Gradient(uint32_t width, uint32_t height)
+	{
+		Image image(width, height, PixelFormat::Gray8);
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				image.Pixels()[size_t(y) * image.Stride() + x] = static_cast<uint8_t>(x * 7 + y * 13);
+			}
+		}
+
+		return image;
+	}
+
+	uint8_t At(const Image& image, uint32_t x, uint32_t y)
+	{
+		return image.Pixels()[size_t(y) * image.Stride() + size_t(x) * BytesPerPixel(image.Format())];
+	}
+}
+
+TEST(TileKeysHashApart)
+{
+	std::unordered_set<size_t> hashes;
+	size_t keys = 0;
+
+	for (uint32_t level = 0; level < 6; ++level)
+	{
+		for (uint32_t row = 0; row < 64; ++row)
+		{
+			for (uint32_t column = 0; column < 64; ++column)
+			{
+				hashes.insert(TileKeyHash()({ level, column, row }));
+				++keys;
+			}
+		}
+	}
+
+	CHECK(hashes.size() == keys);
+	CHECK(TileKeyHash()({ 0, 1, 2 }) != TileKeyHash()({ 0, 2, 1 }));
+}
+
+TEST(OnlyVeryLargeImagesAreTiled)
+{
+	CHECK(!TilePyramid::Wanted(4096, 4096));
+	CHECK(!TilePyramid::Wanted(8192, 2048));
+	CHECK(TilePyramid::Wanted(8193, 16));
+	CHECK(TilePyramid::Wanted(4097, 4096));
+	CHECK(TilePyramid::Wanted(16384, 12288));
+}
+
+TEST(LevelsEndAtASingleTile)
+{
+	CHECK(TilePyramid(Tile, Tile).Levels() == 1);
+	CHECK(TilePyramid(Tile + 1, 10).Levels() == 2);
+	CHECK(TilePyramid(16384, 12288).Levels() == 6);
+}
+
+TEST(LevelKeepsAsManyPixelsAsDrawn)
+{
+	const TilePyramid pyramid(16384, 12288);
+
+	CHECK(pyramid.LevelFor(2.0f) == 0);
+	CHECK(pyramid.LevelFor(1.0f) == 0);
+	CHECK(pyramid.LevelFor(0.6f) == 0);
+	CHECK(pyramid.LevelFor(0.5f) == 1);
+	CHECK(pyramid.LevelFor(0.25f) == 2);
+	CHECK(pyramid.LevelFor(0.2f) == 2);
+	CHECK(pyramid.LevelFor(0.001f) == pyramid.Levels() - 1);
+}
+
+TEST(TilesCoverTheVisibleArea)
+{
+	const TilePyramid pyramid(3 * Tile + 100, 2 * Tile + 1);
+
+	const std::vector<TileKey> all = pyramid.Tiles(0, { 0.0f, 0.0f, 1e6f, 1e6f });
+	CHECK(all.size() == 4 * 3);
+	CHECK(std::ranges::count_if(all, [](const TileKey& key) { return key.Level == 0; }) == 12);
+
+	const std::vector<TileKey> inner = pyramid.Tiles(0, { Tile + 1.0f, 10.0f, 2 * Tile - 1.0f, 20.0f });
+	CHECK(inner.size() == 1);
+	CHECK(inner[0] == TileKey(0, 1, 0));
+
+	const std::vector<TileKey> straddling = pyramid.Tiles(0, { Tile - 1.0f, Tile - 1.0f, Tile + 1.0f, Tile + 1.0f });
+	CHECK(straddling.size() == 4);
+
+	const std::vector<TileKey> coarse = pyramid.Tiles(1, { 0.0f, 0.0f, 1e6f, 1e6f });
+	CHECK(coarse.size() == 2 * 2);
+
+	CHECK(pyramid.Tiles(0, { -100.0f, -100.0f, -1.0f, -1.0f }).empty());
+	CHECK(pyramid.Tiles(0, { 5000.0f, 0.0f, 6000.0f, 100.0f }).empty());
+}
+
+TEST(SourceRectStopsAtTheEdge)
+{
+	const TilePyramid pyramid(3 * Tile + 100, 2 * Tile + 1);
+
+	const D2D_RECT_F first = pyramid.SourceRect({ 0, 0, 0 });
+	CHECK(first.left == 0.0f && first.top == 0.0f && first.right == float(Tile) && first.bottom == float(Tile));
+
+	const D2D_RECT_F last = pyramid.SourceRect({ 0, 3, 2 });
+	CHECK(last.left == 3.0f * Tile && last.right == 3.0f * Tile + 100);
+	CHECK(last.top == 2.0f * Tile && last.bottom == 2.0f * Tile + 1);
+
+	const D2D_RECT_F coarse = pyramid.SourceRect({ 1, 1, 0 });
+	CHECK(coarse.left == 2.0f * Tile && coarse.right == 3.0f * Tile + 100);
+	CHECK(coarse.bottom == 2.0f * Tile);
+}
+
+TEST(FullResolutionTilesAreCopies)
+{
+	const Image source = Gradient(Tile + 37, Tile + 3);
+	const TilePyramid pyramid(source.Width(), source.Height());
+
+	const std::shared_ptr<Image> tile = pyramid.Cut(source, { 0, 1, 1 });
+	CHECK(tile->Width() == 37 && tile->Height() == 3);
+	CHECK(tile->Format() == PixelFormat::Gray8);
+
+	bool same = true;
+
+	for (uint32_t y = 0; y < tile->Height(); ++y)
+	{
+		for (uint32_t x = 0; x < tile->Width(); ++x)
+		{
+			same &= At(*tile, x, y) == At(source, Tile + x, Tile + y);
+		}
+	}
+
+	CHECK(same);
+}
+
+TEST(CoarseTilesAverageTheirBlocks)
+{
+	const Image source = Gradient(2 * Tile + 3, 9);
+	const TilePyramid pyramid(source.Width(), source.Height());
+
+	const std::shared_ptr<Image> tile = pyramid.Cut(source, { 1, 0, 0 });
+	CHECK(tile->Width() == Tile && tile->Height() == 5);
+
+	bool averaged = true;
+
+	for (uint32_t y = 0; y < 4; ++y)
+	{
+		for (uint32_t x = 0; x < 16; ++x)
+		{
+			const uint32_t sum = At(source, 2 * x, 2 * y) + At(source, 2 * x + 1, 2 * y) +
+				At(source, 2 * x, 2 * y + 1) + At(source, 2 * x + 1, 2 * y + 1);
+
+			averaged &= At(*tile, x, y) == sum / 4;
+		}
+	}
+
+	CHECK(averaged);
+
+	// The last row of blocks has only one source row left
+	CHECK(At(*tile, 0, 4) == (At(source, 0, 8) + At(source, 1, 8)) / 2);
+
+	// And the one tile to the right only three source columns
+	const std::shared_ptr<Image> edge = pyramid.Cut(source, { 1, 1, 0 });
+	CHECK(edge->Width() == 2 && edge->Height() == 5);
+	CHECK(At(*edge, 1, 0) == (At(source, 2 * Tile + 2, 0) + At(source, 2 * Tile + 2, 1)) / 2);
+}
+
+TEST(CutKeepsEveryChannel)
+{
+	Image source(Tile * 4, 8, PixelFormat::Bgr24);
+
+	for (size_t i = 0; i < source.Pixels().size(); i += 3)
+	{
+		source.Pixels()[i] = 10;
+		source.Pixels()[i + 1] = 20;
+		source.Pixels()[i + 2] = 30;
+	}
+
+	const TilePyramid pyramid(source.Width(), source.Height());
+	const std::shared_ptr<Image> tile = pyramid.Cut(source, { 2, 0, 0 });
+
+	CHECK(tile->Width() == Tile && tile->Height() == 2);
+	CHECK(tile->Format() == PixelFormat::Bgr24);
+
+	const uint8_t* pixel = tile->Pixels().data() + size_t(tile->Stride()) + size_t(Tile - 1) * 3;
+	CHECK(pixel[0] == 10 && pixel[1] == 20 && pixel[2] == 30);
+}
\ No newline at end of file
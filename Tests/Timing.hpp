@@ -0,0 +1,32 @@
+#pragma once
+
+namespace PictureBrowser::Tests
+{
+	using Clock = std::chrono::steady_clock;
+
+	inline double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// The sample below which the given share of them lie, sorts them on the way
+	inline double Percentile(std::vector<double>& samples, double share)
+	{
+		if (samples.empty())
+		{
+			return 0.0;
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		const size_t index = std::min(static_cast<size_t>(share * double(samples.size())), samples.size() - 1);
+		return samples[index];
+	}
+
+	// Keeps the optimizer from dropping work whose result is otherwise unused
+	template <typename T>
+	void KeepAlive(const T& value)
+	{
+		asm volatile("" : : "g"(&value) : "memory");
+	}
+}
\ No newline at end of file